@@ -0,0 +1,77 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+# Author(s):  David Cantrell <dcantrell@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+#
+# Compare two benchmark results files written by runbench.py, for
+# example from runs on two commits.  For every benchmark in both files
+# the median of a metric is compared, using the last result for each
+# benchmark and scale in a file.
+#
+#     compare.py [--metric METRIC] [--threshold PERCENT] OLD NEW
+#
+# Exits with 1 if any benchmark got slower by more than the threshold.
+#
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+
+    with open(path) as f:
+        for line in f:
+            if line.strip():
+                r = json.loads(line)
+                results[(r["benchmark"], r["scale"])] = r
+
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare rpminspect benchmark results")
+    parser.add_argument("--metric", default="wall time")
+    parser.add_argument("--threshold", type=float, default=10.0, help="percent change reported as a regression")
+    parser.add_argument("old")
+    parser.add_argument("new")
+    args = parser.parse_args()
+
+    old = load(args.old)
+    new = load(args.new)
+    regressions = 0
+
+    print("%-32s %-8s %12s %12s %8s" % ("benchmark", "scale", "old", "new", "change"))
+
+    for key in sorted(set(old.keys()) & set(new.keys())):
+        a = old[key]["metrics"][args.metric]["median"]
+        b = new[key]["metrics"][args.metric]["median"]
+        change = ((b - a) * 100.0 / a) if a else 0.0
+        flag = ""
+
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+
+        print("%-32s %-8s %12.6g %12.6g %+7.1f%%%s" % (key[0], key[1], a, b, change, flag))
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
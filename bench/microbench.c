@@ -0,0 +1,787 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <ftw.h>
+#include <search.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rpminspect.h"
+
+/**
+ * @file microbench.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Micro-benchmarks for the string, list, ignore, and checksum
+ *        functions in librpminspect.
+ *
+ * Every benchmark runs one function over the same generated input:
+ * paths, lists of paths, and files in a temporary directory, all made
+ * from a fixed seed so two runs on the same scale measure the same
+ * work.  A benchmark is run a few times to warm up and then timed
+ * for each repetition.  The minimum, median, 90th and 99th
+ * percentile, and maximum are reported per repetition and per call.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/* Same seed the corpus generator uses */
+#define BENCH_SEED 20200401
+
+#define DEFAULT_WARMUP 3
+#define DEFAULT_REPEAT 20
+
+/* Generated input shared by every benchmark */
+struct input {
+    size_t count;              /* number of paths */
+    char **paths;
+    string_list_t *before;     /* the paths */
+    string_list_t *after;      /* the paths with a few changed */
+    char **paragraphs;         /* text for printwrap() */
+    size_t nparagraphs;
+    struct rpminspect ri;      /* only ri.ignores is set */
+    char *tmpdir;              /* files for compute_checksum() */
+    char **files;
+    size_t nfiles;
+    FILE *devnull;
+};
+
+struct benchmark {
+    const char *name;
+    /* runs the function over the input once, returns the call count */
+    size_t (*run)(struct input *);
+};
+
+/* Keeps results from being optimized away */
+static volatile size_t sink = 0;
+
+static const char *scales[] = { "small", "medium", "large", NULL };
+static const size_t scale_counts[] = { 1000, 10000, 100000 };
+
+static const char *words[] = {
+    "usr", "lib", "lib64", "share", "bin", "sbin", "etc", "doc",
+    "include", "man", "man1", "locale", "python3.8", "site-packages",
+    "__pycache__", "kernel", "modules", "firmware", "java", "icons",
+    "hicolor", "applications", "systemd", "system", "pkgconfig",
+    "licenses", "foo", "bar", "baz", "qux", "plugins", "data",
+    NULL
+};
+
+static const char *suffixes[] = {
+    "", ".so", ".so.1", ".py", ".pyc", ".h", ".1.gz", ".xml", ".desktop",
+    ".jar", ".ko.xz", ".mo", ".conf", ".service", ".pc", ".txt",
+    NULL
+};
+
+static const char *prefixes[] = {
+    "/usr/lib", "/usr/lib64", "/usr/share/man", "/usr/share/doc",
+    "/usr/include", "/etc", "/usr/lib/modules", "/usr/share/locale",
+    NULL
+};
+
+static const char *ignores[] = {
+    "/usr/lib*/python?.?/site-packages/__pycache__",
+    "/usr/lib*/python?.?/site-packages/*/*.pyc",
+    "/usr/lib*/python?.?/site-packages/*/*.pyo",
+    "/usr/share/doc/*/{README,NEWS,ChangeLog}",
+    "/usr/lib/modules/*/{kernel,extra}/*.ko.xz",
+    "/usr/share/locale/*/LC_MESSAGES/*.mo",
+    "/usr/share/icons/*/*/apps/*.{png,svg}",
+    "/etc/*.conf",
+    NULL
+};
+
+/*
+ * xorshift64*, so the input does not depend on the C library's rand().
+ */
+static uint64_t rng_state = BENCH_SEED;
+
+static uint64_t next_random(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * UINT64_C(2685821657736338717);
+}
+
+static size_t random_below(const size_t n)
+{
+    return next_random() % n;
+}
+
+static size_t array_len(const char **a)
+{
+    size_t n = 0;
+
+    while (a[n] != NULL) {
+        n++;
+    }
+
+    return n;
+}
+
+static char *random_path(void)
+{
+    char *path = NULL;
+    size_t depth = 2 + random_below(6);
+    size_t i = 0;
+
+    path = strdup("");
+    assert(path != NULL);
+
+    for (i = 0; i < depth; i++) {
+        path = strappend(path, "/");
+        path = strappend(path, words[random_below(array_len(words))]);
+    }
+
+    path = strappend(path, suffixes[random_below(array_len(suffixes))]);
+    return path;
+}
+
+static string_list_t *new_list(void)
+{
+    string_list_t *list = NULL;
+
+    list = calloc(1, sizeof(*list));
+    assert(list != NULL);
+    TAILQ_INIT(list);
+    return list;
+}
+
+static void list_add(string_list_t *list, const char *s)
+{
+    string_entry_t *entry = NULL;
+
+    entry = calloc(1, sizeof(*entry));
+    assert(entry != NULL);
+    entry->data = strdup(s);
+    assert(entry->data != NULL);
+    TAILQ_INSERT_TAIL(list, entry, items);
+    return;
+}
+
+static void make_files(struct input *in)
+{
+    char tmpl[] = "/tmp/microbench.XXXXXX";
+    unsigned char buf[BUFSIZ];
+    size_t size = 0;
+    size_t i = 0;
+    size_t j = 0;
+    FILE *fp = NULL;
+
+    if (mkdtemp(tmpl) == NULL) {
+        fprintf(stderr, _("*** Unable to create a temporary directory: %s\n"), strerror(errno));
+        fflush(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    in->tmpdir = strdup(tmpl);
+    assert(in->tmpdir != NULL);
+
+    /* one file for every 100 paths, each 1 to 32 BUFSIZ blocks */
+    in->nfiles = (in->count / 100) + 1;
+    in->files = calloc(in->nfiles, sizeof(*in->files));
+    assert(in->files != NULL);
+
+    for (i = 0; i < in->nfiles; i++) {
+        xasprintf(&in->files[i], "%s/file%zu", in->tmpdir, i);
+        fp = fopen(in->files[i], "w");
+
+        if (fp == NULL) {
+            fprintf(stderr, _("*** Error opening %s for writing: %s\n"), in->files[i], strerror(errno));
+            fflush(stderr);
+            exit(EXIT_FAILURE);
+        }
+
+        for (size = 1 + random_below(32); size > 0; size--) {
+            for (j = 0; j < sizeof(buf); j++) {
+                buf[j] = next_random() & 0xff;
+            }
+
+            if (fwrite(buf, sizeof(buf[0]), sizeof(buf), fp) != sizeof(buf)) {
+                fprintf(stderr, _("*** Error writing %s: %s\n"), in->files[i], strerror(errno));
+                fflush(stderr);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        fclose(fp);
+    }
+
+    return;
+}
+
+static void make_input(struct input *in, const size_t count)
+{
+    size_t i = 0;
+    size_t j = 0;
+    char *p = NULL;
+
+    memset(in, 0, sizeof(*in));
+    in->count = count;
+    rng_state = BENCH_SEED;
+
+    /* paths, and the same paths with about 5% changed */
+    in->paths = calloc(count, sizeof(*in->paths));
+    assert(in->paths != NULL);
+    in->before = new_list();
+    in->after = new_list();
+
+    for (i = 0; i < count; i++) {
+        in->paths[i] = random_path();
+        list_add(in->before, in->paths[i]);
+
+        if (random_below(20) == 0) {
+            p = random_path();
+            list_add(in->after, p);
+            free(p);
+        } else {
+            list_add(in->after, in->paths[i]);
+        }
+    }
+
+    /* paragraphs of 20 to 100 words, one for every 10 paths */
+    in->nparagraphs = (count / 10) + 1;
+    in->paragraphs = calloc(in->nparagraphs, sizeof(*in->paragraphs));
+    assert(in->paragraphs != NULL);
+
+    for (i = 0; i < in->nparagraphs; i++) {
+        in->paragraphs[i] = strdup("");
+        assert(in->paragraphs[i] != NULL);
+
+        for (j = 20 + random_below(81); j > 0; j--) {
+            in->paragraphs[i] = strappend(in->paragraphs[i], words[random_below(array_len(words))]);
+            in->paragraphs[i] = strappend(in->paragraphs[i], (j > 1) ? " " : "");
+        }
+    }
+
+    /* ignore patterns */
+    in->ri.ignores = new_list();
+
+    for (i = 0; ignores[i] != NULL; i++) {
+        list_add(in->ri.ignores, ignores[i]);
+    }
+
+    make_files(in);
+
+    in->devnull = fopen("/dev/null", "w");
+    assert(in->devnull != NULL);
+    return;
+}
+
+static int remove_entry(const char *fpath, __attribute__((unused)) const struct stat *sb,
+                        __attribute__((unused)) int typeflag, __attribute__((unused)) struct FTW *ftwbuf)
+{
+    return remove(fpath);
+}
+
+static void free_input(struct input *in)
+{
+    size_t i = 0;
+
+    for (i = 0; i < in->count; i++) {
+        free(in->paths[i]);
+    }
+
+    for (i = 0; i < in->nparagraphs; i++) {
+        free(in->paragraphs[i]);
+    }
+
+    for (i = 0; i < in->nfiles; i++) {
+        free(in->files[i]);
+    }
+
+    free(in->paths);
+    free(in->paragraphs);
+    free(in->files);
+    list_free(in->before, free);
+    list_free(in->after, free);
+    list_free(in->ri.ignores, free);
+    nftw(in->tmpdir, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+    free(in->tmpdir);
+    fclose(in->devnull);
+    return;
+}
+
+/*
+ * The benchmarks.
+ */
+static size_t bench_strreplace(struct input *in)
+{
+    size_t i = 0;
+    char *s = NULL;
+
+    for (i = 0; i < in->count; i++) {
+        s = strreplace(in->paths[i], "/usr/lib", "/usr/lib64");
+        sink += strlen(s);
+        free(s);
+    }
+
+    return in->count;
+}
+
+static size_t bench_strsplit(struct input *in)
+{
+    size_t i = 0;
+    string_list_t *list = NULL;
+
+    for (i = 0; i < in->count; i++) {
+        list = strsplit(in->paths[i], "/");
+        sink += list_len(list);
+        list_free(list, free);
+    }
+
+    return in->count;
+}
+
+static size_t bench_strprefix(struct input *in)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < in->count; i++) {
+        for (j = 0; prefixes[j] != NULL; j++) {
+            sink += strprefix(in->paths[i], prefixes[j]);
+        }
+    }
+
+    return in->count * j;
+}
+
+static size_t bench_strsuffix(struct input *in)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < in->count; i++) {
+        for (j = 0; suffixes[j] != NULL; j++) {
+            sink += strsuffix(in->paths[i], suffixes[j]);
+        }
+    }
+
+    return in->count * j;
+}
+
+static size_t bench_printwrap(struct input *in)
+{
+    size_t i = 0;
+
+    for (i = 0; i < in->nparagraphs; i++) {
+        sink += printwrap(in->paragraphs[i], 80, 4, in->devnull);
+    }
+
+    return in->nparagraphs;
+}
+
+static size_t bench_list_sort(struct input *in)
+{
+    string_list_t *sorted = NULL;
+
+    sorted = list_sort(in->before);
+    sink += list_len(sorted);
+    list_free(sorted, NULL);
+    return 1;
+}
+
+static size_t bench_list_difference(struct input *in)
+{
+    string_list_t *diff = NULL;
+
+    diff = list_difference(in->before, in->after);
+    sink += list_len(diff);
+    list_free(diff, NULL);
+    return 1;
+}
+
+static size_t bench_list_union(struct input *in)
+{
+    string_list_t *u = NULL;
+
+    u = list_union(in->before, in->after);
+    sink += list_len(u);
+    list_free(u, NULL);
+    return 1;
+}
+
+static size_t bench_list_to_table(struct input *in)
+{
+    struct hsearch_data *table = NULL;
+
+    table = list_to_table(in->before);
+    assert(table != NULL);
+    hdestroy_r(table);
+    free(table);
+    return 1;
+}
+
+static size_t bench_ignore_path(struct input *in)
+{
+    size_t i = 0;
+
+    for (i = 0; i < in->count; i++) {
+        sink += ignore_path(&in->ri, in->paths[i]);
+    }
+
+    return in->count;
+}
+
+static size_t checksum_files(struct input *in, const enum checksum type)
+{
+    size_t i = 0;
+    char *sum = NULL;
+
+    for (i = 0; i < in->nfiles; i++) {
+        sum = compute_checksum(in->files[i], NULL, type);
+        assert(sum != NULL);
+        sink += strlen(sum);
+        free(sum);
+    }
+
+    return in->nfiles;
+}
+
+static size_t bench_md5(struct input *in)
+{
+    return checksum_files(in, MD5SUM);
+}
+
+static size_t bench_sha1(struct input *in)
+{
+    return checksum_files(in, SHA1SUM);
+}
+
+static size_t bench_sha256(struct input *in)
+{
+    return checksum_files(in, SHA256SUM);
+}
+
+static struct benchmark benchmarks[] = {
+    { "strreplace", bench_strreplace },
+    { "strsplit", bench_strsplit },
+    { "strprefix", bench_strprefix },
+    { "strsuffix", bench_strsuffix },
+    { "printwrap", bench_printwrap },
+    { "list_sort", bench_list_sort },
+    { "list_difference", bench_list_difference },
+    { "list_union", bench_list_union },
+    { "list_to_table", bench_list_to_table },
+    { "ignore_path", bench_ignore_path },
+    { "checksum_md5", bench_md5 },
+    { "checksum_sha1", bench_sha1 },
+    { "checksum_sha256", bench_sha256 },
+    { NULL, NULL }
+};
+
+/*
+ * Timing and reporting.
+ */
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile of sorted samples */
+static double percentile(const double *sorted, const size_t n, const unsigned int pct)
+{
+    size_t rank = ((pct * n) + 99) / 100;
+
+    return sorted[(rank == 0) ? 0 : rank - 1];
+}
+
+static double median(const double *sorted, const size_t n)
+{
+    if (n % 2) {
+        return sorted[n / 2];
+    }
+
+    return (sorted[(n / 2) - 1] + sorted[n / 2]) / 2.0;
+}
+
+static void write_metric(FILE *fp, const char *name, const double *samples, const size_t n, const double scale)
+{
+    double *sorted = NULL;
+    size_t i = 0;
+
+    sorted = calloc(n, sizeof(*sorted));
+    assert(sorted != NULL);
+
+    for (i = 0; i < n; i++) {
+        sorted[i] = samples[i] * scale;
+    }
+
+    qsort(sorted, n, sizeof(*sorted), compare_doubles);
+    fprintf(fp, "\"%s\": {\"min\": %.9g, \"median\": %.9g, \"p90\": %.9g, \"p99\": %.9g, \"max\": %.9g, \"samples\": [",
+            name, sorted[0], median(sorted, n), percentile(sorted, n, 90), percentile(sorted, n, 99), sorted[n - 1]);
+
+    for (i = 0; i < n; i++) {
+        fprintf(fp, "%s%.9g", (i > 0) ? ", " : "", samples[i] * scale);
+    }
+
+    fprintf(fp, "]}");
+    free(sorted);
+    return;
+}
+
+/*
+ * One JSON object per line, in the same form runbench.py writes, so
+ * compare.py can compare these results too.
+ */
+static void write_result(FILE *fp, const char *name, const char *scale, const size_t calls,
+                         const double *samples, const size_t repeat)
+{
+    char host[HOST_NAME_MAX + 1];
+
+    if (gethostname(host, sizeof(host)) != 0) {
+        strcpy(host, "unknown");
+    }
+
+    host[sizeof(host) - 1] = '\0';
+
+    fprintf(fp, "{\"benchmark\": \"micro.%s\", \"case\": \"micro\", \"scale\": \"%s\", \"target\": \"function %s\", ",
+            name, scale, name);
+    fprintf(fp, "\"repeat\": %zu, \"calls\": %zu, \"seed\": %d, \"host\": \"%s\", \"time\": %lld, \"metrics\": {",
+            repeat, calls, BENCH_SEED, host, (long long) time(NULL));
+    write_metric(fp, "wall time", samples, repeat, 1.0);
+    fprintf(fp, ", ");
+    write_metric(fp, "time per call", samples, repeat, 1000000000.0 / calls);
+    fprintf(fp, "}}\n");
+    return;
+}
+
+static void print_row(const char *name, const size_t calls, const double *samples, const size_t repeat)
+{
+    double *sorted = NULL;
+    double ns = 1000000000.0 / calls;
+    size_t i = 0;
+
+    sorted = calloc(repeat, sizeof(*sorted));
+    assert(sorted != NULL);
+
+    for (i = 0; i < repeat; i++) {
+        sorted[i] = samples[i] * ns;
+    }
+
+    qsort(sorted, repeat, sizeof(*sorted), compare_doubles);
+    printf("%-18s %10zu %12.1f %12.1f %12.1f %12.1f %12.1f\n", name, calls,
+           sorted[0], median(sorted, repeat), percentile(sorted, repeat, 90),
+           percentile(sorted, repeat, 99), sorted[repeat - 1]);
+    free(sorted);
+    return;
+}
+
+static void usage(const char *progname)
+{
+    int i = 0;
+
+    printf(_("Usage: %s [OPTIONS] [BENCHMARK...]\n"), progname);
+    printf(_("Run micro-benchmarks of librpminspect functions.\n\n"));
+    printf(_("Options:\n"));
+    printf(_("  -s, --scale=SCALE     Input size: small, medium, or large (default: small)\n"));
+    printf(_("  -w, --warmup=N        Untimed runs before measuring (default: %d)\n"), DEFAULT_WARMUP);
+    printf(_("  -r, --repeat=N        Timed runs of each benchmark (default: %d)\n"), DEFAULT_REPEAT);
+    printf(_("  -o, --output=FILE     Append results to FILE as JSON lines\n"));
+    printf(_("  -l, --list            List the benchmarks and exit\n"));
+    printf(_("  -h, --help            Display usage information\n\n"));
+    printf(_("Times are nanoseconds per call.  Benchmarks:\n"));
+
+    for (i = 0; benchmarks[i].name != NULL; i++) {
+        printf("  %s\n", benchmarks[i].name);
+    }
+
+    return;
+}
+
+static bool selected(const char *name, int argc, char **argv)
+{
+    int i = 0;
+
+    if (optind >= argc) {
+        return true;
+    }
+
+    for (i = optind; i < argc; i++) {
+        if (!strcmp(argv[i], name)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    int c = 0;
+    int idx = 0;
+    int i = 0;
+    int scale = 0;
+    size_t warmup = DEFAULT_WARMUP;
+    size_t repeat = DEFAULT_REPEAT;
+    size_t calls = 0;
+    size_t n = 0;
+    double start = 0;
+    double *samples = NULL;
+    char *output = NULL;
+    FILE *fp = NULL;
+    struct input in;
+    const char *short_options = "s:w:r:o:lh";
+    struct option long_options[] = {
+        { "scale", required_argument, 0, 's' },
+        { "warmup", required_argument, 0, 'w' },
+        { "repeat", required_argument, 0, 'r' },
+        { "output", required_argument, 0, 'o' },
+        { "list", no_argument, 0, 'l' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    while (1) {
+        c = getopt_long(argc, argv, short_options, long_options, &idx);
+
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+            case 's':
+                for (scale = 0; scales[scale] != NULL; scale++) {
+                    if (!strcmp(optarg, scales[scale])) {
+                        break;
+                    }
+                }
+
+                if (scales[scale] == NULL) {
+                    fprintf(stderr, _("*** Unknown scale: %s\n"), optarg);
+                    fflush(stderr);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            case 'w':
+                warmup = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                repeat = strtoul(optarg, NULL, 10);
+
+                if (repeat == 0) {
+                    fprintf(stderr, _("*** Invalid repeat count: %s\n"), optarg);
+                    fflush(stderr);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'l':
+                for (i = 0; benchmarks[i].name != NULL; i++) {
+                    printf("%s\n", benchmarks[i].name);
+                }
+
+                return EXIT_SUCCESS;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    for (i = optind; i < argc; i++) {
+        for (idx = 0; benchmarks[idx].name != NULL; idx++) {
+            if (!strcmp(argv[i], benchmarks[idx].name)) {
+                break;
+            }
+        }
+
+        if (benchmarks[idx].name == NULL) {
+            fprintf(stderr, _("*** Unknown benchmark: %s\n"), argv[i]);
+            fflush(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (output != NULL) {
+        fp = fopen(output, "a");
+
+        if (fp == NULL) {
+            fprintf(stderr, _("*** Error opening %s for writing: %s\n"), output, strerror(errno));
+            fflush(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    make_input(&in, scale_counts[scale]);
+    samples = calloc(repeat, sizeof(*samples));
+    assert(samples != NULL);
+
+    printf(_("scale %s (%zu paths, %zu files), seed %d, %zu warm up and %zu timed runs\n\n"),
+           scales[scale], in.count, in.nfiles, BENCH_SEED, warmup, repeat);
+    printf("%-18s %10s %12s %12s %12s %12s %12s\n", _("benchmark"), _("calls"),
+           _("min"), _("median"), _("p90"), _("p99"), _("max"));
+
+    for (i = 0; benchmarks[i].name != NULL; i++) {
+        if (!selected(benchmarks[i].name, argc, argv)) {
+            continue;
+        }
+
+        for (n = 0; n < warmup; n++) {
+            benchmarks[i].run(&in);
+        }
+
+        for (n = 0; n < repeat; n++) {
+            start = now_seconds();
+            calls = benchmarks[i].run(&in);
+            samples[n] = now_seconds() - start;
+        }
+
+        print_row(benchmarks[i].name, calls, samples, repeat);
+
+        if (fp != NULL) {
+            write_result(fp, benchmarks[i].name, scales[scale], calls, samples, repeat);
+        }
+    }
+
+    if (fp != NULL) {
+        fclose(fp);
+    }
+
+    free(samples);
+    free_input(&in);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,395 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+# Author(s):  David Cantrell <dcantrell@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+#
+# Generate synthetic before and after builds for the benchmark suite.
+#
+# Each case is one package built twice with rpmfluff.  The payload is
+# generated from a fixed seed, so the same case and scale always give
+# the same files.  The after build changes, removes, and adds a few
+# percent of the files so the comparison inspections have work to do.
+#
+# The builds are written to CORPUS/CASE-SCALE/before and .../after,
+# which rpminspect reads as local builds.  An existing case directory
+# is reused.
+#
+#     mkcorpus.py [--corpus DIR] [--scale SCALE] CASE...
+#
+
+import argparse
+import glob
+import gzip
+import io
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import tarfile
+import tempfile
+import zipfile
+
+NAME = "benchware"
+BEFORE_VER = "1.0"
+AFTER_VER = "1.1"
+SEED = 20200401
+
+# Exit code meson reads as a skipped test or benchmark
+SKIP = 77
+
+# Multiplier applied to every count below
+SCALES = {"small": 1, "medium": 10, "large": 100}
+
+# Per case counts at scale 1
+COUNTS = {
+    "files": 200,       # text, XML, and shell files plus symlinks
+    "elf": 5,           # executables
+    "jar": 5,           # jar files, JAR_CLASSES classes each
+    "kmod": 5,          # kernel modules
+    "manpage": 50,      # compressed man pages
+    "deep": 200,        # files DEEP_LEVELS directories down
+    "renamed": 200,     # files under versioned directory names
+}
+
+JAR_CLASSES = 20
+DEEP_LEVELS = 24
+
+# Fraction of files changed, removed, and added in the after build
+CHANGED = 0.10
+REMOVED = 0.05
+ADDED = 0.05
+
+ELF_SRC = """#include <stdio.h>
+int main(void) { printf("benchware %d\\n", VARIANT); return 0; }
+"""
+
+
+class Skip(Exception):
+    pass
+
+
+def text(rng, lines):
+    words = ["alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel"]
+    return "".join(" ".join(rng.choice(words) for _ in range(8)) + "\n" for _ in range(lines))
+
+
+def plan(rng, paths):
+    """
+    Split a list of payload paths in to those kept as is, those whose
+    content changes in the after build, and those only in the before
+    build, then make up the new after build paths.
+    """
+    paths = list(paths)
+    rng.shuffle(paths)
+    nchanged = int(len(paths) * CHANGED)
+    nremoved = int(len(paths) * REMOVED)
+    nadded = int(len(paths) * ADDED)
+    changed = set(paths[:nchanged])
+    removed = set(paths[nchanged:nchanged + nremoved])
+    added = ["%s.new%d" % (paths[i % len(paths)], i) for i in range(nadded)]
+    return (changed, removed, added)
+
+
+def files_payload(rng, count, version):
+    """Plain files of a few kinds in a few directories, and symlinks."""
+    payload = {}
+
+    for i in range(count):
+        kind = i % 10
+
+        if kind == 0:
+            payload["/usr/share/%s/data/file%05d.xml" % (NAME, i)] = "<?xml version=\"1.0\"?>\n<file n=\"%d\">%s</file>\n" % (i, text(rng, 2))
+        elif kind == 1:
+            payload["/usr/libexec/%s/script%05d.sh" % (NAME, i)] = "#!/bin/sh\necho %d\n" % i
+        else:
+            payload["/usr/share/%s/data/file%05d.txt" % (NAME, i)] = text(rng, 4)
+
+    return payload
+
+
+def elf_payload(rng, count, version, workdir):
+    """Executables built with the flags a distribution would use."""
+    payload = {}
+    src = os.path.join(workdir, "elf.c")
+
+    with open(src, "w") as f:
+        f.write(ELF_SRC)
+
+    for i in range(count):
+        exe = os.path.join(workdir, "elf%d" % i)
+        cmd = ["cc", "-O2", "-g", "-fPIE", "-pie", "-Wl,-z,relro,-z,now",
+               "-D_FORTIFY_SOURCE=2", "-fstack-protector-strong", "-DVARIANT=%d" % i,
+               "-o", exe, src]
+
+        if subprocess.call(cmd) != 0:
+            raise Skip("unable to compile ELF objects")
+
+        with open(exe, "rb") as f:
+            payload["/usr/bin/%s-%03d" % (NAME, i)] = f.read()
+
+    return payload
+
+
+def class_file(major, name):
+    """A minimal Java class file, enough for javabytecode to read."""
+    name = name.encode("utf-8")
+    pool = struct.pack(">BH", 1, len(name)) + name
+    pool += struct.pack(">BH", 7, 1)
+    pool += struct.pack(">BH", 1, 16) + b"java/lang/Object"
+    pool += struct.pack(">BH", 7, 3)
+    return struct.pack(">IHHH", 0xCAFEBABE, 0, major, 5) + pool + struct.pack(">HHHHHHH", 0x21, 2, 4, 0, 0, 0, 0)
+
+
+def jar_payload(rng, count, version):
+    """Jar files holding JAR_CLASSES classes each."""
+    payload = {}
+
+    for i in range(count):
+        buf = io.BytesIO()
+
+        with zipfile.ZipFile(buf, "w") as jar:
+            jar.writestr("META-INF/MANIFEST.MF", "Manifest-Version: 1.0\n")
+
+            for j in range(JAR_CLASSES):
+                name = "org/example/bench%d/Class%d" % (i, j)
+                jar.writestr(name + ".class", class_file(52, name))
+
+        payload["/usr/share/java/%s/%s%d.jar" % (NAME, NAME, i)] = buf.getvalue()
+
+    return payload
+
+
+def kmod_payload(rng, count, version, workdir):
+    """Kernel modules, built from the test suite's derp module."""
+    makefiles = sorted(glob.glob("/lib/modules/*/build/Makefile"))
+
+    if not makefiles:
+        raise Skip("kernel-devel is not installed")
+
+    kver = makefiles[0].split("/")[3]
+    srcdir = os.path.join(os.environ["RPMINSPECT_TEST_DATA_PATH"], "derp-kmod")
+    moddir = os.path.join(workdir, "derp-kmod")
+    shutil.copytree(srcdir, moddir)
+
+    if subprocess.call(["make", "-s", "-C", moddir, "KERNEL_BUILD_DIR=" + os.path.dirname(makefiles[0])]) != 0:
+        raise Skip("unable to build kernel modules")
+
+    with open(os.path.join(moddir, "derp.ko"), "rb") as f:
+        ko = f.read()
+
+    return {"/usr/lib/modules/%s/extra/%s/derp%d.ko" % (kver, NAME, i): ko for i in range(count)}
+
+
+def manpage_payload(rng, count, version):
+    """Compressed man pages in section 1."""
+    payload = {}
+
+    for i in range(count):
+        page = ".TH BENCH%d 1\n.SH NAME\nbench%d \\- benchmark page\n.SH DESCRIPTION\n%s" % (i, i, text(rng, 20))
+        payload["/usr/share/man/man1/bench%d.1.gz" % i] = gzip.compress(page.encode("utf-8"), mtime=0)
+
+    return payload
+
+
+def deep_payload(rng, count, version):
+    """Files spread over a tree DEEP_LEVELS directories deep."""
+    payload = {}
+
+    for i in range(count):
+        parts = ["d%d" % ((i >> (level % 8)) % 4) for level in range(DEEP_LEVELS)]
+        payload["/usr/share/%s/%s/file%05d" % (NAME, "/".join(parts), i)] = text(rng, 1)
+
+    return payload
+
+
+def renamed_payload(rng, count, version):
+    """Files under directory and file names that carry the version."""
+    payload = {}
+
+    for i in range(count):
+        payload["/usr/lib/%s-%s/mod%d/lib%s%d-%s.txt" % (NAME, version, i % 10, NAME, i, version)] = text(rng, 2)
+
+    return payload
+
+
+def payload_for(case, count, version, workdir):
+    rng = random.Random("%d-%s" % (SEED, case))
+
+    if case == "files":
+        return files_payload(rng, count, version)
+    elif case == "elf":
+        return elf_payload(rng, count, version, workdir)
+    elif case == "jar":
+        return jar_payload(rng, count, version)
+    elif case == "kmod":
+        return kmod_payload(rng, count, version, workdir)
+    elif case == "manpage":
+        return manpage_payload(rng, count, version)
+    elif case == "deep":
+        return deep_payload(rng, count, version)
+    elif case == "renamed":
+        return renamed_payload(rng, count, version)
+
+    raise ValueError("unknown case %s" % case)
+
+
+def change(path, content):
+    """Make a small change to a file's content."""
+    if path.endswith(".gz"):
+        return gzip.compress(gzip.decompress(content) + b".\\\" changed\n", mtime=0)
+    elif isinstance(content, bytes):
+        return content + b"\0"
+
+    return content + "changed\n"
+
+
+def after_payload(case, before, workdir):
+    """The after build: a few files changed, removed, and added."""
+    rng = random.Random("%d-%s-after" % (SEED, case))
+
+    if case == "renamed":
+        before = {p.replace(BEFORE_VER, AFTER_VER): c for (p, c) in before.items()}
+
+    (changed, removed, added) = plan(rng, sorted(before.keys()))
+    after = {}
+
+    for (path, content) in before.items():
+        if path in removed:
+            continue
+
+        if path in changed:
+            content = change(path, content)
+
+        after[path] = content
+
+    for path in added:
+        after[path] = before[path.rsplit(".new", 1)[0]]
+
+    return after
+
+
+def tarball(payload):
+    buf = io.BytesIO()
+
+    with tarfile.open(fileobj=buf, mode="w") as tar:
+        for (path, content) in sorted(payload.items()):
+            if isinstance(content, str):
+                content = content.encode("utf-8")
+
+            info = tarfile.TarInfo("." + path)
+            info.size = len(content)
+            info.mtime = 0
+            info.mode = 0o755 if path.startswith(("/usr/bin/", "/usr/libexec/")) else 0o644
+            tar.addfile(info, io.BytesIO(content))
+
+    return buf.getvalue()
+
+
+def build(version, release, payload, dest):
+    """
+    Build the package with rpmfluff.  The payload goes in as one
+    tarball source so the spec file stays small at any scale.
+    """
+    import rpmfluff
+
+    pkg = rpmfluff.SimpleRpmBuild(NAME, version, release)
+    idx = pkg.add_source(rpmfluff.SourceFile("payload.tar", tarball(payload)))
+    pkg.section_install += "mkdir -p $RPM_BUILD_ROOT\ntar -C $RPM_BUILD_ROOT -xf %%{SOURCE%d}\n" % idx
+
+    files = pkg.get_subpackage(None)
+
+    for path in sorted(payload.keys()):
+        files.section_files += "%s\n" % path
+
+    # a few symlinks for the symlinks inspection
+    for path in sorted(payload.keys())[:10]:
+        pkg.add_installed_symlink(path + ".link", os.path.basename(path))
+
+    pkg.do_make()
+
+    # lay the packages out like a Koji build
+    os.makedirs(os.path.join(dest, "src"))
+    shutil.copy(pkg.get_built_srpm(), os.path.join(dest, "src"))
+
+    for arch in pkg.get_build_archs():
+        os.makedirs(os.path.join(dest, arch), exist_ok=True)
+        shutil.copy(pkg.get_built_rpm(arch), os.path.join(dest, arch))
+
+    shutil.rmtree(pkg.get_base_dir(), ignore_errors=True)
+
+
+def make_case(corpus, case, scale):
+    """
+    Generate CORPUS/CASE-SCALE unless it is already there.  Returns
+    the case directory.  Raises Skip if the case cannot be built on
+    this system.
+    """
+    casedir = os.path.join(corpus, "%s-%s" % (case, scale))
+
+    if os.path.isdir(os.path.join(casedir, "after")):
+        return casedir
+
+    try:
+        import rpmfluff
+    except ImportError:
+        raise Skip("rpmfluff is not installed")
+
+    count = COUNTS[case] * SCALES[scale]
+    workdir = tempfile.mkdtemp(prefix="mkcorpus.")
+    tmpdir = casedir + ".tmp"
+    shutil.rmtree(tmpdir, ignore_errors=True)
+
+    try:
+        before = payload_for(case, count, BEFORE_VER, workdir)
+        after = after_payload(case, before, workdir)
+        cwd = os.getcwd()
+        os.chdir(workdir)
+
+        try:
+            build(BEFORE_VER, "1", before, os.path.join(tmpdir, "before"))
+            build(AFTER_VER, "1", after, os.path.join(tmpdir, "after"))
+        finally:
+            os.chdir(cwd)
+
+        os.rename(tmpdir, casedir)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+        shutil.rmtree(tmpdir, ignore_errors=True)
+
+    return casedir
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate benchmark builds for rpminspect")
+    parser.add_argument("--corpus", default=os.environ.get("RPMINSPECT_BENCH_CORPUS", "corpus"))
+    parser.add_argument("--scale", choices=sorted(SCALES.keys()), default="small")
+    parser.add_argument("cases", nargs="+", choices=sorted(COUNTS.keys()))
+    args = parser.parse_args()
+
+    for case in args.cases:
+        try:
+            print(make_case(args.corpus, case, args.scale))
+        except Skip as e:
+            print("skipping %s: %s" % (case, e), file=sys.stderr)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,217 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+# Author(s):  David Cantrell <dcantrell@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+#
+# Run one benchmark: compare the before and after builds of a corpus
+# case with rpminspect --stats, a few times, and record what one
+# inspection or one phase (gather, peers) cost.
+#
+#     runbench.py --case CASE [--scale SCALE] --inspection NAME
+#     runbench.py --case CASE [--scale SCALE] --phase PHASE
+#
+# The corpus case is generated first if it does not exist yet.  After
+# one warm up run, each measured run is a separate rpminspect process.
+# The result is one JSON object appended as a line to the results file
+# and printed on stdout.  Use compare.py to compare two results files.
+#
+# Environment:
+#     RPMINSPECT                  rpminspect executable
+#     RPMINSPECT_YAML             configuration file to start from
+#     RPMINSPECT_TEST_DATA_PATH   vendor data directory (test/data)
+#     RPMINSPECT_BENCH_CORPUS     where corpus cases are kept
+#     RPMINSPECT_BENCH_RESULTS    results file (JSON Lines)
+#
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+import yaml
+
+import mkcorpus
+
+# Inspection used to make rpminspect extract and match everything
+# for the phase benchmarks
+PHASE_INSPECTION = "changedfiles"
+
+# Phases that together gather the builds.  Packages are extracted while
+# they are copied or downloaded, so the extraction phase on its own
+# only times waiting for the last extractions to finish.  The gather
+# benchmark adds up all of them.
+GATHER_PHASES = ["download", "copy", "extraction"]
+
+METRICS = ["wall time", "cpu time", "peak rss delta", "files", "subprocesses", "bytes read"]
+
+
+def config_file(workdir):
+    """The sample configuration, set up the way the test suite does."""
+    with open(os.environ["RPMINSPECT_YAML"]) as f:
+        cfg = yaml.full_load(f)
+
+    cfg["common"]["workdir"] = workdir
+    cfg["vendor"]["vendor_data_dir"] = os.environ["RPMINSPECT_TEST_DATA_PATH"]
+    cfg["vendor"]["licensedb"] = "test.json"
+    cfg["metadata"]["buildhost_subdomain"] = ["localhost", platform.node()]
+
+    (handle, path) = tempfile.mkstemp(suffix=".yaml")
+    os.close(handle)
+
+    with open(path, "w") as f:
+        f.write(yaml.dump(cfg).replace("- ", "  - "))
+
+    return path
+
+
+def run_once(args, conffile, casedir, inspection):
+    """Run rpminspect once and return its stats object."""
+    (handle, output) = tempfile.mkstemp(suffix=".json")
+    os.close(handle)
+
+    cmd = [os.environ["RPMINSPECT"], "-c", conffile, "-s", "-F", "json", "-o", output,
+           "-r", "GENERIC", "-T", inspection,
+           os.path.join(casedir, "before"), os.path.join(casedir, "after")]
+
+    start = time.monotonic()
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    elapsed = time.monotonic() - start
+
+    # 1 only means the inspection found problems
+    if proc.returncode not in (0, 1):
+        sys.stderr.write(proc.stderr.decode("utf-8", "replace"))
+        raise RuntimeError("rpminspect exited with %d" % proc.returncode)
+
+    with open(output) as f:
+        stats = json.load(f)["stats"]
+
+    os.unlink(output)
+    stats["process wall time"] = elapsed
+    return stats
+
+
+def phase_stats(stats, phase):
+    """The stats of one phase, or of every phase that gathers the builds."""
+    phases = stats["phases"]
+
+    if phase != "gather":
+        return phases.get(phase)
+
+    entries = [phases[p] for p in GATHER_PHASES if p in phases]
+
+    if not entries:
+        return None
+
+    return {m: sum(e[m] for e in entries) for m in METRICS}
+
+
+def summarize(samples):
+    """Minimum, median, maximum, and every sample of a metric."""
+    return {"min": min(samples), "median": statistics.median(samples), "max": max(samples), "samples": samples}
+
+
+def git_commit():
+    srcdir = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
+
+    try:
+        out = subprocess.check_output(["git", "-C", srcdir, "rev-parse", "HEAD"], stderr=subprocess.DEVNULL)
+        return out.decode("utf-8").strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run an rpminspect benchmark")
+    parser.add_argument("--case", required=True, choices=sorted(mkcorpus.COUNTS.keys()))
+    parser.add_argument("--scale", choices=sorted(mkcorpus.SCALES.keys()), default="small")
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--inspection")
+    target.add_argument("--phase", choices=["gather", "peers"])
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--corpus", default=os.environ.get("RPMINSPECT_BENCH_CORPUS", "corpus"))
+    parser.add_argument("--results", default=os.environ.get("RPMINSPECT_BENCH_RESULTS"))
+    args = parser.parse_args()
+
+    try:
+        casedir = mkcorpus.make_case(args.corpus, args.case, args.scale)
+    except mkcorpus.Skip as e:
+        print("skipping: %s" % e)
+        return mkcorpus.SKIP
+
+    if args.inspection:
+        inspection = args.inspection
+        name = "inspection " + inspection
+    else:
+        inspection = PHASE_INSPECTION
+        name = "phase " + args.phase
+
+    workdir = tempfile.mkdtemp(prefix="runbench.")
+    conffile = config_file(workdir)
+    samples = {m: [] for m in METRICS + ["process wall time"]}
+
+    try:
+        # warm up the page cache and the rpminspect binary
+        run_once(args, conffile, casedir, inspection)
+
+        for i in range(args.repeat):
+            stats = run_once(args, conffile, casedir, inspection)
+
+            if args.inspection:
+                entry = stats["inspections"].get(inspection)
+            else:
+                entry = phase_stats(stats, args.phase)
+
+            if entry is None:
+                raise RuntimeError("no stats for %s in the rpminspect output" % name)
+
+            for m in METRICS:
+                samples[m].append(entry[m])
+
+            samples["process wall time"].append(stats["process wall time"])
+    finally:
+        os.unlink(conffile)
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    result = {
+        "benchmark": "%s.%s" % (args.inspection or args.phase, args.case),
+        "case": args.case,
+        "scale": args.scale,
+        "target": name,
+        "repeat": args.repeat,
+        "commit": git_commit(),
+        "host": platform.node(),
+        "time": int(time.time()),
+        "metrics": {m: summarize(v) for (m, v) in samples.items()},
+    }
+
+    line = json.dumps(result, sort_keys=True)
+    print(line)
+
+    if args.results:
+        with open(args.results, "a") as f:
+            f.write(line + "\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
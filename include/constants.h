@@ -85,6 +85,73 @@
  */
 #define INSPECTIONS "inspections"
 
+/**
+ * @def DOWNLOAD_CONCURRENCY
+ * Default number of files downloaded from Koji at the same time.
+ */
+#define DOWNLOAD_CONCURRENCY 4
+
+/**
+ * @def DOWNLOAD_RETRIES
+ * Default number of times a failed download is retried.
+ */
+#define DOWNLOAD_RETRIES 2
+
+/**
+ * @def DOWNLOAD_RETRY_DELAY
+ * Seconds to wait before retrying a failed download.  The delay is
+ * multiplied by the number of attempts made so far.
+ */
+#define DOWNLOAD_RETRY_DELAY 2
+
+/**
+ * @def CACHE_SIZE
+ * Default size limit of the download cache in megabytes.  The cache
+ * is only used if cache_dir is set in the configuration file.
+ */
+#define CACHE_SIZE 10240
+
+/**
+ * @def COPY_BUFFER_SIZE
+ * Size of the buffer used to copy files when the data cannot be
+ * reflinked, hardlinked, or copied with copy_file_range().
+ */
+#define COPY_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * @def KOJI_CACHE_SUBDIR
+ * Subdirectory of cache_dir holding cached Koji hub responses.
+ */
+#define KOJI_CACHE_SUBDIR "koji"
+
+/**
+ * @def KOJI_ARCHES_TTL
+ * Seconds a cached getAllArches response from the Koji hub is used
+ * before it is requested again.
+ */
+#define KOJI_ARCHES_TTL (24 * 60 * 60)
+
+/**
+ * @def KOJI_MULTICALL_SIZE
+ * Maximum number of calls sent to the Koji hub in one multiCall
+ * request.
+ */
+#define KOJI_MULTICALL_SIZE 100
+
+/**
+ * @def KOJI_BUILD_STATE_COMPLETE
+ * Koji build state for a completed build.  Completed builds do not
+ * change, so their hub responses can be cached.
+ */
+#define KOJI_BUILD_STATE_COMPLETE 1
+
+/**
+ * @def KOJI_TASK_STATE_CLOSED
+ * Koji task state for a successfully finished task.  Closed tasks do
+ * not change, so their hub responses can be cached.
+ */
+#define KOJI_TASK_STATE_CLOSED 2
+
 /** @} */
 
 /**
@@ -268,6 +335,84 @@
  */
 #define KERNEL_MODULES_DIR "/lib/modules/"
 
+/**
+ * @def ARENA_BLOCK_SIZE
+ * Size in bytes of each block an arena_t allocates.  File entries and
+ * their paths for one package are carved out of these blocks.
+ */
+#define ARENA_BLOCK_SIZE (256 * 1024)
+
+/**
+ * @def TRASH_DIR
+ * Directory in the workdir that working directories are moved to
+ * before they are removed.
+ */
+#define TRASH_DIR ".trash"
+
+/**
+ * @def TRASH_SPLIT_DEPTH
+ * Depth below a trashed working directory at which the subtrees are
+ * removed in parallel.  At this depth they are the extracted package
+ * trees (before/ARCH/PACKAGE).
+ */
+#define TRASH_SPLIT_DEPTH 3
+
+/**
+ * @def TRACE_RING_SIZE
+ * Number of spans the --trace ring buffer holds before they are
+ * written out.  Spans recorded while it is full are dropped.
+ */
+#define TRACE_RING_SIZE 16384
+
+/**
+ * @def TRACE_THRESHOLD
+ * Default trace_threshold in microseconds.  Per-file inspection
+ * callbacks shorter than this are not written to a --trace file.
+ */
+#define TRACE_THRESHOLD 1000
+
+/**
+ * @def EXTRACT_QUEUE_DEPTH
+ * Number of payload extraction jobs per worker thread that may wait
+ * in the extraction queue before adding another job blocks.
+ */
+#define EXTRACT_QUEUE_DEPTH 2
+
+/**
+ * @def RPM_LEAD_SIZE
+ * Size in bytes of the lead at the start of every RPM package.
+ */
+#define RPM_LEAD_SIZE 96
+
+/**
+ * @def HEADER_FETCH_SIZE
+ * Number of bytes --estimate first downloads of each package.  This
+ * holds the headers of most packages, the rest are fetched again with
+ * the size the signature header says they need.
+ */
+#define HEADER_FETCH_SIZE 65536
+
+/**
+ * @def CALIBRATION_GATHER_RATE
+ * Default rate in bytes per second at which --estimate assumes
+ * packages are downloaded and extracted, until a calibration file
+ * says otherwise.
+ */
+#define CALIBRATION_GATHER_RATE (50 * 1024 * 1024)
+
+/**
+ * @def CALIBRATION_WEIGHT
+ * Weight each new run gets when it is blended into the calibration
+ * file.  The rest of the value comes from the earlier runs.
+ */
+#define CALIBRATION_WEIGHT 0.25
+
+/**
+ * @def SERVE_REQUEST_MAX
+ * Largest job request in bytes rpminspect --serve accepts.
+ */
+#define SERVE_REQUEST_MAX 65536
+
 /** @} */
 
 /**
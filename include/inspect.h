@@ -76,6 +76,46 @@ bool foreach_peer_file(struct rpminspect *ri, foreach_peer_file_func callback, b
  */
 const char *inspection_desc(const uint64_t id);
 
+/**
+ * @brief Return the payload file classes the enabled inspections read.
+ *
+ * Combine the FILES_* classes of every inspection selected in
+ * ri->tests.  Inspections that need a before build are left out when
+ * there is no before build, since they will not run.
+ *
+ * @param ri Pointer to the struct rpminspect used for the program.
+ * @return Mask of FILES_* classes to extract.
+ */
+uint32_t payload_files(const struct rpminspect *ri);
+
+/**
+ * @brief Return the index in inspections[] of the inspection that
+ * runs nth.
+ *
+ * The inspections run in the order of inspections[] unless
+ * schedule_inspections() set ri->order.
+ *
+ * @param ri Pointer to the struct rpminspect used for the program.
+ * @param n Position in the run order, starting at 0.
+ * @return Index in inspections[], or -1 once n is past the last
+ *         inspection.
+ */
+int inspection_at(const struct rpminspect *ri, const int n);
+
+/**
+ * @brief Return the payload file classes the enabled inspections
+ * from position first in the run order on read.
+ *
+ * Same as payload_files(), but inspections that run before position
+ * first are left out.  Lazy extraction uses it to extract everything
+ * the rest of the run needs from a payload in one pass.
+ *
+ * @param ri Pointer to the struct rpminspect used for the program.
+ * @param first Position in the run order to start at.
+ * @return Mask of FILES_* classes.
+ */
+uint32_t remaining_payload_files(const struct rpminspect *ri, const int first);
+
 /** @} */
 
 /**
@@ -412,6 +452,32 @@ bool inspect_lostpayload(struct rpminspect *ri);
 #define INSPECT_SYMLINKS                    (((uint64_t) 1) << 29)
 #define INSPECT_LOSTPAYLOAD                 (((uint64_t) 1) << 30)
 
+/*
+ * Classes of payload files an inspection reads from disk.  Each
+ * inspection lists its classes in the inspections array and only the
+ * union of the classes for the enabled inspections is extracted.
+ * Every other payload member is still listed, using the metadata in
+ * the RPM header, but its fullpath is NULL.  ELF, text, and Java
+ * files are recognized by the file class rpmbuild recorded in the
+ * header; files are extracted if the header has no file classes.
+ *
+ * FILES_DEBUG selects packages rather than files.  When the
+ * debug_packages setting is 'lazy', debuginfo and debugsource
+ * packages are only extracted for inspections that have it.
+ */
+#define FILES_NONE                          0           /* header and file metadata only */
+#define FILES_ELF                           (1 << 0)    /* ELF objects */
+#define FILES_STATIC_LIBS                   (1 << 1)    /* static libraries */
+#define FILES_TEXT                          (1 << 2)    /* text files, including scripts and XML */
+#define FILES_MANPAGES                      (1 << 3)    /* man pages (manpage_path_include) */
+#define FILES_KMODS                         (1 << 4)    /* kernel modules */
+#define FILES_JAVA                          (1 << 5)    /* Java class files and jars */
+#define FILES_WRITABLE                      (1 << 6)    /* world-writable or sticky regular files */
+#define FILES_SOURCE                        (1 << 7)    /* every file in a source package */
+#define FILES_DEBUG                         (1 << 8)    /* files in debuginfo and debugsource packages */
+#define FILES_ALL                           (~0U)       /* the entire payload */
+#define FILES_PAYLOAD                       (FILES_ALL & ~FILES_DEBUG) /* the entire payload, not in debug packages */
+
 /* Long descriptions for the inspections */
 #define DESC_LICENSE _("Verify the string specified in the License tag of the RPM metadata describes permissible software licenses as defined by the license database. Also checks to see if the License tag contains any unprofessional words as defined in the configuration file.")
 
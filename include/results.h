@@ -27,6 +27,7 @@
  * Inspection headers
  */
 #define HEADER_RPMINSPECT    "rpminspect"
+#define HEADER_FAILFAST      "fail-fast"
 #define HEADER_METADATA      "header-metadata"
 #define HEADER_EMPTYRPM      "empty-payload"
 #define HEADER_LOSTPAYLOAD   "lost-payload"
@@ -61,6 +62,9 @@
 /*
  * Inspection remedies
  */
+/* fail-fast */
+#define REMEDY_FAILFAST _("Run rpminspect without --fail-fast to get the results of every inspection.")
+
 /* metadata */
 #define REMEDY_VENDOR _("Change the string specified on the 'Vendor:' line in the spec file.")
 #define REMEDY_BUILDHOST _("Make sure the SRPM is built on a host within the expected subdomain.")
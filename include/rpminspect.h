@@ -110,6 +110,12 @@ bool init_stat_whitelist(struct rpminspect *);
 bool init_caps_whitelist(struct rpminspect *);
 int init_rpminspect(struct rpminspect *, const char *, const char *);
 
+/* idcache.c */
+const id_cache_entry_t *get_owner_id(struct rpminspect *, const char *);
+const id_cache_entry_t *get_group_id(struct rpminspect *, const char *);
+void init_id_cache(struct rpminspect *);
+void free_id_cache(id_cache_t *);
+
 /* free.c */
 void free_regex(regex_t *);
 void free_mapping(struct hsearch_data *, string_list_t *);
@@ -131,6 +137,17 @@ string_list_t * list_sort(const string_list_t *);
 string_list_t * list_copy(const string_list_t *);
 string_list_t *list_from_array(const char **);
 
+/* download.c */
+download_queue_t *init_download_queue(const struct rpminspect *);
+void free_download_queue(download_queue_t *);
+download_entry_t *add_download(download_queue_t *, const char *, const char *);
+unsigned int run_download_queue(download_queue_t *);
+
+/* cache.c */
+bool cache_fetch(struct rpminspect *, const char *, const char *, const long long int, const char *);
+void cache_store(struct rpminspect *, const char *, const char *, const char *);
+void prune_cache(const struct rpminspect *);
+
 /* local.c */
 bool is_local_build(const char *);
 bool is_local_rpm(struct rpminspect *, const char *);
@@ -149,6 +166,7 @@ void free_koji_task(struct koji_task *);
 struct koji_build *get_koji_build(struct rpminspect *, const char *);
 struct koji_task *get_koji_task(struct rpminspect *, const char *);
 string_list_t *get_all_arches(const struct rpminspect *);
+void free_koji_client(void);
 bool allowed_arch(const struct rpminspect *, const char *);
 
 /* kmods.c */
@@ -159,12 +177,40 @@ void free_module_aliases(kernel_alias_data_t *);
 bool compare_module_aliases(kernel_alias_data_t *, kernel_alias_data_t *, module_alias_callback, void *);
 string_list_t *get_kmod_values(const char *, const char *);
 
+/* pathmatch.c */
+path_matcher_t *init_path_matcher(const path_match_type_t);
+void free_path_matcher(path_matcher_t *);
+void add_path_matcher_rule(path_matcher_t *, const char *, const char *);
+path_matcher_t *compile_path_matcher(const string_list_t *, const path_match_type_t);
+const char *match_path(const path_matcher_t *, const char *);
+
 /* mkdirp.c */
 int mkdirp(char *, mode_t);
 
 /* rmtree.c */
 int rmtree(const char *, const bool, const bool);
 
+/* stats.c */
+void count_file_visit(void);
+void count_subprocess(void);
+void start_stats(const struct rpminspect *, stats_mark_t *);
+void end_stats(const struct rpminspect *, const stats_mark_t *, const stats_kind_t, const char *);
+stats_t *init_stats(void);
+void free_stats(stats_t *);
+void print_stats(const stats_t *, FILE *);
+
+/* trace.c */
+bool init_trace(const char *, const unsigned int);
+void finish_trace(void);
+uint64_t trace_start(void);
+void trace_end(const uint64_t, const char *, const char *, const char *);
+void trace_end_slow(const uint64_t, const char *, const char *, const char *);
+
+/* trash.c */
+int rmtree_parallel(const char *, const bool, unsigned int);
+int trash_tree(const struct rpminspect *, const char *);
+void empty_trash(const struct rpminspect *);
+
 /* strfuncs.c */
 bool strprefix(const char *, const char *);
 bool strsuffix(const char *, const char *);
@@ -183,23 +229,49 @@ bool has_bad_word(const char *, const string_list_t *);
 
 /* copyfile.c */
 int copyfile(const char *, const char *, bool, bool);
+copy_strategy_t fastcopy(const char *, const char *, bool);
+const char *copy_strategy_desc(const copy_strategy_t);
 
 /* rpm.c */
 int init_librpm(void);
 Header get_rpm_header(struct rpminspect *, const char *);
+int get_rpm_header_end(const char *, off_t *);
+void cache_rpm_header(struct rpminspect *, const char *, Header);
 char *get_rpmtag_str(Header, rpmTagVal);
 char *get_nevr(Header);
 char *get_nevra(Header);
 const char *get_rpm_header_arch(Header);
+bool is_debug_package(Header);
+header_columns_t *init_header_columns(Header);
+void free_header_columns(header_columns_t *);
+const char *get_rpm_file_str(const rpmfile_entry_t *, rpmTagVal);
+uint64_t get_rpm_file_num(const rpmfile_entry_t *, rpmTagVal);
 
 /* peers.c */
 rpmpeer_t *init_rpmpeer(void);
 void free_rpmpeer(rpmpeer_t *);
-void add_peer(rpmpeer_t **, int, bool, const char *, Header);
+void add_peer(rpmpeer_t **, int, bool, const char *, Header, extract_pool_t *);
+void add_extracted_peer(rpmpeer_t **, int, const char *, Header, header_columns_t *, rpmfile_t *, char *, arena_t *);
+void link_peer_files(rpmpeer_t *);
+
+/* stream.c */
+rpm_stream_t *stream_rpm_download(const struct rpminspect *, download_entry_t *, bool);
+void free_rpm_stream(rpm_stream_t *);
+
+/* extractpool.c */
+extract_pool_t *init_extract_pool(const struct rpminspect *, unsigned int);
+void queue_extraction(extract_pool_t *, rpmpeer_entry_t *, const int);
+void queue_materialize(extract_pool_t *, rpmpeer_entry_t *, const int, const uint32_t);
+void finish_extract_pool(extract_pool_t *);
+void materialize_peers(struct rpminspect *, const int);
 
 /* files.c */
 void free_files(rpmfile_t *files);
-rpmfile_t * extract_rpm(const char *, Header, char **output_dir);
+rpmfile_t * extract_rpm(const struct rpminspect *, const char *, Header, const header_columns_t *, char **output_dir, arena_t *);
+rpmfile_t * extract_rpm_fd(const struct rpminspect *, const char *, Header, const header_columns_t *, int, char **output_dir, arena_t *);
+uint32_t payload_file_classes(const struct rpminspect *, const uint32_t, const header_columns_t *, const int, const char *);
+bool payload_pending(const struct rpminspect *, Header, const rpmfile_t *, const uint32_t);
+bool materialize_rpm(const struct rpminspect *, const char *, Header, rpmfile_t *, const char *, arena_t *, const uint32_t);
 bool process_file_path(const rpmfile_entry_t *, regex_t *, regex_t *);
 void find_file_peers(rpmfile_t *, rpmfile_t *);
 cap_t get_cap(rpmfile_entry_t *);
@@ -220,15 +292,36 @@ void add_result(struct rpminspect *, struct result_params *);
 const char *format_desc(unsigned int);
 
 /* output_text.c */
-void output_text(const results_t *, const char *);
+void output_text(const results_t *, const char *, const stats_t *);
+
+/* events.c */
+bool init_events(const char *);
+void finish_events(void);
+void event_run_start(const char *, const char *);
+void event_run_finish(const severity_t, const int);
+void event_inspection_start(const char *);
+void event_inspection_finish(const char *, const bool);
+void event_inspection_skipped(const char *);
+void event_result(const struct result_params *);
+
+/* jsonwriter.c */
+void json_writer_init(json_writer_t *, FILE *, const bool);
+void json_begin_object(json_writer_t *, const char *);
+void json_end_object(json_writer_t *);
+void json_begin_array(json_writer_t *, const char *);
+void json_end_array(json_writer_t *);
+void json_write_string(json_writer_t *, const char *, const char *);
+void json_write_int(json_writer_t *, const char *, const int64_t);
+void json_write_double(json_writer_t *, const char *, const double);
 
 /* output_json.c */
-void output_json(const results_t *, const char *);
+void output_json(const results_t *, const char *, const stats_t *);
 
 /* unpack.c */
 int unpack_archive(const char *, const char *, const bool);
 
 /* magic.c */
+bool init_magic(void);
 char *get_mime_type(rpmfile_entry_t *);
 bool is_text_file(rpmfile_entry_t *);
 
@@ -236,6 +329,36 @@ bool is_text_file(rpmfile_entry_t *);
 char *compute_checksum(const char *, mode_t *, enum checksum);
 char *checksum(rpmfile_entry_t *);
 
+/* cancel.c */
+void enable_cancel(void);
+bool cancel_enabled(void);
+void cancel_run(void);
+bool run_cancelled(void);
+void register_child(const pid_t);
+void unregister_child(const pid_t);
+
+/* schedule.c */
+bool get_order_policy(const char *, order_policy_t *);
+workload_t *get_workloads(const struct rpminspect *);
+void get_payload_workload(const struct rpminspect *, const uint32_t, workload_t *);
+uint64_t inspection_commands(const struct rpminspect *, const int, const workload_t *);
+uint64_t inspection_cost(const struct rpminspect *, const int, const workload_t *);
+int *order_by_cost(const order_policy_t, const uint64_t *);
+void schedule_inspections(struct rpminspect *);
+
+/* estimate.c */
+bool read_calibration(const char *, calibration_t *);
+void write_calibration(const char *, const calibration_t *);
+double blend_calibration(const double, const double);
+void update_calibration(const struct rpminspect *);
+bool write_estimate(struct rpminspect *, const char *, const bool);
+
+/* serve.c */
+bool parse_serve_job(const char *, serve_job_t *, char **);
+void free_serve_job(serve_job_t *);
+void finish_serve_job(void);
+int serve(const struct rpminspect *, const char *, serve_job_t *);
+
 /* runcmd.c */
 char *run_cmd(int *, const char *, ...);
 
@@ -262,6 +385,7 @@ const char *get_after_rel(struct rpminspect *);
 
 /* builds.c */
 int gather_builds(struct rpminspect *, bool);
+int gather_headers(struct rpminspect *);
 
 /* macros.c */
 string_list_t *get_macros(const char *);
@@ -280,6 +404,15 @@ bool has_textrel(Elf *elf);
 void free_elf_data(void);
 void init_elf_data(void);
 
+/* inspect_license.c */
+void load_licensedb(const struct rpminspect *);
+
+/* arena.c */
+arena_t *init_arena(void);
+void free_arena(arena_t *);
+void *arena_alloc(arena_t *, size_t);
+char *arena_strdup(arena_t *, const char *);
+
 /* bytes.c */
 /**
  * Given a byte array of a specified length, convert it to a NUL
@@ -303,6 +436,6 @@ char *bytes_to_str(unsigned char *array, size_t len);
  * directory, optional (pass NULL to use '/').  @return True if path
  * should be ignored, false otherwise.
  */
-bool ignore_path(const struct rpminspect *ri, const char *path, const char *root);
+bool ignore_path(const struct rpminspect *ri, const char *path);
 
 #endif
@@ -21,9 +21,12 @@
  */
 
 #include <regex.h>
+#include <stdio.h>
+#include <time.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <search.h>
+#include <pthread.h>
 #include <sys/queue.h>
 #include <sys/stat.h>
 #include <sys/capability.h>
@@ -54,10 +57,173 @@ typedef struct _pair_entry_t {
 
 typedef TAILQ_HEAD(pair_entry_s, _pair_entry_t) pair_list_t;
 
+/*
+ * Compiled path matcher.  Lists of path prefixes, suffixes, or exact
+ * paths from the configuration file are compiled in to a trie once
+ * so each file path can be checked against the whole list in a
+ * single pass.  Suffix rules are stored reversed.  The rule member of
+ * a node is an index in to the rules array, or -1 if no rule ends at
+ * that node.  See pathmatch.c.
+ */
+typedef enum _path_match_type_t {
+    PATH_MATCH_PREFIX = 0,
+    PATH_MATCH_SUFFIX = 1,
+    PATH_MATCH_EXACT = 2
+} path_match_type_t;
+
+typedef struct _path_trie_node_t {
+    unsigned char c;
+    int rule;
+    struct _path_trie_node_t *child;
+    struct _path_trie_node_t *sibling;
+} path_trie_node_t;
+
+typedef struct _path_matcher_t {
+    path_match_type_t type;
+    path_trie_node_t *root;
+    size_t nrules;
+    char **rules;
+} path_matcher_t;
+
+/*
+ * Bump allocator.  Memory is handed out from large blocks and only
+ * released all at once by free_arena().  Used for the rpmfile_entry_t
+ * structs and path strings of a package.  See arena.c.
+ */
+typedef struct _arena_block_t {
+    struct _arena_block_t *next;
+    size_t size;
+    size_t used;
+    char data[];
+} arena_block_t;
+
+typedef struct _arena_t {
+    arena_block_t *head;
+} arena_t;
+
+/* State of a single download queue entry */
+typedef enum _download_state_t {
+    DOWNLOAD_PENDING = 0,      /* waiting to start (or to be retried) */
+    DOWNLOAD_ACTIVE = 1,       /* transfer in progress */
+    DOWNLOAD_DONE = 2,         /* file downloaded */
+    DOWNLOAD_FAILED = 3        /* all attempts failed, dst removed */
+} download_state_t;
+
+/*
+ * How fastcopy() placed a file at its destination.  Listed in order
+ * of preference.
+ */
+typedef enum _copy_strategy_t {
+    COPY_FAILED = 0,           /* the file could not be placed */
+    COPY_REFLINK = 1,          /* FICLONE, data blocks are shared */
+    COPY_HARDLINK = 2,         /* same inode, same filesystem */
+    COPY_RANGE = 3,            /* copy_file_range(), in the kernel */
+    COPY_BUFFER = 4,           /* read() and write() through a buffer */
+    COPY_SYMLINK = 5           /* not copied, read in place (--no-copy) */
+} copy_strategy_t;
+
+/*
+ * What a download sink did with a block of data.  A blocked sink has
+ * not used any of the data and is given the same data again once its
+ * wait_fd is writable.
+ */
+typedef enum _sink_result_t {
+    SINK_OK = 0,               /* the data was used */
+    SINK_BLOCKED = 1,          /* try again when wait_fd is writable */
+    SINK_ERROR = 2             /* the attempt fails */
+} sink_result_t;
+
+/*
+ * A single file transfer in a download queue.  handle and fp are only
+ * set while the transfer is active.  retry_at is the monotonic time in
+ * seconds before which a failed transfer will not be restarted.  range
+ * is a CURLOPT_RANGE string such as "0-65535"; servers that do not do
+ * ranges send the whole file.
+ */
+typedef struct _download_entry_t {
+    char *src;                 /* URL to download */
+    char *dst;                 /* local destination path */
+    FILE *fp;
+    void *handle;              /* libcurl easy handle */
+    unsigned int attempts;
+    time_t retry_at;
+    uint64_t bytes;            /* bytes received for this transfer */
+    download_state_t state;
+    const struct _download_sink_t *sink; /* optional data consumer */
+    void *sink_data;           /* owned by the entry, see download_sink_t */
+    bool keep_dst;             /* with a sink, also write dst */
+    bool paused;               /* the sink blocked, transfer is paused */
+    char *digest;              /* expected payload digest, may be NULL */
+    char *range;               /* byte range to request, NULL for all */
+    uint64_t trace_start;      /* start of the attempt, see trace_start() */
+    TAILQ_ENTRY(_download_entry_t) items;
+} download_entry_t;
+
+/*
+ * Optional consumer of the data received for a download entry.  With
+ * a sink, dst is only written if keep_dst is true.  start is called
+ * before every attempt and write for each block of data received.
+ * write must not block, since every transfer in the queue runs on one
+ * thread.  If it cannot take the data it returns SINK_BLOCKED and the
+ * transfer is paused until the descriptor from wait_fd is writable.
+ * finish is called after every attempt with ok set if the transfer
+ * succeeded, it returns false if the sink could not use the data,
+ * which fails the attempt.  free releases the entry's sink_data when
+ * the queue is freed.
+ */
+typedef struct _download_sink_t {
+    bool (*start)(download_entry_t *);
+    sink_result_t (*write)(download_entry_t *, const char *, size_t);
+    int (*wait_fd)(download_entry_t *);
+    bool (*finish)(download_entry_t *, bool);
+    void (*free)(void *);
+} download_sink_t;
+
+typedef TAILQ_HEAD(download_entry_s, _download_entry_t) download_list_t;
+
+/* Called for each finished download, see run_download_queue() */
+typedef void (*download_done_func)(const download_entry_t *, void *);
+
+/*
+ * Queue of file transfers run concurrently by run_download_queue().
+ */
+typedef struct _download_queue_t {
+    download_list_t *entries;
+    unsigned int concurrency;  /* maximum transfers at once */
+    unsigned int retries;      /* retries per transfer after a failure */
+    bool verbose;
+    download_done_func done;   /* optional, called in queue order */
+    void *done_data;           /* passed to done */
+} download_queue_t;
+
+/*
+ * Per-header cache of the RPM file array tags.  Each column is decoded
+ * once when the package is extracted and indexed by rpmfile_entry_t
+ * idx.  String columns point in to the header's own data and stay
+ * valid while the header is held.  A column is NULL if the header
+ * lacks that tag.  See rpm.c.
+ */
+typedef struct _header_columns_t {
+    Header hdr;
+    rpm_count_t count;
+    const char **owners;      /* RPMTAG_FILEUSERNAME */
+    const char **groups;      /* RPMTAG_FILEGROUPNAME */
+    const char **digests;     /* RPMTAG_FILEDIGESTS */
+    const char **caps;        /* RPMTAG_FILECAPS */
+    const char **linktos;     /* RPMTAG_FILELINKTOS */
+    const char **classes;     /* RPMTAG_FILECLASS via RPMTAG_CLASSDICT */
+    uint16_t *modes;          /* RPMTAG_FILEMODES */
+    uint32_t *flags;          /* RPMTAG_FILEFLAGS */
+    uint64_t *sizes;          /* RPMTAG_LONGFILESIZES */
+} header_columns_t;
+
 /*
  * A file is information about a file in an RPM payload.
  *
  * If fullpath is not NULL, it is the absolute path of the unpacked file.
+ * fullpath is the extraction root followed by localpath, and localpath
+ * points in to the same string.  Both, and the entry itself, belong to
+ * the peer's arena and must not be freed individually.
  * Not every file is unpacked (e.g., block and char special files are skipped).
  * The ownership and permissions of the unpacked file may not match the
  * intended owner and mode from the RPM metadata.
@@ -71,6 +237,10 @@ typedef TAILQ_HEAD(pair_entry_s, _pair_entry_t) pair_list_t;
  *
  * idx is the index for this file into the RPM array tags such as RPMTAG_FILESIZES.
  *
+ * cols is the decoded RPM array tags for rpm_header, shared by every
+ * file from the same package.  Read tag values through cols rather
+ * than calling headerGet() per file.
+ *
  * type is the MIME type string that you would get from 'file --mime-type'.
  *
  * cap is the getcap() value for the file.
@@ -86,6 +256,7 @@ typedef struct _rpmfile_entry_t {
     char *localpath;
     struct stat st;
     int idx;
+    const header_columns_t *cols;
     char *type;
     char *checksum;
     cap_t cap;
@@ -110,11 +281,72 @@ typedef struct _rpmpeer_entry_t {
     char *after_root;         /* full path to the after RPM extracted root dir */
     rpmfile_t *before_files;  /* list of files in the payload of the before RPM */
     rpmfile_t *after_files;   /* list of files in the payload of the after RPM */
+    header_columns_t *before_cols; /* decoded file tags of before_hdr */
+    header_columns_t *after_cols;  /* decoded file tags of after_hdr */
+    arena_t *before_arena;    /* storage for before_files entries and paths */
+    arena_t *after_arena;     /* storage for after_files entries and paths */
+    uint32_t before_extracted; /* FILES_* classes extracted from before_rpm */
+    uint32_t after_extracted;  /* FILES_* classes extracted from after_rpm */
     TAILQ_ENTRY(_rpmpeer_entry_t) items;
 } rpmpeer_entry_t;
 
 typedef TAILQ_HEAD(rpmpeer_s, _rpmpeer_entry_t) rpmpeer_t;
 
+/*
+ * A payload extraction job for the before or after package of a peer.
+ */
+typedef struct _extract_job_t {
+    rpmpeer_entry_t *peer;
+    int whichbuild;
+    uint32_t files;           /* FILES_* classes for materialize_rpm(), or FILES_NONE */
+    TAILQ_ENTRY(_extract_job_t) items;
+} extract_job_t;
+
+typedef TAILQ_HEAD(extract_job_s, _extract_job_t) extract_job_list_t;
+
+/*
+ * An RPM being read from a download stream.  A reader thread parses
+ * the header from the read end of a pipe and then extracts the
+ * payload while the download writes to the other end.  hdr, cols,
+ * files, root, and arena hold the result once the stream is finished.
+ * No other thread sees hdr until the reader is joined, so the reader
+ * decodes its file tags itself.
+ */
+typedef struct _rpm_stream_t {
+    const struct rpminspect *ri;
+    const char *pkg;           /* path the RPM would have on disk */
+    int fds[2];                /* the write end is non-blocking */
+    char *pending;             /* data the pipe did not take yet */
+    size_t npending;
+    pthread_t thread;
+    bool running;
+    rpmts ts;
+    Header hdr;
+    header_columns_t *cols;
+    rpmfile_t *files;
+    char *root;
+    arena_t *arena;
+} rpm_stream_t;
+
+/*
+ * Worker threads that extract RPM payloads.  Jobs wait in a queue that
+ * holds at most 'depth' entries, queue_extraction() blocks while it
+ * is full.  'finished' tells the workers no more jobs are coming.
+ * 'ri' selects the payload files to extract, see payload_files().
+ */
+typedef struct _extract_pool_t {
+    const struct rpminspect *ri;
+    pthread_t *threads;
+    unsigned int nthreads;
+    extract_job_list_t *jobs;
+    unsigned int queued;
+    unsigned int depth;
+    bool finished;
+    pthread_mutex_t lock;
+    pthread_cond_t has_jobs;
+    pthread_cond_t has_room;
+} extract_pool_t;
+
 /*
  * And individual inspection result and the list to hold them.
  */
@@ -175,6 +407,52 @@ typedef struct _results_entry_t {
 
 typedef TAILQ_HEAD(results_s, _results_entry_t) results_t;
 
+/*
+ * Resource use of the phases of a run, collected with --stats.  Phases
+ * that run more than once, such as Koji hub calls, are added up.
+ */
+typedef enum _stats_kind_t {
+    STATS_PHASE = 0,
+    STATS_INSPECTION = 1
+} stats_kind_t;
+
+typedef struct _stats_entry_t {
+    char *name;
+    stats_kind_t kind;
+    unsigned int count;        /* number of times the phase ran */
+    double wall;               /* elapsed seconds */
+    double cpu;                /* user and system seconds, with children */
+    long maxrss;               /* peak RSS growth in kilobytes */
+    uint64_t files;            /* files passed to per-file callbacks */
+    uint64_t subprocesses;     /* commands run */
+    uint64_t bytes_read;       /* bytes read by the process */
+    TAILQ_ENTRY(_stats_entry_t) items;
+} stats_entry_t;
+
+typedef TAILQ_HEAD(stats_entry_s, _stats_entry_t) stats_t;
+
+/* Counters taken when a phase starts, see start_stats() */
+typedef struct _stats_mark_t {
+    struct timespec wall;
+    double cpu;
+    long maxrss;
+    uint64_t files;
+    uint64_t subprocesses;
+    uint64_t bytes_read;
+} stats_mark_t;
+
+/*
+ * Streaming JSON writer, see jsonwriter.c.  Bit n of children is set
+ * once the object or array open at depth n has a member, so at most
+ * 63 levels can be open.
+ */
+typedef struct _json_writer_t {
+    FILE *fp;
+    bool pretty;               /* spaced and indented like json-c */
+    unsigned int level;        /* open objects and arrays */
+    uint64_t children;
+} json_writer_t;
+
 /*
  * Known types of Koji builds
  */
@@ -254,6 +532,94 @@ typedef struct _header_cache_entry_t {
     TAILQ_ENTRY(_header_cache_entry_t) items;
 } header_cache_entry_t;
 
+/*
+ * Cache of user and group name lookups.  Each distinct name is
+ * resolved with getpwnam_r() or getgrnam_r() once per run.  Names that
+ * do not resolve are cached too (found is false).  forbidden is true
+ * if the name appears on forbidden_owners or forbidden_groups.
+ */
+typedef struct _id_cache_entry_t {
+    char *name;
+    bool found;
+    id_t id;
+    bool forbidden;
+    TAILQ_ENTRY(_id_cache_entry_t) items;
+} id_cache_entry_t;
+
+typedef TAILQ_HEAD(id_cache_entry_s, _id_cache_entry_t) id_cache_t;
+
+/* Payload extraction modes */
+typedef enum _extract_mode_t {
+    EXTRACT_EAGER = 0,         /* extract while gathering builds */
+    EXTRACT_LAZY = 1           /* extract before the inspections that read files */
+} extract_mode_t;
+
+/* How working directories are removed at the end of a run */
+typedef enum _teardown_t {
+    TEARDOWN_INLINE = 0,       /* remove them before exiting */
+    TEARDOWN_PARALLEL = 1,     /* same, on several threads */
+    TEARDOWN_BACKGROUND = 2    /* remove them in a detached process */
+} teardown_t;
+
+/* Order the inspections are run in */
+typedef enum _order_policy_t {
+    ORDER_TABLE = 0,           /* the order of inspections[] */
+    ORDER_EXPENSIVE = 1,       /* most expensive first */
+    ORDER_CHEAPEST = 2         /* cheapest first */
+} order_policy_t;
+
+/*
+ * The work an inspection has ahead of it, counted from the RPM
+ * headers of the build set before anything is extracted.  See
+ * schedule.c.
+ */
+typedef struct _workload_t {
+    uint64_t packages;         /* package headers it looks at */
+    uint64_t files;            /* payload members listed in them */
+    uint64_t read_files;       /* regular files it reads */
+    uint64_t read_bytes;       /* total size of those files */
+    uint64_t elf;              /* ELF objects among those files */
+    uint64_t jars;             /* Java archives and class files among them */
+    uint64_t kmods;            /* kernel modules among them */
+    uint64_t scripts;          /* shell scripts among them */
+} workload_t;
+
+/*
+ * What the --estimate calibration file holds, 0 where it has nothing.
+ * See estimate.c.
+ */
+typedef struct _calibration_t {
+    double gather_rate;        /* bytes per second */
+    double *factors;           /* per inspections[] entry */
+} calibration_t;
+
+/*
+ * A comparison job received by rpminspect --serve.  The members are
+ * the strings from the request, NULL if it did not have them.  argv
+ * is the command line the job is the same as, with argc members, and
+ * the builds start at argv[builds].
+ */
+typedef struct _serve_job_t {
+    char *before;
+    char *after;
+    char *tests;
+    char *exclude;
+    char *arches;
+    char *release;
+    char *threshold;
+    char **argv;
+    int argc;
+    int builds;
+} serve_job_t;
+
+/* Handling of debuginfo and debugsource packages */
+typedef enum _debug_packages_t {
+    DEBUGPKG_EXTRACT = 0,      /* same as every other package */
+    DEBUGPKG_LAZY = 1,         /* extract for inspections that read them */
+    DEBUGPKG_LIST = 2,         /* download, but never extract */
+    DEBUGPKG_SKIP = 3          /* do not download */
+} debug_packages_t;
+
 /* Product release string favoring */
 typedef enum _favor_release_t {
     FAVOR_NONE = 0,
@@ -274,6 +640,14 @@ struct rpminspect {
     char *workdir;             /* full path to working directory */
     char *profiledir;          /* full path to profiles directory */
     char *worksubdir;          /* within workdir, where these builds go */
+    char *cache_dir;           /* download cache directory, may be NULL */
+    uint64_t cache_size;       /* download cache size limit in bytes */
+    extract_mode_t extract_mode; /* when payloads are extracted */
+    debug_packages_t debug_packages; /* what to do with debug packages */
+    teardown_t teardown;       /* how the working directory is removed */
+    order_policy_t order_policy; /* order the inspections run in */
+    char *calibration;         /* --estimate calibration file, may be NULL */
+    unsigned int trace_threshold; /* shortest per-file span traced, usec */
 
     /* Vendor data */
     char *vendor_data_dir;     /* main vendor data directory */
@@ -284,10 +658,23 @@ struct rpminspect {
     stat_whitelist_t *stat_whitelist;
     caps_whitelist_t *caps_whitelist;
 
+    /*
+     * Hash tables indexing the whitelists above, built when the
+     * whitelists are read.  stat_whitelist_table maps a file path to
+     * its stat_whitelist_entry_t.  caps_whitelist_table maps
+     * "package path" to its caps_filelist_entry_t, the keys for that
+     * table are kept in caps_whitelist_keys.
+     */
+    struct hsearch_data *stat_whitelist_table;
+    struct hsearch_data *caps_whitelist_table;
+    string_list_t *caps_whitelist_keys;
+
     /* Koji information (from config file) */
     char *kojihub;             /* URL of Koji hub */
     char *kojiursine;          /* URL to access packages built in Koji */
     char *kojimbs;             /* URL to access module packages in Koji */
+    unsigned int download_concurrency; /* simultaneous downloads */
+    unsigned int download_retries;     /* retries per failed download */
 
     /* Information used by different tests */
     string_list_t *badwords;   /* Space-delimited list of words prohibited
@@ -353,6 +740,10 @@ struct rpminspect {
     string_list_t *forbidden_owners;
     string_list_t *forbidden_groups;
 
+    /* Resolved user and group names, see idcache.c */
+    id_cache_t *uid_cache;
+    id_cache_t *gid_cache;
+
     /* List of shells to check script syntax */
     string_list_t *shells;
 
@@ -385,11 +776,28 @@ struct rpminspect {
     /* list of paths to ignore (these strings allow glob(3) syntax) */
     string_list_t *ignores;
 
+    /*
+     * Compiled matchers for the path lists above, built once by
+     * init_rpminspect() after all configuration files are read.
+     */
+    path_matcher_t *security_path_prefix_match;
+    path_matcher_t *header_file_extensions_match;
+    path_matcher_t *forbidden_path_prefixes_match;
+    path_matcher_t *forbidden_path_suffixes_match;
+    path_matcher_t *forbidden_directories_match;
+    path_matcher_t *bin_paths_match;
+    path_matcher_t *pathmigration_match;
+
     /* Options specified by the user */
     char *before;              /* before build ID arg given on cmdline */
     char *after;               /* after build ID arg given on cmdline */
     uint64_t tests;            /* which tests to run (default: ALL) */
     bool verbose;              /* verbose inspection output? */
+    bool keep_rpms;            /* keep streamed RPMs in the workdir? */
+    bool no_copy;              /* read local RPMs in place? */
+    bool fail_fast;            /* cancel at the first failing result? */
+    uint32_t payload_files;    /* FILES_* classes to extract */
+    int *order;                /* inspections[] indexes in run order, or NULL */
 
     /* Failure threshold */
     severity_t threshold;
@@ -418,6 +826,9 @@ struct rpminspect {
 
     /* inspection results */
     results_t *results;
+
+    /* resource use per phase, NULL unless --stats was given */
+    stats_t *stats;
 };
 
 /*
@@ -430,8 +841,8 @@ struct format {
     /* short name of the format */
     char *name;
 
-    /* output driver function */
-    void (*driver)(const results_t *, const char *);
+    /* output driver function, stats may be NULL */
+    void (*driver)(const results_t *, const char *, const stats_t *);
 };
 
 /*
@@ -458,6 +869,9 @@ struct inspect {
      */
     bool single_build;
 
+    /* FILES_* classes of payload files the inspection reads */
+    uint32_t files;
+
     /* the driver function for the inspection */
     bool (*driver)(struct rpminspect *);
 };
@@ -472,6 +886,7 @@ typedef struct _koji_rpmlist_entry_t {
     char *release;
     int epoch;
     long long int size;
+    char *payloadhash;
     TAILQ_ENTRY(_koji_rpmlist_entry_t) items;
 } koji_rpmlist_entry_t;
 
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "rpminspect.h"
+
+/**
+ * @file arena.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Bump allocator for per-package file data.
+ *
+ * Extracting a package creates one rpmfile_entry_t and a couple of
+ * path strings per payload member.  Carving those out of a few large
+ * blocks avoids a malloc() and free() per member and keeps the file
+ * list close together in memory.  Everything in an arena is released
+ * at once with free_arena().
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/* Alignment suitable for any struct we store in an arena */
+#define ARENA_ALIGN 16
+
+/**
+ * @brief Create a new, empty arena.
+ *
+ * @return Newly allocated arena_t, free with free_arena().
+ */
+arena_t *init_arena(void)
+{
+    arena_t *arena = NULL;
+
+    arena = calloc(1, sizeof(*arena));
+    assert(arena != NULL);
+    return arena;
+}
+
+/**
+ * @brief Release an arena and everything allocated from it.
+ *
+ * @param arena The arena to free (may be NULL).
+ */
+void free_arena(arena_t *arena)
+{
+    arena_block_t *block = NULL;
+    arena_block_t *next = NULL;
+
+    if (arena == NULL) {
+        return;
+    }
+
+    for (block = arena->head; block != NULL; block = next) {
+        next = block->next;
+        free(block);
+    }
+
+    free(arena);
+    return;
+}
+
+/*
+ * Take size bytes aligned to align (a power of two) from the arena,
+ * adding a new block if the current one is too full.
+ */
+static void *arena_take(arena_t *arena, size_t size, size_t align)
+{
+    arena_block_t *block = NULL;
+    size_t blocksize = ARENA_BLOCK_SIZE;
+    size_t pad = 0;
+    char *ptr = NULL;
+
+    assert(arena != NULL);
+
+    block = arena->head;
+
+    if (block != NULL) {
+        ptr = block->data + block->used;
+        pad = (align - ((uintptr_t) ptr & (align - 1))) & (align - 1);
+    }
+
+    if (block == NULL || (block->size - block->used) < (pad + size)) {
+        /* oversized requests get a block of their own */
+        if ((size + align) > blocksize) {
+            blocksize = size + align;
+        }
+
+        block = malloc(sizeof(*block) + blocksize);
+        assert(block != NULL);
+        block->size = blocksize;
+        block->used = 0;
+        block->next = arena->head;
+        arena->head = block;
+
+        ptr = block->data;
+        pad = (align - ((uintptr_t) ptr & (align - 1))) & (align - 1);
+    }
+
+    ptr += pad;
+    block->used += pad + size;
+    return ptr;
+}
+
+/**
+ * @brief Allocate zeroed memory from an arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param size Number of bytes needed.
+ * @return Pointer to size bytes of zeroed memory.  Do not free() it.
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    void *ptr = NULL;
+
+    ptr = arena_take(arena, size, ARENA_ALIGN);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+/**
+ * @brief Copy a string in to an arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param s The string to copy.
+ * @return The copy of s.  Do not free() it.
+ */
+char *arena_strdup(arena_t *arena, const char *s)
+{
+    size_t len;
+    char *ret = NULL;
+
+    assert(s != NULL);
+
+    len = strlen(s) + 1;
+    ret = arena_take(arena, len, 1);
+    memcpy(ret, s, len);
+    return ret;
+}
@@ -42,6 +42,9 @@
 static struct rpminspect *workri = NULL;
 static int whichbuild = BEFORE_BUILD;
 static bool fetch_only = false;
+static bool headers_only = false;
+static download_queue_t *header_retries = NULL;
+static extract_pool_t *extract_pool = NULL;
 static int mode = S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
 
 /* This array holds strings that map to the whichbuild index value. */
@@ -50,11 +53,17 @@ static char *build_desc[] = { "before", "after" };
 /* Local prototypes */
 static void set_worksubdir(struct rpminspect *, workdir_t, const struct koji_build *, const struct koji_task *);
 static void get_rpm_info(const char *);
+static void header_done(const download_entry_t *);
+static void download_done(const download_entry_t *, void *);
+static void queue_package(download_queue_t *, const char *, const char *, const koji_rpmlist_entry_t *);
 static void prune_local(const int);
 static int copytree(const char *, const struct stat *, int, struct FTW *);
+static int read_header(const char *, const struct stat *, int, struct FTW *);
+static void run_queue(const struct rpminspect *, download_queue_t *);
 static int download_build(const struct rpminspect *, struct koji_build *);
 static int download_task(const struct rpminspect *, struct koji_task *);
 static void curl_helper(const bool, const char *, const char *);
+static int collect_builds(struct rpminspect *);
 
 /*
  * Set the working subdirectory for this particular run based on whether
@@ -129,7 +138,196 @@ static void get_rpm_info(const char *pkg)
     arch = get_rpm_header_arch(h);
 
     if (allowed_arch(workri, arch)) {
-        add_peer(&workri->peers, whichbuild, fetch_only, pkg, h);
+        add_peer(&workri->peers, whichbuild, fetch_only || headers_only, pkg, h, extract_pool);
+    }
+
+    return;
+}
+
+/*
+ * Handle a package fetched by gather_headers().  Only the start of
+ * the package was requested.  If that does not hold the whole header,
+ * the package is queued again for as much as the header needs.
+ */
+static void header_done(const download_entry_t *entry)
+{
+    struct stat sb;
+    off_t end = 0;
+    off_t requested = 0;
+    download_entry_t *retry = NULL;
+    int r = 0;
+
+    assert(entry != NULL);
+
+    if (entry->state != DOWNLOAD_DONE) {
+        return;
+    }
+
+    r = get_rpm_header_end(entry->dst, &end);
+
+    if (r == 1) {
+        get_rpm_info(entry->dst);
+        return;
+    } else if (r == -1) {
+        fprintf(stderr, _("*** %s is not an RPM package\n"), entry->src);
+        fflush(stderr);
+        return;
+    }
+
+    /* the server sent less than was asked for, there is no more */
+    if (entry->range != NULL) {
+        requested = strtoll(strchr(entry->range, '-') + 1, NULL, 10) + 1;
+    }
+
+    if (entry->range == NULL || stat(entry->dst, &sb) == -1 || sb.st_size < requested) {
+        fprintf(stderr, _("*** %s is truncated\n"), entry->src);
+        fflush(stderr);
+        return;
+    }
+
+    if (header_retries == NULL) {
+        header_retries = init_download_queue(workri);
+        header_retries->done = download_done;
+    }
+
+    DEBUG_PRINT("fetching %jd bytes of %s\n", (intmax_t) end, entry->src);
+    retry = add_download(header_retries, entry->src, entry->dst);
+    xasprintf(&retry->range, "0-%jd", (intmax_t) end - 1);
+    return;
+}
+
+/*
+ * Download queue callback.  Packages arrive here in queue order while
+ * later packages are still downloading.  Streamed packages have
+ * already been read and extracted, they only need to be added as
+ * peers.
+ */
+static void download_done(const download_entry_t *entry, __attribute__((unused)) void *data)
+{
+    rpm_stream_t *stream = NULL;
+    Header h;
+
+    assert(entry != NULL);
+
+    if (headers_only) {
+        header_done(entry);
+        return;
+    } else if (entry->sink_data == NULL) {
+        get_rpm_info(entry->dst);
+    } else {
+        stream = entry->sink_data;
+
+        if (entry->state != DOWNLOAD_DONE || stream->hdr == NULL) {
+            return;
+        }
+
+        /* the header cache owns the header, same as get_rpm_header() */
+        h = stream->hdr;
+        stream->hdr = NULL;
+        cache_rpm_header(workri, entry->dst, h);
+
+        if (allowed_arch(workri, get_rpm_header_arch(h))) {
+            add_extracted_peer(&workri->peers, whichbuild, entry->dst, h, stream->cols, stream->files, stream->root, stream->arena);
+            stream->cols = NULL;
+            stream->files = NULL;
+            stream->root = NULL;
+            stream->arena = NULL;
+        }
+    }
+
+    /* packages with a digest were not found in the download cache */
+    if (entry->state == DOWNLOAD_DONE && entry->digest != NULL) {
+        cache_store(workri, basename(entry->dst), entry->digest, entry->dst);
+    }
+
+    return;
+}
+
+/*
+ * Return true if the RPM file at path is a debuginfo or debugsource
+ * package.  The package name is the file name up to the version.
+ */
+static bool is_debug_package_file(const char *path)
+{
+    const char *pkg = NULL;
+    const char *end = NULL;
+    size_t len = 0;
+    int i = 0;
+
+    assert(path != NULL);
+
+    pkg = strrchr(path, '/');
+    pkg = (pkg == NULL) ? path : pkg + 1;
+    end = pkg + strlen(pkg);
+
+    /* drop "-release.arch.rpm" and "-version" */
+    for (i = 0; i < 2 && end != NULL; i++) {
+        end = memrchr(pkg, '-', end - pkg);
+    }
+
+    if (end == NULL) {
+        return false;
+    }
+
+    len = end - pkg;
+
+    if (len >= strlen(DEBUGINFO_SUFFIX) && !strncmp(end - strlen(DEBUGINFO_SUFFIX), DEBUGINFO_SUFFIX, strlen(DEBUGINFO_SUFFIX))) {
+        return true;
+    }
+
+    if (len >= strlen(DEBUGSOURCE_SUFFIX) && !strncmp(end - strlen(DEBUGSOURCE_SUFFIX), DEBUGSOURCE_SUFFIX, strlen(DEBUGSOURCE_SUFFIX))) {
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Queue a package download.  Packages from a Koji build (rpm is not
+ * NULL) are taken from the download cache if they are there, they are
+ * still queued so they reach download_done() in order.  Unless we are
+ * only fetching builds, the package is read and extracted while it
+ * downloads.  Packages that will be added to the cache or extracted
+ * later are always written to dst.  Debug packages are not queued at
+ * all if the debug_packages setting is 'skip'.  For gather_headers()
+ * only the start of each package is requested and nothing is
+ * extracted or added to the cache.
+ */
+static void queue_package(download_queue_t *queue, const char *src, const char *dst, const koji_rpmlist_entry_t *rpm)
+{
+    download_entry_t *entry = NULL;
+    bool debug = is_debug_package_file(dst);
+    bool keep = false;
+
+    if (!fetch_only && debug && workri->debug_packages == DEBUGPKG_SKIP) {
+        DEBUG_PRINT("skipping debug package %s\n", dst);
+        return;
+    }
+
+    entry = add_download(queue, src, dst);
+
+    if (workri->cache_dir != NULL && rpm != NULL && rpm->payloadhash != NULL) {
+        if (cache_fetch(workri, basename(dst), rpm->payloadhash, rpm->size, dst)) {
+            entry->state = DOWNLOAD_DONE;
+            return;
+        }
+
+        if (!headers_only) {
+            entry->digest = strdup(rpm->payloadhash);
+            assert(entry->digest != NULL);
+        }
+    }
+
+    if (headers_only) {
+        xasprintf(&entry->range, "0-%d", HEADER_FETCH_SIZE - 1);
+        return;
+    }
+
+    /* lazy extraction reads the payload again from the kept RPM */
+    if (!fetch_only) {
+        keep = workri->keep_rpms || entry->digest != NULL || workri->extract_mode == EXTRACT_LAZY;
+        keep = keep || (debug && workri->debug_packages == DEBUGPKG_LAZY);
+        stream_rpm_download(workri, entry, keep);
     }
 
     return;
@@ -181,8 +379,10 @@ static int copytree(const char *fpath, const struct stat *sb, int tflag, struct
     char *workfpath = NULL;
     char *bufpath = NULL;
     char *copysrc = NULL;
+    char *destdir = NULL;
     Header h;
     const char *arch = NULL;
+    copy_strategy_t strategy = COPY_FAILED;
     int ret = 0;
 
     /*
@@ -223,11 +423,38 @@ static int copytree(const char *fpath, const struct stat *sb, int tflag, struct
             return 0;
         }
 
-        if (copyfile(copysrc, bufpath, true, false)) {
-            fprintf(stderr, _("*** error copying file %s: %s\n"), bufpath, strerror(errno));
+        if (workri->debug_packages == DEBUGPKG_SKIP && is_debug_package(h)) {
+            return 0;
+        }
+
+        destdir = strdup(bufpath);
+        assert(destdir != NULL);
+        *strrchr(destdir, '/') = '\0';
+
+        if (mkdirp(destdir, mode)) {
+            fprintf(stderr, _("*** error creating directory %s: %s\n"), destdir, strerror(errno));
+        } else if (workri->no_copy) {
+            /* read the package in place, extraction still goes to the workdir */
+            (void) unlink(bufpath);
+
+            if (symlink(copysrc, bufpath) == 0) {
+                strategy = COPY_SYMLINK;
+            } else {
+                fprintf(stderr, _("*** error linking file %s: %s\n"), bufpath, strerror(errno));
+            }
+        } else {
+            strategy = fastcopy(copysrc, bufpath, true);
+        }
+
+        if (strategy == COPY_FAILED) {
+            fprintf(stderr, _("*** error copying file %s\n"), bufpath);
             ret = -1;
+        } else if (workri->verbose) {
+            printf(_("Collected %s (%s)\n"), workfpath, copy_strategy_desc(strategy));
         }
 
+        free(destdir);
+
         /* Gather the RPM header for packages */
         get_rpm_info(bufpath);
     } else {
@@ -242,6 +469,66 @@ static int copytree(const char *fpath, const struct stat *sb, int tflag, struct
     return ret;
 }
 
+/*
+ * Used to read the RPM headers in a local build tree where it is,
+ * for gather_headers().
+ */
+static int read_header(const char *fpath, const struct stat *sb, int tflag, __attribute__((unused)) struct FTW *ftwbuf)
+{
+    Header h;
+
+    /* Ignore unreadable things */
+    if (tflag == FTW_DNR || tflag == FTW_NS || tflag == FTW_SLN) {
+        fprintf(stderr, _("*** unable to read %s, skipping\n"), fpath);
+        fflush(stderr);
+        return 0;
+    }
+
+    if (!S_ISREG(sb->st_mode) && !S_ISLNK(sb->st_mode)) {
+        return 0;
+    }
+
+    h = get_rpm_header(workri, fpath);
+
+    if (h == NULL) {
+        return 0;
+    }
+
+    if (workri->debug_packages == DEBUGPKG_SKIP && is_debug_package(h)) {
+        return 0;
+    }
+
+    get_rpm_info(fpath);
+    return 0;
+}
+
+/*
+ * Run a download queue and free it.  For gather_headers() this keeps
+ * going until every package that needed more of its header has it.
+ */
+static void run_queue(const struct rpminspect *ri, download_queue_t *queue)
+{
+    download_queue_t *retries = NULL;
+    stats_mark_t mark;
+
+    assert(queue != NULL);
+
+    /* download the packages, RPM headers are gathered as they arrive */
+    start_stats(ri, &mark);
+    run_download_queue(queue);
+
+    while (header_retries != NULL) {
+        retries = header_retries;
+        header_retries = NULL;
+        run_download_queue(retries);
+        free_download_queue(retries);
+    }
+
+    end_stats(ri, &mark, STATS_PHASE, "download");
+    free_download_queue(queue);
+    return;
+}
+
 /*
  * Download helper for libcurl
  */
@@ -329,10 +616,14 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
     string_list_t *filter = NULL;
     string_entry_t *filtered_rpm = NULL;
     bool filtered = false;
+    download_queue_t *queue = NULL;
 
     assert(build != NULL);
     assert(build->builds != NULL);
 
+    queue = init_download_queue(ri);
+    queue->done = download_done;
+
     /* Iterate over list of builds, each with a list of packages */
     TAILQ_FOREACH(buildentry, build->builds, builditems) {
         if (TAILQ_EMPTY(buildentry->rpms)) {
@@ -356,6 +647,7 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
             if (mkdirp(dst, mode)) {
                 fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
                 fflush(stderr);
+                free_download_queue(queue);
                 return -1;
             }
 
@@ -449,6 +741,7 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
             if (mkdirp(dst, mode)) {
                 fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
                 fflush(stderr);
+                free_download_queue(queue);
                 return -1;
             }
 
@@ -513,11 +806,8 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
                       rpm->arch,
                       pkg);
 
-            /* download the package */
-            curl_helper(workri->verbose, src, dst);
-
-            /* gather the RPM header */
-            get_rpm_info(dst);
+            /* queue the package for download */
+            queue_package(queue, src, dst, rpm);
 
             /* start over */
             free(src);
@@ -529,6 +819,7 @@ static int download_build(const struct rpminspect *ri, struct koji_build *build)
         filter = NULL;
     }
 
+    run_queue(ri, queue);
     return 0;
 }
 
@@ -545,11 +836,15 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
     char *tail = NULL;
     koji_task_entry_t *descendent = NULL;
     string_entry_t *entry = NULL;
+    download_queue_t *queue = NULL;
 
     assert(ri != NULL);
     assert(task != NULL);
     assert(task->descendents != NULL);
 
+    queue = init_download_queue(ri);
+    queue->done = download_done;
+
     TAILQ_FOREACH(descendent, task->descendents, items) {
         /* skip if we have nothing */
         if (TAILQ_EMPTY(descendent->srpms) && TAILQ_EMPTY(descendent->rpms)) {
@@ -566,6 +861,7 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
         if (mkdirp(dst, mode)) {
             fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
             fflush(stderr);
+            free_download_queue(queue);
             return -1;
         }
 
@@ -584,6 +880,7 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
             if (mkdirp(dst, mode)) {
                 fprintf(stderr, _("*** error creating directory %s: %s\n"), dst, strerror(errno));
                 fflush(stderr);
+                free_download_queue(queue);
                 return -1;
             }
 
@@ -595,10 +892,7 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
             assert(dst != NULL);
 
             xasprintf(&src, "%s/work/%s", workri->kojiursine, entry->data);
-            curl_helper(workri->verbose, src, dst);
-
-            /* gather the RPM header */
-            get_rpm_info(dst);
+            queue_package(queue, src, dst, NULL);
 
             free(dst);
             free(src);
@@ -614,16 +908,14 @@ static int download_task(const struct rpminspect *ri, struct koji_task *task)
             }
 
             xasprintf(&src, "%s/work/%s", workri->kojiursine, entry->data);
-            curl_helper(workri->verbose, src, dst);
-
-            /* gather the RPM header */
-            get_rpm_info(dst);
+            queue_package(queue, src, dst, NULL);
 
             free(dst);
             free(src);
         }
     }
 
+    run_queue(ri, queue);
     return 0;
 }
 
@@ -645,31 +937,17 @@ static bool is_task_id(const char *id)
     return true;
 }
 
-/**
- * @brief Collects specified builds in to the working directory.
- *
- * For each build that is not NULL, determine if it is local or remote
- * and collect it in the appropriate manner.  For local builds, that
- * is just copying files.  For remote builds, **libcurl** is called to
- * download files.  Files are downloaded to each build's subdirectory
- * in the program working directory.  This function gathers both
- * before and after builds if specified at run time.
- *
- * @param ri The main program data structure; contains the before and
- *        after build specifications from the command line.
- * @param fo True if '-f' (fetch only) specified, false otherwise.
- * @return 0 on success, non-zero on failure.
+/*
+ * Collect the after build and then the before build, if there is one.
  */
-int gather_builds(struct rpminspect *ri, bool fo) {
+static int collect_builds(struct rpminspect *ri) {
     struct koji_build *build = NULL;
     struct koji_task *task = NULL;
+    stats_mark_t mark;
 
     assert(ri != NULL);
     assert(ri->after != NULL);
 
-    workri = ri;
-    fetch_only = fo;
-
     /* process after first so the temp directory gets the NV of that pkg */
     if (ri->after != NULL) {
         whichbuild = AFTER_BUILD;
@@ -683,13 +961,17 @@ int gather_builds(struct rpminspect *ri, bool fo) {
 
             set_worksubdir(ri, LOCAL_WORKDIR, NULL, NULL);
 
-            /* copy after tree */
-            if (nftw(ri->after, copytree, 15, FTW_PHYS) == -1) {
+            /* copy after tree, or read its headers in place */
+            start_stats(ri, &mark);
+
+            if (nftw(ri->after, headers_only ? read_header : copytree, 15, FTW_PHYS) == -1) {
                 fprintf(stderr, _("*** error gathering build %s: %s\n"), ri->after, strerror(errno));
                 fflush(stderr);
                 return -1;
             }
 
+            end_stats(ri, &mark, STATS_PHASE, "copy");
+
             /* clean up */
             prune_local(whichbuild);
         } else if (is_task_id(ri->after) && (task = get_koji_task(ri, ri->after)) != NULL) {
@@ -730,13 +1012,17 @@ int gather_builds(struct rpminspect *ri, bool fo) {
     if (is_local_build(ri->before) || is_local_rpm(ri, ri->before)) {
         set_worksubdir(ri, LOCAL_WORKDIR, NULL, NULL);
 
-        /* copy before tree */
-        if (nftw(ri->before, copytree, 15, FTW_PHYS) == -1) {
+        /* copy before tree, or read its headers in place */
+        start_stats(ri, &mark);
+
+        if (nftw(ri->before, headers_only ? read_header : copytree, 15, FTW_PHYS) == -1) {
             fprintf(stderr, _("*** error gathering build %s: %s\n"), ri->before, strerror(errno));
             fflush(stderr);
             return -1;
         }
 
+        end_stats(ri, &mark, STATS_PHASE, "copy");
+
         /* clean up */
         prune_local(whichbuild);
     } else if (is_task_id(ri->before) && (task = get_koji_task(ri, ri->before)) != NULL) {
@@ -767,3 +1053,80 @@ int gather_builds(struct rpminspect *ri, bool fo) {
 
     return 0;
 }
+
+/**
+ * @brief Collects specified builds in to the working directory.
+ *
+ * For each build that is not NULL, determine if it is local or remote
+ * and collect it in the appropriate manner.  For local builds, that
+ * is just copying files.  For remote builds, **libcurl** is called to
+ * download files.  Files are downloaded to each build's subdirectory
+ * in the program working directory.  This function gathers both
+ * before and after builds if specified at run time.
+ *
+ * Gathering is a pipeline.  Packages are downloaded concurrently, the
+ * main thread reads each package header in order as its download
+ * completes, and payload extraction is queued for worker threads.
+ * This function returns once every payload has been extracted.
+ *
+ * @param ri The main program data structure; contains the before and
+ *        after build specifications from the command line.
+ * @param fo True if '-f' (fetch only) specified, false otherwise.
+ * @return 0 on success, non-zero on failure.
+ */
+int gather_builds(struct rpminspect *ri, bool fo) {
+    int ret = 0;
+    stats_mark_t mark;
+
+    assert(ri != NULL);
+
+    workri = ri;
+    fetch_only = fo;
+
+    if (!fetch_only) {
+        ri->payload_files = payload_files(ri);
+        extract_pool = init_extract_pool(ri, 0);
+    }
+
+    ret = collect_builds(ri);
+    prune_cache(ri);
+
+    /* wait for the extraction workers, then match up the files */
+    if (extract_pool != NULL) {
+        start_stats(ri, &mark);
+        finish_extract_pool(extract_pool);
+        extract_pool = NULL;
+        end_stats(ri, &mark, STATS_PHASE, "extraction");
+
+        start_stats(ri, &mark);
+        link_peer_files(ri->peers);
+        end_stats(ri, &mark, STATS_PHASE, "peers");
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Read the RPM headers of the builds without extracting them.
+ *
+ * Used by --estimate.  Local packages are read where they are.  For
+ * remote builds only the start of each package holding its header is
+ * downloaded, using HTTP range requests.  Servers that do not do range
+ * requests send the whole package, which still works.  Each package
+ * is added as a peer with its header and no files.
+ *
+ * @param ri The main program data structure.
+ * @return 0 on success, non-zero on failure.
+ */
+int gather_headers(struct rpminspect *ri) {
+    int ret = 0;
+
+    assert(ri != NULL);
+
+    workri = ri;
+    fetch_only = false;
+    headers_only = true;
+    ret = collect_builds(ri);
+    headers_only = false;
+    return ret;
+}
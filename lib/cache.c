@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <openssl/md5.h>
+#include <rpm/rpmlib.h>
+#include <rpm/rpmts.h>
+#include <rpm/header.h>
+#include "rpminspect.h"
+
+/**
+ * @file cache.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Download cache shared between runs.
+ *
+ * When cache_dir is set in the configuration file, packages
+ * downloaded from Koji builds are kept in that directory for later
+ * runs.  Entries are keyed by the payload digest Koji reports for the
+ * package and the package file name (NVRA):
+ *
+ *     CACHE_DIR/XX/DIGEST-NAME-VERSION-RELEASE.ARCH.rpm
+ *
+ * where XX is the first two characters of the digest.  A cached
+ * package is checked against the digest and then hardlinked in to
+ * the working directory.  If that is not possible, the package is
+ * reflinked or copied.
+ *
+ * Any number of rpminspect processes can use the same cache.  They
+ * hold a shared flock() on CACHE_DIR/.lock while adding and linking
+ * entries.  New entries are written under a temporary name and
+ * renamed in to place, so a partial entry is never seen.  Pruning the
+ * cache takes the lock exclusively.  The modification time of an
+ * entry is updated on every hit and the least recently used entries
+ * are removed first when the cache grows past cache_size.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/* A cache entry found when pruning */
+typedef struct _cache_file_t {
+    char *path;
+    off_t size;
+    time_t mtime;
+} cache_file_t;
+
+/*
+ * Digests come from the Koji hub and end up in a path name, only
+ * accept hex strings.
+ */
+static bool valid_digest(const char *digest)
+{
+    size_t len = 0;
+
+    if (digest == NULL) {
+        return false;
+    }
+
+    len = strlen(digest);
+    return len >= 2 && strspn(digest, "0123456789abcdefABCDEF") == len;
+}
+
+/*
+ * Open and lock the cache lock file.  op is passed to flock().
+ * Returns the locked descriptor, close it to release the lock, or -1.
+ */
+static int lock_cache(const struct rpminspect *ri, const int op)
+{
+    char *lockfile = NULL;
+    int fd = -1;
+
+    assert(ri != NULL);
+    assert(ri->cache_dir != NULL);
+
+    if (mkdirp(ri->cache_dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
+        fprintf(stderr, _("*** unable to create cache directory %s: %s\n"), ri->cache_dir, strerror(errno));
+        fflush(stderr);
+        return -1;
+    }
+
+    xasprintf(&lockfile, "%s/.lock", ri->cache_dir);
+    fd = open(lockfile, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+    if (fd == -1) {
+        fprintf(stderr, _("*** unable to open %s: %s\n"), lockfile, strerror(errno));
+        fflush(stderr);
+        free(lockfile);
+        return -1;
+    }
+
+    while (flock(fd, op) == -1) {
+        if (errno != EINTR) {
+            if (errno != EWOULDBLOCK) {
+                fprintf(stderr, _("*** unable to lock %s: %s\n"), lockfile, strerror(errno));
+                fflush(stderr);
+            }
+
+            close(fd);
+            free(lockfile);
+            return -1;
+        }
+    }
+
+    free(lockfile);
+    return fd;
+}
+
+/*
+ * Compute the MD5 digest of the main header and payload of a package,
+ * which is what its SIGMD5 tag holds.  Returns the digest as a hex
+ * string, or NULL if the package cannot be read.  Free the result.
+ */
+static char *package_md5(const char *pkg)
+{
+    static const unsigned char header_magic[] = { 0x8e, 0xad, 0xe8, 0x01 };
+    unsigned char buf[BUFSIZ];
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    MD5_CTX md5c;
+    off_t offset = RPM_LEAD_SIZE;
+    off_t size = 0;
+    ssize_t len = 0;
+    char *ret = NULL;
+    int fd = -1;
+    int i = 0;
+
+    assert(pkg != NULL);
+
+    if ((fd = open(pkg, O_RDONLY | O_CLOEXEC)) == -1) {
+        return NULL;
+    }
+
+    /* skip the lead and the signature header, which is padded */
+    if (pread(fd, buf, 16, offset) != 16 || memcmp(buf, header_magic, sizeof(header_magic))) {
+        close(fd);
+        return NULL;
+    }
+
+    size = 16 + (16 * (off_t) ((buf[8] << 24) | (buf[9] << 16) | (buf[10] << 8) | buf[11]));
+    size += (off_t) ((buf[12] << 24) | (buf[13] << 16) | (buf[14] << 8) | buf[15]);
+    offset += (size + 7) & ~7;
+
+    if (lseek(fd, offset, SEEK_SET) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    MD5_Init(&md5c);
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        MD5_Update(&md5c, buf, len);
+    }
+
+    close(fd);
+
+    if (len == -1) {
+        return NULL;
+    }
+
+    MD5_Final(digest, &md5c);
+    ret = calloc((MD5_DIGEST_LENGTH * 2) + 1, sizeof(*ret));
+    assert(ret != NULL);
+
+    for (i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        sprintf(&ret[i * 2], "%02x", (unsigned int) digest[i]);
+    }
+
+    return ret;
+}
+
+/*
+ * Read the RPM header of a package and check its SIGMD5 against the
+ * digest Koji reported.  rpm checks the header digests while reading
+ * it, and the header and payload are checked against SIGMD5 here so a
+ * truncated or corrupted payload is not used.  Returns the header on
+ * a match, NULL otherwise.
+ */
+static Header read_verified_header(const char *pkg, const char *digest)
+{
+    rpmts ts;
+    FD_t fd;
+    rpmRC result;
+    Header h = NULL;
+    char *sigmd5 = NULL;
+    char *md5 = NULL;
+
+    assert(pkg != NULL);
+    assert(digest != NULL);
+
+    fd = Fopen(pkg, "r.ufdio");
+
+    if (fd == NULL || Ferror(fd)) {
+        if (fd) {
+            Fclose(fd);
+        }
+
+        return NULL;
+    }
+
+    ts = rpmtsCreate();
+    rpmtsSetVSFlags(ts, _RPMVSF_NOSIGNATURES);
+    result = rpmReadPackageFile(ts, fd, pkg, &h);
+    rpmtsFree(ts);
+    Fclose(fd);
+
+    if (result != RPMRC_OK) {
+        return NULL;
+    }
+
+    sigmd5 = headerGetAsString(h, RPMTAG_SIGMD5);
+
+    if (sigmd5 == NULL || strcasecmp(sigmd5, digest) || (md5 = package_md5(pkg)) == NULL || strcasecmp(md5, sigmd5)) {
+        headerFree(h);
+        h = NULL;
+    }
+
+    free(sigmd5);
+    free(md5);
+    return h;
+}
+
+/**
+ * @brief Get a package from the download cache.
+ *
+ * If the package is in the cache, place it at dst and add its header
+ * to the header cache.  The cached package must match the digest and,
+ * if it is known, the size reported by Koji.  Entries that do not
+ * match are removed from the cache.
+ *
+ * @param ri The main program data structure.
+ * @param pkg The package file name (NVRA.rpm).
+ * @param digest The payload digest Koji reports for the package.
+ * @param size The package size Koji reports, or a value <= 0 if it
+ *        is not known.
+ * @param dst Where the package is needed.
+ * @return True if dst now holds the package, false if it still needs
+ *         to be downloaded.
+ */
+bool cache_fetch(struct rpminspect *ri, const char *pkg, const char *digest, const long long int size, const char *dst)
+{
+    char *path = NULL;
+    struct stat sb;
+    Header h = NULL;
+    int lock = -1;
+    bool found = false;
+
+    assert(ri != NULL);
+    assert(pkg != NULL);
+    assert(dst != NULL);
+
+    if (ri->cache_dir == NULL || !valid_digest(digest)) {
+        return false;
+    }
+
+    if ((lock = lock_cache(ri, LOCK_SH)) == -1) {
+        return false;
+    }
+
+    xasprintf(&path, "%s/%.2s/%s-%s", ri->cache_dir, digest, digest, pkg);
+
+    if (stat(path, &sb) == 0) {
+        if (size > 0 && sb.st_size != size) {
+            DEBUG_PRINT("cached %s has the wrong size, removing\n", path);
+            unlink(path);
+        } else if (fastcopy(path, dst, false) != COPY_FAILED) {
+            /* mark the entry as recently used */
+            utimensat(AT_FDCWD, path, NULL, 0);
+            found = true;
+        }
+    }
+
+    close(lock);
+
+    if (found) {
+        h = read_verified_header(dst, digest);
+
+        if (h == NULL) {
+            fprintf(stderr, _("*** cached %s does not match its digest, downloading it again\n"), pkg);
+            fflush(stderr);
+            unlink(dst);
+            unlink(path);
+            found = false;
+        } else {
+            cache_rpm_header(ri, dst, h);
+
+            if (ri->verbose) {
+                printf(_("Using cached %s\n"), pkg);
+            }
+        }
+    }
+
+    free(path);
+    return found;
+}
+
+/**
+ * @brief Add a downloaded package to the download cache.
+ *
+ * The package is only added if its header and payload match the
+ * digest Koji reported.  Nothing happens if the package is already
+ * cached.
+ *
+ * @param ri The main program data structure.
+ * @param pkg The package file name (NVRA.rpm).
+ * @param digest The payload digest Koji reports for the package.
+ * @param src The downloaded package.
+ */
+void cache_store(struct rpminspect *ri, const char *pkg, const char *digest, const char *src)
+{
+    Header h = NULL;
+    char *dir = NULL;
+    char *path = NULL;
+    char *tmp = NULL;
+    int lock = -1;
+
+    assert(ri != NULL);
+    assert(pkg != NULL);
+    assert(src != NULL);
+
+    if (ri->cache_dir == NULL || !valid_digest(digest)) {
+        return;
+    }
+
+    /* only cache what Koji says we should have gotten */
+    if ((h = read_verified_header(src, digest)) == NULL) {
+        fprintf(stderr, _("*** %s does not match the digest from Koji, not caching it\n"), pkg);
+        fflush(stderr);
+        return;
+    }
+
+    /* the header cache already has the header of the download */
+    headerFree(h);
+
+    if ((lock = lock_cache(ri, LOCK_SH)) == -1) {
+        return;
+    }
+
+    xasprintf(&dir, "%s/%.2s", ri->cache_dir, digest);
+    xasprintf(&path, "%s/%s-%s", dir, digest, pkg);
+
+    if (access(path, F_OK) == 0) {
+        /* another run cached it first */
+        utimensat(AT_FDCWD, path, NULL, 0);
+    } else if (mkdirp(dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
+        fprintf(stderr, _("*** unable to create cache directory %s: %s\n"), dir, strerror(errno));
+        fflush(stderr);
+    } else {
+        xasprintf(&tmp, "%s/.%s.%d", dir, pkg, getpid());
+        unlink(tmp);
+
+        if (fastcopy(src, tmp, false) == COPY_FAILED || rename(tmp, path) == -1) {
+            fprintf(stderr, _("*** unable to add %s to the cache: %s\n"), pkg, strerror(errno));
+            fflush(stderr);
+            unlink(tmp);
+        }
+
+        free(tmp);
+    }
+
+    close(lock);
+    free(path);
+    free(dir);
+    return;
+}
+
+/* qsort() comparator, oldest entries first */
+static int cmp_mtime(const void *a, const void *b)
+{
+    const cache_file_t *x = a;
+    const cache_file_t *y = b;
+
+    if (x->mtime < y->mtime) {
+        return -1;
+    } else if (x->mtime > y->mtime) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Shrink the download cache to its size limit.
+ *
+ * The least recently used packages are removed until the cache is no
+ * larger than cache_size.  If another process is using the cache, the
+ * cache is left alone and pruned by a later run.
+ *
+ * @param ri The main program data structure.
+ */
+void prune_cache(const struct rpminspect *ri)
+{
+    DIR *top = NULL;
+    DIR *sub = NULL;
+    struct dirent *de = NULL;
+    struct dirent *se = NULL;
+    struct stat sb;
+    char *subdir = NULL;
+    char *path = NULL;
+    cache_file_t *files = NULL;
+    size_t nfiles = 0;
+    size_t alloc = 0;
+    size_t i = 0;
+    uint64_t total = 0;
+    int lock = -1;
+
+    assert(ri != NULL);
+
+    if (ri->cache_dir == NULL || ri->cache_size == 0) {
+        return;
+    }
+
+    if ((lock = lock_cache(ri, LOCK_EX | LOCK_NB)) == -1) {
+        return;
+    }
+
+    if ((top = opendir(ri->cache_dir)) == NULL) {
+        close(lock);
+        return;
+    }
+
+    /* collect every entry, including temporary files left by crashes */
+    while ((de = readdir(top)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+
+        xasprintf(&subdir, "%s/%s", ri->cache_dir, de->d_name);
+
+        if ((sub = opendir(subdir)) == NULL) {
+            free(subdir);
+            continue;
+        }
+
+        while ((se = readdir(sub)) != NULL) {
+            if (!strcmp(se->d_name, ".") || !strcmp(se->d_name, "..")) {
+                continue;
+            }
+
+            xasprintf(&path, "%s/%s", subdir, se->d_name);
+
+            if (lstat(path, &sb) == -1 || !S_ISREG(sb.st_mode)) {
+                free(path);
+                continue;
+            }
+
+            if (nfiles == alloc) {
+                alloc = (alloc == 0) ? 64 : alloc * 2;
+                files = realloc(files, alloc * sizeof(*files));
+                assert(files != NULL);
+            }
+
+            files[nfiles].path = path;
+            files[nfiles].size = sb.st_size;
+            files[nfiles].mtime = sb.st_mtime;
+            total += sb.st_size;
+            nfiles++;
+        }
+
+        closedir(sub);
+        free(subdir);
+    }
+
+    closedir(top);
+
+    if (total > ri->cache_size) {
+        qsort(files, nfiles, sizeof(*files), cmp_mtime);
+
+        for (i = 0; i < nfiles && total > ri->cache_size; i++) {
+            DEBUG_PRINT("removing %s from the cache\n", files[i].path);
+
+            if (unlink(files[i].path) == 0) {
+                total -= files[i].size;
+            }
+        }
+    }
+
+    for (i = 0; i < nfiles; i++) {
+        free(files[i].path);
+    }
+
+    free(files);
+    close(lock);
+    return;
+}
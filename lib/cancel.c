@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "rpminspect.h"
+
+/**
+ * @file cancel.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Stop a run part way through.
+ *
+ * With --fail-fast, the first result at or above the failure
+ * threshold calls cancel_run().  From then on no more inspections
+ * are started, foreach_peer_file() stops visiting files, run_cmd()
+ * does not start new commands, and the process group of every
+ * command still running is sent SIGTERM.  Once enable_cancel() has
+ * been called, run_cmd() starts each command in its own process group
+ * and registers it here while it runs, so whatever the command itself
+ * started goes too.  Without --fail-fast commands stay in rpminspect's
+ * process group, so a Ctrl-C at the terminal reaches them as well.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+static bool cancelled = false;
+static bool enabled = false;
+
+/* Process groups of the commands run_cmd() is waiting for */
+static pid_t *children = NULL;
+static size_t nchildren = 0;
+static size_t children_alloc = 0;
+static pthread_mutex_t children_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Run commands so cancel_run() can stop them.
+ *
+ * Called once for --fail-fast, before any command runs.
+ */
+void enable_cancel(void)
+{
+    __atomic_store_n(&enabled, true, __ATOMIC_RELEASE);
+    return;
+}
+
+/**
+ * @brief Has enable_cancel() been called?
+ */
+bool cancel_enabled(void)
+{
+    return __atomic_load_n(&enabled, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Cancel the rest of the run.
+ *
+ * Safe to call from any thread and more than once.
+ */
+void cancel_run(void)
+{
+    size_t i = 0;
+
+    if (__atomic_exchange_n(&cancelled, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+
+    pthread_mutex_lock(&children_lock);
+
+    for (i = 0; i < nchildren; i++) {
+        DEBUG_PRINT("terminating process group %d\n", (int) children[i]);
+        (void) kill(-children[i], SIGTERM);
+    }
+
+    pthread_mutex_unlock(&children_lock);
+    return;
+}
+
+/**
+ * @brief Has cancel_run() been called?
+ */
+bool run_cancelled(void)
+{
+    return __atomic_load_n(&cancelled, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Note a command that is running in process group pgid.
+ *
+ * If the run has already been cancelled, the process group is sent
+ * SIGTERM right away.
+ *
+ * @param pgid Process group of the command.
+ */
+void register_child(const pid_t pgid)
+{
+    pthread_mutex_lock(&children_lock);
+
+    if (nchildren == children_alloc) {
+        children_alloc = (children_alloc == 0) ? 8 : children_alloc * 2;
+        children = realloc(children, children_alloc * sizeof(*children));
+        assert(children != NULL);
+    }
+
+    children[nchildren++] = pgid;
+
+    /* cancel_run() may have been called before the child was added */
+    if (run_cancelled()) {
+        (void) kill(-pgid, SIGTERM);
+    }
+
+    pthread_mutex_unlock(&children_lock);
+    return;
+}
+
+/**
+ * @brief Forget a command once it has been waited for.
+ *
+ * @param pgid Process group of the command.
+ */
+void unregister_child(const pid_t pgid)
+{
+    size_t i = 0;
+
+    pthread_mutex_lock(&children_lock);
+
+    for (i = 0; i < nchildren; i++) {
+        if (children[i] == pgid) {
+            children[i] = children[--nchildren];
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&children_lock);
+    return;
+}
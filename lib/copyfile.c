@@ -36,8 +36,77 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
 #include "rpminspect.h"
 
+/*
+ * Copy the contents of one open file to another, both positioned at
+ * the start.  copy_file_range() is used if the kernel and filesystems
+ * support it, otherwise the data goes through a large buffer.  Returns
+ * COPY_RANGE or COPY_BUFFER on success, COPY_FAILED on error with
+ * errno set.
+ */
+static copy_strategy_t copy_data(int in, int out)
+{
+    ssize_t n = 0;
+    ssize_t w = 0;
+    ssize_t off = 0;
+    bool ranged = false;
+    char *buf = NULL;
+
+    while ((n = copy_file_range(in, NULL, out, NULL, COPY_BUFFER_SIZE, 0)) != 0) {
+        if (n > 0) {
+            ranged = true;
+            continue;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (!ranged && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+            /* not supported here, fall back on a buffered copy */
+            break;
+        }
+
+        return COPY_FAILED;
+    }
+
+    if (n == 0) {
+        return COPY_RANGE;
+    }
+
+    buf = malloc(COPY_BUFFER_SIZE);
+    assert(buf != NULL);
+
+    while ((n = read(in, buf, COPY_BUFFER_SIZE)) != 0) {
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            free(buf);
+            return COPY_FAILED;
+        }
+
+        for (off = 0; off < n; off += w) {
+            w = write(out, buf + off, n - off);
+
+            if (w == -1) {
+                if (errno == EINTR) {
+                    w = 0;
+                    continue;
+                }
+
+                free(buf);
+                return COPY_FAILED;
+            }
+        }
+    }
+
+    free(buf);
+    return COPY_BUFFER;
+}
+
 /**
  * @brief Generic file copy function.
  *
@@ -54,11 +123,8 @@
  * @return 0 on success, -1 on error.
  */
 int copyfile(const char *src, const char *dest, bool force, bool verbose) {
-    FILE *in = NULL, *out = NULL;
-    int out_fd;                 /* use open() to test if file exists, then
-                                 * fdopen for out */
-    char buf[BUFSIZ];
-    size_t s;
+    int in_fd;
+    int out_fd;                 /* use open() to test if file exists */
     int success = 0;
     char *destpath = NULL;
     char *destdir = NULL;
@@ -107,7 +173,7 @@ int copyfile(const char *src, const char *dest, bool force, bool verbose) {
     }
 
     /* copy src to dest */
-    if ((in = fopen(src, "r")) == NULL) {
+    if ((in_fd = open(src, O_RDONLY | O_CLOEXEC)) == -1) {
         fprintf(stderr, _("*** Unable to open %s for reading: %s\n"), src, strerror(errno));
         fflush(stderr);
         return -1;
@@ -129,48 +195,44 @@ int copyfile(const char *src, const char *dest, bool force, bool verbose) {
                 if (remove(dest)) {
                     fprintf(stderr, _("*** Unable to remove %s: %s\n"), dest, strerror(errno));
                     fflush(stderr);
+                    close(in_fd);
                     return -1;
                 } else {
                     if ((out_fd = open(dest, oflags, mode)) == -1) {
                         fprintf(stderr, _("*** Still unable to open %s, giving up\n"), dest);
                         fflush(stderr);
+                        close(in_fd);
+                        return -1;
                     }
                 }
             } else {
                 putc('\n', stderr);
                 fflush(stderr);
+                close(in_fd);
                 return -1;
             }
         } else {
             fprintf(stderr, _("*** Unable to open %s for writing: %s\n"), dest, strerror(errno));
             fflush(stderr);
+            close(in_fd);
             return -1;
         }
     }
 
-    if ((out = fdopen(out_fd, "wb")) == NULL) {
-        fprintf(stderr, _("*** Unable to open %s: %s\n"), dest, strerror(errno));
+    if (copy_data(in_fd, out_fd) == COPY_FAILED) {
+        fprintf(stderr, _("*** Error writing to %s: %s\n"), dest, strerror(errno));
         fflush(stderr);
-        return -1;
-    }
-
-    while ((s = fread(buf, sizeof(char), BUFSIZ, in)) > 0) {
-        if (fwrite(buf, sizeof(char), s, out) != s) {
-            fprintf(stderr, _("*** Error writing to %s: %s\n"), dest, strerror(errno));
-            fflush(stderr);
-            errno = 0;
-            success = -1;
-            break;
-        }
+        errno = 0;
+        success = -1;
     }
 
-    if (fflush(out) | fclose(out)) {
+    if (close(out_fd)) {
         fprintf(stderr, _("*** Error writing to %s: %s\n"), dest, strerror(errno));
         fflush(stderr);
         success = -1;
     }
 
-    fclose(in);
+    close(in_fd);
 
     if (success != 0) {
         remove(dest);
@@ -193,3 +255,129 @@ int copyfile(const char *src, const char *dest, bool force, bool verbose) {
 
     return success;
 }
+
+/**
+ * @brief Place a file at a destination as cheaply as possible.
+ *
+ * The strategies are tried in order: a reflink (FICLONE) so the two
+ * files share data blocks, a hardlink if both are on the same
+ * filesystem, copy_file_range(), and finally a copy through a large
+ * buffer.  A hardlinked destination is the same inode as the source,
+ * so callers must not modify it.  Unlike copyfile(), symlinks are
+ * followed and the destination directory must already exist.  Errors
+ * are reported on stderr.
+ *
+ * @param src Full path to source file.
+ * @param dest Full path to the destination file.
+ * @param force True to replace the destination if it already exists,
+ *              false otherwise.
+ * @return The strategy used to place the file, COPY_FAILED on error.
+ */
+copy_strategy_t fastcopy(const char *src, const char *dest, bool force)
+{
+    int in_fd = -1;
+    int out_fd = -1;
+    int oflags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+    copy_strategy_t strategy = COPY_FAILED;
+    struct stat sb;
+
+    assert(src != NULL);
+    assert(dest != NULL);
+
+    if (force && unlink(dest) == -1 && errno != ENOENT) {
+        fprintf(stderr, _("*** Unable to remove %s: %s\n"), dest, strerror(errno));
+        fflush(stderr);
+        return COPY_FAILED;
+    }
+
+    if ((in_fd = open(src, O_RDONLY | O_CLOEXEC)) == -1 || fstat(in_fd, &sb) == -1) {
+        fprintf(stderr, _("*** Unable to open %s for reading: %s\n"), src, strerror(errno));
+        fflush(stderr);
+
+        if (in_fd != -1) {
+            close(in_fd);
+        }
+
+        return COPY_FAILED;
+    }
+
+    if ((out_fd = open(dest, oflags, S_IRUSR | S_IWUSR)) == -1) {
+        fprintf(stderr, _("*** Unable to open %s for writing: %s\n"), dest, strerror(errno));
+        fflush(stderr);
+        close(in_fd);
+        return COPY_FAILED;
+    }
+
+#ifdef FICLONE
+    if (ioctl(out_fd, FICLONE, in_fd) == 0) {
+        strategy = COPY_REFLINK;
+    }
+#endif
+
+    if (strategy == COPY_FAILED) {
+        /* try a hardlink in place of the empty file */
+        close(out_fd);
+        out_fd = -1;
+
+        if (unlink(dest) == 0 && linkat(AT_FDCWD, src, AT_FDCWD, dest, AT_SYMLINK_FOLLOW) == 0) {
+            strategy = COPY_HARDLINK;
+        } else if ((out_fd = open(dest, oflags, S_IRUSR | S_IWUSR)) == -1) {
+            fprintf(stderr, _("*** Unable to open %s for writing: %s\n"), dest, strerror(errno));
+            fflush(stderr);
+            close(in_fd);
+            return COPY_FAILED;
+        } else {
+            strategy = copy_data(in_fd, out_fd);
+
+            if (strategy == COPY_FAILED) {
+                fprintf(stderr, _("*** Error writing to %s: %s\n"), dest, strerror(errno));
+                fflush(stderr);
+            }
+        }
+    }
+
+    if (out_fd != -1) {
+        if (strategy != COPY_FAILED && fchmod(out_fd, sb.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO)) == -1) {
+            fprintf(stderr, _("*** chmod() error on %s: %s\n"), dest, strerror(errno));
+            fflush(stderr);
+            strategy = COPY_FAILED;
+        }
+
+        if (close(out_fd) && strategy != COPY_FAILED) {
+            fprintf(stderr, _("*** Error writing to %s: %s\n"), dest, strerror(errno));
+            fflush(stderr);
+            strategy = COPY_FAILED;
+        }
+
+        if (strategy == COPY_FAILED) {
+            unlink(dest);
+        }
+    }
+
+    close(in_fd);
+    return strategy;
+}
+
+/**
+ * @brief Describe a copy_strategy_t for verbose output.
+ *
+ * @param strategy The strategy returned by fastcopy().
+ * @return Constant string naming the strategy, do not free.
+ */
+const char *copy_strategy_desc(const copy_strategy_t strategy)
+{
+    switch (strategy) {
+        case COPY_REFLINK:
+            return _("reflink");
+        case COPY_HARDLINK:
+            return _("hardlink");
+        case COPY_RANGE:
+            return _("copy_file_range");
+        case COPY_BUFFER:
+            return _("copy");
+        case COPY_SYMLINK:
+            return _("in place");
+        default:
+            return _("failed");
+    }
+}
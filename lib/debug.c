@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <inttypes.h>
 #include <assert.h>
 #include "rpminspect.h"
 
@@ -75,6 +76,18 @@ void dump_cfg(const struct rpminspect *ri)
         if (ri->profiledir) {
             fprintf(stderr, "        profiledir: %s\n", ri->profiledir);
         }
+        if (ri->cache_dir) {
+            fprintf(stderr, "        cache_dir: %s\n", ri->cache_dir);
+            fprintf(stderr, "        cache_size: %" PRIu64 "\n", ri->cache_size / (1024 * 1024));
+        }
+        fprintf(stderr, "        extract: %s\n", (ri->extract_mode == EXTRACT_EAGER) ? "eager" : (ri->extract_mode == EXTRACT_LAZY) ? "lazy" : "?");
+        fprintf(stderr, "        debug_packages: %s\n", (ri->debug_packages == DEBUGPKG_EXTRACT) ? "extract" : (ri->debug_packages == DEBUGPKG_LAZY) ? "lazy" : (ri->debug_packages == DEBUGPKG_LIST) ? "list" : (ri->debug_packages == DEBUGPKG_SKIP) ? "skip" : "?");
+        fprintf(stderr, "        teardown: %s\n", (ri->teardown == TEARDOWN_INLINE) ? "inline" : (ri->teardown == TEARDOWN_PARALLEL) ? "parallel" : (ri->teardown == TEARDOWN_BACKGROUND) ? "background" : "?");
+        fprintf(stderr, "        order: %s\n", (ri->order_policy == ORDER_TABLE) ? "table" : (ri->order_policy == ORDER_EXPENSIVE) ? "expensive" : (ri->order_policy == ORDER_CHEAPEST) ? "cheapest" : "?");
+        if (ri->calibration) {
+            fprintf(stderr, "        calibration: %s\n", ri->calibration);
+        }
+        fprintf(stderr, "        trace_threshold: %u\n", ri->trace_threshold);
     }
 
     if (ri->kojihub || ri->kojiursine || ri->kojimbs) {
@@ -88,6 +101,8 @@ void dump_cfg(const struct rpminspect *ri)
         if (ri->kojimbs) {
             fprintf(stderr, "        download_mbs: %s\n", ri->kojimbs);
         }
+        fprintf(stderr, "        download_concurrency: %u\n", ri->download_concurrency);
+        fprintf(stderr, "        download_retries: %u\n", ri->download_retries);
     }
 
     fprintf(stderr, "    vendor:\n");
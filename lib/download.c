@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <time.h>
+#include <curl/curl.h>
+#include "rpminspect.h"
+
+/**
+ * @file download.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Concurrent file downloads with libcurl.
+ *
+ * Files to download are added to a download_queue_t and then fetched
+ * together with a libcurl multi handle.  At most 'concurrency'
+ * transfers run at once.  All transfers share the connection cache
+ * of the multi handle, so connections are kept alive and reused
+ * between files and HTTP/2 streams are multiplexed over a single
+ * connection when the server supports it.  Transfers that fail
+ * because of a network or server error are retried.  A transfer whose
+ * sink cannot keep up is paused on its own, see download_sink_t.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/*
+ * Current monotonic time in seconds.
+ */
+static time_t now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        return time(NULL);
+    }
+
+    return ts.tv_sec;
+}
+
+/*
+ * libcurl write callback, hands the received data to the entry's
+ * sink and writes it to the entry's destination file.  If the sink
+ * is blocked the transfer is paused and libcurl passes the same data
+ * again once it is resumed, so nothing is written to the file until
+ * the sink has taken the data.
+ */
+static size_t write_data(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    download_entry_t *entry = userdata;
+    size_t len = size * nmemb;
+
+    assert(entry != NULL);
+
+    if (entry->sink != NULL) {
+        switch (entry->sink->write(entry, ptr, len)) {
+            case SINK_OK:
+                break;
+            case SINK_BLOCKED:
+                entry->paused = true;
+                return CURL_WRITEFUNC_PAUSE;
+            default:
+                return 0;
+        }
+    }
+
+    if (entry->fp != NULL && fwrite(ptr, 1, len, entry->fp) != len) {
+        return 0;
+    }
+
+    entry->bytes += len;
+    return len;
+}
+
+/*
+ * Wait for transfer activity, or for the sink of a paused transfer
+ * to be ready for more data, and resume those transfers.
+ */
+static void wait_transfers(const download_queue_t *queue, CURLM *multi, const unsigned int active)
+{
+    download_entry_t *entry = NULL;
+    download_entry_t **paused = NULL;
+    struct curl_waitfd *fds = NULL;
+    unsigned int n = 0;
+    unsigned int i = 0;
+
+    assert(queue != NULL);
+    assert(multi != NULL);
+
+    if (active > 0) {
+        fds = calloc(active, sizeof(*fds));
+        assert(fds != NULL);
+        paused = calloc(active, sizeof(*paused));
+        assert(paused != NULL);
+
+        TAILQ_FOREACH(entry, queue->entries, items) {
+            if (n < active && entry->state == DOWNLOAD_ACTIVE && entry->paused) {
+                fds[n].fd = entry->sink->wait_fd(entry);
+                fds[n].events = CURL_WAIT_POLLOUT;
+                paused[n++] = entry;
+            }
+        }
+    }
+
+    curl_multi_wait(multi, fds, n, 1000, NULL);
+
+    for (i = 0; i < n; i++) {
+        if (fds[i].revents & CURL_WAIT_POLLOUT) {
+            /* the write callback may run, and pause it again, right here */
+            paused[i]->paused = false;
+            curl_easy_pause(paused[i]->handle, CURLPAUSE_CONT);
+        }
+    }
+
+    free(fds);
+    free(paused);
+    return;
+}
+
+/*
+ * Returns true if a failed transfer is worth trying again.  Client
+ * errors like 404 will not go away on a retry.
+ */
+static bool retryable(const CURLcode result, const long code)
+{
+    if (result == CURLE_HTTP_RETURNED_ERROR) {
+        return code >= 500 || code == 408 || code == 429;
+    }
+
+    return true;
+}
+
+/*
+ * Open the destination file, set up an easy handle for the entry and
+ * add it to the multi handle.  Returns true if the transfer started.
+ */
+static bool start_transfer(const download_queue_t *queue, CURLM *multi, download_entry_t *entry)
+{
+    CURL *c = NULL;
+
+    assert(queue != NULL);
+    assert(multi != NULL);
+    assert(entry != NULL);
+
+    DEBUG_PRINT("src=|%s|\ndst=|%s|\n", entry->src, entry->dst);
+
+    if (!(c = curl_easy_init())) {
+        fprintf(stderr, _("*** curl_easy_init() failed\n"));
+        fflush(stderr);
+        return false;
+    }
+
+    if (entry->sink == NULL || entry->keep_dst) {
+        entry->fp = fopen(entry->dst, "wb");
+
+        if (entry->fp == NULL) {
+            fprintf(stderr, _("*** error opening %s: %s\n"), entry->dst, strerror(errno));
+            fflush(stderr);
+            abort();
+        }
+    }
+
+    if (entry->sink != NULL && !entry->sink->start(entry)) {
+        if (entry->fp != NULL) {
+            fclose(entry->fp);
+            entry->fp = NULL;
+            unlink(entry->dst);
+        }
+
+        curl_easy_cleanup(c);
+        return false;
+    }
+
+    curl_easy_setopt(c, CURLOPT_URL, entry->src);
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, write_data);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, entry);
+    curl_easy_setopt(c, CURLOPT_PRIVATE, entry);
+    curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(c, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(c, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    if (entry->range != NULL) {
+        curl_easy_setopt(c, CURLOPT_RANGE, entry->range);
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x072f00 /* HTTP/2 over TLS only, added in 7.47.0 */
+    curl_easy_setopt(c, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00 /* added in 7.43.0 */
+    /* prefer waiting for a connection to multiplex over opening a new one */
+    curl_easy_setopt(c, CURLOPT_PIPEWAIT, 1L);
+#endif
+
+    entry->handle = c;
+    entry->paused = false;
+    entry->bytes = 0;
+    entry->attempts++;
+    entry->state = DOWNLOAD_ACTIVE;
+    entry->trace_start = trace_start();
+
+    if (queue->verbose && entry->attempts == 1) {
+        printf(_("Downloading %s...\n"), entry->src);
+    }
+
+    curl_multi_add_handle(multi, c);
+    return true;
+}
+
+/*
+ * Handle a completed transfer.  Successful entries are marked done,
+ * failed ones have their partial output removed and are either
+ * scheduled for another attempt or marked failed.  Returns the entry
+ * the transfer belonged to.
+ */
+static download_entry_t *finish_transfer(const download_queue_t *queue, CURLM *multi, CURL *c, CURLcode result)
+{
+    download_entry_t *entry = NULL;
+    long code = 0;
+    bool wrote = false;
+    const char *name = NULL;
+
+    assert(queue != NULL);
+    assert(multi != NULL);
+    assert(c != NULL);
+
+    curl_easy_getinfo(c, CURLINFO_PRIVATE, (char **) &entry);
+    assert(entry != NULL);
+    curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &code);
+
+    curl_multi_remove_handle(multi, c);
+    curl_easy_cleanup(c);
+    entry->handle = NULL;
+
+    if (entry->fp != NULL) {
+        if (fclose(entry->fp) != 0) {
+            fprintf(stderr, _("*** error closing %s: %s\n"), entry->dst, strerror(errno));
+            fflush(stderr);
+            abort();
+        }
+
+        entry->fp = NULL;
+        wrote = true;
+    }
+
+    /* the sink can fail a transfer curl thought was fine */
+    if (entry->sink != NULL && !entry->sink->finish(entry, result == CURLE_OK) && result == CURLE_OK) {
+        result = CURLE_WRITE_ERROR;
+    }
+
+    name = strrchr(entry->dst, '/');
+    trace_end(entry->trace_start, "download", (name == NULL) ? entry->dst : name + 1, entry->src);
+
+    if (result == CURLE_OK) {
+        entry->state = DOWNLOAD_DONE;
+        return entry;
+    }
+
+    /* remove output file if there was a download error (e.g., 404) */
+    if (wrote && unlink(entry->dst)) {
+        fprintf(stderr, _("*** unable to unlink %s: %s\n"), entry->dst, strerror(errno));
+        fflush(stderr);
+    }
+
+    if (retryable(result, code) && entry->attempts <= queue->retries) {
+        DEBUG_PRINT("retrying %s after attempt %u: %s\n", entry->src, entry->attempts, curl_easy_strerror(result));
+        entry->retry_at = now() + (DOWNLOAD_RETRY_DELAY * entry->attempts);
+        entry->state = DOWNLOAD_PENDING;
+        return entry;
+    }
+
+    DEBUG_PRINT("giving up on %s after %u attempts: %s\n", entry->src, entry->attempts, curl_easy_strerror(result));
+
+    if (queue->verbose) {
+        fprintf(stderr, _("*** error downloading %s: %s\n"), entry->src, curl_easy_strerror(result));
+        fflush(stderr);
+    }
+
+    entry->state = DOWNLOAD_FAILED;
+    return entry;
+}
+
+/*
+ * Hand finished entries to the queue's done callback in queue order.
+ * An entry is only reported once every entry before it has finished,
+ * so the caller sees files in the same order as a serial download.
+ * Returns the first entry that has not been reported.
+ */
+static download_entry_t *report_done(const download_queue_t *queue, download_entry_t *next)
+{
+    assert(queue != NULL);
+
+    while (next != NULL && (next->state == DOWNLOAD_DONE || next->state == DOWNLOAD_FAILED)) {
+        if (queue->done) {
+            queue->done(next, queue->done_data);
+        }
+
+        next = TAILQ_NEXT(next, items);
+    }
+
+    return next;
+}
+
+/**
+ * @brief Allocate an empty download queue.
+ *
+ * The number of simultaneous transfers and retries come from the
+ * download_concurrency and download_retries configuration settings.
+ *
+ * @param ri The main program data structure.
+ * @return Newly allocated download_queue_t, free with
+ *         free_download_queue().
+ */
+download_queue_t *init_download_queue(const struct rpminspect *ri)
+{
+    download_queue_t *queue = NULL;
+
+    assert(ri != NULL);
+
+    queue = calloc(1, sizeof(*queue));
+    assert(queue != NULL);
+
+    queue->entries = calloc(1, sizeof(*queue->entries));
+    assert(queue->entries != NULL);
+    TAILQ_INIT(queue->entries);
+
+    queue->concurrency = (ri->download_concurrency == 0) ? 1 : ri->download_concurrency;
+    queue->retries = ri->download_retries;
+    queue->verbose = ri->verbose;
+
+    return queue;
+}
+
+/**
+ * @brief Free a download queue.
+ *
+ * Downloaded files are left on disk.
+ *
+ * @param queue The download_queue_t to free (may be NULL).
+ */
+void free_download_queue(download_queue_t *queue)
+{
+    download_entry_t *entry = NULL;
+
+    if (queue == NULL) {
+        return;
+    }
+
+    while (!TAILQ_EMPTY(queue->entries)) {
+        entry = TAILQ_FIRST(queue->entries);
+        TAILQ_REMOVE(queue->entries, entry, items);
+
+        if (entry->sink != NULL && entry->sink->free != NULL) {
+            entry->sink->free(entry->sink_data);
+        }
+
+        free(entry->src);
+        free(entry->dst);
+        free(entry->digest);
+        free(entry->range);
+        free(entry);
+    }
+
+    free(queue->entries);
+    free(queue);
+    return;
+}
+
+/**
+ * @brief Add a file to a download queue.
+ *
+ * Nothing is downloaded until run_download_queue() is called.
+ * Entries stay in the order they were added.
+ *
+ * @param queue The download queue.
+ * @param src The URL to download.
+ * @param dst The local file to write.  The directory must exist.
+ * @return The new entry, owned by the queue.  Callers may set a sink
+ *         on it before the queue runs.
+ */
+download_entry_t *add_download(download_queue_t *queue, const char *src, const char *dst)
+{
+    download_entry_t *entry = NULL;
+
+    assert(queue != NULL);
+    assert(src != NULL);
+    assert(dst != NULL);
+
+    entry = calloc(1, sizeof(*entry));
+    assert(entry != NULL);
+    entry->src = strdup(src);
+    assert(entry->src != NULL);
+    entry->dst = strdup(dst);
+    assert(entry->dst != NULL);
+    entry->state = DOWNLOAD_PENDING;
+    TAILQ_INSERT_TAIL(queue->entries, entry, items);
+    return entry;
+}
+
+/**
+ * @brief Download every file in a download queue.
+ *
+ * Transfers are started in queue order, up to the queue's concurrency
+ * limit.  When this function returns, every entry is either
+ * DOWNLOAD_DONE or DOWNLOAD_FAILED.  As with a single download, the
+ * output file of a failed transfer is removed.  Entries the caller
+ * set to DOWNLOAD_DONE before running the queue are not downloaded
+ * but are still passed to the done callback in order.
+ *
+ * If the queue has a done callback, it is called for each entry as
+ * soon as that entry and every entry ahead of it have finished.  This
+ * lets the caller start working on files while later ones are still
+ * downloading.
+ *
+ * @param queue The download queue.
+ * @return Number of files that could not be downloaded.
+ */
+unsigned int run_download_queue(download_queue_t *queue)
+{
+    CURLM *multi = NULL;
+    CURLMsg *msg = NULL;
+    download_entry_t *entry = NULL;
+    download_entry_t *next_done = NULL;
+    unsigned int total = 0;
+    unsigned int finished = 0;
+    unsigned int failed = 0;
+    unsigned int active = 0;
+    uint64_t bytes = 0;
+    int running = 0;
+    int left = 0;
+    time_t t = 0;
+    time_t next_retry = 0;
+
+    assert(queue != NULL);
+
+    TAILQ_FOREACH(entry, queue->entries, items) {
+        total++;
+
+        /* entries the caller already has (e.g., from a cache) */
+        if (entry->state == DOWNLOAD_DONE) {
+            finished++;
+        }
+    }
+
+    if (finished == total) {
+        report_done(queue, TAILQ_FIRST(queue->entries));
+        return 0;
+    }
+
+    if (!(multi = curl_multi_init())) {
+        fprintf(stderr, _("*** curl_multi_init() failed\n"));
+        fflush(stderr);
+
+        TAILQ_FOREACH(entry, queue->entries, items) {
+            if (entry->state == DOWNLOAD_PENDING) {
+                entry->state = DOWNLOAD_FAILED;
+                failed++;
+            }
+        }
+
+        report_done(queue, TAILQ_FIRST(queue->entries));
+        return failed;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x071e00 /* added in 7.30.0 */
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) queue->concurrency);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long) queue->concurrency);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00 /* added in 7.43.0 */
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+    next_done = TAILQ_FIRST(queue->entries);
+
+    while (finished < total) {
+        /* start pending transfers, in order, up to the limit */
+        t = now();
+        next_retry = 0;
+
+        TAILQ_FOREACH(entry, queue->entries, items) {
+            if (active >= queue->concurrency) {
+                break;
+            }
+
+            if (entry->state != DOWNLOAD_PENDING) {
+                continue;
+            }
+
+            if (entry->retry_at > t) {
+                if (next_retry == 0 || entry->retry_at < next_retry) {
+                    next_retry = entry->retry_at;
+                }
+
+                continue;
+            }
+
+            if (start_transfer(queue, multi, entry)) {
+                active++;
+            } else {
+                entry->state = DOWNLOAD_FAILED;
+                finished++;
+                failed++;
+            }
+        }
+
+        if (active == 0) {
+            /* only retries waiting on their delay are left */
+            if (next_retry > t) {
+                sleep(next_retry - t);
+            }
+
+            continue;
+        }
+
+        curl_multi_perform(multi, &running);
+
+        while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            entry = finish_transfer(queue, multi, msg->easy_handle, msg->data.result);
+            active--;
+
+            if (entry->state == DOWNLOAD_DONE) {
+                finished++;
+                bytes += entry->bytes;
+
+                if (queue->verbose) {
+                    printf(_("Downloaded %u of %u files (%" PRIu64 " bytes)\n"), finished - failed, total, bytes);
+                }
+            } else if (entry->state == DOWNLOAD_FAILED) {
+                finished++;
+                failed++;
+            }
+        }
+
+        next_done = report_done(queue, next_done);
+
+        if (running > 0) {
+            wait_transfers(queue, multi, active);
+        }
+    }
+
+    report_done(queue, next_done);
+    curl_multi_cleanup(multi);
+    return failed;
+}
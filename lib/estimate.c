@@ -0,0 +1,523 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <rpm/header.h>
+#include "rpminspect.h"
+
+/**
+ * @file estimate.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Predict what a run will cost from the package headers alone.
+ *
+ * With --estimate, only the RPM headers of the builds are gathered
+ * (see gather_headers()) and nothing is extracted or inspected.  The
+ * workload of each selected inspection is counted from the headers as
+ * for --order, and turned into a time with the cost model in
+ * schedule.c.  Gathering the builds is estimated from the size of the
+ * packages and a transfer rate.
+ *
+ * The cost model and the transfer rate are only a starting point.
+ * If the calibration setting names a file, every normal run blends
+ * how long it really took into that file: the seconds each inspection
+ * took per unit of estimated cost, and the bytes per second the builds
+ * were gathered at.  The file is plain text with one "name value"
+ * pair per line, "gather" for the rate and the inspection name for
+ * each factor.  Runs cut short by --fail-fast are not blended in, and
+ * runs updating the same file take turns through a lock file next to
+ * it.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/* The phases that gather the builds, see gather_builds() */
+static const char *gather_phases[] = { "download", "copy", "extraction", "peers", NULL };
+
+static int count_inspections(void)
+{
+    int n = 0;
+
+    while (inspections[n].flag != 0) {
+        n++;
+    }
+
+    return n;
+}
+
+static int find_inspection(const char *name)
+{
+    int i = 0;
+
+    for (i = 0; inspections[i].flag != 0; i++) {
+        if (!strcmp(inspections[i].name, name)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Read the calibration file.
+ *
+ * Anything the file does not have is left at 0.  cal->factors is
+ * allocated even if the file cannot be read, free it with free().
+ *
+ * @param path The calibration file, may be NULL.
+ * @param cal Where to store the values.
+ * @return True if the file was read.
+ */
+bool read_calibration(const char *path, calibration_t *cal)
+{
+    FILE *fp = NULL;
+    char *line = NULL;
+    char *name = NULL;
+    char *hash = NULL;
+    size_t len = 0;
+    double value = 0;
+    int i = 0;
+
+    assert(cal != NULL);
+
+    cal->gather_rate = 0;
+    cal->factors = calloc(count_inspections(), sizeof(*cal->factors));
+    assert(cal->factors != NULL);
+
+    if (path == NULL || (fp = fopen(path, "r")) == NULL) {
+        return false;
+    }
+
+    while (getline(&line, &len, fp) != -1) {
+        if ((hash = strchr(line, '#')) != NULL) {
+            *hash = '\0';
+        }
+
+        if (sscanf(line, "%ms %lf", &name, &value) != 2) {
+            free(name);
+            name = NULL;
+            continue;
+        }
+
+        if (value > 0) {
+            if (!strcmp(name, "gather")) {
+                cal->gather_rate = value;
+            } else if ((i = find_inspection(name)) != -1) {
+                cal->factors[i] = value;
+            }
+        }
+
+        free(name);
+        name = NULL;
+    }
+
+    free(line);
+    fclose(fp);
+    return true;
+}
+
+/**
+ * @brief Write the calibration file.
+ *
+ * It is written to a temporary file that is then renamed over it, so
+ * concurrent runs never see half a file.  The file is readable by
+ * everyone.  Callers updating it must hold the lock, see
+ * update_calibration().
+ *
+ * @param path The calibration file.
+ * @param cal The values to write.
+ */
+void write_calibration(const char *path, const calibration_t *cal)
+{
+    FILE *fp = NULL;
+    char *tmp = NULL;
+    int fd = -1;
+    int i = 0;
+
+    assert(path != NULL);
+    assert(cal != NULL);
+
+    xasprintf(&tmp, "%s.XXXXXX", path);
+
+    if ((fd = mkstemp(tmp)) == -1 || (fp = fdopen(fd, "w")) == NULL) {
+        fprintf(stderr, _("*** Unable to write calibration file %s: %s\n"), path, strerror(errno));
+        fflush(stderr);
+
+        if (fd != -1) {
+            close(fd);
+            unlink(tmp);
+        }
+
+        free(tmp);
+        return;
+    }
+
+    fprintf(fp, "# rpminspect --estimate calibration, updated after each run\n");
+
+    if (cal->gather_rate > 0) {
+        fprintf(fp, "gather %.0f\n", cal->gather_rate);
+    }
+
+    for (i = 0; inspections[i].flag != 0; i++) {
+        if (cal->factors[i] > 0) {
+            fprintf(fp, "%s %.6f\n", inspections[i].name, cal->factors[i]);
+        }
+    }
+
+    /* mkstemp() creates the file readable only by its owner */
+    if (fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == -1 || fclose(fp) != 0 || rename(tmp, path) == -1) {
+        fprintf(stderr, _("*** Unable to write calibration file %s: %s\n"), path, strerror(errno));
+        fflush(stderr);
+        unlink(tmp);
+    }
+
+    free(tmp);
+    return;
+}
+
+/**
+ * @brief Blend a new sample into a calibration value.
+ *
+ * @param old The current value, 0 or less if there is none.
+ * @param sample The value measured by this run.
+ * @return The sample if there is no current value, otherwise the
+ *         current value moved CALIBRATION_WEIGHT of the way to it.
+ */
+double blend_calibration(const double old, const double sample)
+{
+    if (old <= 0) {
+        return sample;
+    }
+
+    return (old * (1 - CALIBRATION_WEIGHT)) + (sample * CALIBRATION_WEIGHT);
+}
+
+/* Size of a package less its lead and signature header */
+static uint64_t package_size(Header hdr)
+{
+    uint64_t size = 0;
+
+    size = headerGetNumber(hdr, RPMTAG_LONGSIGSIZE);
+
+    if (size == 0) {
+        size = headerGetNumber(hdr, RPMTAG_SIGSIZE);
+    }
+
+    return size;
+}
+
+/*
+ * Count the packages of the before or after build and add up their
+ * sizes.
+ */
+static uint64_t build_size(const struct rpminspect *ri, const int whichbuild, uint64_t *packages)
+{
+    rpmpeer_entry_t *peer = NULL;
+    Header hdr = NULL;
+    uint64_t size = 0;
+
+    if (ri->peers == NULL) {
+        return 0;
+    }
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        hdr = (whichbuild == BEFORE_BUILD) ? peer->before_hdr : peer->after_hdr;
+
+        if (hdr != NULL) {
+            size += package_size(hdr);
+
+            if (packages != NULL) {
+                (*packages)++;
+            }
+        }
+    }
+
+    return size;
+}
+
+/* Is the inspection going to run? */
+static bool will_run(const struct rpminspect *ri, const int i)
+{
+    if (!(ri->tests & inspections[i].flag)) {
+        return false;
+    }
+
+    return ri->before != NULL || inspections[i].single_build;
+}
+
+/**
+ * @brief Blend how long this run took into the calibration file.
+ *
+ * Does nothing unless the calibration setting is set, or if the run
+ * was cancelled by --fail-fast, which leaves the times incomplete.
+ * Uses the stats of the run, which must have been collected, so call
+ * this after the inspections with ri->stats set.
+ *
+ * @param ri The main program data structure.
+ */
+void update_calibration(const struct rpminspect *ri)
+{
+    calibration_t cal;
+    workload_t *workloads = NULL;
+    stats_entry_t *entry = NULL;
+    uint64_t cost = 0;
+    uint64_t bytes = 0;
+    double gather = 0;
+    char *lockfile = NULL;
+    int lock = -1;
+    int i = 0;
+
+    assert(ri != NULL);
+
+    if (ri->calibration == NULL || ri->stats == NULL || ri->peers == NULL || run_cancelled()) {
+        return;
+    }
+
+    /* read, blend, and write the file without losing other runs' updates */
+    xasprintf(&lockfile, "%s.lock", ri->calibration);
+    lock = open(lockfile, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+    while (lock != -1 && (i = flock(lock, LOCK_EX)) == -1 && errno == EINTR) {
+        continue;
+    }
+
+    if (lock == -1 || i == -1) {
+        fprintf(stderr, _("*** Unable to lock %s: %s\n"), lockfile, strerror(errno));
+        fflush(stderr);
+
+        if (lock != -1) {
+            close(lock);
+        }
+
+        free(lockfile);
+        return;
+    }
+
+    free(lockfile);
+    (void) read_calibration(ri->calibration, &cal);
+    workloads = get_workloads(ri);
+
+    TAILQ_FOREACH(entry, ri->stats, items) {
+        if (entry->kind == STATS_PHASE) {
+            for (i = 0; gather_phases[i] != NULL; i++) {
+                if (!strcmp(entry->name, gather_phases[i])) {
+                    gather += entry->wall;
+                }
+            }
+        } else if ((i = find_inspection(entry->name)) != -1) {
+            cost = inspection_cost(ri, i, &workloads[i]);
+
+            if (cost > 0 && entry->wall > 0) {
+                cal.factors[i] = blend_calibration(cal.factors[i], (entry->wall * 1000000) / cost);
+            }
+        }
+    }
+
+    bytes = build_size(ri, AFTER_BUILD, NULL) + build_size(ri, BEFORE_BUILD, NULL);
+
+    if (bytes > 0 && gather > 0) {
+        cal.gather_rate = blend_calibration(cal.gather_rate, bytes / gather);
+    }
+
+    write_calibration(ri->calibration, &cal);
+    close(lock);
+    free(workloads);
+    free(cal.factors);
+    return;
+}
+
+/**
+ * @brief Write what a run would cost, from the package headers.
+ *
+ * The builds must have been gathered with gather_headers().  For
+ * each inspection that would run this lists the files it looks at and
+ * reads, the bytes, ELF objects, Java files, kernel modules, and shell
+ * scripts among them, the external commands it runs, and the time it
+ * is predicted to take.  Then the time to gather the builds, the total
+ * time, and the disk space the working directory will need.
+ *
+ * @param ri The main program data structure.
+ * @param dest File to write to, NULL for stdout.
+ * @param json Write JSON rather than text.
+ * @return True if the estimate was written, false if dest could not
+ *         be opened.
+ */
+bool write_estimate(struct rpminspect *ri, const char *dest, const bool json)
+{
+    FILE *fp = NULL;
+    calibration_t cal;
+    bool calibrated = false;
+    workload_t *workloads = NULL;
+    workload_t extracted;
+    json_writer_t w;
+    const char *spec = NULL;
+    bool local = false;
+    uint32_t files = FILES_NONE;
+    uint64_t packages = 0;
+    uint64_t bytes = 0;
+    uint64_t rpm_bytes = 0;
+    uint64_t disk = 0;
+    double *seconds = NULL;
+    double rate = 0;
+    double gather = 0;
+    double inspect = 0;
+    int width = strlen(_("Inspection"));
+    int which = 0;
+    int n = 0;
+    int i = 0;
+
+    assert(ri != NULL);
+
+    if (dest == NULL) {
+        fp = stdout;
+    } else if ((fp = fopen(dest, "w")) == NULL) {
+        fprintf(stderr, _("*** Error opening %s for writing: %s\n"), dest, strerror(errno));
+        fflush(stderr);
+        return false;
+    }
+
+    calibrated = read_calibration(ri->calibration, &cal);
+    workloads = get_workloads(ri);
+    n = count_inspections();
+    seconds = calloc(n, sizeof(*seconds));
+    assert(seconds != NULL);
+
+    for (i = 0; i < n; i++) {
+        if (!will_run(ri, i)) {
+            continue;
+        }
+
+        seconds[i] = inspection_cost(ri, i, &workloads[i]) / 1000000.0;
+
+        if (cal.factors[i] > 0) {
+            seconds[i] *= cal.factors[i];
+        }
+
+        inspect += seconds[i];
+
+        if ((int) strlen(inspections[i].name) > width) {
+            width = strlen(inspections[i].name);
+        }
+    }
+
+    /* the RPM files stay on disk if they are kept or copied */
+    for (which = BEFORE_BUILD; which <= AFTER_BUILD; which++) {
+        spec = (which == BEFORE_BUILD) ? ri->before : ri->after;
+
+        if (spec == NULL) {
+            continue;
+        }
+
+        local = is_local_build(spec) || is_local_rpm(ri, spec);
+        bytes = build_size(ri, which, &packages);
+        rpm_bytes += bytes;
+
+        if (ri->keep_rpms || ri->extract_mode == EXTRACT_LAZY || (local && !ri->no_copy)) {
+            disk += bytes;
+        }
+    }
+
+    rate = (cal.gather_rate > 0) ? cal.gather_rate : CALIBRATION_GATHER_RATE;
+    gather = rpm_bytes / rate;
+
+    files = payload_files(ri);
+
+    if (ri->debug_packages == DEBUGPKG_EXTRACT) {
+        files |= FILES_DEBUG;
+    }
+
+    get_payload_workload(ri, files, &extracted);
+    disk += extracted.read_bytes;
+
+    if (json) {
+        json_writer_init(&w, fp, true);
+        json_begin_object(&w, NULL);
+        json_begin_object(&w, "inspections");
+
+        for (i = 0; i < n; i++) {
+            if (!will_run(ri, i)) {
+                continue;
+            }
+
+            json_begin_object(&w, inspections[i].name);
+            json_write_int(&w, "files", workloads[i].files);
+            json_write_int(&w, "files read", workloads[i].read_files);
+            json_write_int(&w, "bytes read", workloads[i].read_bytes);
+            json_write_int(&w, "elf", workloads[i].elf);
+            json_write_int(&w, "java", workloads[i].jars);
+            json_write_int(&w, "kmods", workloads[i].kmods);
+            json_write_int(&w, "scripts", workloads[i].scripts);
+            json_write_int(&w, "commands", inspection_commands(ri, i, &workloads[i]));
+            json_write_double(&w, "time", seconds[i]);
+            json_end_object(&w);
+        }
+
+        json_end_object(&w);
+        json_write_int(&w, "packages", packages);
+        json_write_int(&w, "package bytes", rpm_bytes);
+        json_write_double(&w, "gather time", gather);
+        json_write_double(&w, "inspection time", inspect);
+        json_write_double(&w, "total time", gather + inspect);
+        json_write_int(&w, "disk bytes", disk);
+        json_write_string(&w, "calibration", calibrated ? ri->calibration : NULL);
+        json_end_object(&w);
+        fprintf(fp, "\n");
+    } else {
+        fprintf(fp, "%-*s %8s %8s %12s %6s %6s %6s %8s %8s %10s\n", width, _("Inspection"),
+                _("Files"), _("Read"), _("Read (KB)"), _("ELF"), _("Java"), _("Kmods"),
+                _("Scripts"), _("Cmds"), _("Time (s)"));
+
+        for (i = 0; i < n; i++) {
+            if (!will_run(ri, i)) {
+                continue;
+            }
+
+            fprintf(fp, "%-*s %8" PRIu64 " %8" PRIu64 " %12" PRIu64 " %6" PRIu64 " %6" PRIu64 " %6" PRIu64 " %8" PRIu64 " %8" PRIu64 " %10.3f\n",
+                    width, inspections[i].name, workloads[i].files, workloads[i].read_files,
+                    workloads[i].read_bytes / 1024, workloads[i].elf, workloads[i].jars,
+                    workloads[i].kmods, workloads[i].scripts,
+                    inspection_commands(ri, i, &workloads[i]), seconds[i]);
+        }
+
+        fprintf(fp, "\n");
+        fprintf(fp, _("Packages:         %" PRIu64 " (%" PRIu64 " KB)\n"), packages, rpm_bytes / 1024);
+        fprintf(fp, _("Gather time:      %.3f s\n"), gather);
+        fprintf(fp, _("Inspection time:  %.3f s\n"), inspect);
+        fprintf(fp, _("Total time:       %.3f s\n"), gather + inspect);
+        fprintf(fp, _("Disk space:       %" PRIu64 " KB\n"), disk / 1024);
+        fprintf(fp, _("Calibration:      %s\n"), calibrated ? ri->calibration : _("defaults"));
+    }
+
+    if (dest != NULL) {
+        fclose(fp);
+    }
+
+    free(seconds);
+    free(workloads);
+    free(cal.factors);
+    return true;
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "rpminspect.h"
+
+/**
+ * @file events.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Stream of results and inspection progress as JSON Lines.
+ *
+ * With --events=DEST, every result passed to add_result() is written
+ * to DEST the moment it is added, along with an event when each
+ * inspection starts and finishes and when the run starts and
+ * finishes.  Each event is one JSON object on its own line and the
+ * stream is flushed after every line, so something reading the other
+ * end sees a failure as soon as it is found.  Every event has an
+ * "event" member naming its type and a "time" member in milliseconds
+ * since the epoch.
+ *
+ * Lines are written under a lock so events from different threads do
+ * not interleave.  None of this changes the report written at the end
+ * of the run.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+static bool enabled = false;
+static FILE *events_fp = NULL;
+static pthread_mutex_t events_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t now_msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((int64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*
+ * Start an event line.  Returns false with nothing locked if no
+ * stream is open.  Otherwise the lock is held until end_event().
+ */
+static bool begin_event(json_writer_t *w, const char *event)
+{
+    if (!__atomic_load_n(&enabled, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&events_lock);
+
+    if (events_fp == NULL) {
+        pthread_mutex_unlock(&events_lock);
+        return false;
+    }
+
+    json_writer_init(w, events_fp, false);
+    json_begin_object(w, NULL);
+    json_write_string(w, "event", event);
+    json_write_int(w, "time", now_msec());
+    return true;
+}
+
+static void end_event(json_writer_t *w)
+{
+    json_end_object(w);
+    fputc('\n', events_fp);
+    fflush(events_fp);
+    pthread_mutex_unlock(&events_lock);
+    return;
+}
+
+/**
+ * @brief Start writing events.
+ *
+ * The stream is closed by finish_events(), which is also registered
+ * with atexit().
+ *
+ * @param dest File to write the events to, or fd:N to write them to
+ *        file descriptor N, which is left open.
+ * @return True if the stream is open, false if not.
+ */
+bool init_events(const char *dest)
+{
+    char *end = NULL;
+    long fd = 0;
+    int copy = -1;
+
+    assert(dest != NULL);
+    assert(events_fp == NULL);
+
+    if (strprefix(dest, "fd:")) {
+        errno = 0;
+        fd = strtol(dest + 3, &end, 10);
+
+        if (errno != 0 || end == dest + 3 || *end != '\0' || fd < 0) {
+            fprintf(stderr, _("*** Invalid file descriptor: %s\n"), dest);
+            fflush(stderr);
+            return false;
+        }
+
+        /* write to a copy so closing the stream leaves fd open */
+        copy = dup(fd);
+
+        if (copy == -1 || (events_fp = fdopen(copy, "w")) == NULL) {
+            fprintf(stderr, _("*** Unable to write events to %s: %s\n"), dest, strerror(errno));
+            fflush(stderr);
+
+            if (copy != -1) {
+                close(copy);
+            }
+
+            return false;
+        }
+    } else {
+        events_fp = fopen(dest, "w");
+
+        if (events_fp == NULL) {
+            fprintf(stderr, _("*** Error opening %s for writing: %s\n"), dest, strerror(errno));
+            fflush(stderr);
+            return false;
+        }
+    }
+
+    __atomic_store_n(&enabled, true, __ATOMIC_RELEASE);
+    atexit(finish_events);
+    return true;
+}
+
+/**
+ * @brief Close the event stream.
+ *
+ * Does nothing if no events are being written.
+ */
+void finish_events(void)
+{
+    if (!__atomic_exchange_n(&enabled, false, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+
+    pthread_mutex_lock(&events_lock);
+    fclose(events_fp);
+    events_fp = NULL;
+    pthread_mutex_unlock(&events_lock);
+    return;
+}
+
+/**
+ * @brief Write the "start" event.
+ *
+ * @param before The before build, NULL if there is none.
+ * @param after The after build.
+ */
+void event_run_start(const char *before, const char *after)
+{
+    json_writer_t w;
+
+    if (!begin_event(&w, "start")) {
+        return;
+    }
+
+    json_write_string(&w, "version", PACKAGE_VERSION);
+    json_write_string(&w, "before", before);
+    json_write_string(&w, "after", after);
+    end_event(&w);
+    return;
+}
+
+/**
+ * @brief Write the "finish" event.
+ *
+ * @param worst The most severe result of the run.
+ * @param status The exit code rpminspect will return.
+ */
+void event_run_finish(const severity_t worst, const int status)
+{
+    json_writer_t w;
+
+    if (!begin_event(&w, "finish")) {
+        return;
+    }
+
+    json_write_string(&w, "result", strseverity(worst));
+    json_write_int(&w, "exit code", status);
+    end_event(&w);
+    return;
+}
+
+/**
+ * @brief Write an "inspection start" event.
+ *
+ * @param name Name of the inspection.
+ */
+void event_inspection_start(const char *name)
+{
+    json_writer_t w;
+
+    assert(name != NULL);
+
+    if (!begin_event(&w, "inspection start")) {
+        return;
+    }
+
+    json_write_string(&w, "inspection", name);
+    end_event(&w);
+    return;
+}
+
+/**
+ * @brief Write an "inspection finish" event.
+ *
+ * @param name Name of the inspection.
+ * @param passed What the inspection driver returned.
+ */
+void event_inspection_finish(const char *name, const bool passed)
+{
+    json_writer_t w;
+
+    assert(name != NULL);
+
+    if (!begin_event(&w, "inspection finish")) {
+        return;
+    }
+
+    json_write_string(&w, "inspection", name);
+    json_write_string(&w, "result", passed ? "pass" : "fail");
+    end_event(&w);
+    return;
+}
+
+/**
+ * @brief Write an "inspection skipped" event.
+ *
+ * Written for each inspection that was not run because --fail-fast
+ * cancelled the run.
+ *
+ * @param name Name of the inspection.
+ */
+void event_inspection_skipped(const char *name)
+{
+    json_writer_t w;
+
+    assert(name != NULL);
+
+    if (!begin_event(&w, "inspection skipped")) {
+        return;
+    }
+
+    json_write_string(&w, "inspection", name);
+    end_event(&w);
+    return;
+}
+
+/**
+ * @brief Write a "result" event.
+ *
+ * The members are the ones the JSON report has for a result, plus
+ * the header it is reported under and the noun, arch, and file if
+ * the inspection gave them.
+ *
+ * @param params The result, as passed to add_result().
+ */
+void event_result(const struct result_params *params)
+{
+    json_writer_t w;
+
+    assert(params != NULL);
+
+    if (!begin_event(&w, "result")) {
+        return;
+    }
+
+    json_write_string(&w, "header", params->header);
+    json_write_string(&w, "result", strseverity(params->severity));
+    json_write_string(&w, "waiver authorization", strwaiverauth(params->waiverauth));
+
+    if (params->msg != NULL) {
+        json_write_string(&w, "message", params->msg);
+    }
+
+    if (params->details != NULL) {
+        json_write_string(&w, "details", params->details);
+    }
+
+    if (params->remedy != NULL) {
+        json_write_string(&w, "remedy", params->remedy);
+    }
+
+    if (params->noun != NULL) {
+        json_write_string(&w, "noun", params->noun);
+    }
+
+    if (params->arch != NULL) {
+        json_write_string(&w, "arch", params->arch);
+    }
+
+    if (params->file != NULL) {
+        json_write_string(&w, "file", params->file);
+    }
+
+    end_event(&w);
+    return;
+}
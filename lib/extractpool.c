@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "rpminspect.h"
+
+/**
+ * @file extractpool.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Extract RPM payloads on worker threads.
+ *
+ * While builds are gathered, the main thread downloads packages and
+ * reads their headers in order, adding each package to the peer list.
+ * The payload extraction for that package is then handed to a pool
+ * of worker threads through a bounded queue, so extraction of one
+ * package overlaps with the download of the next and the before and
+ * after packages of a peer can be extracted at the same time.
+ *
+ * Workers only write the files, root, and arena members for the side
+ * of the peer named in the job.  Everything else about the peer is
+ * set up by the main thread before the job is queued, including the
+ * decoded file tags, because decoding them takes a reference on the
+ * header and headerLink() is not thread safe.
+ *
+ * In lazy extraction mode the payloads are only listed while builds
+ * are gathered.  materialize_peers() then uses a pool before each
+ * inspection to extract the files that inspection reads.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/*
+ * Extract one side of a peer.  If files is not FILES_NONE the payload
+ * was already listed and the members in those classes are extracted.
+ */
+static void extract_peer(const struct rpminspect *ri, rpmpeer_entry_t *peer, const int whichbuild, const uint32_t files)
+{
+    assert(peer != NULL);
+
+    if (whichbuild == BEFORE_BUILD) {
+        if (files == FILES_NONE) {
+            peer->before_files = extract_rpm(ri, peer->before_rpm, peer->before_hdr, peer->before_cols, &peer->before_root, peer->before_arena);
+        } else {
+            (void) materialize_rpm(ri, peer->before_rpm, peer->before_hdr, peer->before_files, peer->before_root, peer->before_arena, files);
+        }
+    } else if (whichbuild == AFTER_BUILD) {
+        if (files == FILES_NONE) {
+            peer->after_files = extract_rpm(ri, peer->after_rpm, peer->after_hdr, peer->after_cols, &peer->after_root, peer->after_arena);
+        } else {
+            (void) materialize_rpm(ri, peer->after_rpm, peer->after_hdr, peer->after_files, peer->after_root, peer->after_arena, files);
+        }
+    }
+
+    return;
+}
+
+/*
+ * Worker thread main loop.  Take jobs off the queue until it is empty
+ * and the pool has been told no more jobs are coming.
+ */
+static void *extract_worker(void *arg)
+{
+    extract_pool_t *pool = arg;
+    extract_job_t *job = NULL;
+
+    assert(pool != NULL);
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+
+        while (TAILQ_EMPTY(pool->jobs) && !pool->finished) {
+            pthread_cond_wait(&pool->has_jobs, &pool->lock);
+        }
+
+        if (TAILQ_EMPTY(pool->jobs)) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        job = TAILQ_FIRST(pool->jobs);
+        TAILQ_REMOVE(pool->jobs, job, items);
+        pool->queued--;
+        pthread_cond_signal(&pool->has_room);
+        pthread_mutex_unlock(&pool->lock);
+
+        extract_peer(pool->ri, job->peer, job->whichbuild, job->files);
+        free(job);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start a pool of payload extraction threads.
+ *
+ * @param ri The main program data structure, it selects the payload
+ *        files to extract (NULL extracts everything).
+ * @param nthreads Number of worker threads, 0 means one per online
+ *        CPU.
+ * @return Newly allocated extract_pool_t, finish and free it with
+ *         finish_extract_pool().
+ */
+extract_pool_t *init_extract_pool(const struct rpminspect *ri, unsigned int nthreads)
+{
+    extract_pool_t *pool = NULL;
+    long ncpus = 0;
+    unsigned int i = 0;
+    int r = 0;
+
+    if (nthreads == 0) {
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (ncpus > 0) ? ncpus : 1;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    assert(pool != NULL);
+    pool->ri = ri;
+
+    pool->jobs = calloc(1, sizeof(*pool->jobs));
+    assert(pool->jobs != NULL);
+    TAILQ_INIT(pool->jobs);
+
+    pool->depth = nthreads * EXTRACT_QUEUE_DEPTH;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->has_jobs, NULL);
+    pthread_cond_init(&pool->has_room, NULL);
+
+    pool->threads = calloc(nthreads, sizeof(*pool->threads));
+    assert(pool->threads != NULL);
+
+    for (i = 0; i < nthreads; i++) {
+        r = pthread_create(&pool->threads[i], NULL, extract_worker, pool);
+
+        if (r != 0) {
+            fprintf(stderr, _("*** unable to start extraction thread: %s\n"), strerror(r));
+            fflush(stderr);
+            break;
+        }
+
+        pool->nthreads++;
+    }
+
+    DEBUG_PRINT("started %u extraction threads\n", pool->nthreads);
+    return pool;
+}
+
+/*
+ * Add a job to the pool, or run it right away if the pool has no
+ * threads.  Blocks while the job queue is full.
+ */
+static void queue_job(extract_pool_t *pool, rpmpeer_entry_t *peer, const int whichbuild, const uint32_t files)
+{
+    extract_job_t *job = NULL;
+
+    assert(pool != NULL);
+    assert(peer != NULL);
+
+    if (pool->nthreads == 0) {
+        extract_peer(pool->ri, peer, whichbuild, files);
+        return;
+    }
+
+    job = calloc(1, sizeof(*job));
+    assert(job != NULL);
+    job->peer = peer;
+    job->whichbuild = whichbuild;
+    job->files = files;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (pool->queued >= pool->depth) {
+        pthread_cond_wait(&pool->has_room, &pool->lock);
+    }
+
+    TAILQ_INSERT_TAIL(pool->jobs, job, items);
+    pool->queued++;
+    pthread_cond_signal(&pool->has_jobs);
+    pthread_mutex_unlock(&pool->lock);
+
+    return;
+}
+
+/**
+ * @brief Queue payload extraction for one side of a peer.
+ *
+ * Blocks while the job queue is full.  If the pool has no threads the
+ * payload is extracted right away on the calling thread.
+ *
+ * @param pool The extraction pool.
+ * @param peer The peer to extract, the header, package path, and
+ *        arena for whichbuild must already be set.
+ * @param whichbuild BEFORE_BUILD or AFTER_BUILD.
+ */
+void queue_extraction(extract_pool_t *pool, rpmpeer_entry_t *peer, const int whichbuild)
+{
+    queue_job(pool, peer, whichbuild, FILES_NONE);
+    return;
+}
+
+/**
+ * @brief Queue extraction of more members of a listed payload.
+ *
+ * Like queue_extraction(), but the payload of whichbuild has already
+ * been listed and the job calls materialize_rpm() for it.
+ *
+ * @param pool The extraction pool.
+ * @param peer The peer to extract.
+ * @param whichbuild BEFORE_BUILD or AFTER_BUILD.
+ * @param files Mask of FILES_* classes to extract, not FILES_NONE.
+ */
+void queue_materialize(extract_pool_t *pool, rpmpeer_entry_t *peer, const int whichbuild, const uint32_t files)
+{
+    assert(files != FILES_NONE);
+    queue_job(pool, peer, whichbuild, files);
+    return;
+}
+
+/**
+ * @brief Wait for all queued extractions and free the pool.
+ *
+ * @param pool The extraction pool (may be NULL).
+ */
+void finish_extract_pool(extract_pool_t *pool)
+{
+    unsigned int i = 0;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->finished = true;
+    pthread_cond_broadcast(&pool->has_jobs);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->nthreads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->has_room);
+    pthread_cond_destroy(&pool->has_jobs);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->jobs);
+    free(pool);
+
+    return;
+}
+
+/*
+ * Helper for materialize_peers().  Queue extraction for one side of
+ * a peer if the members the current inspection reads are not all
+ * there yet.  Everything the remaining inspections read is extracted
+ * in the same pass so each payload is read at most once per run.
+ */
+static void materialize_side(const struct rpminspect *ri, extract_pool_t **pool, rpmpeer_entry_t *peer, const int whichbuild, const uint32_t need, const uint32_t remaining)
+{
+    Header hdr = NULL;
+    rpmfile_t *files = NULL;
+    uint32_t *extracted = NULL;
+
+    if (whichbuild == BEFORE_BUILD) {
+        hdr = peer->before_hdr;
+        files = peer->before_files;
+        extracted = &peer->before_extracted;
+    } else {
+        hdr = peer->after_hdr;
+        files = peer->after_files;
+        extracted = &peer->after_extracted;
+    }
+
+    if (hdr == NULL || (*extracted & need) == need) {
+        return;
+    }
+
+    /* with eager extraction only lazy debug packages are left */
+    if (ri->extract_mode != EXTRACT_LAZY && !is_debug_package(hdr)) {
+        return;
+    }
+
+    /* nothing this inspection reads, check again for the next one */
+    if (!payload_pending(ri, hdr, files, need)) {
+        *extracted |= need;
+        return;
+    }
+
+    if (*pool == NULL) {
+        *pool = init_extract_pool(ri, 0);
+    }
+
+    queue_materialize(*pool, peer, whichbuild, remaining | need);
+    *extracted |= remaining | need;
+    return;
+}
+
+/**
+ * @brief Extract the payload members an inspection reads.
+ *
+ * Only does something in lazy extraction mode, or for debug packages
+ * if the debug_packages setting is 'lazy'.  Call it before running
+ * the inspection at position current in the run order.  Every
+ * package with members in the FILES_* classes of that inspection
+ * that are not extracted yet gets those members, and the members any
+ * later enabled inspection reads, extracted on the pool threads.
+ * Returns once they are all written.
+ *
+ * @param ri The main program data structure.
+ * @param current Position in the run order of the inspection about
+ *        to run, see inspection_at().
+ */
+void materialize_peers(struct rpminspect *ri, const int current)
+{
+    extract_pool_t *pool = NULL;
+    rpmpeer_entry_t *peer = NULL;
+    uint32_t need = FILES_NONE;
+    uint32_t remaining = FILES_NONE;
+
+    assert(ri != NULL);
+
+    if ((ri->extract_mode != EXTRACT_LAZY && ri->debug_packages != DEBUGPKG_LAZY) || ri->peers == NULL) {
+        return;
+    }
+
+    need = inspections[inspection_at(ri, current)].files;
+
+    if (need == FILES_NONE) {
+        return;
+    }
+
+    remaining = remaining_payload_files(ri, current);
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        materialize_side(ri, &pool, peer, BEFORE_BUILD, need, remaining);
+        materialize_side(ri, &pool, peer, AFTER_BUILD, need, remaining);
+    }
+
+    finish_extract_pool(pool);
+    return;
+}
@@ -40,6 +40,7 @@
 
 #include <rpm/header.h>
 #include <rpm/rpmtd.h>
+#include <rpm/rpmfiles.h>
 
 #include <archive.h>
 #include <archive_entry.h>
@@ -50,8 +51,10 @@
  * @brief Free rpmfile_t memory.
  *
  * Free the memory allocated for an rpmfile_t list.  Passing NULL to
- * this function has no effect.  The function will free each struct
- * member in each list entry and then free the entire list.
+ * this function has no effect.  The function frees the lazily
+ * computed members of each list entry and then the list itself.  The
+ * entries and their paths live in the arena passed to extract_rpm()
+ * and are released when that arena is freed.
  *
  * @param files Pointer to the rpmfile_t to free.
  */
@@ -66,16 +69,277 @@ void free_files(rpmfile_t *files)
     while (!TAILQ_EMPTY(files)) {
         entry = TAILQ_FIRST(files);
         TAILQ_REMOVE(files, entry, items);
-        free(entry->fullpath);
-        free(entry->localpath);
         free(entry->type);
         free(entry->checksum);
-        free(entry);
     }
 
     free(files);
 }
 
+/**
+ * @brief Return which of the FILES_* classes in files a payload
+ * member is in.
+ *
+ * Only regular files are in a class.  FILES_SOURCE and FILES_DEBUG
+ * select whole packages and are never returned.  ELF, text, and Java
+ * files are recognized by the file class rpmbuild recorded, so those
+ * classes are only returned if the header has file classes.
+ *
+ * @param ri The main program data structure.
+ * @param files Mask of FILES_* classes to check for.
+ * @param cols Decoded file tags of the package header.
+ * @param idx Index of the member in the header.
+ * @param path Path of the member in the payload.
+ * @return Mask of the FILES_* classes in files the member is in.
+ */
+uint32_t payload_file_classes(const struct rpminspect *ri, const uint32_t files, const header_columns_t *cols, const int idx, const char *path)
+{
+    uint32_t classes = FILES_NONE;
+    mode_t mode = 0;
+    const char *class = NULL;
+
+    assert(path != NULL);
+
+    if (cols == NULL || cols->modes == NULL) {
+        return FILES_NONE;
+    }
+
+    mode = cols->modes[idx];
+
+    if (!S_ISREG(mode)) {
+        return FILES_NONE;
+    }
+
+    if ((files & FILES_WRITABLE) && (mode & (S_IWOTH | S_ISVTX))) {
+        classes |= FILES_WRITABLE;
+    }
+
+    if ((files & FILES_STATIC_LIBS) && strsuffix(path, STATIC_LIB_FILENAME_EXTENSION)) {
+        classes |= FILES_STATIC_LIBS;
+    }
+
+    if ((files & FILES_KMODS) && strstr(path, KERNEL_MODULES_DIR) && strstr(path, KERNEL_MODULE_FILENAME_EXTENSION)) {
+        classes |= FILES_KMODS;
+    }
+
+    if ((files & FILES_MANPAGES) &&
+        (ri->manpage_path_include == NULL || regexec(ri->manpage_path_include, path, 0, NULL, 0) == 0) &&
+        (ri->manpage_path_exclude == NULL || regexec(ri->manpage_path_exclude, path, 0, NULL, 0) != 0)) {
+        classes |= FILES_MANPAGES;
+    }
+
+    if ((files & FILES_JAVA) && (strsuffix(path, JAR_FILENAME_EXTENSION) || strsuffix(path, CLASS_FILENAME_EXTENSION))) {
+        classes |= FILES_JAVA;
+    }
+
+    /* the rest go by the file class rpmbuild recorded */
+    if (cols->classes == NULL) {
+        return classes;
+    }
+
+    class = cols->classes[idx];
+
+    if ((files & FILES_ELF) && strstr(class, "ELF")) {
+        classes |= FILES_ELF;
+    }
+
+    if ((files & FILES_TEXT) && (strstr(class, "text") || strstr(class, "XML"))) {
+        classes |= FILES_TEXT;
+    }
+
+    if ((files & FILES_JAVA) && strstr(class, "Java")) {
+        classes |= FILES_JAVA;
+    }
+
+    return classes;
+}
+
+/*
+ * Return true if payload member idx of a package, a regular file, is
+ * in one of the FILES_* classes in files.  Members are wanted if the
+ * header lacks the information needed to tell.
+ */
+static bool want_file(const struct rpminspect *ri, const uint32_t files, const header_columns_t *cols, const int idx, const char *path)
+{
+    if (cols == NULL || cols->modes == NULL) {
+        return true;
+    }
+
+    if (!S_ISREG(cols->modes[idx])) {
+        return false;
+    }
+
+    if (cols->classes == NULL && (files & (FILES_ELF | FILES_TEXT | FILES_JAVA))) {
+        return true;
+    }
+
+    return payload_file_classes(ri, files, cols, idx, path) != FILES_NONE;
+}
+
+/*
+ * List the payload members of a package from its header alone, for
+ * packages where no member needs to be extracted.  %ghost files are
+ * not in the payload and are left out.
+ */
+static rpmfile_t *list_header_files(Header hdr, rpmtd td, const header_columns_t *cols, arena_t *arena)
+{
+    rpmfile_t *file_list = NULL;
+    rpmfile_entry_t *file_entry = NULL;
+    const char *rpm_path = NULL;
+    int i = 0;
+
+    file_list = calloc(1, sizeof(rpmfile_t));
+    assert(file_list != NULL);
+    TAILQ_INIT(file_list);
+
+    rpmtdInit(td);
+
+    while ((rpm_path = rpmtdNextString(td)) != NULL) {
+        i = rpmtdGetIndex(td);
+
+        if (cols->flags && (cols->flags[i] & RPMFILE_GHOST)) {
+            continue;
+        }
+
+        file_entry = arena_alloc(arena, sizeof(rpmfile_entry_t));
+        file_entry->rpm_header = hdr;
+        file_entry->idx = i;
+        file_entry->st.st_mode = cols->modes[i];
+        file_entry->st.st_nlink = 1;
+
+        if (cols->sizes) {
+            file_entry->st.st_size = cols->sizes[i];
+        }
+
+        file_entry->localpath = arena_strdup(arena, rpm_path);
+        TAILQ_INSERT_TAIL(file_list, file_entry, items);
+    }
+
+    return file_list;
+}
+
+/*
+ * The FILES_* classes to extract from the package in hdr.  Source
+ * packages are extracted whole if an inspection reads them.  Debug
+ * packages follow the debug_packages setting.
+ */
+static uint32_t package_files(const struct rpminspect *ri, Header hdr, uint32_t files)
+{
+    if (is_debug_package(hdr)) {
+        if (ri->debug_packages == DEBUGPKG_LIST) {
+            return FILES_NONE;
+        }
+
+        if (ri->debug_packages == DEBUGPKG_LAZY && !(files & FILES_DEBUG)) {
+            return FILES_NONE;
+        }
+    }
+
+    /* FILES_DEBUG only selects packages, FILES_PAYLOAD is everything */
+    files |= FILES_DEBUG;
+
+    if (headerIsSource(hdr) && (files & FILES_SOURCE)) {
+        return FILES_ALL;
+    }
+
+    return files;
+}
+
+/*
+ * The file name part of a package path, used to name trace spans.
+ */
+static const char *package_name(const char *pkg)
+{
+    const char *name = strrchr(pkg, '/');
+
+    return (name == NULL) ? pkg : name + 1;
+}
+
+/*
+ * Open an RPM payload with libarchive, reading from fd if it is not
+ * -1.  Returns NULL on failure.
+ */
+static struct archive *open_payload(const char *pkg, int fd)
+{
+    struct archive *archive = NULL;
+    int archive_result;
+
+    archive = archive_read_new();
+    assert(archive != NULL);
+
+#if ARCHIVE_VERSION_NUMBER < 3000000
+    archive_read_support_compression_all(archive);
+#else
+    archive_read_support_filter_all(archive);
+#endif
+    archive_read_support_format_all(archive);
+
+    if (fd == -1) {
+        archive_result = archive_read_open_filename(archive, pkg, 10240);
+    } else {
+        archive_result = archive_read_open_fd(archive, fd, 10240);
+    }
+
+    if (archive_result != ARCHIVE_OK) {
+        fprintf(stderr, _("*** Unable to open %s with libarchive: %s\n"), pkg, archive_error_string(archive));
+        archive_read_free(archive);
+        return NULL;
+    }
+
+    return archive;
+}
+
+/*
+ * Write the payload member the archive is positioned at to
+ * output_dir and set the fullpath and localpath of its file entry.
+ * localpath is the tail of fullpath so the root is not stored twice.
+ */
+static bool extract_member(struct archive *archive, struct archive_entry *entry, rpmfile_entry_t *file_entry, const char *pkg, const char *output_dir, const char *archive_path, arena_t *arena)
+{
+    char *hardlinkpath = NULL;
+    mode_t archive_perm;
+    size_t dirlen = 0;
+    size_t pathlen = 0;
+
+    const int archive_flags = ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS;
+
+    /* Prepend output_dir to the path name */
+    dirlen = strlen(output_dir);
+    pathlen = strlen(archive_path);
+    file_entry->fullpath = arena_alloc(arena, dirlen + 1 + pathlen + 1);
+    memcpy(file_entry->fullpath, output_dir, dirlen);
+    file_entry->fullpath[dirlen] = '/';
+    memcpy(file_entry->fullpath + dirlen + 1, archive_path, pathlen + 1);
+    file_entry->localpath = file_entry->fullpath + dirlen + 1;
+    archive_entry_set_pathname(entry, file_entry->fullpath);
+
+    /* Ensure the resulting file is user-rw and global-unwritable */
+    archive_perm = archive_entry_perm(entry);
+    archive_perm |= S_IRUSR | S_IWUSR;
+    archive_perm &= ~S_IWOTH;
+
+    if (S_ISDIR(file_entry->st.st_mode)) {
+        archive_perm |= S_IXUSR;
+    }
+
+    archive_entry_set_perm(entry, archive_perm);
+
+    /* If this is a hard link, update the hardlink destination path */
+    if (archive_entry_nlink(entry) > 1) {
+        xasprintf(&hardlinkpath, "%s/%s", output_dir, archive_entry_hardlink(entry));
+        archive_entry_set_link(entry, hardlinkpath);
+        free(hardlinkpath);
+    }
+
+    /* Write the file to disk */
+    if (archive_read_extract(archive, entry, archive_flags) != ARCHIVE_OK) {
+        fprintf(stderr, _("*** Error extracting %s: %s\n"), pkg, archive_error_string(archive));
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * @brief Extract the RPM package specified to a working directory.
  *
@@ -86,12 +350,52 @@ void free_files(rpmfile_t *files)
  * extraction.  Returns an rpmfile_t list of all the payload members.
  * The caller is responsible for freeing this returned list.
  *
+ * Only the payload files in the FILES_* classes of ri->payload_files
+ * are written to disk.  The other members are listed with a NULL
+ * fullpath.  If no member needs to be written, the payload is not
+ * read at all and the list is built from the header.
+ *
+ * @param ri The main program data structure, or NULL to extract the
+ *           entire payload.
  * @param pkg Path to the RPM package to extract.
  * @param hdr RPM Header for the specified package.
+ * @param cols Decoded file tags of hdr from init_header_columns(),
+ *             used to pick the members to write.  Decode them on the
+ *             thread that owns hdr; they are only read here.
+ * @param output_dir Set to the newly allocated extraction directory.
+ * @param arena Arena the file entries and their paths are allocated
+ *              from.  It must outlive the returned list.
+ * @return rpmfile_t list of all payload members.  The caller is
+ *                   responsible for freeing this list.
+ */
+rpmfile_t *extract_rpm(const struct rpminspect *ri, const char *pkg, Header hdr, const header_columns_t *cols, char **output_dir, arena_t *arena)
+{
+    return extract_rpm_fd(ri, pkg, hdr, cols, -1, output_dir, arena);
+}
+
+/**
+ * @brief Extract an RPM payload read from a file descriptor.
+ *
+ * Same as extract_rpm(), but when fd is not -1 the payload is read
+ * from fd instead of opening pkg.  fd must be positioned at the start
+ * of the compressed payload, right after the package header, and it
+ * may be a pipe.  pkg is still used to name the extraction directory
+ * and in error messages.  fd is not closed, and nothing is read from
+ * it if no payload member needs to be written.
+ *
+ * @param ri The main program data structure, or NULL to extract the
+ *           entire payload.
+ * @param pkg Path of the RPM package (need not exist if fd is given).
+ * @param hdr RPM Header for the specified package.
+ * @param cols Decoded file tags of hdr, as for extract_rpm().
+ * @param fd File descriptor to read the payload from, or -1.
+ * @param output_dir Set to the newly allocated extraction directory.
+ * @param arena Arena the file entries and their paths are allocated
+ *              from.  It must outlive the returned list.
  * @return rpmfile_t list of all payload members.  The caller is
  *                   responsible for freeing this list.
  */
-rpmfile_t *extract_rpm(const char *pkg, Header hdr, char **output_dir)
+rpmfile_t *extract_rpm_fd(const struct rpminspect *ri, const char *pkg, Header hdr, const header_columns_t *cols, int fd, char **output_dir, arena_t *arena)
 {
     rpmtd td = NULL;
     rpm_count_t td_size;
@@ -103,21 +407,24 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr, char **output_dir)
     ENTRY *eptr;
     int *rpm_indices = NULL;
 
-    char *hardlinkpath = NULL;
     struct archive *archive = NULL;
     struct archive_entry *entry = NULL;
     const char *archive_path;
-    mode_t archive_perm;
     int archive_result;
 
     int i;
     rpmfile_entry_t *file_entry;
     rpmfile_t *file_list = NULL;
 
-    const int archive_flags = ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS;
+    uint32_t files = FILES_ALL;
+    bool *wanted = NULL;
+    int nwanted = 0;
+    bool extract = false;
+    uint64_t span = trace_start();
 
     assert(pkg != NULL);
     assert(hdr != NULL);
+    assert(arena != NULL);
 
     /*
      * Create an output directory for the rpm payload.
@@ -168,6 +475,23 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr, char **output_dir)
     rpm_indices = calloc(td_size, sizeof(int));
     assert(rpm_indices != NULL);
 
+    /*
+     * Work out which payload members the enabled inspections read.
+     * In lazy mode they are extracted later by materialize_rpm().
+     */
+    if (ri != NULL) {
+        if (ri->extract_mode == EXTRACT_LAZY || (ri->debug_packages == DEBUGPKG_LAZY && is_debug_package(hdr))) {
+            files = FILES_NONE;
+        } else {
+            files = package_files(ri, hdr, ri->payload_files);
+        }
+    }
+
+    if (files != FILES_ALL) {
+        wanted = calloc(td_size, sizeof(*wanted));
+        assert(wanted != NULL);
+    }
+
     for (i = 0; i < (int) td_size; i++) {
         rpm_path = rpmtdNextString(td);
 
@@ -184,21 +508,23 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr, char **output_dir)
             fprintf(stderr, _("*** Error populating hash table: %s\n"), strerror(errno));
             goto cleanup;
         }
+
+        if (wanted != NULL && want_file(ri, files, cols, i, rpm_path)) {
+            wanted[i] = true;
+            nwanted++;
+        }
     }
 
-    /* Open the file with libarchive */
-    archive = archive_read_new();
-    assert(archive != NULL);
+    /* Nothing to write, the header has everything we need */
+    if (wanted != NULL && nwanted == 0) {
+        file_list = list_header_files(hdr, td, cols, arena);
+        goto cleanup;
+    }
 
-#if ARCHIVE_VERSION_NUMBER < 3000000
-    archive_read_support_compression_all(archive);
-#else
-    archive_read_support_filter_all(archive);
-#endif
-    archive_read_support_format_all(archive);
+    /* Open the file with libarchive */
+    archive = open_payload(pkg, fd);
 
-    if (archive_read_open_filename(archive, pkg, 10240) != ARCHIVE_OK) {
-        fprintf(stderr, _("*** Unable to open %s with libarchive: %s\n"), pkg, archive_error_string(archive));
+    if (archive == NULL) {
         goto cleanup;
     }
 
@@ -235,52 +561,34 @@ rpmfile_t *extract_rpm(const char *pkg, Header hdr, char **output_dir)
         }
 
         /* Create a new rpmfile_entry_t for this file */
-        file_entry = calloc(1, sizeof(rpmfile_entry_t));
-        assert(file_entry != NULL);
+        file_entry = arena_alloc(arena, sizeof(rpmfile_entry_t));
 
         file_entry->rpm_header = hdr;
         memcpy(&file_entry->st, archive_entry_stat(entry), sizeof(struct stat));
         file_entry->idx = *((int *)eptr->data);
 
-        file_entry->localpath = strdup(archive_path);
-        assert(file_entry->localpath);
-
         file_entry->type = NULL;
         file_entry->checksum = NULL;
         file_entry->cap = NULL;
 
         TAILQ_INSERT_TAIL(file_list, file_entry, items);
 
-        /* Are we extracting this file? */
-        if (!(S_ISREG(file_entry->st.st_mode) || S_ISDIR(file_entry->st.st_mode) || S_ISLNK(file_entry->st.st_mode))) {
-            continue;
-        }
-
-        /* Prepend output_dir to the path name */
-        xasprintf(&file_entry->fullpath, "%s/%s", *output_dir, archive_path);
-        archive_entry_set_pathname(entry, file_entry->fullpath);
-
-        /* Ensure the resulting file is user-rw and global-unwritable */
-        archive_perm = archive_entry_perm(entry);
-        archive_perm |= S_IRUSR | S_IWUSR;
-        archive_perm &= ~S_IWOTH;
-
-        if (S_ISDIR(file_entry->st.st_mode)) {
-            archive_perm |= S_IXUSR;
+        /*
+         * Are we extracting this file?  Hard linked files are always
+         * written so the link targets exist.
+         */
+        if (wanted == NULL) {
+            extract = S_ISREG(file_entry->st.st_mode) || S_ISDIR(file_entry->st.st_mode) || S_ISLNK(file_entry->st.st_mode);
+        } else {
+            extract = S_ISREG(file_entry->st.st_mode) && (wanted[file_entry->idx] || archive_entry_nlink(entry) > 1);
         }
 
-        archive_entry_set_perm(entry, archive_perm);
-
-        /* If this is a hard link, update the hardlink destination path */
-        if (archive_entry_nlink(entry) > 1) {
-            xasprintf(&hardlinkpath, "%s/%s", *output_dir, archive_entry_hardlink(entry));
-            archive_entry_set_link(entry, hardlinkpath);
-            free(hardlinkpath);
+        if (!extract) {
+            file_entry->localpath = arena_strdup(arena, archive_path);
+            continue;
         }
 
-        /* Write the file to disk */
-        if (archive_read_extract(archive, entry, archive_flags) != ARCHIVE_OK) {
-            fprintf(stderr, _("*** Error extracting %s: %s\n"), pkg, archive_error_string(archive));
+        if (!extract_member(archive, entry, file_entry, pkg, *output_dir, archive_path, arena)) {
             free_files(file_list);
             file_list = NULL;
             goto cleanup;
@@ -297,8 +605,10 @@ cleanup:
     }
 
     free(rpm_indices);
+    free(wanted);
     rpmtdFree(td);
 
+    trace_end(span, "extract", package_name(pkg), pkg);
     return file_list;
 }
 
@@ -398,6 +708,197 @@ static struct hsearch_data *files_to_table(rpmfile_t *list)
     return table;
 }
 
+/*
+ * Return true if file is not extracted yet but one of the FILES_*
+ * classes in files needs it.
+ */
+static bool pending_file(const struct rpminspect *ri, const uint32_t files, const rpmfile_entry_t *file)
+{
+    if (file->fullpath != NULL) {
+        return false;
+    }
+
+    if (files == FILES_ALL) {
+        return S_ISREG(file->st.st_mode) || S_ISDIR(file->st.st_mode) || S_ISLNK(file->st.st_mode);
+    }
+
+    return S_ISREG(file->st.st_mode) && want_file(ri, files, file->cols, file->idx, file->localpath);
+}
+
+/**
+ * @brief Check whether a listed payload has members left to extract.
+ *
+ * @param ri The main program data structure.
+ * @param hdr RPM Header for the package.
+ * @param list rpmfile_t list of the package payload (may be NULL).
+ * @param files Mask of FILES_* classes.
+ * @return True if a member in one of the classes in files has not
+ *         been extracted yet.
+ */
+bool payload_pending(const struct rpminspect *ri, Header hdr, const rpmfile_t *list, const uint32_t files)
+{
+    const rpmfile_entry_t *file = NULL;
+    uint32_t pkgfiles = FILES_NONE;
+
+    assert(hdr != NULL);
+
+    if (list == NULL || files == FILES_NONE) {
+        return false;
+    }
+
+    pkgfiles = package_files(ri, hdr, files);
+
+    if (pkgfiles == FILES_NONE) {
+        return false;
+    }
+
+    TAILQ_FOREACH(file, list, items) {
+        if (pending_file(ri, pkgfiles, file)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Extract more members of a payload listed by extract_rpm().
+ *
+ * Used in lazy extraction mode, where extract_rpm() only lists the
+ * payload members.  The payload is read once, in archive order, and
+ * every member in one of the FILES_* classes in files that has not
+ * been extracted yet is written under root.  Hard linked files are
+ * always written so the link targets exist.  The fullpath of those
+ * entries is set the same way extract_rpm() would have.  Nothing is
+ * read if no member is pending.
+ *
+ * @param ri The main program data structure.
+ * @param pkg Path to the RPM package on disk.
+ * @param hdr RPM Header for the package.
+ * @param list rpmfile_t list of the package payload (may be NULL).
+ * @param root The extraction directory extract_rpm() created.
+ * @param arena The arena list was allocated from.
+ * @param files Mask of FILES_* classes to extract.
+ * @return True on success, false if the payload could not be read.
+ */
+bool materialize_rpm(const struct rpminspect *ri, const char *pkg, Header hdr, rpmfile_t *list, const char *root, arena_t *arena, const uint32_t files)
+{
+    struct hsearch_data *table = NULL;
+    ENTRY e;
+    ENTRY *eptr;
+    struct archive *archive = NULL;
+    struct archive_entry *entry = NULL;
+    const char *archive_path;
+    int archive_result;
+    rpmfile_entry_t *file = NULL;
+    uint32_t pkgfiles = FILES_NONE;
+    bool result = true;
+    uint64_t span = 0;
+
+    assert(pkg != NULL);
+    assert(hdr != NULL);
+    assert(arena != NULL);
+
+    if (!payload_pending(ri, hdr, list, files)) {
+        return true;
+    }
+
+    span = trace_start();
+
+    assert(root != NULL);
+    pkgfiles = package_files(ri, hdr, files);
+
+    table = files_to_table(list);
+
+    if (table == NULL) {
+        return false;
+    }
+
+    archive = open_payload(pkg, -1);
+
+    if (archive == NULL) {
+        result = false;
+        goto cleanup;
+    }
+
+    DEBUG_PRINT("extracting %s from %s\n", (pkgfiles == FILES_ALL) ? "all files" : "selected files", pkg);
+
+    while ((archive_result = archive_read_next_header(archive, &entry)) != ARCHIVE_EOF) {
+        if (archive_result == ARCHIVE_RETRY) {
+            continue;
+        }
+
+        if (archive_result != ARCHIVE_OK) {
+            fprintf(stderr, _("*** Error reading from archive %s: %s\n"), pkg, archive_error_string(archive));
+            result = false;
+            break;
+        }
+
+        archive_path = archive_entry_pathname(entry);
+
+        if (strprefix(archive_path, "./")) {
+            archive_path += 1;
+        }
+
+        e.key = (char *) archive_path;
+
+        if (hsearch_r(e, FIND, &eptr, table) == 0) {
+            fprintf(stderr, _("*** Payload path %s not in RPM metadata\n"), archive_path);
+            result = false;
+            break;
+        }
+
+        file = eptr->data;
+
+        if (file->fullpath != NULL) {
+            continue;
+        }
+
+        if (!pending_file(ri, pkgfiles, file) && !(S_ISREG(file->st.st_mode) && archive_entry_nlink(entry) > 1)) {
+            continue;
+        }
+
+        if (!extract_member(archive, entry, file, pkg, root, archive_path, arena)) {
+            result = false;
+            break;
+        }
+    }
+
+cleanup:
+    if (archive != NULL) {
+        archive_read_free(archive);
+    }
+
+    hdestroy_r(table);
+    free(table);
+
+    trace_end(span, "extract", package_name(pkg), pkg);
+    return result;
+}
+
+/*
+ * Helper for find_one_peer.  Compare the MIME types of two files, or
+ * the file classes in their headers if either one was not extracted.
+ */
+static bool same_file_type(rpmfile_entry_t *file, rpmfile_entry_t *other)
+{
+    const char *class = NULL;
+    const char *other_class = NULL;
+
+    if (file->fullpath && other->fullpath) {
+        return !strcmp(get_mime_type(file), get_mime_type(other));
+    }
+
+    class = get_rpm_file_str(file, RPMTAG_FILECLASS);
+    other_class = get_rpm_file_str(other, RPMTAG_FILECLASS);
+
+    if (class == NULL || other_class == NULL) {
+        return false;
+    }
+
+    return !strcmp(class, other_class);
+}
+
 /**
  * @brief Helper for find_one_peer
  *
@@ -540,12 +1041,12 @@ static void find_one_peer(rpmfile_entry_t *file, rpmfile_t *after, struct hsearc
         /*
          * This is a best guess that checks the following:
          * - basename (but with a leading '/')
-         * - MIME type
+         * - MIME type (or file class, see same_file_type())
          *
          * This may need refinement down the road to check other things.
          */
         TAILQ_FOREACH(after_file, after, items) {
-            if (strsuffix(after_file->localpath, search_path) && !strcmp(get_mime_type(file), get_mime_type(after_file))) {
+            if (strsuffix(after_file->localpath, search_path) && same_file_type(file, after_file)) {
                 DEBUG_PRINT("%s probably moved to %s\n", file->localpath, after_file->localpath);
 
                 e.key = after_file->localpath;
@@ -586,6 +1087,7 @@ void find_file_peers(rpmfile_t *before, rpmfile_t *after)
 {
     struct hsearch_data *after_table = NULL;
     rpmfile_entry_t *before_entry = NULL;
+    uint64_t span = 0;
 
     assert(before != NULL);
     assert(after != NULL);
@@ -595,6 +1097,8 @@ void find_file_peers(rpmfile_t *before, rpmfile_t *after)
         return;
     }
 
+    span = trace_start();
+
     /* Create a hash table of the after list, mapping path(char *) to rpmfile_entry_t */
     after_table = files_to_table(after);
     assert(after_table);
@@ -606,6 +1110,8 @@ void find_file_peers(rpmfile_t *before, rpmfile_t *after)
 
     hdestroy_r(after_table);
     free(after_table);
+
+    trace_end(span, "peers", "find_file_peers", headerGetString(TAILQ_FIRST(after)->rpm_header, RPMTAG_NAME));
     return;
 }
 
@@ -613,42 +1119,41 @@ void find_file_peers(rpmfile_t *before, rpmfile_t *after)
  * @brief Return the capabilities(7) of the specified rpmfile_entry_t.
  *
  * If the capabilities(7) of the specified file are cached, return
- * that.  Otherwise get and cache the capabilities, then return the
- * cached value.
+ * that.  Otherwise read them from the RPMTAG_FILECAPS value in the
+ * package header and cache them.  The header is used rather than the
+ * extracted file so the capabilities are known for every file, even
+ * when the inspections running do not extract the payload.
  *
  * @param file rpmfile_entry_t specifying the file.
- * @return cap_t containing the capabilities(7) of the file.
+ * @return cap_t containing the capabilities(7) of the file, or NULL
+ *         if it has none.
  */
 cap_t get_cap(rpmfile_entry_t *file)
 {
-    int fd;
-    const char *arch = NULL;
+    const char *caps = NULL;
 
     assert(file != NULL);
-    arch = get_rpm_header_arch(file->rpm_header);
-    assert(arch != NULL);
 
     if (file->cap) {
         return file->cap;
     }
 
-    assert(file->fullpath != NULL);
-
-    /* Only for regular files */
+    /* Only regular files carry capabilities */
     if (!S_ISREG(file->st.st_mode)) {
         return NULL;
     }
 
-    /* Gather capabilities(7) for the file we need */
-    if ((fd = open(file->fullpath, O_RDONLY)) == -1) {
-        fprintf(stderr, _("*** unable to open() %s on %s: %s\n"), file->localpath, arch, strerror(errno));
+    caps = get_rpm_file_str(file, RPMTAG_FILECAPS);
+
+    if (caps == NULL || *caps == '\0') {
         return NULL;
     }
 
-    file->cap = cap_get_fd(fd);
+    file->cap = cap_from_text(caps);
 
-    if (close(fd) == -1) {
-        fprintf(stderr, _("*** unable to close() %s on %s: %s\n"), file->localpath, arch, strerror(errno));
+    if (file->cap == NULL) {
+        fprintf(stderr, _("*** unable to read capabilities '%s' of %s on %s: %s\n"), caps, file->localpath, get_rpm_header_arch(file->rpm_header), strerror(errno));
+        fflush(stderr);
     }
 
     return file->cap;
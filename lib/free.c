@@ -80,6 +80,8 @@ void free_rpminspect(struct rpminspect *ri) {
     free(ri->kojiursine);
     free(ri->kojimbs);
     free(ri->worksubdir);
+    free(ri->cache_dir);
+    free(ri->calibration);
 
     free(ri->vendor_data_dir);
     free(ri->licensedb);
@@ -122,6 +124,18 @@ void free_rpminspect(struct rpminspect *ri) {
         free(ri->caps_whitelist);
     }
 
+    if (ri->stat_whitelist_table) {
+        hdestroy_r(ri->stat_whitelist_table);
+        free(ri->stat_whitelist_table);
+    }
+
+    if (ri->caps_whitelist_table) {
+        hdestroy_r(ri->caps_whitelist_table);
+        free(ri->caps_whitelist_table);
+    }
+
+    list_free(ri->caps_whitelist_keys, free);
+
     list_free(ri->badwords, free);
 
     free_regex(ri->elf_path_include);
@@ -155,6 +169,8 @@ void free_rpminspect(struct rpminspect *ri) {
     free(ri->bin_group);
     list_free(ri->forbidden_owners, free);
     list_free(ri->forbidden_groups, free);
+    free_id_cache(ri->uid_cache);
+    free_id_cache(ri->gid_cache);
     list_free(ri->shells, free);
     free(ri->size_threshold);
     free_mapping(ri->jvm, ri->jvm_keys);
@@ -164,6 +180,14 @@ void free_rpminspect(struct rpminspect *ri) {
     list_free(ri->ignores, free);
     list_free(ri->lto_symbol_name_prefixes, free);
 
+    free_path_matcher(ri->security_path_prefix_match);
+    free_path_matcher(ri->header_file_extensions_match);
+    free_path_matcher(ri->forbidden_path_prefixes_match);
+    free_path_matcher(ri->forbidden_path_suffixes_match);
+    free_path_matcher(ri->forbidden_directories_match);
+    free_path_matcher(ri->bin_paths_match);
+    free_path_matcher(ri->pathmigration_match);
+
     free_rpmpeer(ri->peers);
 
     if (ri->header_cache != NULL) {
@@ -182,7 +206,11 @@ void free_rpminspect(struct rpminspect *ri) {
     free(ri->after_rel);
     free_pair(ri->macros);
 
+    free(ri->order);
     free_results(ri->results);
+    free_stats(ri->stats);
+
+    free_koji_client();
 
     return;
 }
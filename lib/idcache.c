@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <grp.h>
+#include <assert.h>
+#include "rpminspect.h"
+
+/**
+ * @file idcache.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief User and group name to ID cache.
+ *
+ * Files in a package usually share a handful of owners and groups.
+ * Resolving each name once per run keeps the ownership checks from
+ * going through NSS (and possibly SSSD) for every file.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/*
+ * Find name in the cache, or NULL if it has not been looked up yet.
+ */
+static id_cache_entry_t *find_id(id_cache_t *cache, const char *name)
+{
+    id_cache_entry_t *entry = NULL;
+
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    TAILQ_FOREACH(entry, cache, items) {
+        if (!strcmp(entry->name, name)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Add a new, unresolved name to the cache.
+ */
+static id_cache_entry_t *add_id(id_cache_t **cache, const char *name)
+{
+    id_cache_entry_t *entry = NULL;
+
+    assert(cache != NULL);
+
+    if (*cache == NULL) {
+        *cache = calloc(1, sizeof(*(*cache)));
+        assert(*cache != NULL);
+        TAILQ_INIT(*cache);
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    assert(entry != NULL);
+    entry->name = strdup(name);
+    assert(entry->name != NULL);
+    TAILQ_INSERT_TAIL(*cache, entry, items);
+    return entry;
+}
+
+/*
+ * Look up owner in the UID cache, resolving and adding it if needed.
+ */
+static id_cache_entry_t *resolve_owner(struct rpminspect *ri, const char *owner)
+{
+    struct passwd pw;
+    struct passwd *pwp = NULL;
+    char buf[sysconf(_SC_GETPW_R_SIZE_MAX)];
+    id_cache_entry_t *entry = NULL;
+
+    assert(ri != NULL);
+    assert(owner != NULL);
+
+    entry = find_id(ri->uid_cache, owner);
+
+    if (entry) {
+        return entry;
+    }
+
+    entry = add_id(&ri->uid_cache, owner);
+
+    if (getpwnam_r(owner, &pw, buf, sizeof(buf), &pwp) == 0 && pwp != NULL) {
+        entry->found = true;
+        entry->id = pw.pw_uid;
+    }
+
+    return entry;
+}
+
+/*
+ * Look up group in the GID cache, resolving and adding it if needed.
+ */
+static id_cache_entry_t *resolve_group(struct rpminspect *ri, const char *group)
+{
+    struct group gr;
+    struct group *grp = NULL;
+    char buf[sysconf(_SC_GETGR_R_SIZE_MAX)];
+    id_cache_entry_t *entry = NULL;
+
+    assert(ri != NULL);
+    assert(group != NULL);
+
+    entry = find_id(ri->gid_cache, group);
+
+    if (entry) {
+        return entry;
+    }
+
+    entry = add_id(&ri->gid_cache, group);
+
+    if (getgrnam_r(group, &gr, buf, sizeof(buf), &grp) == 0 && grp != NULL) {
+        entry->found = true;
+        entry->id = gr.gr_gid;
+    }
+
+    return entry;
+}
+
+/**
+ * @brief Resolve a user name to a UID, using the run-wide cache.
+ *
+ * @param ri The struct rpminspect for the program.
+ * @param owner The user name to resolve.
+ * @return The cache entry for owner.  Check the found member to see
+ *         if the name resolved.  Do not free the returned entry.
+ */
+const id_cache_entry_t *get_owner_id(struct rpminspect *ri, const char *owner)
+{
+    return resolve_owner(ri, owner);
+}
+
+/**
+ * @brief Resolve a group name to a GID, using the run-wide cache.
+ *
+ * @param ri The struct rpminspect for the program.
+ * @param group The group name to resolve.
+ * @return The cache entry for group.  Check the found member to see
+ *         if the name resolved.  Do not free the returned entry.
+ */
+const id_cache_entry_t *get_group_id(struct rpminspect *ri, const char *group)
+{
+    return resolve_group(ri, group);
+}
+
+/**
+ * @brief Pre-resolve the owner and group names from the configuration.
+ *
+ * Looks up bin_owner, bin_group, and every forbidden owner and group
+ * so the cache is warm before inspections run.  Entries for forbidden
+ * names are marked so callers can check them without walking the
+ * lists.
+ *
+ * @param ri The struct rpminspect for the program.
+ */
+void init_id_cache(struct rpminspect *ri)
+{
+    string_entry_t *entry = NULL;
+
+    assert(ri != NULL);
+
+    if (ri->bin_owner) {
+        resolve_owner(ri, ri->bin_owner);
+    }
+
+    if (ri->bin_group) {
+        resolve_group(ri, ri->bin_group);
+    }
+
+    if (ri->forbidden_owners) {
+        TAILQ_FOREACH(entry, ri->forbidden_owners, items) {
+            resolve_owner(ri, entry->data)->forbidden = true;
+        }
+    }
+
+    if (ri->forbidden_groups) {
+        TAILQ_FOREACH(entry, ri->forbidden_groups, items) {
+            resolve_group(ri, entry->data)->forbidden = true;
+        }
+    }
+
+    return;
+}
+
+/**
+ * @brief Free an id_cache_t.
+ *
+ * @param cache The cache to free (may be NULL).
+ */
+void free_id_cache(id_cache_t *cache)
+{
+    id_cache_entry_t *entry = NULL;
+
+    if (cache == NULL) {
+        return;
+    }
+
+    while (!TAILQ_EMPTY(cache)) {
+        entry = TAILQ_FIRST(cache);
+        TAILQ_REMOVE(cache, entry, items);
+        free(entry->name);
+        free(entry);
+    }
+
+    free(cache);
+    return;
+}
@@ -19,10 +19,9 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
-#include <glob.h>
+#include <fnmatch.h>
 #include <sys/queue.h>
 #include <assert.h>
-#include <err.h>
 
 #include "rpminspect.h"
 
@@ -34,25 +33,78 @@
  * @copyright GPL-3.0-or-later
  */
 
+/*
+ * Match path against a glob(3) pattern the way glob() with
+ * GLOB_PERIOD and GLOB_BRACE would, but without looking at the
+ * filesystem.  Brace groups are expanded one at a time.  A '{' without
+ * a matching '}' is taken literally.
+ */
+static bool match_pattern(const char *pattern, const char *path)
+{
+    const char *open = NULL;
+    const char *close = NULL;
+    const char *alt = NULL;
+    const char *p = NULL;
+    char *expanded = NULL;
+    int depth = 0;
+    bool match = false;
+
+    assert(pattern != NULL);
+    assert(path != NULL);
+
+    /* find the first brace group */
+    for (p = pattern; *p != '\0' && close == NULL; p++) {
+        if (*p == '\\' && *(p + 1) != '\0') {
+            p++;
+        } else if (*p == '{') {
+            if (depth++ == 0) {
+                open = p;
+            }
+        } else if (*p == '}' && depth > 0 && --depth == 0) {
+            close = p;
+        }
+    }
+
+    if (close == NULL) {
+        return fnmatch(pattern, path, FNM_PATHNAME) == 0;
+    }
+
+    /* try each comma separated alternative in the group */
+    alt = open + 1;
+    depth = 0;
+
+    for (p = alt; p <= close && !match; p++) {
+        if (*p == '\\' && p + 1 < close) {
+            p++;
+        } else if (*p == '{') {
+            depth++;
+        } else if (*p == '}' && depth > 0) {
+            depth--;
+        } else if ((*p == ',' && depth == 0) || p == close) {
+            xasprintf(&expanded, "%.*s%.*s%s", (int) (open - pattern), pattern, (int) (p - alt), alt, close + 1);
+            match = match_pattern(expanded, path);
+            free(expanded);
+            alt = p + 1;
+        }
+    }
+
+    return match;
+}
+
 /**
  * @brief Given a path and struct rpminspect, determine if the path should be ignored or not.
  *
+ * The ignore entries are glob(3) patterns.  They are matched against
+ * the path itself, so payload members that were not extracted are
+ * ignored the same as the ones that were.
+ *
  * @param ri The struct rpminspect for the program.
  * @param path The relative path to check (i.e., localpath).
- * @param root The root directory, optional (pass NULL to use '/').
  * @return True if path should be ignored, false otherwise.
  */
-bool ignore_path(const struct rpminspect *ri, const char *path, const char *root)
+bool ignore_path(const struct rpminspect *ri, const char *path)
 {
-    bool match = false;
     string_entry_t *entry = NULL;
-    int gflags = GLOB_NOSORT | GLOB_PERIOD | GLOB_BRACE;
-    char *globpath = NULL;
-    char *globsub = NULL;
-    glob_t found;
-    size_t len = 0;
-    int r = 0;
-    size_t i = 0;
 
     assert(ri != NULL);
 
@@ -60,44 +112,15 @@ bool ignore_path(const struct rpminspect *ri, const char *path, const char *root
         return true;
     }
 
-    if (root) {
-        len = strlen(root);
+    if (ri->ignores == NULL) {
+        return false;
     }
 
     TAILQ_FOREACH(entry, ri->ignores, items) {
-        if (root == NULL) {
-            globpath = strdup(entry->data);
-        } else {
-            xasprintf(&globpath, "%s%s", root, entry->data);
-        }
-
-        r = glob(globpath, gflags, NULL, &found);
-
-        if (r == GLOB_NOSPACE || r == GLOB_ABORTED) {
-            warn("%s: glob()", __func__);
-        }
-
-        if (r != 0) {
-            free(globpath);
-            continue;
-        }
-
-        for (i = 0; i < found.gl_pathc; i++) {
-            globsub = found.gl_pathv[i] + len;
-
-            if (!strcmp(globsub, path)) {
-                match = true;
-                break;
-            }
-        }
-
-        free(globpath);
-        globfree(&found);
-
-        if (match) {
-            break;
+        if (match_pattern(entry->data, path)) {
+            return true;
         }
     }
 
-    return match;
+    return false;
 }
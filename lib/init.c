@@ -574,6 +574,58 @@ static int read_cfgfile(struct rpminspect *ri, const char *filename)
                         } else if (!strcmp(key, "profiledir")) {
                             free(ri->profiledir);
                             ri->profiledir = strdup(t);
+                        } else if (!strcmp(key, "cache_dir")) {
+                            free(ri->cache_dir);
+                            ri->cache_dir = strdup(t);
+                        } else if (!strcmp(key, "cache_size")) {
+                            ri->cache_size = strtoull(t, NULL, 10) * 1024 * 1024;
+                        } else if (!strcmp(key, "extract")) {
+                            if (!strcasecmp(t, "eager")) {
+                                ri->extract_mode = EXTRACT_EAGER;
+                            } else if (!strcasecmp(t, "lazy")) {
+                                ri->extract_mode = EXTRACT_LAZY;
+                            } else {
+                                fprintf(stderr, _("*** unknown extract setting '%s', defaulting to 'eager'\n"), t);
+                                fflush(stderr);
+                                ri->extract_mode = EXTRACT_EAGER;
+                            }
+                        } else if (!strcmp(key, "debug_packages")) {
+                            if (!strcasecmp(t, "extract")) {
+                                ri->debug_packages = DEBUGPKG_EXTRACT;
+                            } else if (!strcasecmp(t, "lazy")) {
+                                ri->debug_packages = DEBUGPKG_LAZY;
+                            } else if (!strcasecmp(t, "list")) {
+                                ri->debug_packages = DEBUGPKG_LIST;
+                            } else if (!strcasecmp(t, "skip")) {
+                                ri->debug_packages = DEBUGPKG_SKIP;
+                            } else {
+                                fprintf(stderr, _("*** unknown debug_packages setting '%s', defaulting to 'extract'\n"), t);
+                                fflush(stderr);
+                                ri->debug_packages = DEBUGPKG_EXTRACT;
+                            }
+                        } else if (!strcmp(key, "teardown")) {
+                            if (!strcasecmp(t, "inline")) {
+                                ri->teardown = TEARDOWN_INLINE;
+                            } else if (!strcasecmp(t, "parallel")) {
+                                ri->teardown = TEARDOWN_PARALLEL;
+                            } else if (!strcasecmp(t, "background")) {
+                                ri->teardown = TEARDOWN_BACKGROUND;
+                            } else {
+                                fprintf(stderr, _("*** unknown teardown setting '%s', defaulting to 'parallel'\n"), t);
+                                fflush(stderr);
+                                ri->teardown = TEARDOWN_PARALLEL;
+                            }
+                        } else if (!strcmp(key, "order")) {
+                            if (!get_order_policy(t, &ri->order_policy)) {
+                                fprintf(stderr, _("*** unknown order setting '%s', defaulting to 'table'\n"), t);
+                                fflush(stderr);
+                                ri->order_policy = ORDER_TABLE;
+                            }
+                        } else if (!strcmp(key, "calibration")) {
+                            free(ri->calibration);
+                            ri->calibration = strdup(t);
+                        } else if (!strcmp(key, "trace_threshold")) {
+                            ri->trace_threshold = strtoul(t, NULL, 10);
                         }
                     } else if (block == BLOCK_KOJI) {
                         if (!strcmp(key, "hub")) {
@@ -585,6 +637,14 @@ static int read_cfgfile(struct rpminspect *ri, const char *filename)
                         } else if (!strcmp(key, "download_mbs")) {
                             free(ri->kojimbs);
                             ri->kojimbs = strdup(t);
+                        } else if (!strcmp(key, "download_concurrency")) {
+                            ri->download_concurrency = strtoul(t, NULL, 10);
+
+                            if (ri->download_concurrency == 0) {
+                                ri->download_concurrency = 1;
+                            }
+                        } else if (!strcmp(key, "download_retries")) {
+                            ri->download_retries = strtoul(t, NULL, 10);
                         }
                     } else if (group == BLOCK_METADATA) {
                         /*
@@ -841,6 +901,9 @@ bool init_stat_whitelist(struct rpminspect *ri) {
     char *fnpart = NULL;
     stat_whitelist_field_t field = MODE;
     stat_whitelist_entry_t *entry = NULL;
+    size_t count = 0;
+    ENTRY e;
+    ENTRY *eptr = NULL;
 
     assert(ri != NULL);
     assert(ri->vendor_data_dir != NULL);
@@ -936,6 +999,30 @@ bool init_stat_whitelist(struct rpminspect *ri) {
         field = MODE;
     }
 
+    fclose(input);
+
+    /* index the entries by path, the first listed entry wins */
+    TAILQ_FOREACH(entry, ri->stat_whitelist, items) {
+        count++;
+    }
+
+    ri->stat_whitelist_table = calloc(1, sizeof(*ri->stat_whitelist_table));
+    assert(ri->stat_whitelist_table != NULL);
+
+    if (hcreate_r(count * 1.25, ri->stat_whitelist_table) == 0) {
+        fprintf(stderr, _("*** hcreate_r() failure in init_stat_whitelist()\n"));
+        fflush(stderr);
+        free(ri->stat_whitelist_table);
+        ri->stat_whitelist_table = NULL;
+        return true;
+    }
+
+    TAILQ_FOREACH(entry, ri->stat_whitelist, items) {
+        e.key = entry->filename;
+        e.data = entry;
+        hsearch_r(e, ENTER, &eptr, ri->stat_whitelist_table);
+    }
+
     return true;
 }
 
@@ -955,6 +1042,10 @@ bool init_caps_whitelist(struct rpminspect *ri)
     caps_filelist_t *files = NULL;
     caps_whitelist_entry_t *entry = NULL;
     caps_filelist_entry_t *filelist_entry = NULL;
+    char *key = NULL;
+    size_t count = 0;
+    ENTRY e;
+    ENTRY *eptr = NULL;
 
     assert(ri != NULL);
     assert(ri->vendor_data_dir != NULL);
@@ -1044,9 +1135,112 @@ bool init_caps_whitelist(struct rpminspect *ri)
         field = PACKAGE;
     }
 
+    fclose(input);
+
+    /* index the entries by package and path, the first listed entry wins */
+    TAILQ_FOREACH(entry, ri->caps_whitelist, items) {
+        TAILQ_FOREACH(filelist_entry, entry->files, items) {
+            count++;
+        }
+    }
+
+    ri->caps_whitelist_table = calloc(1, sizeof(*ri->caps_whitelist_table));
+    assert(ri->caps_whitelist_table != NULL);
+
+    if (hcreate_r(count * 1.25, ri->caps_whitelist_table) == 0) {
+        fprintf(stderr, _("*** hcreate_r() failure in init_caps_whitelist()\n"));
+        fflush(stderr);
+        free(ri->caps_whitelist_table);
+        ri->caps_whitelist_table = NULL;
+        return true;
+    }
+
+    TAILQ_FOREACH(entry, ri->caps_whitelist, items) {
+        TAILQ_FOREACH(filelist_entry, entry->files, items) {
+            if (filelist_entry->path == NULL) {
+                continue;
+            }
+
+            /* same key format as get_caps_whitelist_entry() */
+            xasprintf(&key, "%s %s", entry->pkg, filelist_entry->path);
+            add_entry(&ri->caps_whitelist_keys, key);
+            free(key);
+
+            e.key = TAILQ_LAST(ri->caps_whitelist_keys, string_entry_s)->data;
+            e.data = filelist_entry;
+            hsearch_r(e, ENTER, &eptr, ri->caps_whitelist_table);
+        }
+    }
+
     return true;
 }
 
+/*
+ * Compile the path lists from the configuration in to path matchers.
+ * Each list is normalized here the same way the inspections used to
+ * normalize entries on every comparison.
+ */
+static void compile_path_matchers(struct rpminspect *ri)
+{
+    string_entry_t *entry = NULL;
+    const char *key = NULL;
+    char *tmp = NULL;
+
+    assert(ri != NULL);
+
+    /* forbidden prefixes are compared without leading slashes */
+    if (ri->forbidden_path_prefixes) {
+        ri->forbidden_path_prefixes_match = init_path_matcher(PATH_MATCH_PREFIX);
+
+        TAILQ_FOREACH(entry, ri->forbidden_path_prefixes, items) {
+            key = entry->data;
+
+            while (*key == '/') {
+                key++;
+            }
+
+            add_path_matcher_rule(ri->forbidden_path_prefixes_match, key, entry->data);
+        }
+    }
+
+    ri->forbidden_path_suffixes_match = compile_path_matcher(ri->forbidden_path_suffixes, PATH_MATCH_SUFFIX);
+    ri->forbidden_directories_match = compile_path_matcher(ri->forbidden_directories, PATH_MATCH_EXACT);
+    ri->header_file_extensions_match = compile_path_matcher(ri->header_file_extensions, PATH_MATCH_SUFFIX);
+    ri->bin_paths_match = compile_path_matcher(ri->bin_paths, PATH_MATCH_PREFIX);
+
+    /* security path prefixes start at the first slash */
+    if (ri->security_path_prefix) {
+        ri->security_path_prefix_match = init_path_matcher(PATH_MATCH_PREFIX);
+
+        TAILQ_FOREACH(entry, ri->security_path_prefix, items) {
+            key = strchr(entry->data, '/');
+
+            if (key == NULL) {
+                continue;
+            }
+
+            add_path_matcher_rule(ri->security_path_prefix_match, key, entry->data);
+        }
+    }
+
+    /* path migrations match on the old directory with a trailing slash */
+    if (ri->pathmigration_keys) {
+        ri->pathmigration_match = init_path_matcher(PATH_MATCH_PREFIX);
+
+        TAILQ_FOREACH(entry, ri->pathmigration_keys, items) {
+            if (strsuffix(entry->data, "/")) {
+                add_path_matcher_rule(ri->pathmigration_match, entry->data, NULL);
+            } else {
+                xasprintf(&tmp, "%s/", entry->data);
+                add_path_matcher_rule(ri->pathmigration_match, tmp, entry->data);
+                free(tmp);
+            }
+        }
+    }
+
+    return;
+}
+
 /*
  * Initialize a struct rpminspect.  Called by applications using
  * librpminspect before they began calling library functions.
@@ -1067,6 +1261,14 @@ int init_rpminspect(struct rpminspect *ri, const char *cfgfile, const char *prof
     ri->vendor_data_dir = strdup(VENDOR_DATA_DIR);
     ri->licensedb = strdup(LICENSE_DB_FILE);
     ri->favor_release = FAVOR_NONE;
+    ri->download_concurrency = DOWNLOAD_CONCURRENCY;
+    ri->download_retries = DOWNLOAD_RETRIES;
+    ri->cache_size = (uint64_t) CACHE_SIZE * 1024 * 1024;
+    ri->extract_mode = EXTRACT_EAGER;
+    ri->debug_packages = DEBUGPKG_EXTRACT;
+    ri->teardown = TEARDOWN_PARALLEL;
+    ri->order_policy = ORDER_TABLE;
+    ri->trace_threshold = TRACE_THRESHOLD;
     ri->tests = ~0;
     ri->desktop_entry_files_dir = strdup(DESKTOP_ENTRY_FILES_DIR);
     ri->bin_paths = list_from_array(BIN_PATHS);
@@ -1083,6 +1285,8 @@ int init_rpminspect(struct rpminspect *ri, const char *cfgfile, const char *prof
     if ((ri->cfgfile == NULL) || (access(ri->cfgfile, F_OK|R_OK) == -1)) {
         free(ri->cfgfile);
         ri->cfgfile = NULL;
+        compile_path_matchers(ri);
+        init_id_cache(ri);
         return 0;
     }
 
@@ -1108,6 +1312,12 @@ int init_rpminspect(struct rpminspect *ri, const char *cfgfile, const char *prof
         free(tmp);
     }
 
+    /* compile path lists now that all configuration files are read */
+    compile_path_matchers(ri);
+
+    /* resolve the configured owners and groups once */
+    init_id_cache(ri);
+
     /* the rest of the members are used at runtime */
     ri->buildtype = KOJI_BUILD_RPM;
     ri->peers = init_rpmpeer();
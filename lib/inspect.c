@@ -38,41 +38,42 @@ struct inspect inspections[] = {
      * { INSPECT_TYPE (add to inspect.h),
      *   "short name",
      *   bool--true if for single build, false if before&after required,
+     *   FILES_* classes of payload files read (add to inspect.h),
      *   &function_pointer },
      *
      * NOTE: long descriptions are inspect.h and returned by inspection_desc()
      */
-    { INSPECT_LICENSE,       "license",       true,  &inspect_license },
-    { INSPECT_EMPTYRPM,      "emptyrpm",      true,  &inspect_emptyrpm },
-    { INSPECT_LOSTPAYLOAD,   "lostpayload",   false, &inspect_lostpayload },
-    { INSPECT_METADATA,      "metadata",      true,  &inspect_metadata },
-    { INSPECT_MANPAGE,       "manpage",       true,  &inspect_manpage },
-    { INSPECT_XML,           "xml",           true,  &inspect_xml },
-    { INSPECT_ELF,           "elf",           true,  &inspect_elf },
-    { INSPECT_DESKTOP,       "desktop",       true,  &inspect_desktop },
-    { INSPECT_DISTTAG,       "disttag",       true,  &inspect_disttag },
-    { INSPECT_SPECNAME,      "specname",      true,  &inspect_specname },
-    { INSPECT_MODULARITY,    "modularity",    true,  &inspect_modularity },
-    { INSPECT_JAVABYTECODE,  "javabytecode",  true,  &inspect_javabytecode },
-    { INSPECT_CHANGEDFILES,  "changedfiles",  false, &inspect_changedfiles },
-    { INSPECT_REMOVEDFILES,  "removedfiles",  false, &inspect_removedfiles },
-    { INSPECT_ADDEDFILES,    "addedfiles",    false, &inspect_addedfiles },
-    { INSPECT_UPSTREAM,      "upstream",      false, &inspect_upstream },
-    { INSPECT_OWNERSHIP,     "ownership",     true,  &inspect_ownership },
-    { INSPECT_SHELLSYNTAX,   "shellsyntax",   true,  &inspect_shellsyntax },
-    { INSPECT_ANNOCHECK,     "annocheck",     true,  &inspect_annocheck },
-    { INSPECT_DT_NEEDED,     "DT_NEEDED",     false, &inspect_dt_needed },
-    { INSPECT_FILESIZE,      "filesize",      false, &inspect_filesize },
-    { INSPECT_PERMISSIONS,   "permissions",   false, &inspect_permissions },
-    { INSPECT_CAPABILITIES,  "capabilities",  true,  &inspect_capabilities },
-    { INSPECT_KMOD,          "kmod",          false, &inspect_kmod },
-    { INSPECT_ARCH,          "arch",          false, &inspect_arch },
-    { INSPECT_SUBPACKAGES,   "subpackages",   false, &inspect_subpackages },
-    { INSPECT_CHANGELOG,     "changelog",     false, &inspect_changelog },
-    { INSPECT_PATHMIGRATION, "pathmigration", true,  &inspect_pathmigration },
-    { INSPECT_LTO,           "LTO",           true,  &inspect_lto },
-    { INSPECT_SYMLINKS,      "symlinks",      true,  &inspect_symlinks },
-    { 0, NULL, false, NULL }
+    { INSPECT_LICENSE,       "license",       true,  FILES_NONE,                                   &inspect_license },
+    { INSPECT_EMPTYRPM,      "emptyrpm",      true,  FILES_NONE,                                   &inspect_emptyrpm },
+    { INSPECT_LOSTPAYLOAD,   "lostpayload",   false, FILES_NONE,                                   &inspect_lostpayload },
+    { INSPECT_METADATA,      "metadata",      true,  FILES_NONE,                                   &inspect_metadata },
+    { INSPECT_MANPAGE,       "manpage",       true,  FILES_MANPAGES,                               &inspect_manpage },
+    { INSPECT_XML,           "xml",           true,  FILES_TEXT,                                   &inspect_xml },
+    { INSPECT_ELF,           "elf",           true,  FILES_ELF | FILES_STATIC_LIBS | FILES_DEBUG,  &inspect_elf },
+    { INSPECT_DESKTOP,       "desktop",       true,  FILES_PAYLOAD,                                &inspect_desktop },
+    { INSPECT_DISTTAG,       "disttag",       true,  FILES_SOURCE,                                 &inspect_disttag },
+    { INSPECT_SPECNAME,      "specname",      true,  FILES_NONE,                                   &inspect_specname },
+    { INSPECT_MODULARITY,    "modularity",    true,  FILES_NONE,                                   &inspect_modularity },
+    { INSPECT_JAVABYTECODE,  "javabytecode",  true,  FILES_JAVA,                                   &inspect_javabytecode },
+    { INSPECT_CHANGEDFILES,  "changedfiles",  false, FILES_PAYLOAD,                                &inspect_changedfiles },
+    { INSPECT_REMOVEDFILES,  "removedfiles",  false, FILES_PAYLOAD,                                &inspect_removedfiles },
+    { INSPECT_ADDEDFILES,    "addedfiles",    false, FILES_NONE,                                   &inspect_addedfiles },
+    { INSPECT_UPSTREAM,      "upstream",      false, FILES_SOURCE,                                 &inspect_upstream },
+    { INSPECT_OWNERSHIP,     "ownership",     true,  FILES_NONE,                                   &inspect_ownership },
+    { INSPECT_SHELLSYNTAX,   "shellsyntax",   true,  FILES_TEXT,                                   &inspect_shellsyntax },
+    { INSPECT_ANNOCHECK,     "annocheck",     true,  FILES_ELF,                                    &inspect_annocheck },
+    { INSPECT_DT_NEEDED,     "DT_NEEDED",     false, FILES_ELF,                                    &inspect_dt_needed },
+    { INSPECT_FILESIZE,      "filesize",      false, FILES_NONE,                                   &inspect_filesize },
+    { INSPECT_PERMISSIONS,   "permissions",   false, FILES_WRITABLE,                               &inspect_permissions },
+    { INSPECT_CAPABILITIES,  "capabilities",  true,  FILES_NONE,                                   &inspect_capabilities },
+    { INSPECT_KMOD,          "kmod",          false, FILES_KMODS,                                  &inspect_kmod },
+    { INSPECT_ARCH,          "arch",          false, FILES_NONE,                                   &inspect_arch },
+    { INSPECT_SUBPACKAGES,   "subpackages",   false, FILES_NONE,                                   &inspect_subpackages },
+    { INSPECT_CHANGELOG,     "changelog",     false, FILES_NONE,                                   &inspect_changelog },
+    { INSPECT_PATHMIGRATION, "pathmigration", true,  FILES_NONE,                                   &inspect_pathmigration },
+    { INSPECT_LTO,           "LTO",           true,  FILES_ELF | FILES_STATIC_LIBS,                &inspect_lto },
+    { INSPECT_SYMLINKS,      "symlinks",      true,  FILES_PAYLOAD,                                &inspect_symlinks },
+    { 0, NULL, false, FILES_NONE, NULL }
 };
 
 /**
@@ -82,7 +83,8 @@ struct inspect inspections[] = {
  * foreach_peer_file_func returns false for any file, the result will
  * be false.  foreach_peer_file_func is run on each file even if an
  * earlier file fails. This allows for multiple errors to be collected
- * for a single inspection.
+ * for a single inspection.  The only exception is a run cancelled by
+ * --fail-fast, which stops the iteration.
  *
  * @param ri Pointer to the struct rpminspect used for the program.
  * @param callback Callback function to iterate over each file.
@@ -95,6 +97,7 @@ bool foreach_peer_file(struct rpminspect *ri, foreach_peer_file_func check_fn, b
     rpmpeer_entry_t *peer;
     rpmfile_entry_t *file;
     bool result = true;
+    uint64_t span = 0;
 
     assert(ri != NULL);
     assert(check_fn != NULL);
@@ -106,14 +109,24 @@ bool foreach_peer_file(struct rpminspect *ri, foreach_peer_file_func check_fn, b
         }
 
         TAILQ_FOREACH(file, peer->after_files, items) {
+            /* --fail-fast cancelled the run */
+            if (run_cancelled()) {
+                return result;
+            }
+
             /* Ignore files we should be ignoring */
-            if (use_ignore && ignore_path(ri, file->localpath, peer->after_root)) {
+            if (use_ignore && ignore_path(ri, file->localpath)) {
                 continue;
             }
 
+            count_file_visit();
+            span = trace_start();
+
             if (!check_fn(ri, file)) {
                 result = false;
             }
+
+            trace_end_slow(span, "file", file->localpath, get_rpm_header_arch(file->rpm_header));
         }
     }
 
@@ -194,3 +207,64 @@ const char *inspection_desc(const uint64_t inspection)
             return NULL;
     }
 }
+
+/**
+ * @brief Return the payload file classes the enabled inspections read.
+ *
+ * @param ri Pointer to the struct rpminspect used for the program.
+ * @return Mask of FILES_* classes to extract.
+ */
+uint32_t payload_files(const struct rpminspect *ri)
+{
+    return remaining_payload_files(ri, 0);
+}
+
+/**
+ * @brief Return the index in inspections[] of the inspection run nth.
+ *
+ * @param ri Pointer to the struct rpminspect used for the program.
+ * @param n Position in the run order.
+ * @return Index in inspections[], -1 past the last inspection.
+ */
+int inspection_at(const struct rpminspect *ri, const int n)
+{
+    assert(ri != NULL);
+    assert(n >= 0);
+
+    if (ri->order != NULL) {
+        return ri->order[n];
+    }
+
+    return (inspections[n].flag != 0) ? n : -1;
+}
+
+/**
+ * @brief Return the payload file classes read by the enabled
+ * inspections from position first in the run order on.
+ *
+ * @param ri Pointer to the struct rpminspect used for the program.
+ * @param first Position in the run order to start at.
+ * @return Mask of FILES_* classes.
+ */
+uint32_t remaining_payload_files(const struct rpminspect *ri, const int first)
+{
+    uint32_t files = FILES_NONE;
+    int n = 0;
+    int i = 0;
+
+    assert(ri != NULL);
+
+    for (n = first; (i = inspection_at(ri, n)) != -1; n++) {
+        if (!(ri->tests & inspections[i].flag)) {
+            continue;
+        }
+
+        if (ri->before == NULL && !inspections[i].single_build) {
+            continue;
+        }
+
+        files |= inspections[i].files;
+    }
+
+    return files;
+}
@@ -33,10 +33,9 @@
 static bool addedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 {
     const char *name = NULL;
-    char *subpath = NULL;
-    char *localpath = NULL;
+    const char *localpath = NULL;
+    const char *rule = NULL;
     const char *arch = NULL;
-    string_entry_t *entry = NULL;
     struct result_params params;
 
     /* Skip files with a peer, other inspections handle changed/missing files */
@@ -83,71 +82,48 @@ static bool addedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     params.file = file->localpath;
 
     /* Check for any forbidden path prefixes */
-    if (ri->forbidden_path_prefixes) {
-        TAILQ_FOREACH(entry, ri->forbidden_path_prefixes, items) {
-            subpath = entry->data;
-            localpath = file->localpath;
-
-            /* ensure the paths do not start with '/' */
-            if (*subpath == '/') {
-                while (*subpath == '/') {
-                    subpath++;
-                }
-            }
-
-            if (*localpath == '/') {
-                while (*localpath == '/') {
-                    localpath++;
-                }
-            }
-
-            if (strprefix(localpath, subpath)) {
-                xasprintf(&params.msg, _("Packages should not contain not files or directories starting with `%s` on %s: %s"), entry->data, arch, file->localpath);
-                add_result(ri, &params);
-                goto done;
-            }
-        }
+    localpath = file->localpath;
+
+    /* ensure the path does not start with '/' */
+    while (*localpath == '/') {
+        localpath++;
+    }
+
+    rule = match_path(ri->forbidden_path_prefixes_match, localpath);
+
+    if (rule) {
+        xasprintf(&params.msg, _("Packages should not contain not files or directories starting with `%s` on %s: %s"), rule, arch, file->localpath);
+        add_result(ri, &params);
+        goto done;
     }
 
     /* Check for any forbidden path suffixes */
-    if (ri->forbidden_path_suffixes) {
-        TAILQ_FOREACH(entry, ri->forbidden_path_suffixes, items) {
-            if (strsuffix(file->localpath, entry->data)) {
-                xasprintf(&params.msg, _("Packages should not contain files or directories ending with `%s` on %s: %s"), entry->data, arch, file->localpath);
-                add_result(ri, &params);
-                goto done;
-            }
-        }
+    rule = match_path(ri->forbidden_path_suffixes_match, file->localpath);
+
+    if (rule) {
+        xasprintf(&params.msg, _("Packages should not contain files or directories ending with `%s` on %s: %s"), rule, arch, file->localpath);
+        add_result(ri, &params);
+        goto done;
     }
 
     /* Check for any forbidden directories */
-    if (ri->forbidden_directories && S_ISDIR(file->st.st_mode)) {
-        TAILQ_FOREACH(entry, ri->forbidden_directories, items) {
-            if (!strcmp(file->localpath, entry->data)) {
-                xasprintf(&params.msg, _("Forbidden directory `%s` found on %s"), entry->data, arch);
-                add_result(ri, &params);
-                goto done;
-            }
+    if (S_ISDIR(file->st.st_mode)) {
+        rule = match_path(ri->forbidden_directories_match, file->localpath);
+
+        if (rule) {
+            xasprintf(&params.msg, _("Forbidden directory `%s` found on %s"), rule, arch);
+            add_result(ri, &params);
+            goto done;
         }
     }
 
     /* New security path file */
-    if (ri->security_path_prefix && S_ISREG(file->st.st_mode)) {
-        TAILQ_FOREACH(entry, ri->security_path_prefix, items) {
-            subpath = entry->data;
-
-            while (*subpath != '/') {
-                subpath++;
-            }
-
-            if (strprefix(file->localpath, subpath)) {
-                params.severity = RESULT_VERIFY;
-                params.waiverauth = WAIVABLE_BY_SECURITY;
-                xasprintf(&params.msg, _("New security-related file `%s` added on %s requires inspection by the Security Team"), file->localpath, arch);
-                add_result(ri, &params);
-                goto done;
-            }
-        }
+    if (S_ISREG(file->st.st_mode) && match_path(ri->security_path_prefix_match, file->localpath)) {
+        params.severity = RESULT_VERIFY;
+        params.waiverauth = WAIVABLE_BY_SECURITY;
+        xasprintf(&params.msg, _("New security-related file `%s` added on %s requires inspection by the Security Team"), file->localpath, arch);
+        add_result(ri, &params);
+        goto done;
     }
 
     /* Check for any new setuid or setgid files */
@@ -97,7 +97,6 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     char *skip_line = NULL;
     int exitcode;
     bool possible_header = false;
-    string_entry_t *entry = NULL;
     char *before_tmp = NULL;
     char *after_tmp = NULL;
     int fd;
@@ -156,18 +155,9 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     params.file = file->localpath;
 
     /* Set the waiver type if this is a file of security concern */
-    if (ri->security_path_prefix) {
-        TAILQ_FOREACH(entry, ri->security_path_prefix, items) {
-            while (*entry->data != '/') {
-                entry->data++;
-            }
-
-            if (strprefix(file->localpath, entry->data)) {
-                params.severity = RESULT_BAD;
-                params.waiverauth = WAIVABLE_BY_SECURITY;
-                break;
-            }
-        }
+    if (match_path(ri->security_path_prefix_match, file->localpath)) {
+        params.severity = RESULT_BAD;
+        params.waiverauth = WAIVABLE_BY_SECURITY;
     }
 
     /* Get the MIME type of the file, will need that */
@@ -338,13 +328,8 @@ static bool changedfiles_driver(struct rpminspect *ri, rpmfile_entry_t *file)
      * be a configuration file change.  But more importantly, this check
      * excludes any header files that lack a file ending like this.
      */
-    if (ri->header_file_extensions) {
-        TAILQ_FOREACH(entry, ri->header_file_extensions, items) {
-            if (strsuffix(file->localpath, entry->data)) {
-                possible_header = true;
-                break;
-            }
-        }
+    if (match_path(ri->header_file_extensions_match, file->localpath)) {
+        possible_header = true;
     }
 
     if (!strcmp(type, "text/x-c") && possible_header) {
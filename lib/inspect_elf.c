@@ -70,6 +70,11 @@ void init_elf_data(void)
     ENTRY e;
     ENTRY *eptr;
 
+    /* already loaded */
+    if (fortifiable_table != NULL) {
+        return;
+    }
+
     /*
      * Use libdl to get the path to libc.so.6 so we can open it.
      * This is kind of lame, but avoids having to hardcode library paths
@@ -1239,10 +1244,15 @@ bool inspect_elf(struct rpminspect *ri)
 {
     bool result;
     struct result_params params;
+    bool loaded = (fortifiable_table != NULL);
 
+    /* keep the data if it was loaded ahead of time, see serve() */
     init_elf_data();
     result = foreach_peer_file(ri, elf_driver, true);
-    free_elf_data();
+
+    if (!loaded) {
+        free_elf_data();
+    }
 
     if (result) {
         init_result_params(&params);
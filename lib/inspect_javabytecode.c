@@ -171,6 +171,11 @@ static bool javabytecode_driver(struct rpminspect *ri, rpmfile_entry_t *file, co
     char *tmppath = NULL;
     int jarstatus = 0;
 
+    /* Only Java files are extracted for this inspection */
+    if (file->fullpath == NULL) {
+        return true;
+    }
+
     if (strsuffix(file->fullpath, JAR_FILENAME_EXTENSION)) {
         /* if we have a possible jar file, try to unpack and walk it */
 
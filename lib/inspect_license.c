@@ -385,6 +385,35 @@ static int check_peer_license(struct rpminspect *ri, struct result_params *param
     return ret;
 }
 
+/**
+ * @brief Read the license database ahead of the license inspection.
+ *
+ * The inspection then uses it and leaves it loaded, so a process that
+ * runs more than one comparison (see serve()) reads it once.  Does
+ * nothing if the database is missing, the inspection reports that.
+ *
+ * @param ri Pointer to the struct rpminspect for the program.
+ */
+void load_licensedb(const struct rpminspect *ri)
+{
+    char *actual_licensedb = NULL;
+
+    assert(ri != NULL);
+
+    if (licdb != NULL || ri->licensedb == NULL) {
+        return;
+    }
+
+    xasprintf(&actual_licensedb, "%s/%s/%s", ri->vendor_data_dir, LICENSES_DIR, ri->licensedb);
+
+    if (access(actual_licensedb, F_OK|R_OK) == 0) {
+        licdb = read_licensedb(actual_licensedb);
+    }
+
+    free(actual_licensedb);
+    return;
+}
+
 /*
  * Helper function to clean up the static globals here.
  */
@@ -427,6 +456,7 @@ bool inspect_license(struct rpminspect *ri)
     rpmpeer_entry_t *peer = NULL;
     char *actual_licensedb = NULL;
     struct result_params params;
+    bool loaded = (licdb != NULL);
 
     assert(ri != NULL);
     assert(ri->peers != NULL);
@@ -463,8 +493,11 @@ bool inspect_license(struct rpminspect *ri)
         seen++;
     }
 
-    /* Clean up */
-    free_licensedb();
+    /* Clean up, unless load_licensedb() read the database */
+    if (!loaded) {
+        free_licensedb();
+    }
+
     free(actual_licensedb);
 
     if (good == seen) {
@@ -21,8 +21,6 @@
 #include <unistd.h>
 #include <limits.h>
 #include <sys/types.h>
-#include <pwd.h>
-#include <grp.h>
 #include <errno.h>
 #include <assert.h>
 #include <err.h>
@@ -31,64 +29,37 @@
 #include "rpminspect.h"
 
 /*
- * Given an RPM header tag, get that header tag array and return the
- * string that matches the index value for this file.  That's complex,
- * but some tags are arrays of strings (or ints) and what we need to
- * do is first get the array, then knowing the index entry for the file
- * we have, pull that array index out and return it.
- *
- * Limitations:
- * "tag" must refer to an s[] tag (see rpmtag.h from librpm)
- * "file" must have a usable array index value (idx)
- *
- * Returned value must be free'd by caller.
+ * Given an RPM header tag, return the string for this file from the
+ * decoded header columns.  "tag" must refer to an s[] tag (see
+ * get_rpm_file_str()).  Do not free the returned value.
  */
-static char *get_header_value(const rpmfile_entry_t *file, rpmTag tag)
+static const char *get_header_value(const rpmfile_entry_t *file, rpmTag tag)
 {
-    rpmtd td = NULL;
-    rpmFlags flags = HEADERGET_MINMEM | HEADERGET_EXT | HEADERGET_ARGV;
     const char *val = NULL;
-    char *ret = NULL;
 
     assert(file != NULL);
     assert(file->idx >= 0);
 
-    /* get the tag */
-    td = rpmtdNew();
+    val = get_rpm_file_str(file, tag);
 
-    if (!headerGet(file->rpm_header, tag, td, flags)) {
+    if (val == NULL) {
         fprintf(stderr, _("*** unable to find tag %d for %s\n"), tag, file->fullpath);
         abort();
     }
 
-    /* walk the tag and cram everything in to a list */
-    while ((val = rpmtdNextString(td)) != NULL) {
-        if (rpmtdGetIndex(td) == file->idx) {
-            ret = strdup(val);
-            break;
-        }
-    }
-
-    rpmtdFree(td);
-    return ret;
+    return val;
 }
 
 /* Main driver for the 'ownership' inspection */
 static bool ownership_driver(struct rpminspect *ri, rpmfile_entry_t *file) {
     bool result = true;
     const char *arch = NULL;
-    char *owner = NULL;
-    char *group = NULL;
-    int r = 0;
-    struct passwd pw;
-    struct passwd *pwp = NULL;
-    char pbuf[sysconf(_SC_GETPW_R_SIZE_MAX)];
-    struct group gr;
-    struct group *grp = NULL;
-    char gbuf[sysconf(_SC_GETGR_R_SIZE_MAX)];
-    char *before_owner = NULL;
-    char *before_group = NULL;
-    string_entry_t *entry = NULL;
+    const char *owner = NULL;
+    const char *group = NULL;
+    const id_cache_entry_t *owner_id = NULL;
+    const id_cache_entry_t *group_id = NULL;
+    const char *before_owner = NULL;
+    const char *before_group = NULL;
     bool bin = false;
     char *before_val = NULL;
     char *after_val = NULL;
@@ -113,16 +84,16 @@ static bool ownership_driver(struct rpminspect *ri, rpmfile_entry_t *file) {
      * Try to look up the ID values of the owner and name and put
      * those in the struct stat
      */
-    r = getpwnam_r(owner, &pw, pbuf, sizeof(pbuf), &pwp);
+    owner_id = get_owner_id(ri, owner);
 
-    if (r == 0 && pwp != NULL) {
-        file->st.st_uid = pw.pw_uid;
+    if (owner_id->found) {
+        file->st.st_uid = owner_id->id;
     }
 
-    r = getgrnam_r(group, &gr, gbuf, sizeof(gbuf), &grp);
+    group_id = get_group_id(ri, group);
 
-    if (r == 0 && grp != NULL) {
-        file->st.st_gid = gr.gr_gid;
+    if (group_id->found) {
+        file->st.st_gid = group_id->id;
     }
 
     /* Set up result parameters */
@@ -136,98 +107,84 @@ static bool ownership_driver(struct rpminspect *ri, rpmfile_entry_t *file) {
      */
 
     /* Report forbidden file owners */
-    if (ri->forbidden_owners) {
-        TAILQ_FOREACH(entry, ri->forbidden_owners, items) {
-            if (!strcmp(owner, entry->data)) {
-                xasprintf(&params.msg, _("File %s has forbidden owner `%s` on %s"), file->localpath, owner, arch);
-                params.severity = RESULT_BAD;
-                params.waiverauth = WAIVABLE_BY_ANYONE;
-                params.remedy = REMEDY_OWNERSHIP_DEFATTR;
-                add_result(ri, &params);
-                free(params.msg);
-                result = false;
-                break;
-            }
-        }
+    if (owner_id->forbidden) {
+        xasprintf(&params.msg, _("File %s has forbidden owner `%s` on %s"), file->localpath, owner, arch);
+        params.severity = RESULT_BAD;
+        params.waiverauth = WAIVABLE_BY_ANYONE;
+        params.remedy = REMEDY_OWNERSHIP_DEFATTR;
+        add_result(ri, &params);
+        free(params.msg);
+        result = false;
     }
 
     /* Report forbidden file groups */
-    if (ri->forbidden_groups) {
-        TAILQ_FOREACH(entry, ri->forbidden_groups, items) {
-            if (!strcmp(group, entry->data)) {
-                xasprintf(&params.msg, _("File %s has forbidden group `%s` on %s"), file->localpath, owner, arch);
-                params.severity = RESULT_BAD;
-                params.waiverauth = WAIVABLE_BY_ANYONE;
-                params.remedy = REMEDY_OWNERSHIP_DEFATTR;
-                add_result(ri, &params);
-                free(params.msg);
-                result = false;
-                break;
-            }
-        }
+    if (group_id->forbidden) {
+        xasprintf(&params.msg, _("File %s has forbidden group `%s` on %s"), file->localpath, group, arch);
+        params.severity = RESULT_BAD;
+        params.waiverauth = WAIVABLE_BY_ANYONE;
+        params.remedy = REMEDY_OWNERSHIP_DEFATTR;
+        add_result(ri, &params);
+        free(params.msg);
+        result = false;
     }
 
     /* Report files in bin paths not under the bin owner or group */
-    TAILQ_FOREACH(entry, ri->bin_paths, items) {
-        if (strprefix(file->localpath, entry->data)) {
-            bin = true;
+    if (match_path(ri->bin_paths_match, file->localpath)) {
+        bin = true;
 
-            /* Check the owner */
-            if (strcmp(owner, ri->bin_owner) && !on_stat_whitelist_owner(ri, file, owner, HEADER_OWNERSHIP, NULL)) {
-                xasprintf(&params.msg, _("File %s has owner `%s` on %s, but should be `%s`"), file->localpath, owner, arch, ri->bin_owner);
-                params.severity = RESULT_BAD;
-                params.waiverauth = WAIVABLE_BY_ANYONE;
-                params.remedy = REMEDY_OWNERSHIP_BIN_OWNER;
-                add_result(ri, &params);
-                free(params.msg);
-                result = false;
-            }
+        /* Check the owner */
+        if (strcmp(owner, ri->bin_owner) && !on_stat_whitelist_owner(ri, file, owner, HEADER_OWNERSHIP, NULL)) {
+            xasprintf(&params.msg, _("File %s has owner `%s` on %s, but should be `%s`"), file->localpath, owner, arch, ri->bin_owner);
+            params.severity = RESULT_BAD;
+            params.waiverauth = WAIVABLE_BY_ANYONE;
+            params.remedy = REMEDY_OWNERSHIP_BIN_OWNER;
+            add_result(ri, &params);
+            free(params.msg);
+            result = false;
+        }
 
-            /* Check the group - special handling */
-            if (strcmp(group, ri->bin_group)) {
-                /* Gather capabilities(7) for the file we need */
-                cap = get_cap(file);
+        /* Check the group - special handling */
+        if (strcmp(group, ri->bin_group)) {
+            /* Gather capabilities(7) for the file we need */
+            cap = get_cap(file);
 
-                if (cap) {
-                    if (cap_get_flag(cap, CAP_SETUID, CAP_EFFECTIVE, &have_setuid) == -1) {
-                        fprintf(stderr, _("*** unable to get capabilities for %s\n"), file->localpath);
-                        have_setuid = CAP_CLEAR;
-                    }
+            if (cap) {
+                if (cap_get_flag(cap, CAP_SETUID, CAP_EFFECTIVE, &have_setuid) == -1) {
+                    fprintf(stderr, _("*** unable to get capabilities for %s\n"), file->localpath);
+                    have_setuid = CAP_CLEAR;
                 }
+            }
 
-                /* Handle if CAP_SETUID is present or not */
-                if (have_setuid == CAP_SET) {
-                    if (file->st.st_mode & S_IXOTH) {
-                        xasprintf(&params.msg, _("File %s on %s has CAP_SETUID capability but group `%s` and is world executable"), file->localpath, arch, group);
-                        params.severity = RESULT_BAD;
-                        params.waiverauth = WAIVABLE_BY_ANYONE;
-                        params.remedy = REMEDY_OWNERSHIP_IXOTH;
-                        add_result(ri, &params);
-                        free(params.msg);
-                        result = false;
-                    }
-
-                    if (file->st.st_mode & S_IWGRP) {
-                        xasprintf(&params.msg, _("File %s on %s has CAP_SETUID capability but group `%s` and is group writable"), file->localpath, arch, group);
-                        params.severity = RESULT_BAD;
-                        params.waiverauth = WAIVABLE_BY_SECURITY;
-                        params.remedy = REMEDY_OWNERSHIP_IWGRP;
-                        add_result(ri, &params);
-                        free(params.msg);
-                        result = false;
-                    }
-                } else if (!on_stat_whitelist_group(ri, file, group, HEADER_OWNERSHIP, NULL)) {
-                    xasprintf(&params.msg, _("File %s has group `%s` on %s, but should be `%s`"), file->localpath, group, arch, ri->bin_group);
+            /* Handle if CAP_SETUID is present or not */
+            if (have_setuid == CAP_SET) {
+                if (file->st.st_mode & S_IXOTH) {
+                    xasprintf(&params.msg, _("File %s on %s has CAP_SETUID capability but group `%s` and is world executable"), file->localpath, arch, group);
                     params.severity = RESULT_BAD;
                     params.waiverauth = WAIVABLE_BY_ANYONE;
-                    params.remedy = REMEDY_OWNERSHIP_BIN_GROUP;
+                    params.remedy = REMEDY_OWNERSHIP_IXOTH;
                     add_result(ri, &params);
                     free(params.msg);
                     result = false;
                 }
-            }
 
-            break;
+                if (file->st.st_mode & S_IWGRP) {
+                    xasprintf(&params.msg, _("File %s on %s has CAP_SETUID capability but group `%s` and is group writable"), file->localpath, arch, group);
+                    params.severity = RESULT_BAD;
+                    params.waiverauth = WAIVABLE_BY_SECURITY;
+                    params.remedy = REMEDY_OWNERSHIP_IWGRP;
+                    add_result(ri, &params);
+                    free(params.msg);
+                    result = false;
+                }
+            } else if (!on_stat_whitelist_group(ri, file, group, HEADER_OWNERSHIP, NULL)) {
+                xasprintf(&params.msg, _("File %s has group `%s` on %s, but should be `%s`"), file->localpath, group, arch, ri->bin_group);
+                params.severity = RESULT_BAD;
+                params.waiverauth = WAIVABLE_BY_ANYONE;
+                params.remedy = REMEDY_OWNERSHIP_BIN_GROUP;
+                add_result(ri, &params);
+                free(params.msg);
+                result = false;
+            }
         }
     }
 
@@ -286,14 +243,10 @@ static bool ownership_driver(struct rpminspect *ri, rpmfile_entry_t *file) {
             result = false;
         }
 
-        free(before_owner);
-        free(before_group);
         free(before_val);
         free(after_val);
     }
 
-    free(owner);
-    free(group);
     return result;
 }
 
@@ -27,8 +27,7 @@ static bool pathmigration_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     bool result = true;
     ENTRY e;
     ENTRY *eptr = NULL;
-    string_entry_t *entry = NULL;
-    char *old = NULL;
+    const char *rule = NULL;
     const char *arch = NULL;
     struct result_params params;
 
@@ -48,43 +47,28 @@ static bool pathmigration_driver(struct rpminspect *ri, rpmfile_entry_t *file)
     params.remedy = REMEDY_PATHMIGRATION;
     params.arch = arch;
 
-    /* Check for each path migration, break early if we find a match */
-    TAILQ_FOREACH(entry, ri->pathmigration_keys, items) {
-        e.key = entry->data;
-        hsearch_r(e, FIND, &eptr, ri->pathmigration);
-
-        if (eptr == NULL) {
-            continue;
-        }
-
-        /*
-         * Make sure the old path name ends with a slash.
-         */
-
-        if (strsuffix(entry->data, "/")) {
-            old = strdup(entry->data);
-        } else {
-            xasprintf(&old, "%s/", entry->data);
-        }
-
-        DEBUG_PRINT("old=|%s|, file->localpath=|%s|\n", old, file->localpath);
-
-        /* Check to see if we found a path that should be migrated */
-        if (strprefix(file->localpath, old)) {
-            xasprintf(&params.msg, "File %s found should be in %s on %s", file->localpath, (char *) eptr->data, arch);
-            params.file = file->localpath;
-            add_result(ri, &params);
-            free(params.msg);
-            result = false;
-        }
-
-        free(old);
-
-        if (!result) {
-            break;
-        }
+    /* Check all path migrations at once, the first one listed wins */
+    rule = match_path(ri->pathmigration_match, file->localpath);
+
+    if (rule == NULL) {
+        return true;
+    }
+
+    e.key = (char *) rule;
+    hsearch_r(e, FIND, &eptr, ri->pathmigration);
+
+    if (eptr == NULL) {
+        return true;
     }
 
+    DEBUG_PRINT("old=|%s|, file->localpath=|%s|\n", rule, file->localpath);
+
+    xasprintf(&params.msg, "File %s found should be in %s on %s", file->localpath, (char *) eptr->data, arch);
+    params.file = file->localpath;
+    add_result(ri, &params);
+    free(params.msg);
+    result = false;
+
     return result;
 }
 
@@ -23,6 +23,38 @@
 
 #include "rpminspect.h"
 
+/*
+ * Describe what kind of file this is for reporting.  Only extracted
+ * files have a MIME type, so FIFOs, sockets, and device nodes use the
+ * file class from the header or the type from their mode.
+ */
+static const char *describe_file(rpmfile_entry_t *file)
+{
+    const char *type = NULL;
+
+    if (file->fullpath != NULL && (type = get_mime_type(file)) != NULL) {
+        return type;
+    }
+
+    type = get_rpm_file_str(file, RPMTAG_FILECLASS);
+
+    if (type != NULL && *type != '\0') {
+        return type;
+    }
+
+    if (S_ISFIFO(file->st.st_mode)) {
+        return _("fifo");
+    } else if (S_ISSOCK(file->st.st_mode)) {
+        return _("socket");
+    } else if (S_ISCHR(file->st.st_mode)) {
+        return _("character device");
+    } else if (S_ISBLK(file->st.st_mode)) {
+        return _("block device");
+    }
+
+    return _("file");
+}
+
 static bool permissions_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 {
     bool result = true;
@@ -89,7 +121,7 @@ static bool permissions_driver(struct rpminspect *ri, rpmfile_entry_t *file)
 
     /* check for world-writability */
     if (!whitelisted && (!S_ISLNK(file->st.st_mode) && !S_ISDIR(file->st.st_mode) && (after_mode & (S_IWOTH|S_ISVTX)))) {
-        xasprintf(&params.msg, _("%s (%s) is world-writable on %s"), file->localpath, get_mime_type(file), arch);
+        xasprintf(&params.msg, _("%s (%s) is world-writable on %s"), file->localpath, describe_file(file), arch);
         params.severity = RESULT_BAD;
         params.waiverauth = WAIVABLE_BY_SECURITY;
         add_result(ri, &params);
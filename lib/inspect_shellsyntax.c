@@ -114,6 +114,11 @@ static bool shellsyntax_driver(struct rpminspect *ri, rpmfile_entry_t *file)
         return true;
     }
 
+    /* Only text files are extracted for this inspection */
+    if (file->fullpath == NULL) {
+        return true;
+    }
+
     /* Get the mime type of the file */
     type = get_mime_type(file);
 
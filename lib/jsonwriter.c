@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <math.h>
+#include "rpminspect.h"
+
+/**
+ * @file jsonwriter.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Write JSON to a stream as it is produced.
+ *
+ * A json_writer_t writes each value straight to its FILE, so the
+ * memory it needs does not grow with the size of the document.  The
+ * bytes written are the same json_object_to_json_string_ext() gives
+ * for the equivalent json-c object tree, with
+ * JSON_C_TO_STRING_SPACED | JSON_C_TO_STRING_PRETTY if the writer is
+ * pretty and JSON_C_TO_STRING_PLAIN if not.  That includes json-c's
+ * string escapes (it escapes '/') and its formatting of doubles.
+ *
+ * Values are written with a key inside an object and with a NULL key
+ * inside an array or at the top level.  The caller is responsible
+ * for writing each key of an object only once.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+static void indent(json_writer_t *w)
+{
+    unsigned int i = 0;
+
+    if (!w->pretty) {
+        return;
+    }
+
+    for (i = 0; i < w->level; i++) {
+        fputs("  ", w->fp);
+    }
+
+    return;
+}
+
+/* Write s as a JSON string, escaped the way json-c does it */
+static void write_escaped(FILE *fp, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char *c = (const unsigned char *) s;
+
+    fputc('"', fp);
+
+    for (; *c != '\0'; c++) {
+        switch (*c) {
+            case '\b':
+                fputs("\\b", fp);
+                break;
+            case '\n':
+                fputs("\\n", fp);
+                break;
+            case '\r':
+                fputs("\\r", fp);
+                break;
+            case '\t':
+                fputs("\\t", fp);
+                break;
+            case '\f':
+                fputs("\\f", fp);
+                break;
+            case '"':
+                fputs("\\\"", fp);
+                break;
+            case '\\':
+                fputs("\\\\", fp);
+                break;
+            case '/':
+                fputs("\\/", fp);
+                break;
+            default:
+                if (*c < ' ') {
+                    fprintf(fp, "\\u00%c%c", hex[*c >> 4], hex[*c & 0xf]);
+                } else {
+                    fputc(*c, fp);
+                }
+
+                break;
+        }
+    }
+
+    fputc('"', fp);
+    return;
+}
+
+/*
+ * Start a value: the separator from the previous member of the
+ * enclosing object or array, the indentation, and the key.
+ */
+static void begin_value(json_writer_t *w, const char *key)
+{
+    uint64_t bit = UINT64_C(1) << w->level;
+
+    if (w->level == 0) {
+        assert(key == NULL);
+        return;
+    }
+
+    if (w->children & bit) {
+        fputc(',', w->fp);
+
+        if (w->pretty) {
+            fputc('\n', w->fp);
+        }
+    }
+
+    w->children |= bit;
+    indent(w);
+
+    if (key != NULL) {
+        write_escaped(w->fp, key);
+        fputs(w->pretty ? ": " : ":", w->fp);
+    }
+
+    return;
+}
+
+static void open_container(json_writer_t *w, const char *key, const char c)
+{
+    assert(w != NULL);
+    assert(w->level < 63);
+
+    begin_value(w, key);
+    fputc(c, w->fp);
+
+    if (w->pretty) {
+        fputc('\n', w->fp);
+    }
+
+    w->level++;
+    w->children &= ~(UINT64_C(1) << w->level);
+    return;
+}
+
+static void close_container(json_writer_t *w, const char c)
+{
+    assert(w != NULL);
+    assert(w->level > 0);
+
+    if (w->pretty && (w->children & (UINT64_C(1) << w->level))) {
+        fputc('\n', w->fp);
+    }
+
+    w->level--;
+    indent(w);
+    fputc(c, w->fp);
+    return;
+}
+
+/**
+ * @brief Set up a json_writer_t.
+ *
+ * @param w The writer to set up.
+ * @param fp Stream to write to.
+ * @param pretty True to write spaced and indented JSON, false to
+ *        write it all on one line.
+ */
+void json_writer_init(json_writer_t *w, FILE *fp, const bool pretty)
+{
+    assert(w != NULL);
+    assert(fp != NULL);
+
+    memset(w, 0, sizeof(*w));
+    w->fp = fp;
+    w->pretty = pretty;
+    return;
+}
+
+/**
+ * @brief Open an object.
+ *
+ * @param w The writer.
+ * @param key Key of the object in the enclosing object, NULL in an
+ *        array or at the top level.
+ */
+void json_begin_object(json_writer_t *w, const char *key)
+{
+    open_container(w, key, '{');
+    return;
+}
+
+/**
+ * @brief Close the object opened last.
+ */
+void json_end_object(json_writer_t *w)
+{
+    close_container(w, '}');
+    return;
+}
+
+/**
+ * @brief Open an array.
+ *
+ * @param w The writer.
+ * @param key Key of the array in the enclosing object, NULL in an
+ *        array or at the top level.
+ */
+void json_begin_array(json_writer_t *w, const char *key)
+{
+    open_container(w, key, '[');
+    return;
+}
+
+/**
+ * @brief Close the array opened last.
+ */
+void json_end_array(json_writer_t *w)
+{
+    close_container(w, ']');
+    return;
+}
+
+/**
+ * @brief Write a string value.
+ *
+ * @param w The writer.
+ * @param key Key in the enclosing object, NULL in an array.
+ * @param value The string, NULL is written as null.
+ */
+void json_write_string(json_writer_t *w, const char *key, const char *value)
+{
+    assert(w != NULL);
+
+    begin_value(w, key);
+
+    if (value == NULL) {
+        fputs("null", w->fp);
+    } else {
+        write_escaped(w->fp, value);
+    }
+
+    return;
+}
+
+/**
+ * @brief Write an integer value.
+ *
+ * @param w The writer.
+ * @param key Key in the enclosing object, NULL in an array.
+ * @param value The integer.
+ */
+void json_write_int(json_writer_t *w, const char *key, const int64_t value)
+{
+    assert(w != NULL);
+
+    begin_value(w, key);
+    fprintf(w->fp, "%" PRId64, value);
+    return;
+}
+
+/**
+ * @brief Write a double value.
+ *
+ * Formatted with %.17g, with ".0" added to whole numbers, and NaN
+ * and the infinities written as bare words, as json-c does.
+ *
+ * @param w The writer.
+ * @param key Key in the enclosing object, NULL in an array.
+ * @param value The double.
+ */
+void json_write_double(json_writer_t *w, const char *key, const double value)
+{
+    char buf[128];
+    char *p = NULL;
+
+    assert(w != NULL);
+
+    begin_value(w, key);
+
+    if (isnan(value)) {
+        fputs("NaN", w->fp);
+    } else if (isinf(value)) {
+        fputs((value > 0) ? "Infinity" : "-Infinity", w->fp);
+    } else {
+        snprintf(buf, sizeof(buf), "%.17g", value);
+
+        /* the decimal point is a '.' in every locale */
+        p = strchr(buf, ',');
+
+        if (p != NULL) {
+            *p = '.';
+        }
+
+        fputs(buf, w->fp);
+
+        if (strpbrk(buf, ".e") == NULL) {
+            fputs(".0", w->fp);
+        }
+    }
+
+    return;
+}
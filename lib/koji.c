@@ -16,13 +16,21 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 #include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <sys/queue.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+#include <xmlrpc-c/base.h>
 #include <xmlrpc-c/client.h>
-#include <xmlrpc-c/client_global.h>
 #include "rpminspect.h"
 
 /*
@@ -38,6 +46,359 @@ static void xmlrpc_abort_on_fault(xmlrpc_env *env)
     }
 }
 
+/*
+ * The XML-RPC client and hub.  These are set up on the first call to
+ * the hub and kept for the life of the process so every call shares
+ * the same client and its connections.  free_koji_client() releases
+ * them.
+ */
+static xmlrpc_client *koji_client = NULL;
+static xmlrpc_server_info *koji_server = NULL;
+static char *koji_server_url = NULL;
+
+/*
+ * Set up the shared client if that has not happened yet.
+ */
+static void init_koji_client(xmlrpc_env *env, const struct rpminspect *ri)
+{
+    assert(env != NULL);
+    assert(ri != NULL);
+    assert(ri->kojihub != NULL);
+
+    if (koji_client == NULL) {
+        xmlrpc_client_setup_global_const(env);
+        xmlrpc_abort_on_fault(env);
+
+        xmlrpc_client_create(env, XMLRPC_CLIENT_NO_FLAGS, SOFTWARE_NAME, PACKAGE_VERSION, NULL, 0, &koji_client);
+        xmlrpc_abort_on_fault(env);
+
+        /* increase the message response size */
+        xmlrpc_limit_set(XMLRPC_XML_SIZE_LIMIT_ID, INT_MAX);
+    }
+
+    if (koji_server_url != NULL && !strcmp(koji_server_url, ri->kojihub)) {
+        return;
+    }
+
+    if (koji_server != NULL) {
+        xmlrpc_server_info_free(koji_server);
+        free(koji_server_url);
+    }
+
+    koji_server = xmlrpc_server_info_new(env, ri->kojihub);
+    xmlrpc_abort_on_fault(env);
+    koji_server_url = strdup(ri->kojihub);
+    assert(koji_server_url != NULL);
+
+    return;
+}
+
+/*
+ * Call a method on the Koji hub.  params is an array of the method
+ * arguments.  Faults are left in env for the caller.
+ */
+static xmlrpc_value *koji_call(xmlrpc_env *env, const struct rpminspect *ri, const char *method, xmlrpc_value *params)
+{
+    xmlrpc_value *result = NULL;
+    stats_mark_t mark;
+    uint64_t span = 0;
+
+    assert(env != NULL);
+    assert(method != NULL);
+    assert(params != NULL);
+
+    init_koji_client(env, ri);
+    DEBUG_PRINT("%s\n", method);
+    start_stats(ri, &mark);
+    span = trace_start();
+    xmlrpc_client_call2(env, koji_client, koji_server, method, params, &result);
+    trace_end(span, "koji", method, ri->kojihub);
+    end_stats(ri, &mark, STATS_PHASE, "koji");
+    return result;
+}
+
+/*
+ * Path of the response cache file for a call, or NULL if there is no
+ * cache_dir.  The name is the SHA-256 of the hub URL, the method, and
+ * the XML of the arguments.
+ */
+static char *koji_cache_path(xmlrpc_env *env, const struct rpminspect *ri, const char *method, xmlrpc_value *params)
+{
+    xmlrpc_mem_block *xml = NULL;
+    SHA256_CTX ctx;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char hex[(SHA256_DIGEST_LENGTH * 2) + 1];
+    char *path = NULL;
+    int i = 0;
+
+    assert(env != NULL);
+    assert(ri != NULL);
+
+    if (ri->cache_dir == NULL) {
+        return NULL;
+    }
+
+    xml = xmlrpc_mem_block_new(env, 0);
+    xmlrpc_abort_on_fault(env);
+    xmlrpc_serialize_value(env, xml, params);
+    xmlrpc_abort_on_fault(env);
+
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, ri->kojihub, strlen(ri->kojihub) + 1);
+    SHA256_Update(&ctx, method, strlen(method) + 1);
+    SHA256_Update(&ctx, xmlrpc_mem_block_contents(xml), xmlrpc_mem_block_size(xml));
+    SHA256_Final(digest, &ctx);
+    xmlrpc_mem_block_free(xml);
+
+    for (i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+        sprintf(hex + (i * 2), "%02x", digest[i]);
+    }
+
+    xasprintf(&path, "%s/%s/%s", ri->cache_dir, KOJI_CACHE_SUBDIR, hex);
+    return path;
+}
+
+/*
+ * Return the cached response for a call, or NULL if there is none.
+ * A ttl of 0 means the response never expires.
+ */
+static xmlrpc_value *koji_cache_lookup(xmlrpc_env *env, const struct rpminspect *ri, const char *method, xmlrpc_value *params, const time_t ttl)
+{
+    char *path = NULL;
+    char *xml = NULL;
+    FILE *fp = NULL;
+    struct stat sb;
+    xmlrpc_value *result = NULL;
+
+    if ((path = koji_cache_path(env, ri, method, params)) == NULL) {
+        return NULL;
+    }
+
+    if ((fp = fopen(path, "r")) == NULL) {
+        free(path);
+        return NULL;
+    }
+
+    if (fstat(fileno(fp), &sb) == 0 && (ttl == 0 || sb.st_mtime + ttl > time(NULL))) {
+        xml = malloc(sb.st_size + 1);
+        assert(xml != NULL);
+
+        if (fread(xml, 1, sb.st_size, fp) == (size_t) sb.st_size) {
+            xmlrpc_parse_value_xml(env, xml, sb.st_size, &result);
+
+            if (env->fault_occurred) {
+                /* a damaged entry is just a miss */
+                xmlrpc_env_clean(env);
+                xmlrpc_env_init(env);
+                result = NULL;
+            }
+        }
+
+        free(xml);
+    }
+
+    fclose(fp);
+
+    if (result != NULL) {
+        DEBUG_PRINT("%s from %s\n", method, path);
+
+        /*
+         * mark the entry as recently used for prune_cache(), except
+         * when the mtime says how old the response is
+         */
+        if (ttl == 0) {
+            utimensat(AT_FDCWD, path, NULL, 0);
+        }
+    }
+
+    free(path);
+    return result;
+}
+
+/*
+ * Save the response to a call in the cache.  The entry is written
+ * under a temporary name and renamed in to place so other processes
+ * never read a partial response.
+ */
+static void koji_cache_save(xmlrpc_env *env, const struct rpminspect *ri, const char *method, xmlrpc_value *params, xmlrpc_value *result)
+{
+    char *path = NULL;
+    char *dir = NULL;
+    char *tmp = NULL;
+    FILE *fp = NULL;
+    xmlrpc_mem_block *xml = NULL;
+    size_t len = 0;
+    bool ok = false;
+
+    assert(result != NULL);
+
+    if ((path = koji_cache_path(env, ri, method, params)) == NULL) {
+        return;
+    }
+
+    xasprintf(&dir, "%s/%s", ri->cache_dir, KOJI_CACHE_SUBDIR);
+
+    if (mkdirp(dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
+        fprintf(stderr, _("*** unable to create cache directory %s: %s\n"), dir, strerror(errno));
+        fflush(stderr);
+        free(dir);
+        free(path);
+        return;
+    }
+
+    xml = xmlrpc_mem_block_new(env, 0);
+    xmlrpc_abort_on_fault(env);
+    xmlrpc_serialize_value(env, xml, result);
+    xmlrpc_abort_on_fault(env);
+    len = xmlrpc_mem_block_size(xml);
+
+    xasprintf(&tmp, "%s.%d", path, getpid());
+
+    if ((fp = fopen(tmp, "w")) != NULL) {
+        ok = (fwrite(xmlrpc_mem_block_contents(xml), 1, len, fp) == len);
+        ok = (fclose(fp) == 0) && ok;
+    }
+
+    if (!ok || rename(tmp, path) == -1) {
+        DEBUG_PRINT("unable to cache %s response in %s\n", method, path);
+        unlink(tmp);
+    }
+
+    xmlrpc_mem_block_free(xml);
+    free(tmp);
+    free(dir);
+    free(path);
+    return;
+}
+
+/*
+ * Call a method once for each argument array in params, using Koji's
+ * multiCall to send up to KOJI_MULTICALL_SIZE calls per request.
+ * Responses found in the cache are not requested again.  If save is
+ * true, new responses are added to the cache.  Returns an array of n
+ * results in the same order as params, the caller must DECREF each
+ * result and free the array.  A fault for any one call is fatal, the
+ * same as for a single call.
+ */
+static xmlrpc_value **koji_multicall(xmlrpc_env *env, const struct rpminspect *ri, const char *method, xmlrpc_value **params, const int n, const bool save)
+{
+    xmlrpc_value **results = NULL;
+    xmlrpc_value *calls = NULL;
+    xmlrpc_value *call = NULL;
+    xmlrpc_value *args = NULL;
+    xmlrpc_value *batch = NULL;
+    xmlrpc_value *item = NULL;
+    int *index = NULL;
+    int count = 0;
+    int fault_code = 0;
+    char *fault_string = NULL;
+    int i = 0;
+    int j = 0;
+
+    assert(env != NULL);
+    assert(method != NULL);
+
+    if (n == 0) {
+        return NULL;
+    }
+
+    results = calloc(n, sizeof(*results));
+    assert(results != NULL);
+    index = calloc(KOJI_MULTICALL_SIZE, sizeof(*index));
+    assert(index != NULL);
+
+    for (i = 0; i < n; i++) {
+        results[i] = koji_cache_lookup(env, ri, method, params[i], 0);
+    }
+
+    i = 0;
+
+    while (i < n) {
+        /* collect the next batch of calls we do not have */
+        calls = xmlrpc_array_new(env);
+        xmlrpc_abort_on_fault(env);
+        count = 0;
+
+        for (; i < n && count < KOJI_MULTICALL_SIZE; i++) {
+            if (results[i] != NULL) {
+                continue;
+            }
+
+            call = xmlrpc_build_value(env, "{s:s,s:A}", "methodName", method, "params", params[i]);
+            xmlrpc_abort_on_fault(env);
+            xmlrpc_array_append_item(env, calls, call);
+            xmlrpc_abort_on_fault(env);
+            xmlrpc_DECREF(call);
+            index[count++] = i;
+        }
+
+        if (count == 0) {
+            xmlrpc_DECREF(calls);
+            continue;
+        }
+
+        args = xmlrpc_build_value(env, "(A)", calls);
+        xmlrpc_abort_on_fault(env);
+        batch = koji_call(env, ri, "multiCall", args);
+        xmlrpc_abort_on_fault(env);
+        xmlrpc_DECREF(args);
+        xmlrpc_DECREF(calls);
+
+        /* each result is either a one element array or a fault struct */
+        for (j = 0; j < count; j++) {
+            xmlrpc_array_read_item(env, batch, j, &item);
+            xmlrpc_abort_on_fault(env);
+
+            if (xmlrpc_value_type(item) == XMLRPC_TYPE_STRUCT) {
+                xmlrpc_decompose_value(env, item, "{s:i,s:s,*}", "faultCode", &fault_code, "faultString", &fault_string);
+                xmlrpc_abort_on_fault(env);
+                fprintf(stderr, _("XML-RPC Fault: %s (%d)\n"), fault_string, fault_code);
+                fflush(stderr);
+                abort();
+            }
+
+            xmlrpc_array_read_item(env, item, 0, &results[index[j]]);
+            xmlrpc_abort_on_fault(env);
+            xmlrpc_DECREF(item);
+
+            if (save) {
+                koji_cache_save(env, ri, method, params[index[j]], results[index[j]]);
+            }
+        }
+
+        xmlrpc_DECREF(batch);
+    }
+
+    free(index);
+    return results;
+}
+
+/**
+ * @brief Release the shared Koji XML-RPC client.
+ *
+ * Called from free_rpminspect().  The next call to the hub sets up a
+ * new client.
+ */
+void free_koji_client(void)
+{
+    if (koji_client == NULL) {
+        return;
+    }
+
+    if (koji_server != NULL) {
+        xmlrpc_server_info_free(koji_server);
+        koji_server = NULL;
+        free(koji_server_url);
+        koji_server_url = NULL;
+    }
+
+    xmlrpc_client_destroy(koji_client);
+    koji_client = NULL;
+    xmlrpc_client_teardown_global_const();
+
+    return;
+}
+
 /*
  * Read a koji task info struct and store in the struct koji_task.
  */
@@ -282,6 +643,8 @@ void free_koji_rpmlist(koji_rpmlist_t *rpms)
         entry->version = NULL;
         free(entry->release);
         entry->release = NULL;
+        free(entry->payloadhash);
+        entry->payloadhash = NULL;
         free(entry);
     }
 
@@ -505,6 +868,12 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
     char *key = NULL;
     koji_buildlist_entry_t *buildentry = NULL;
     koji_rpmlist_entry_t *rpm = NULL;
+    xmlrpc_value *params = NULL;
+    xmlrpc_value **rpmparams = NULL;
+    xmlrpc_value **rpmresults = NULL;
+    bool cached = false;
+    int nbuilds = 0;
+    int n = 0;
 
     assert(ri != NULL);
 
@@ -517,24 +886,27 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
         return NULL;
     }
 
-    /* initialize everything and get XMLRPC ready */
+    /* initialize everything */
     build = calloc(1, sizeof(*build));
     assert(build != NULL);
     init_koji_build(build);
     xmlrpc_env_init(&env);
-    xmlrpc_client_init2(&env, XMLRPC_CLIENT_NO_FLAGS, SOFTWARE_NAME, PACKAGE_VERSION, NULL, 0);
-    xmlrpc_abort_on_fault(&env);
 
-    /* increase the message response size */
-    xmlrpc_limit_set(XMLRPC_XML_SIZE_LIMIT_ID, INT_MAX);
+    /* call 'getBuild' on the koji hub, unless we have it cached */
+    params = xmlrpc_build_value(&env, "(s)", buildspec);
+    xmlrpc_abort_on_fault(&env);
+    result = koji_cache_lookup(&env, ri, "getBuild", params, 0);
+    cached = (result != NULL);
 
-    /* call 'getBuild' on the koji hub */
-    result = xmlrpc_client_call(&env, ri->kojihub, "getBuild", "(s)", buildspec);
+    if (!cached) {
+        result = koji_call(&env, ri, "getBuild", params);
+    }
 
     if (env.fault_occurred && env.fault_code >= 1000) {
         /* server side error which means Koji protocol error */
+        xmlrpc_DECREF(params);
         xmlrpc_env_clean(&env);
-        xmlrpc_client_cleanup();
+        free_koji_build(build);
         return NULL;
     } else {
         xmlrpc_abort_on_fault(&env);
@@ -543,8 +915,9 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
     /* is this a valid build? */
     if (xmlrpc_value_type(result) == XMLRPC_TYPE_NIL) {
         xmlrpc_DECREF(result);
+        xmlrpc_DECREF(params);
         xmlrpc_env_clean(&env);
-        xmlrpc_client_cleanup();
+        free_koji_build(build);
         return NULL;
     }
 
@@ -735,11 +1108,30 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
         }
     }
 
+    /* builds do not change once they are complete */
+    if (!cached && build->state == KOJI_BUILD_STATE_COMPLETE) {
+        koji_cache_save(&env, ri, "getBuild", params, result);
+    }
+
+    xmlrpc_DECREF(params);
+
     /* Modules have multiple builds, so collect the IDs */
     if (ri->buildtype == KOJI_BUILD_MODULE) {
         xmlrpc_DECREF(result);
-        result = xmlrpc_client_call(&env, ri->kojihub, "getLatestBuilds", "(s)", build->module_content_koji_tag);
+        params = xmlrpc_build_value(&env, "(s)", build->module_content_koji_tag);
         xmlrpc_abort_on_fault(&env);
+        result = koji_cache_lookup(&env, ri, "getLatestBuilds", params, 0);
+
+        if (result == NULL) {
+            result = koji_call(&env, ri, "getLatestBuilds", params);
+            xmlrpc_abort_on_fault(&env);
+
+            if (build->state == KOJI_BUILD_STATE_COMPLETE) {
+                koji_cache_save(&env, ri, "getLatestBuilds", params, result);
+            }
+        }
+
+        xmlrpc_DECREF(params);
 
         /* read the values from the result */
         size = xmlrpc_array_size(&env, result);
@@ -855,8 +1247,29 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
 
     /* Call 'listBuildRPMs' on the koji hub for each build_id */
     TAILQ_FOREACH(buildentry, build->builds, builditems) {
-        result = xmlrpc_client_call(&env, ri->kojihub, "listBuildRPMs", "(i)", buildentry->build_id);
+        nbuilds++;
+    }
+
+    if (nbuilds > 0) {
+        rpmparams = calloc(nbuilds, sizeof(*rpmparams));
+        assert(rpmparams != NULL);
+    }
+
+    n = 0;
+
+    TAILQ_FOREACH(buildentry, build->builds, builditems) {
+        rpmparams[n] = xmlrpc_build_value(&env, "(i)", buildentry->build_id);
         xmlrpc_abort_on_fault(&env);
+        n++;
+    }
+
+    rpmresults = koji_multicall(&env, ri, "listBuildRPMs", rpmparams, nbuilds, build->state == KOJI_BUILD_STATE_COMPLETE);
+    n = 0;
+
+    TAILQ_FOREACH(buildentry, build->builds, builditems) {
+        result = rpmresults[n];
+        xmlrpc_DECREF(rpmparams[n]);
+        n++;
 
         /* read the values from the result */
         size = xmlrpc_array_size(&env, result);
@@ -904,6 +1317,9 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
                     xmlrpc_abort_on_fault(&env);
                 } else if (!strcmp(key, "epoch")) {
                     xmlrpc_decompose_value(&env, value, "i", &rpm->epoch);
+                } else if (!strcmp(key, "payloadhash")) {
+                    xmlrpc_decompose_value(&env, value, "s", &rpm->payloadhash);
+                    xmlrpc_abort_on_fault(&env);
                 } else if (!strcmp(key, "size")) {
                     if (xmlrpc_value_type(value) == XMLRPC_TYPE_INT) {
                         xmlrpc_decompose_value(&env, value, "i", &rpm->size);
@@ -927,13 +1343,14 @@ struct koji_build *get_koji_build(struct rpminspect *ri, const char *buildspec)
                 TAILQ_INSERT_TAIL(buildentry->rpms, rpm, items);
             }
         }
+
+        xmlrpc_DECREF(result);
     }
 
     /* Cleanup */
-    xmlrpc_DECREF(result);
-
+    free(rpmparams);
+    free(rpmresults);
     xmlrpc_env_clean(&env);
-    xmlrpc_client_cleanup();
 
     return build;
 }
@@ -945,7 +1362,10 @@ struct koji_task *get_koji_task(struct rpminspect *ri, const char *taskspec)
 {
     int i, j, k;
     int size, dsize, rsize;
+    int ndescendents = 0;
+    int n = 0;
     xmlrpc_env env;
+    xmlrpc_value *params = NULL;
     xmlrpc_value *result = NULL;
     xmlrpc_value *xk = NULL;
     xmlrpc_value *xv = NULL;
@@ -953,9 +1373,14 @@ struct koji_task *get_koji_task(struct rpminspect *ri, const char *taskspec)
     xmlrpc_value *tr_v = NULL;
     xmlrpc_value *dstruct = NULL;
     xmlrpc_value *dresult = NULL;
+    xmlrpc_value **dparams = NULL;
+    xmlrpc_value **dresults = NULL;
     char *key = NULL;
     struct koji_task *task = NULL;
     koji_task_entry_t *descendent = NULL;
+    koji_task_list_t *found = NULL;
+    bool cached = false;
+    bool closed = false;
 
     assert(ri != NULL);
 
@@ -968,35 +1393,56 @@ struct koji_task *get_koji_task(struct rpminspect *ri, const char *taskspec)
         return NULL;
     }
 
-    /* initialize everything and get XMLRPC ready */
+    /* initialize everything */
     task = calloc(1, sizeof(*task));
     assert(task != NULL);
     init_koji_task(task);
     xmlrpc_env_init(&env);
-    xmlrpc_client_init2(&env, XMLRPC_CLIENT_NO_FLAGS, SOFTWARE_NAME, PACKAGE_VERSION, NULL, 0);
-    xmlrpc_abort_on_fault(&env);
 
-    /* increase the message response size */
-    xmlrpc_limit_set(XMLRPC_XML_SIZE_LIMIT_ID, INT_MAX);
-
-    /* call 'getTaskInfo' on the koji hub */
-    result = xmlrpc_client_call(&env, ri->kojihub, "getTaskInfo", "(s)", taskspec);
+    /* call 'getTaskInfo' on the koji hub, unless we have it cached */
+    params = xmlrpc_build_value(&env, "(s)", taskspec);
     xmlrpc_abort_on_fault(&env);
+    result = koji_cache_lookup(&env, ri, "getTaskInfo", params, 0);
+    cached = (result != NULL);
+
+    if (!cached) {
+        result = koji_call(&env, ri, "getTaskInfo", params);
+        xmlrpc_abort_on_fault(&env);
+    }
 
     /* is this a valid build? */
     if (xmlrpc_value_type(result) == XMLRPC_TYPE_NIL) {
         xmlrpc_DECREF(result);
+        xmlrpc_DECREF(params);
         xmlrpc_env_clean(&env);
-        xmlrpc_client_cleanup();
+        free_koji_task(task);
         return NULL;
     }
 
     read_koji_task_struct(&env, result, task);
+
+    /* tasks do not change once they are closed */
+    closed = (task->state == KOJI_TASK_STATE_CLOSED);
+
+    if (!cached && closed) {
+        koji_cache_save(&env, ri, "getTaskInfo", params, result);
+    }
+
     xmlrpc_DECREF(result);
 
     /* call 'getTaskDescendents' on the task ID */
-    result = xmlrpc_client_call(&env, ri->kojihub, "getTaskDescendents", "(s)", taskspec);
-    xmlrpc_abort_on_fault(&env);
+    result = koji_cache_lookup(&env, ri, "getTaskDescendents", params, 0);
+
+    if (result == NULL) {
+        result = koji_call(&env, ri, "getTaskDescendents", params);
+        xmlrpc_abort_on_fault(&env);
+
+        if (closed) {
+            koji_cache_save(&env, ri, "getTaskDescendents", params, result);
+        }
+    }
+
+    xmlrpc_DECREF(params);
 
     /* read the values from the result */
     size = xmlrpc_struct_size(&env, result);
@@ -1006,6 +1452,11 @@ struct koji_task *get_koji_task(struct rpminspect *ri, const char *taskspec)
     assert(task->descendents != NULL);
     TAILQ_INIT(task->descendents);
 
+    /* descendents are collected here until we have their results */
+    found = calloc(1, sizeof(*found));
+    assert(found != NULL);
+    TAILQ_INIT(found);
+
     for (i = 0; i < size; i++) {
         xmlrpc_struct_read_member(&env, result, i, &xk, &xv);
         xmlrpc_abort_on_fault(&env);
@@ -1028,57 +1479,86 @@ struct koji_task *get_koji_task(struct rpminspect *ri, const char *taskspec)
             assert(descendent != NULL);
             init_koji_task_entry(descendent);
             read_koji_task_struct(&env, dstruct, descendent->task);
+            TAILQ_INSERT_TAIL(found, descendent, items);
+            ndescendents++;
+        }
+    }
 
-            /* gather the task results */
-            dresult = xmlrpc_client_call(&env, ri->kojihub, "getTaskResult", "(i)", descendent->task->id);
-            xmlrpc_abort_on_fault(&env);
+    xmlrpc_DECREF(result);
 
-            if (xmlrpc_value_type(dresult) == XMLRPC_TYPE_NIL) {
-                /* some task IDs may be nothing, so ignore */
-                xmlrpc_DECREF(dresult);
-                continue;
-            }
+    /* gather the task results, batched in to as few calls as we can */
+    if (ndescendents > 0) {
+        dparams = calloc(ndescendents, sizeof(*dparams));
+        assert(dparams != NULL);
+    }
 
-            rsize = xmlrpc_struct_size(&env, dresult);
+    n = 0;
 
-            for (k = 0; k < rsize; k++) {
-                /* Read the result struct */
-                xmlrpc_struct_read_member(&env, dresult, k, &tr_k, &tr_v);
-                xmlrpc_abort_on_fault(&env);
+    TAILQ_FOREACH(descendent, found, items) {
+        dparams[n] = xmlrpc_build_value(&env, "(i)", descendent->task->id);
+        xmlrpc_abort_on_fault(&env);
+        n++;
+    }
 
-                /* Get the key as a string */
-                xmlrpc_decompose_value(&env, tr_k, "s", &key);
-                xmlrpc_abort_on_fault(&env);
-                xmlrpc_DECREF(tr_k);
+    dresults = koji_multicall(&env, ri, "getTaskResult", dparams, ndescendents, closed);
+    n = 0;
 
-                /* Read the values */
-                if (!strcmp(key, "brootid")) {
-                    xmlrpc_decompose_value(&env, tr_v, "i", &descendent->brootid);
-                    xmlrpc_abort_on_fault(&env);
-                } else if (!strcmp(key, "srpms") && xmlrpc_value_type(tr_v) == XMLRPC_TYPE_ARRAY) {
-                    descendent->srpms = read_koji_descendent_results(&env, tr_v);
-                } else if (!strcmp(key, "rpms")) {
-                    descendent->rpms = read_koji_descendent_results(&env, tr_v);
-                } else if (!strcmp(key, "logs")) {
-                    descendent->logs = read_koji_descendent_results(&env, tr_v);
-                }
+    while (!TAILQ_EMPTY(found)) {
+        descendent = TAILQ_FIRST(found);
+        TAILQ_REMOVE(found, descendent, items);
+        dresult = dresults[n];
+        xmlrpc_DECREF(dparams[n]);
+        n++;
 
-                xmlrpc_DECREF(tr_v);
-                free(key);
-            }
+        if (xmlrpc_value_type(dresult) == XMLRPC_TYPE_NIL) {
+            /* some task IDs may be nothing, so ignore */
+            xmlrpc_DECREF(dresult);
+            free_koji_task_entry(descendent);
+            continue;
+        }
 
-            /* save this descendent in the list */
-            TAILQ_INSERT_TAIL(task->descendents, descendent, items);
+        rsize = xmlrpc_struct_size(&env, dresult);
 
-            xmlrpc_DECREF(dresult);
+        for (k = 0; k < rsize; k++) {
+            /* Read the result struct */
+            xmlrpc_struct_read_member(&env, dresult, k, &tr_k, &tr_v);
+            xmlrpc_abort_on_fault(&env);
+
+            /* Get the key as a string */
+            xmlrpc_decompose_value(&env, tr_k, "s", &key);
+            xmlrpc_abort_on_fault(&env);
+            xmlrpc_DECREF(tr_k);
+
+            /* Read the values */
+            if (!strcmp(key, "brootid")) {
+                xmlrpc_decompose_value(&env, tr_v, "i", &descendent->brootid);
+                xmlrpc_abort_on_fault(&env);
+            } else if (!strcmp(key, "srpms") && xmlrpc_value_type(tr_v) == XMLRPC_TYPE_ARRAY) {
+                list_free(descendent->srpms, free);
+                descendent->srpms = read_koji_descendent_results(&env, tr_v);
+            } else if (!strcmp(key, "rpms")) {
+                list_free(descendent->rpms, free);
+                descendent->rpms = read_koji_descendent_results(&env, tr_v);
+            } else if (!strcmp(key, "logs")) {
+                list_free(descendent->logs, free);
+                descendent->logs = read_koji_descendent_results(&env, tr_v);
+            }
+
+            xmlrpc_DECREF(tr_v);
+            free(key);
         }
-    }
 
-    xmlrpc_DECREF(result);
+        /* save this descendent in the list */
+        TAILQ_INSERT_TAIL(task->descendents, descendent, items);
+
+        xmlrpc_DECREF(dresult);
+    }
 
     /* Cleanup */
+    free(found);
+    free(dparams);
+    free(dresults);
     xmlrpc_env_clean(&env);
-    xmlrpc_client_cleanup();
 
     return task;
 }
@@ -1096,8 +1576,7 @@ string_list_t *get_all_arches(const struct rpminspect *ri)
     int size = 0;
     int i = 0;
     xmlrpc_env env;
-    xmlrpc_server_info *server = NULL;
-    xmlrpc_value *fake_params = NULL;
+    xmlrpc_value *params = NULL;
     xmlrpc_value *result = NULL;
     xmlrpc_value *value = NULL;
     char *element = NULL;
@@ -1124,38 +1603,35 @@ string_list_t *get_all_arches(const struct rpminspect *ri)
 
     TAILQ_INSERT_TAIL(arches, arch, items);
 
-    /* initialize everything and get XMLRPC ready */
+    /* initialize everything */
     xmlrpc_env_init(&env);
-    xmlrpc_client_init2(&env, XMLRPC_CLIENT_NO_FLAGS, SOFTWARE_NAME, PACKAGE_VERSION, NULL, 0);
-    xmlrpc_abort_on_fault(&env);
-
-    /* increase the message response size */
-    xmlrpc_limit_set(XMLRPC_XML_SIZE_LIMIT_ID, INT_MAX);
 
     /*
      * call 'getAllArches' on the koji hub
-     * Why not use xmlrpc_client_call() here?  I'm glad you asked.  That
-     * function takes a format string and argument list and builds a
-     * parameter array for the call.  There's just one problem.  You can't
-     * tell it NULL for the format string for calls that require no
-     * parameters.  This is a problem for this call because we need to
-     * pass nothing.  Within libxmlrpc there is another call we can use
-     * but we do still have to create an empty argument array and pass it
-     * anyway.  I believe it's better to use xmlrpc_client_call_server_params
-     * rather than the xmlrpc_client_call function.  This is what the command
-     * line xmlrpc(1) tool does and it works with basically anything.
+     * This call takes no parameters, so it gets an empty argument
+     * array.  The list of architectures rarely changes, so the
+     * response is cached for KOJI_ARCHES_TTL seconds.
      */
-    server = xmlrpc_server_info_new(&env, ri->kojihub);
-    xmlrpc_abort_on_fault(&env);
-    fake_params = xmlrpc_array_new(&env);              /* super empty array */
-    result = xmlrpc_client_call_server_params(&env, server, "getAllArches", fake_params);
+    params = xmlrpc_array_new(&env);              /* super empty array */
     xmlrpc_abort_on_fault(&env);
+    result = koji_cache_lookup(&env, ri, "getAllArches", params, KOJI_ARCHES_TTL);
+
+    if (result == NULL) {
+        result = koji_call(&env, ri, "getAllArches", params);
+        xmlrpc_abort_on_fault(&env);
+
+        if (xmlrpc_value_type(result) == XMLRPC_TYPE_ARRAY) {
+            koji_cache_save(&env, ri, "getAllArches", params, result);
+        }
+    }
+
+    xmlrpc_DECREF(params);
 
     /* is this a valid return value? */
     if (xmlrpc_value_type(result) != XMLRPC_TYPE_ARRAY) {
         xmlrpc_DECREF(result);
         xmlrpc_env_clean(&env);
-        xmlrpc_client_cleanup();
+        list_free(arches, free);
         return NULL;
     }
 
@@ -1218,7 +1694,6 @@ string_list_t *get_all_arches(const struct rpminspect *ri)
     xmlrpc_DECREF(result);
 
     xmlrpc_env_clean(&env);
-    xmlrpc_client_cleanup();
 
     return arches;
 }
@@ -23,6 +23,42 @@
 
 #include "rpminspect.h"
 
+/*
+ * The magic database is loaded once and kept for the life of the
+ * process.  Inspections only ask for MIME types from the main thread.
+ */
+static magic_t cookie = NULL;
+
+/**
+ * @brief Load the magic database if it is not loaded yet.
+ *
+ * @return True if the database is loaded, false if not.
+ */
+bool init_magic(void)
+{
+    if (cookie != NULL) {
+        return true;
+    }
+
+    cookie = magic_open(MAGIC_MIME | MAGIC_CHECK);
+
+    if (cookie == NULL) {
+        fprintf(stderr, _("*** Unable to initialize the magic library\n"));
+        fflush(stderr);
+        return false;
+    }
+
+    if (magic_load(cookie, NULL) != 0) {
+        fprintf(stderr, _("*** Unable to load the magic database: %s\n"), magic_error(cookie));
+        fflush(stderr);
+        magic_close(cookie);
+        cookie = NULL;
+        return false;
+    }
+
+    return true;
+}
+
 /*
  * Return the MIME type of the specified file.  The type is cached in the
  * rpmfile_entry_t.  If that is not NULL, this function returns that value.
@@ -33,7 +69,6 @@ char *get_mime_type(rpmfile_entry_t *file) {
     char *ret = NULL;
     char *pos = NULL;
     const char *tmp = NULL;
-    magic_t cookie;
 
     assert(file != NULL);
 
@@ -44,18 +79,8 @@ char *get_mime_type(rpmfile_entry_t *file) {
 
     /* Get and cache MIME type */
     assert(file->fullpath != NULL);
-    cookie = magic_open(MAGIC_MIME | MAGIC_CHECK);
 
-    if (cookie == NULL) {
-        fprintf(stderr, _("*** Unable to initialize the magic library\n"));
-        fflush(stderr);
-        return ret;
-    }
-
-    if (magic_load(cookie, NULL) != 0) {
-        fprintf(stderr, _("*** Unable to load the magic database: %s\n"), magic_error(cookie));
-        fflush(stderr);
-        magic_close(cookie);
+    if (!init_magic()) {
         return ret;
     }
 
@@ -72,7 +97,6 @@ char *get_mime_type(rpmfile_entry_t *file) {
         }
     }
 
-    magic_close(cookie);
     return file->type;
 }
 
@@ -17,73 +17,160 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
-#include <json.h>
 
 #include "rpminspect.h"
 
 /*
- * Output a results_t in JSON format.
+ * Results are written as they are walked rather than built up as a
+ * json-c object tree first, which on kernel builds with verbose
+ * results took several times the memory of the results themselves.
+ * The output is what the tree gave, including when an inspection's
+ * results are not all together: json-c kept the object member where
+ * the key was first added but replaced its value, so the last run of
+ * results for a header is written where the first one was.
  */
-void output_json(const results_t *results, const char *dest) {
+
+/* Where the last run of results for a header starts */
+struct header_run {
+    const char *header;
+    const results_entry_t *last;
+    bool written;
+};
+
+static struct header_run *find_run(struct header_run *runs, const size_t nruns, const char *header)
+{
+    size_t i = 0;
+
+    for (i = 0; i < nruns; i++) {
+        if (!strcmp(runs[i].header, header)) {
+            return &runs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Find the start of the last run of results for each header, in the
+ * order the headers first appear.
+ */
+static struct header_run *header_runs(const results_t *results, size_t *nruns)
+{
     results_entry_t *result = NULL;
-    int r = 0;
-    int len = 0;
-    FILE *fp = NULL;
     const char *header = NULL;
-    struct json_object *j = NULL;
-    struct json_object *ji = NULL;
-    struct json_object *jr = NULL;
-    int flags = JSON_C_TO_STRING_SPACED | JSON_C_TO_STRING_PRETTY;
-    struct json_object_iter iter;
+    struct header_run *runs = NULL;
+    struct header_run *run = NULL;
+    size_t alloc = 0;
 
-    assert(results != NULL);
+    *nruns = 0;
 
-    /*
-     * The main results object.  Each inspection will be an array
-     * with the results contained as array elements.
-     */
-    j = json_object_new_object();
-
-    /* output the results */
     TAILQ_FOREACH(result, results, items) {
-        /* if we have a new inspection set, create a new object */
-        if (header == NULL || strcmp(header, result->header)) {
-            /* add previous inspection if there is one */
-            if (ji != NULL) {
-                json_object_object_add(j, header, json_object_get(ji));
+        if (header != NULL && !strcmp(header, result->header)) {
+            continue;
+        }
+
+        header = result->header;
+        run = find_run(runs, *nruns, header);
+
+        if (run == NULL) {
+            if (*nruns == alloc) {
+                alloc = (alloc == 0) ? 64 : alloc * 2;
+                runs = realloc(runs, alloc * sizeof(*runs));
+                assert(runs != NULL);
             }
 
-            /* new inspection begins now */
-            header = result->header;
-            ji = json_object_new_array();
+            run = &runs[(*nruns)++];
+            run->header = header;
+            run->written = false;
         }
 
-        /* create the object for this result */
-        jr = json_object_new_object();
-        json_object_object_add(jr, "result", json_object_new_string(strseverity(result->severity)));
-        json_object_object_add(jr, "waiver authorization", json_object_new_string(strwaiverauth(result->waiverauth)));
+        run->last = result;
+    }
 
-        if (result->msg != NULL) {
-            json_object_object_add(jr, "message", json_object_new_string(result->msg));
-        }
+    return runs;
+}
 
-        if (result->details != NULL) {
-            json_object_object_add(jr, "details", json_object_new_string(result->details));
-        }
+/*
+ * Write the "stats" object from a stats_t.  Phases and inspections
+ * are separate objects keyed by name.
+ */
+static void write_stats(json_writer_t *w, const stats_t *stats)
+{
+    stats_entry_t *entry = NULL;
+    int kind = 0;
+
+    json_begin_object(w, "stats");
 
-        if (result->remedy != NULL) {
-            json_object_object_add(jr, "remedy", json_object_new_string(result->remedy));
+    for (kind = STATS_PHASE; kind <= STATS_INSPECTION; kind++) {
+        json_begin_object(w, (kind == STATS_PHASE) ? "phases" : "inspections");
+
+        TAILQ_FOREACH(entry, stats, items) {
+            if ((int) entry->kind != kind) {
+                continue;
+            }
+
+            json_begin_object(w, entry->name);
+            json_write_int(w, "count", entry->count);
+            json_write_double(w, "wall time", entry->wall);
+            json_write_double(w, "cpu time", entry->cpu);
+            json_write_int(w, "peak rss delta", entry->maxrss);
+            json_write_int(w, "files", entry->files);
+            json_write_int(w, "subprocesses", entry->subprocesses);
+            json_write_int(w, "bytes read", entry->bytes_read);
+            json_end_object(w);
         }
 
-        /* add this result data to the inspection array */
-        json_object_array_add(ji, jr);
+        json_end_object(w);
+    }
+
+    json_end_object(w);
+    return;
+}
+
+/*
+ * Write one result as an object in the inspection's array.
+ */
+static void write_result(json_writer_t *w, const results_entry_t *result)
+{
+    json_begin_object(w, NULL);
+    json_write_string(w, "result", strseverity(result->severity));
+    json_write_string(w, "waiver authorization", strwaiverauth(result->waiverauth));
+
+    if (result->msg != NULL) {
+        json_write_string(w, "message", result->msg);
+    }
+
+    if (result->details != NULL) {
+        json_write_string(w, "details", result->details);
+    }
+
+    if (result->remedy != NULL) {
+        json_write_string(w, "remedy", result->remedy);
     }
 
-    /* add the final inspection */
-    json_object_object_add(j, header, json_object_get(ji));
+    json_end_object(w);
+    return;
+}
+
+/*
+ * Output a results_t in JSON format.
+ */
+void output_json(const results_t *results, const char *dest, const stats_t *stats) {
+    const results_entry_t *result = NULL;
+    const results_entry_t *entry = NULL;
+    const char *header = NULL;
+    int r = 0;
+    FILE *fp = NULL;
+    struct header_run *runs = NULL;
+    struct header_run *run = NULL;
+    size_t nruns = 0;
+    json_writer_t w;
+
+    assert(results != NULL);
 
     /* default to stdout unless a filename was specified */
     if (dest == NULL) {
@@ -98,8 +185,47 @@ void output_json(const results_t *results, const char *dest) {
         }
     }
 
-    /* write out the results */
-    fprintf(fp, "%s\n", json_object_to_json_string_ext(j, flags));
+    /*
+     * The main results object.  Each inspection is an array with the
+     * results contained as array elements.
+     */
+    runs = header_runs(results, &nruns);
+    json_writer_init(&w, fp, true);
+    json_begin_object(&w, NULL);
+
+    TAILQ_FOREACH(result, results, items) {
+        /* only look at the first result of each run */
+        if (header != NULL && !strcmp(header, result->header)) {
+            continue;
+        }
+
+        header = result->header;
+        run = find_run(runs, nruns, header);
+        assert(run != NULL);
+
+        if (run->written) {
+            continue;
+        }
+
+        run->written = true;
+        json_begin_array(&w, header);
+
+        for (entry = run->last; entry != NULL && !strcmp(entry->header, header); entry = TAILQ_NEXT(entry, items)) {
+            write_result(&w, entry);
+        }
+
+        json_end_array(&w);
+    }
+
+    free(runs);
+
+    /* resource use, if it was collected */
+    if (stats != NULL) {
+        write_stats(&w, stats);
+    }
+
+    json_end_object(&w);
+    fputc('\n', fp);
 
     /* tidy up and return */
     r = fflush(fp);
@@ -110,20 +236,5 @@ void output_json(const results_t *results, const char *dest) {
         assert(r == 0);
     }
 
-    /* clean up the json library memory allocation */
-    json_object_object_foreachC(j, iter) {
-        if (json_object_get_type(iter.val) == json_type_array) {
-            len = json_object_array_length(iter.val);
-
-            for (r = 0; r < len; r++) {
-                json_object_array_put_idx(iter.val, r, NULL);
-            }
-        }
-
-        json_object_put(iter.val);
-    }
-
-    json_object_put(j);
-
     return;
 }
@@ -26,7 +26,7 @@
 /*
  * Output a results_t in plain text format.
  */
-void output_text(const results_t *results, const char *dest) {
+void output_text(const results_t *results, const char *dest, const stats_t *stats) {
     results_entry_t *result = NULL;
     int r = 0;
     int count = 0;
@@ -113,6 +113,18 @@ void output_text(const results_t *results, const char *dest) {
         fprintf(fp, "\n");
     }
 
+    /* resource use, if it was collected */
+    if (stats != NULL) {
+        fprintf(fp, "\n%s:\n", _("stats"));
+
+        for (r = 0; r < (int) strlen(_("stats")) + 1; r++) {
+            fprintf(fp, "-");
+        }
+
+        fprintf(fp, "\n");
+        print_stats(stats, fp);
+    }
+
     /* tidy up and return */
     r = fflush(fp);
     assert(r == 0);
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "rpminspect.h"
+
+/**
+ * @file pathmatch.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Compiled multi-pattern path matching.
+ *
+ * Lists of path prefixes, suffixes, and exact paths from the
+ * configuration file are compiled once in to a trie.  A file path is
+ * then checked against every rule in the list with a single walk over
+ * the path rather than one strprefix() or strsuffix() call per rule.
+ * Suffix rules are stored reversed and the path is walked from the
+ * end.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/*
+ * Allocate a new trie node for character c.
+ */
+static path_trie_node_t *new_node(unsigned char c)
+{
+    path_trie_node_t *node = NULL;
+
+    node = calloc(1, sizeof(*node));
+    assert(node != NULL);
+    node->c = c;
+    node->rule = -1;
+    return node;
+}
+
+/*
+ * Return the child of node for character c.  If create is true and no
+ * child exists, one is added.
+ */
+static path_trie_node_t *get_child(path_trie_node_t *node, unsigned char c, bool create)
+{
+    path_trie_node_t *child = NULL;
+
+    assert(node != NULL);
+
+    for (child = node->child; child != NULL; child = child->sibling) {
+        if (child->c == c) {
+            return child;
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    child = new_node(c);
+    child->sibling = node->child;
+    node->child = child;
+    return child;
+}
+
+/*
+ * Recursively free a trie.
+ */
+static void free_nodes(path_trie_node_t *node)
+{
+    path_trie_node_t *next = NULL;
+
+    while (node != NULL) {
+        next = node->sibling;
+        free_nodes(node->child);
+        free(node);
+        node = next;
+    }
+
+    return;
+}
+
+/*
+ * Record rule as a match if it came earlier in the original list than
+ * the current best match.
+ */
+static inline int better_rule(int best, int rule)
+{
+    if (rule < 0) {
+        return best;
+    }
+
+    if (best < 0 || rule < best) {
+        return rule;
+    }
+
+    return best;
+}
+
+/**
+ * @brief Allocate an empty path matcher of the given type.
+ *
+ * @param type PATH_MATCH_PREFIX, PATH_MATCH_SUFFIX, or PATH_MATCH_EXACT.
+ * @return Newly allocated path_matcher_t, free with free_path_matcher().
+ */
+path_matcher_t *init_path_matcher(const path_match_type_t type)
+{
+    path_matcher_t *matcher = NULL;
+
+    matcher = calloc(1, sizeof(*matcher));
+    assert(matcher != NULL);
+    matcher->type = type;
+    matcher->root = new_node('\0');
+    return matcher;
+}
+
+/**
+ * @brief Free a path matcher and all of its rules.
+ *
+ * @param matcher The path_matcher_t to free (may be NULL).
+ */
+void free_path_matcher(path_matcher_t *matcher)
+{
+    size_t i;
+
+    if (matcher == NULL) {
+        return;
+    }
+
+    free_nodes(matcher->root);
+
+    for (i = 0; i < matcher->nrules; i++) {
+        free(matcher->rules[i]);
+    }
+
+    free(matcher->rules);
+    free(matcher);
+    return;
+}
+
+/**
+ * @brief Add a rule to a path matcher.
+ *
+ * The key is the string actually matched against paths.  The rule is
+ * the string handed back to the caller on a match, which is usually
+ * the original configuration file entry before any normalization was
+ * applied to create the key.  Rules are numbered in the order they
+ * are added and match_path() reports the lowest numbered match, so
+ * adding rules in list order preserves the "first entry wins"
+ * behavior of a TAILQ_FOREACH loop.
+ *
+ * @param matcher The path matcher to add to.
+ * @param key The prefix, suffix, or exact path to match.
+ * @param rule The string to return when key matches (NULL means key).
+ */
+void add_path_matcher_rule(path_matcher_t *matcher, const char *key, const char *rule)
+{
+    path_trie_node_t *node = NULL;
+    size_t len;
+    size_t i;
+    int idx;
+
+    assert(matcher != NULL);
+    assert(key != NULL);
+
+    /* store the rule string */
+    matcher->rules = reallocarray(matcher->rules, matcher->nrules + 1, sizeof(*matcher->rules));
+    assert(matcher->rules != NULL);
+    matcher->rules[matcher->nrules] = strdup(rule ? rule : key);
+    assert(matcher->rules[matcher->nrules] != NULL);
+    idx = matcher->nrules;
+    matcher->nrules++;
+
+    /* insert the key, reversed for suffix matching */
+    node = matcher->root;
+    len = strlen(key);
+
+    for (i = 0; i < len; i++) {
+        if (matcher->type == PATH_MATCH_SUFFIX) {
+            node = get_child(node, key[len - i - 1], true);
+        } else {
+            node = get_child(node, key[i], true);
+        }
+    }
+
+    /* duplicate keys keep the earliest rule */
+    node->rule = better_rule(node->rule, idx);
+    return;
+}
+
+/**
+ * @brief Compile a string_list_t in to a new path matcher.
+ *
+ * Each list entry is used as both the key and the rule.  Callers that
+ * need to normalize entries should use init_path_matcher() and
+ * add_path_matcher_rule() directly.
+ *
+ * @param list The list of strings to compile (may be NULL).
+ * @param type PATH_MATCH_PREFIX, PATH_MATCH_SUFFIX, or PATH_MATCH_EXACT.
+ * @return Newly allocated path_matcher_t or NULL if list is NULL.
+ */
+path_matcher_t *compile_path_matcher(const string_list_t *list, const path_match_type_t type)
+{
+    path_matcher_t *matcher = NULL;
+    string_entry_t *entry = NULL;
+
+    if (list == NULL) {
+        return NULL;
+    }
+
+    matcher = init_path_matcher(type);
+
+    TAILQ_FOREACH(entry, list, items) {
+        add_path_matcher_rule(matcher, entry->data, NULL);
+    }
+
+    return matcher;
+}
+
+/**
+ * @brief Match a path against every rule in a path matcher.
+ *
+ * The path is walked once.  Every rule whose key is a prefix (or
+ * suffix, or exact match) of the path is considered and the one added
+ * first is returned.
+ *
+ * @param matcher The compiled path matcher (may be NULL).
+ * @param path The path to check.
+ * @return The matching rule string or NULL if nothing matched.  The
+ *         string belongs to the matcher, do not free it.
+ */
+const char *match_path(const path_matcher_t *matcher, const char *path)
+{
+    const path_trie_node_t *node = NULL;
+    size_t len;
+    size_t i;
+    int best = -1;
+
+    if (matcher == NULL || path == NULL) {
+        return NULL;
+    }
+
+    node = matcher->root;
+    len = strlen(path);
+
+    /* an empty key matches everything except in exact mode */
+    if (matcher->type != PATH_MATCH_EXACT || len == 0) {
+        best = better_rule(best, node->rule);
+    }
+
+    for (i = 0; i < len; i++) {
+        if (matcher->type == PATH_MATCH_SUFFIX) {
+            node = get_child((path_trie_node_t *) node, path[len - i - 1], false);
+        } else {
+            node = get_child((path_trie_node_t *) node, path[i], false);
+        }
+
+        if (node == NULL) {
+            break;
+        }
+
+        if (matcher->type != PATH_MATCH_EXACT || i == (len - 1)) {
+            best = better_rule(best, node->rule);
+        }
+    }
+
+    if (best < 0) {
+        return NULL;
+    }
+
+    return matcher->rules[best];
+}
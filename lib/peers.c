@@ -61,6 +61,14 @@ void free_rpmpeer(rpmpeer_t *peers) {
         entry->before_files = NULL;
         free_files(entry->after_files);
         entry->after_files = NULL;
+        free_header_columns(entry->before_cols);
+        entry->before_cols = NULL;
+        free_header_columns(entry->after_cols);
+        entry->after_cols = NULL;
+        free_arena(entry->before_arena);
+        entry->before_arena = NULL;
+        free_arena(entry->after_arena);
+        entry->after_arena = NULL;
         free(entry);
     }
 
@@ -70,12 +78,31 @@ void free_rpmpeer(rpmpeer_t *peers) {
 }
 
 /*
- * Add the specified package as a peer in the list of packages.
+ * Point every file at the decoded file tags of its package.
  */
-void add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pkg, Header hdr)
+static void set_file_columns(rpmfile_t *files, header_columns_t *cols)
+{
+    rpmfile_entry_t *file = NULL;
+
+    if (files == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(file, files, items) {
+        file->cols = cols;
+    }
+
+    return;
+}
+
+/*
+ * Find the peer the package in hdr belongs with, which is the peer
+ * whose package from the other build has the same name (and arch,
+ * for binary packages).  Returns NULL if there is no such peer.
+ */
+static rpmpeer_entry_t *find_peer(rpmpeer_t *peers, int whichbuild, Header hdr)
 {
     rpmpeer_entry_t *peer = NULL;
-    bool found = false;
     const char *newname = NULL;
     const char *newarch = NULL;
     const char *existingname = NULL;
@@ -84,20 +111,14 @@ void add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pk
     bool newsrc = false;
 
     assert(peers != NULL);
-    assert(pkg != NULL);
     assert(hdr != NULL);
 
-    if (*peers == NULL) {
-        *peers = init_rpmpeer();
-    }
-
     /* Get the package or subpackage name and arch */
     newname = headerGetString(hdr, RPMTAG_NAME);
     newarch = get_rpm_header_arch(hdr);
     newsrc = headerIsSource(hdr);
 
-    /* If we don't have this peer, try to add it */
-    TAILQ_FOREACH(peer, *peers, items) {
+    TAILQ_FOREACH(peer, peers, items) {
         if (whichbuild == BEFORE_BUILD && peer->after_rpm != NULL) {
             existingname = headerGetString(peer->after_hdr, RPMTAG_NAME);
             existingarch = get_rpm_header_arch(peer->after_hdr);
@@ -115,11 +136,39 @@ void add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pk
         if ((existingsrc && newsrc && !strcmp(existingname, newname)) ||
             (!existingsrc && !newsrc && !strcmp(existingname, newname) && !strcmp(existingarch, newarch))) {
             /* found the existing peer */
-            found = true;
-            break;
+            return peer;
         }
     }
 
+    return NULL;
+}
+
+/*
+ * Add the specified package as a peer in the list of packages.  If
+ * pool is not NULL the payload is extracted by the pool's worker
+ * threads and link_peer_files() must be called once the pool is
+ * finished.  Otherwise the entire payload is extracted before
+ * returning.  The file tags are decoded here, on the main thread,
+ * because init_header_columns() takes a reference on hdr and
+ * headerLink() is not thread safe.  Workers only read them.
+ */
+void add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pkg, Header hdr, extract_pool_t *pool)
+{
+    rpmpeer_entry_t *peer = NULL;
+    bool found = false;
+
+    assert(peers != NULL);
+    assert(pkg != NULL);
+    assert(hdr != NULL);
+
+    if (*peers == NULL) {
+        *peers = init_rpmpeer();
+    }
+
+    /* If we don't have this peer, try to add it */
+    peer = find_peer(*peers, whichbuild, hdr);
+    found = (peer != NULL);
+
     /* Add the peer if it doesn't already exist, otherwise add it */
     if (!found) {
         if ((peer = calloc(1, sizeof(*peer))) == NULL) {
@@ -137,7 +186,13 @@ void add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pk
             peer->before_files = NULL;
             peer->after_root = NULL;
         } else {
-            peer->before_files = extract_rpm(pkg, hdr, &peer->before_root);
+            peer->before_arena = init_arena();
+            peer->before_cols = init_header_columns(hdr);
+
+            if (pool == NULL) {
+                peer->before_files = extract_rpm(NULL, pkg, hdr, peer->before_cols, &peer->before_root, peer->before_arena);
+                set_file_columns(peer->before_files, peer->before_cols);
+            }
         }
     } else if (whichbuild == AFTER_BUILD) {
         peer->after_hdr = hdr;
@@ -147,7 +202,13 @@ void add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pk
             peer->after_files = NULL;
             peer->after_root = NULL;
         } else {
-            peer->after_files = extract_rpm(pkg, hdr, &peer->after_root);
+            peer->after_arena = init_arena();
+            peer->after_cols = init_header_columns(hdr);
+
+            if (pool == NULL) {
+                peer->after_files = extract_rpm(NULL, pkg, hdr, peer->after_cols, &peer->after_root, peer->after_arena);
+                set_file_columns(peer->after_files, peer->after_cols);
+            }
         }
     }
 
@@ -155,9 +216,91 @@ void add_peer(rpmpeer_t **peers, int whichbuild, bool fetch_only, const char *pk
         TAILQ_INSERT_TAIL(*peers, peer, items);
     }
 
-    if (peer->before_files && peer->after_files) {
+    if (pool != NULL && !fetch_only) {
+        queue_extraction(pool, peer, whichbuild);
+    } else if (peer->before_files && peer->after_files) {
         find_file_peers(peer->before_files, peer->after_files);
     }
 
     return;
 }
+
+/*
+ * Add a package whose payload has already been extracted (for example
+ * while it was being downloaded) as a peer.  cols are the decoded file
+ * tags of hdr that the extraction used.  The peer takes ownership of
+ * cols, files, root, and arena.  Call link_peer_files() once every
+ * package has been added.
+ */
+void add_extracted_peer(rpmpeer_t **peers, int whichbuild, const char *pkg, Header hdr, header_columns_t *cols, rpmfile_t *files, char *root, arena_t *arena)
+{
+    rpmpeer_entry_t *peer = NULL;
+    bool found = false;
+
+    assert(peers != NULL);
+    assert(pkg != NULL);
+    assert(hdr != NULL);
+
+    if (*peers == NULL) {
+        *peers = init_rpmpeer();
+    }
+
+    peer = find_peer(*peers, whichbuild, hdr);
+    found = (peer != NULL);
+
+    if (!found) {
+        if ((peer = calloc(1, sizeof(*peer))) == NULL) {
+            fprintf(stderr, _("*** failed to allocate new peer peer\n"));
+            fflush(stderr);
+            return;
+        }
+    }
+
+    if (whichbuild == BEFORE_BUILD) {
+        peer->before_hdr = hdr;
+        peer->before_rpm = strdup(pkg);
+        peer->before_cols = cols;
+        peer->before_files = files;
+        peer->before_root = root;
+        peer->before_arena = arena;
+    } else if (whichbuild == AFTER_BUILD) {
+        peer->after_hdr = hdr;
+        peer->after_rpm = strdup(pkg);
+        peer->after_cols = cols;
+        peer->after_files = files;
+        peer->after_root = root;
+        peer->after_arena = arena;
+    }
+
+    if (!found) {
+        TAILQ_INSERT_TAIL(*peers, peer, items);
+    }
+
+    return;
+}
+
+/*
+ * Finish peers whose payloads were extracted by an extraction pool
+ * or added with add_extracted_peer(): point the files at the file
+ * tags decoded when the peer was added and match up the before and
+ * after files.  Call this after finish_extract_pool().
+ */
+void link_peer_files(rpmpeer_t *peers)
+{
+    rpmpeer_entry_t *peer = NULL;
+
+    if (peers == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(peer, peers, items) {
+        set_file_columns(peer->before_files, peer->before_cols);
+        set_file_columns(peer->after_files, peer->after_cols);
+
+        if (peer->before_files && peer->after_files) {
+            find_file_peers(peer->before_files, peer->after_files);
+        }
+    }
+
+    return;
+}
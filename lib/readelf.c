@@ -92,6 +92,11 @@ static Elf * get_elf_with_kind(const char *fullpath, int *out_fd, Elf_Kind kind)
         initialized = true;
     }
 
+    /* payload members that were not extracted have no path */
+    if (fullpath == NULL) {
+        return NULL;
+    }
+
     /* make sure this is a regular file */
     if (lstat(fullpath, &sbuf) != 0) {
         fprintf(stderr, _("Unable to stat %s\n"), fullpath);
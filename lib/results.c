@@ -154,6 +154,11 @@ void add_result_entry(results_t **results, struct result_params *params)
 
 /*
  * Shortcut to call add_result_entry() by giving the struct rpminspect.
+ * The result is also written to the --events stream, if there is one.
+ *
+ * With --fail-fast, a result at or above the failure threshold
+ * cancels the run.  Results reported after that come from work that
+ * was cut short and are dropped.
  */
 void add_result(struct rpminspect *ri, struct result_params *params)
 {
@@ -161,10 +166,20 @@ void add_result(struct rpminspect *ri, struct result_params *params)
     assert(params != NULL);
     assert(params->severity >= 0);
 
+    if (run_cancelled()) {
+        return;
+    }
+
     if (params->severity > ri->worst_result) {
         ri->worst_result = params->severity;
     }
 
     add_result_entry(&ri->results, params);
+    event_result(params);
+
+    if (ri->fail_fast && params->severity >= ri->threshold) {
+        cancel_run();
+    }
+
     return;
 }
@@ -18,13 +18,21 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <rpm/rpmlib.h>
 #include <rpm/rpmts.h>
 #include <rpm/header.h>
 
 #include "rpminspect.h"
 
+/* Local prototypes */
+static void add_header_cache_entry(struct rpminspect *, header_cache_entry_t *);
+
 /* Initialize librpm if needed */
 int init_librpm(void)
 {
@@ -94,6 +102,93 @@ Header get_rpm_header(struct rpminspect *ri, const char *pkg)
         return NULL;
     }
 
+    add_header_cache_entry(ri, hentry);
+    return hentry->hdr;
+}
+
+/* Read a big endian 32-bit value */
+static uint32_t get_be32(const unsigned char *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+/*
+ * Find where the main header of a package ends, which is all
+ * get_rpm_header() needs to read.  pkg may hold only the start of the
+ * package.  The lead is followed by the signature header, padded to a
+ * multiple of 8 bytes, then the main header.  Each header starts with
+ * a 16 byte intro holding the number of index entries and the size of
+ * the data store.
+ *
+ * Returns 1 with *end set if pkg holds the whole main header, 0 with
+ * *end set to how much of the file is needed to know more, and -1 if
+ * pkg is not an RPM package.
+ */
+int get_rpm_header_end(const char *pkg, off_t *end)
+{
+    static const unsigned char lead_magic[] = { 0xed, 0xab, 0xee, 0xdb };
+    static const unsigned char header_magic[] = { 0x8e, 0xad, 0xe8, 0x01 };
+    unsigned char buf[16];
+    struct stat sb;
+    off_t offset = RPM_LEAD_SIZE;
+    off_t size = 0;
+    int fd = -1;
+    int i = 0;
+
+    assert(pkg != NULL);
+    assert(end != NULL);
+
+    fd = open(pkg, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1 || fstat(fd, &sb) == -1) {
+        if (fd != -1) {
+            close(fd);
+        }
+
+        return -1;
+    }
+
+    if (pread(fd, buf, sizeof(lead_magic), 0) != sizeof(lead_magic) || memcmp(buf, lead_magic, sizeof(lead_magic))) {
+        close(fd);
+        return -1;
+    }
+
+    /* the signature header, then the main header */
+    for (i = 0; i < 2; i++) {
+        if (pread(fd, buf, sizeof(buf), offset) != sizeof(buf)) {
+            close(fd);
+            *end = offset + sizeof(buf);
+            return 0;
+        }
+
+        if (memcmp(buf, header_magic, sizeof(header_magic))) {
+            close(fd);
+            return -1;
+        }
+
+        size = sizeof(buf) + (16 * (off_t) get_be32(buf + 8)) + get_be32(buf + 12);
+
+        /* only the signature header is padded */
+        if (i == 0) {
+            size = (size + 7) & ~7;
+        }
+
+        offset += size;
+    }
+
+    close(fd);
+    *end = offset;
+    return (sb.st_size >= offset) ? 1 : 0;
+}
+
+/*
+ * Add an entry to the header cache, initializing it if necessary.
+ */
+static void add_header_cache_entry(struct rpminspect *ri, header_cache_entry_t *hentry)
+{
+    assert(ri != NULL);
+    assert(hentry != NULL);
+
     if (ri->header_cache == NULL) {
         /* Initialize the header cache if necessary */
         ri->header_cache = calloc(1, sizeof(*ri->header_cache));
@@ -102,7 +197,29 @@ Header get_rpm_header(struct rpminspect *ri, const char *pkg)
     }
 
     TAILQ_INSERT_TAIL(ri->header_cache, hentry, items);
-    return hentry->hdr;
+    return;
+}
+
+/*
+ * Add a header that was read some other way than get_rpm_header()
+ * (for example from a download stream) to the header cache.  The
+ * cache takes ownership of hdr and later get_rpm_header() calls for
+ * pkg return it.
+ */
+void cache_rpm_header(struct rpminspect *ri, const char *pkg, Header hdr)
+{
+    header_cache_entry_t *hentry = NULL;
+
+    assert(ri != NULL);
+    assert(pkg != NULL);
+    assert(hdr != NULL);
+
+    hentry = calloc(1, sizeof(*hentry));
+    assert(hentry != NULL);
+    hentry->pkg = strdup(basename(pkg));
+    hentry->hdr = hdr;
+    add_header_cache_entry(ri, hentry);
+    return;
 }
 
 /*
@@ -172,3 +289,296 @@ const char *get_rpm_header_arch(Header h)
         return headerGetString(h, RPMTAG_ARCH);
     }
 }
+
+/*
+ * Returns true if the package is a debuginfo or debugsource package.
+ */
+bool is_debug_package(Header h)
+{
+    const char *name = NULL;
+
+    assert(h != NULL);
+
+    name = headerGetString(h, RPMTAG_NAME);
+
+    if (name == NULL) {
+        return false;
+    }
+
+    return strsuffix(name, DEBUGINFO_SUFFIX) || strsuffix(name, DEBUGSOURCE_SUFFIX);
+}
+
+/*
+ * Decode a string array file tag in to a newly allocated array of
+ * pointers.  The strings themselves are not copied, they remain in
+ * the header.  Returns NULL if the tag is missing or the wrong size.
+ */
+static const char **get_file_str_column(Header hdr, rpmTagVal tag, rpm_count_t count)
+{
+    rpmtd td = NULL;
+    const char **col = NULL;
+    rpm_count_t i = 0;
+
+    td = rpmtdNew();
+    assert(td != NULL);
+
+    if (headerGet(hdr, tag, td, HEADERGET_MINMEM) != 1 || rpmtdCount(td) != count) {
+        goto str_cleanup;
+    }
+
+    col = calloc(count, sizeof(*col));
+    assert(col != NULL);
+
+    while (rpmtdNext(td) != -1 && i < count) {
+        col[i++] = rpmtdGetString(td);
+    }
+
+str_cleanup:
+    rpmtdFreeData(td);
+    rpmtdFree(td);
+    return col;
+}
+
+/*
+ * Decode a numeric file tag in to a newly allocated array of
+ * uint64_t values.  Returns NULL if the tag is missing or the wrong
+ * size.
+ */
+static uint64_t *get_file_num_column(Header hdr, rpmTagVal tag, rpm_count_t count)
+{
+    rpmtd td = NULL;
+    uint64_t *col = NULL;
+    rpm_count_t i = 0;
+
+    td = rpmtdNew();
+    assert(td != NULL);
+
+    if (headerGet(hdr, tag, td, HEADERGET_MINMEM | HEADERGET_EXT) != 1 || rpmtdCount(td) != count) {
+        goto num_cleanup;
+    }
+
+    col = calloc(count, sizeof(*col));
+    assert(col != NULL);
+
+    while (rpmtdNext(td) != -1 && i < count) {
+        col[i++] = rpmtdGetNumber(td);
+    }
+
+num_cleanup:
+    rpmtdFreeData(td);
+    rpmtdFree(td);
+    return col;
+}
+
+/*
+ * Decode RPMTAG_FILECLASS in to a newly allocated array of pointers
+ * to the class descriptions in RPMTAG_CLASSDICT.  The strings remain
+ * in the header.  Returns NULL if either tag is missing or the wrong
+ * size.
+ */
+static const char **get_file_class_column(Header hdr, rpm_count_t count)
+{
+    const char **dict = NULL;
+    const char **col = NULL;
+    uint64_t *idx = NULL;
+    rpm_count_t ndict = 0;
+    rpmtd td = NULL;
+    rpm_count_t i = 0;
+
+    idx = get_file_num_column(hdr, RPMTAG_FILECLASS, count);
+
+    if (idx == NULL) {
+        return NULL;
+    }
+
+    td = rpmtdNew();
+    assert(td != NULL);
+
+    if (headerGet(hdr, RPMTAG_CLASSDICT, td, HEADERGET_MINMEM) != 1) {
+        goto class_cleanup;
+    }
+
+    ndict = rpmtdCount(td);
+    dict = get_file_str_column(hdr, RPMTAG_CLASSDICT, ndict);
+
+    if (dict == NULL) {
+        goto class_cleanup;
+    }
+
+    col = calloc(count, sizeof(*col));
+    assert(col != NULL);
+
+    for (i = 0; i < count; i++) {
+        col[i] = (idx[i] < ndict) ? dict[idx[i]] : "";
+    }
+
+class_cleanup:
+    free(dict);
+    free(idx);
+    rpmtdFreeData(td);
+    rpmtdFree(td);
+    return col;
+}
+
+/*
+ * Decode the file array tags of an RPM header once so inspections can
+ * read per-file values by index.  Returns NULL for headers without
+ * any files.  Free the result with free_header_columns().
+ */
+header_columns_t *init_header_columns(Header hdr)
+{
+    header_columns_t *cols = NULL;
+    rpmtd td = NULL;
+    rpm_count_t count = 0;
+    uint64_t *nums = NULL;
+    rpm_count_t i;
+
+    assert(hdr != NULL);
+
+    /* the number of files in the package */
+    td = rpmtdNew();
+    assert(td != NULL);
+
+    if (headerGet(hdr, RPMTAG_FILEMODES, td, HEADERGET_MINMEM) == 1) {
+        count = rpmtdCount(td);
+    }
+
+    rpmtdFreeData(td);
+    rpmtdFree(td);
+
+    if (count == 0) {
+        return NULL;
+    }
+
+    cols = calloc(1, sizeof(*cols));
+    assert(cols != NULL);
+    cols->hdr = headerLink(hdr);
+    cols->count = count;
+
+    cols->owners = get_file_str_column(hdr, RPMTAG_FILEUSERNAME, count);
+    cols->groups = get_file_str_column(hdr, RPMTAG_FILEGROUPNAME, count);
+    cols->digests = get_file_str_column(hdr, RPMTAG_FILEDIGESTS, count);
+    cols->caps = get_file_str_column(hdr, RPMTAG_FILECAPS, count);
+    cols->linktos = get_file_str_column(hdr, RPMTAG_FILELINKTOS, count);
+    cols->classes = get_file_class_column(hdr, count);
+    cols->sizes = get_file_num_column(hdr, RPMTAG_LONGFILESIZES, count);
+
+    /* modes and flags are narrower than the decoded numbers */
+    nums = get_file_num_column(hdr, RPMTAG_FILEMODES, count);
+
+    if (nums) {
+        cols->modes = calloc(count, sizeof(*cols->modes));
+        assert(cols->modes != NULL);
+
+        for (i = 0; i < count; i++) {
+            cols->modes[i] = nums[i];
+        }
+
+        free(nums);
+    }
+
+    nums = get_file_num_column(hdr, RPMTAG_FILEFLAGS, count);
+
+    if (nums) {
+        cols->flags = calloc(count, sizeof(*cols->flags));
+        assert(cols->flags != NULL);
+
+        for (i = 0; i < count; i++) {
+            cols->flags[i] = nums[i];
+        }
+
+        free(nums);
+    }
+
+    return cols;
+}
+
+/*
+ * Free a header_columns_t from init_header_columns().
+ */
+void free_header_columns(header_columns_t *cols)
+{
+    if (cols == NULL) {
+        return;
+    }
+
+    free(cols->owners);
+    free(cols->groups);
+    free(cols->digests);
+    free(cols->caps);
+    free(cols->linktos);
+    free(cols->classes);
+    free(cols->modes);
+    free(cols->flags);
+    free(cols->sizes);
+    headerFree(cols->hdr);
+    free(cols);
+    return;
+}
+
+/*
+ * Return the value of a string array file tag for the given file from
+ * its header column cache.  Supported tags are RPMTAG_FILEUSERNAME,
+ * RPMTAG_FILEGROUPNAME, RPMTAG_FILEDIGESTS, RPMTAG_FILECAPS,
+ * RPMTAG_FILELINKTOS, and RPMTAG_FILECLASS (the class description).
+ * NOTE: Do not free() what this function returns.
+ */
+const char *get_rpm_file_str(const rpmfile_entry_t *file, rpmTagVal tag)
+{
+    const char **col = NULL;
+
+    assert(file != NULL);
+
+    if (file->cols == NULL || file->idx < 0 || (rpm_count_t) file->idx >= file->cols->count) {
+        return NULL;
+    }
+
+    if (tag == RPMTAG_FILEUSERNAME) {
+        col = file->cols->owners;
+    } else if (tag == RPMTAG_FILEGROUPNAME) {
+        col = file->cols->groups;
+    } else if (tag == RPMTAG_FILEDIGESTS) {
+        col = file->cols->digests;
+    } else if (tag == RPMTAG_FILECAPS) {
+        col = file->cols->caps;
+    } else if (tag == RPMTAG_FILELINKTOS) {
+        col = file->cols->linktos;
+    } else if (tag == RPMTAG_FILECLASS) {
+        col = file->cols->classes;
+    }
+
+    if (col == NULL) {
+        return NULL;
+    }
+
+    return col[file->idx];
+}
+
+/*
+ * Return the value of a numeric file tag for the given file from its
+ * header column cache.  Supported tags are RPMTAG_FILEMODES,
+ * RPMTAG_FILEFLAGS, and RPMTAG_FILESIZES (or RPMTAG_LONGFILESIZES).
+ * Returns 0 if the value is not available.
+ */
+uint64_t get_rpm_file_num(const rpmfile_entry_t *file, rpmTagVal tag)
+{
+    const header_columns_t *cols = NULL;
+
+    assert(file != NULL);
+
+    cols = file->cols;
+
+    if (cols == NULL || file->idx < 0 || (rpm_count_t) file->idx >= cols->count) {
+        return 0;
+    }
+
+    if (tag == RPMTAG_FILEMODES && cols->modes) {
+        return cols->modes[file->idx];
+    } else if (tag == RPMTAG_FILEFLAGS && cols->flags) {
+        return cols->flags[file->idx];
+    } else if ((tag == RPMTAG_FILESIZES || tag == RPMTAG_LONGFILESIZES) && cols->sizes) {
+        return cols->sizes[file->idx];
+    }
+
+    return 0;
+}
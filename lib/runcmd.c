@@ -24,17 +24,21 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "rpminspect.h"
 
 /*
- * Generic popen() wrapper to return the output of the process and the
- * exit code (if desired).  This function returns an allocated string of
- * the output from the program that ran or NULL if there was no output.
+ * Generic popen() style wrapper to return the output of the process and
+ * the exit code (if desired).  This function returns an allocated string
+ * of the output from the program that ran or NULL if there was no output.
  *
  * The first argument is a pointer to an int that will hold the exit code
- * from popen().  If this pointer is NULL, then the caller does not want
- * the exit code and the function does nothing.
+ * as pclose() would return it.  If this pointer is NULL, then the caller
+ * does not want the exit code and the function does nothing.
  *
  * The second argument is the command followed by any additional arguments
  * that should be included with it.  Note that it is not a format string,
@@ -50,8 +54,13 @@ char *run_cmd(int *exitcode, const char *cmd, ...)
     size_t n = BUFSIZ;
     char *buf = NULL;
     FILE *cmdfp = NULL;
+    int fds[2];
+    pid_t pid = 0;
+    pid_t r = 0;
     char *built = NULL;
     char *element = NULL;
+    uint64_t span = 0;
+    bool own_group = cancel_enabled();
 
     assert(cmd != NULL);
 
@@ -71,6 +80,18 @@ char *run_cmd(int *exitcode, const char *cmd, ...)
 
     va_end(ap);
 
+    /* nothing new is started once the run is cancelled */
+    if (run_cancelled()) {
+        DEBUG_PRINT("run cancelled, not running `%s`\n", built);
+        free(built);
+
+        if (exitcode != NULL) {
+            *exitcode = -1;
+        }
+
+        return NULL;
+    }
+
     /* always combine stdout and stderr */
     xasprintf(&output, "%s 2>&1", built);
     assert(output != NULL);
@@ -80,16 +101,51 @@ char *run_cmd(int *exitcode, const char *cmd, ...)
     /* shrink memory allocation */
     built = realloc(built, strlen(built) + 1);
 
-    /* run the command */
-    cmdfp = popen(built, "r");
+    /*
+     * run the command the way popen() would, and with --fail-fast in
+     * its own process group so cancel_run() can stop it and whatever
+     * it started
+     */
+    count_subprocess();
+    span = trace_start();
 
-    if (cmdfp == NULL) {
+    if (pipe2(fds, O_CLOEXEC) == -1) {
         fprintf(stderr, _("error running `%s`: %s\n"), built, strerror(errno));
         fflush(stderr);
         free(built);
-        return false;
+        return NULL;
     }
 
+    pid = fork();
+
+    if (pid == -1) {
+        fprintf(stderr, _("error running `%s`: %s\n"), built, strerror(errno));
+        fflush(stderr);
+        close(fds[0]);
+        close(fds[1]);
+        free(built);
+        return NULL;
+    }
+
+    if (pid == 0) {
+        if (own_group) {
+            setpgid(0, 0);
+        }
+
+        dup2(fds[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", built, (char *) NULL);
+        _exit(127);
+    }
+
+    if (own_group) {
+        setpgid(pid, pid);
+        register_child(pid);
+    }
+
+    close(fds[1]);
+    cmdfp = fdopen(fds[0], "r");
+    assert(cmdfp != NULL);
+
     /*
      * Read in all of the information back from the command and store
      * it as our result.  Just concatenate the string as we read it
@@ -113,7 +169,21 @@ char *run_cmd(int *exitcode, const char *cmd, ...)
     free(buf);
 
     /* Capture the return code from the validation tool */
-    status = pclose(cmdfp);
+    fclose(cmdfp);
+
+    while ((r = waitpid(pid, &status, 0)) == -1 && errno == EINTR) {
+        continue;
+    }
+
+    if (r == -1) {
+        status = -1;
+    }
+
+    if (own_group) {
+        unregister_child(pid);
+    }
+
+    trace_end(span, "command", cmd, built);
 
     if (exitcode != NULL) {
         *exitcode = status;
@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <rpm/header.h>
+#include <rpm/rpmtd.h>
+#include <rpm/rpmfiles.h>
+#include "rpminspect.h"
+
+/**
+ * @file schedule.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Order the inspections by how much work they have.
+ *
+ * The RPM headers of the build set are enough to tell roughly how
+ * much work each inspection has ahead of it before anything is
+ * extracted: how many packages and payload members it looks at, how
+ * many regular files in its FILES_* classes it reads and how many
+ * bytes those hold, how many of them are ELF objects, Java files,
+ * kernel modules, and shell scripts, and how many external commands
+ * it will run for them.  Those counts are weighed per inspection to
+ * give a cost, and the
+ * inspections can be run most expensive first or cheapest first
+ * rather than in the order of inspections[].  Cheapest first gets to
+ * the first failure sooner, which is what --fail-fast wants.  Most
+ * expensive first keeps the long inspections from being left until
+ * the end.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/*
+ * Weights of the cost model, about microseconds on a typical host.
+ * The inspections that read every byte of their files have a high
+ * per_mib weight.  per_command is for each external command the
+ * inspection runs, see inspection_commands().  The last entry is
+ * used for inspections not listed.
+ */
+static const struct {
+    uint64_t flag;
+    unsigned int per_package;   /* each package header */
+    unsigned int per_listed;    /* each payload member listed */
+    unsigned int per_file;      /* each regular file read */
+    unsigned int per_mib;       /* each MiB of those files */
+    unsigned int per_command;   /* each external command run */
+} weights[] = {
+    { INSPECT_ANNOCHECK,    50, 1,   100, 5000, 20000 },
+    { INSPECT_SHELLSYNTAX,  50, 1,    20,    0,  3000 },
+    { INSPECT_ELF,          50, 1,   200, 2000,     0 },
+    { INSPECT_LTO,          50, 1,   100, 2000,     0 },
+    { INSPECT_DT_NEEDED,    50, 1,   100,  500,     0 },
+    { INSPECT_KMOD,         50, 1,   500, 2000,     0 },
+    { INSPECT_JAVABYTECODE, 50, 1,    50, 1000,     0 },
+    { INSPECT_MANPAGE,      50, 1,   500, 4000,     0 },
+    { INSPECT_XML,          50, 1,   100, 4000,     0 },
+    { INSPECT_CHANGEDFILES, 50, 2,   200, 3000,     0 },
+    { INSPECT_UPSTREAM,     50, 1,   100, 3000,     0 },
+    { INSPECT_DESKTOP,      50, 1,     5,    0,     0 },
+    { 0,                    50, 2,     5,    0,     0 }
+};
+
+/*
+ * Does an inspection reading the FILES_* classes in files read a
+ * regular file in the given classes?  unknown is true if the header
+ * has no file classes, in which case the ELF, text, and Java files
+ * cannot be told apart from the rest.
+ */
+static bool reads_file(const uint32_t files, const uint32_t classes, const bool source, const bool unknown)
+{
+    if (files == FILES_NONE) {
+        return false;
+    }
+
+    if ((files & FILES_PAYLOAD) == FILES_PAYLOAD || (source && (files & FILES_SOURCE))) {
+        return true;
+    }
+
+    if (unknown && (files & (FILES_ELF | FILES_TEXT | FILES_JAVA))) {
+        return true;
+    }
+
+    return (classes & files) != FILES_NONE;
+}
+
+/*
+ * Add the work in one package to n workloads, where workloads[i] is
+ * for something reading the FILES_* classes in masks[i].
+ */
+static void add_package_workload(const struct rpminspect *ri, Header hdr, const uint32_t *masks, const int n, workload_t *workloads)
+{
+    header_columns_t *cols = NULL;
+    rpmtd td = NULL;
+    const char *path = NULL;
+    uint32_t classes = FILES_NONE;
+    uint64_t size = 0;
+    bool source = false;
+    bool debug = false;
+    bool script = false;
+    int idx = 0;
+    int i = 0;
+
+    source = headerIsSource(hdr);
+    debug = is_debug_package(hdr);
+
+    for (i = 0; i < n; i++) {
+        workloads[i].packages++;
+    }
+
+    cols = init_header_columns(hdr);
+
+    if (cols == NULL || cols->modes == NULL) {
+        free_header_columns(cols);
+        return;
+    }
+
+    td = rpmtdNew();
+    assert(td != NULL);
+
+    if (headerGet(hdr, RPMTAG_FILENAMES, td, HEADERGET_MINMEM | HEADERGET_EXT) != 1) {
+        rpmtdFree(td);
+        free_header_columns(cols);
+        return;
+    }
+
+    while ((path = rpmtdNextString(td)) != NULL) {
+        idx = rpmtdGetIndex(td);
+
+        /* %ghost files are not in the payload */
+        if (cols->flags && (cols->flags[idx] & RPMFILE_GHOST)) {
+            continue;
+        }
+
+        classes = payload_file_classes(ri, FILES_PAYLOAD, cols, idx, path);
+        size = (cols->sizes != NULL) ? cols->sizes[idx] : 0;
+        script = (cols->classes != NULL && strstr(cols->classes[idx], "shell script") != NULL);
+
+        for (i = 0; i < n; i++) {
+            workloads[i].files++;
+
+            if (!S_ISREG(cols->modes[idx])) {
+                continue;
+            }
+
+            /* debug packages are only read by the inspections asking for them */
+            if (debug && (!(masks[i] & FILES_DEBUG) || ri->debug_packages == DEBUGPKG_LIST)) {
+                continue;
+            }
+
+            if (!reads_file(masks[i], classes, source, cols->classes == NULL)) {
+                continue;
+            }
+
+            workloads[i].read_files++;
+            workloads[i].read_bytes += size;
+
+            if (classes & FILES_ELF) {
+                workloads[i].elf++;
+            }
+
+            if (classes & FILES_JAVA) {
+                workloads[i].jars++;
+            }
+
+            if (classes & FILES_KMODS) {
+                workloads[i].kmods++;
+            }
+
+            if (script) {
+                workloads[i].scripts++;
+            }
+        }
+    }
+
+    rpmtdFreeData(td);
+    rpmtdFree(td);
+    free_header_columns(cols);
+    return;
+}
+
+/*
+ * Add the work in every package of the build set to n workloads, see
+ * add_package_workload().
+ */
+static void add_peers_workload(const struct rpminspect *ri, const uint32_t *masks, const int n, workload_t *workloads)
+{
+    rpmpeer_entry_t *peer = NULL;
+
+    if (ri->peers == NULL) {
+        return;
+    }
+
+    TAILQ_FOREACH(peer, ri->peers, items) {
+        if (peer->before_hdr != NULL) {
+            add_package_workload(ri, peer->before_hdr, masks, n, workloads);
+        }
+
+        if (peer->after_hdr != NULL) {
+            add_package_workload(ri, peer->after_hdr, masks, n, workloads);
+        }
+    }
+
+    return;
+}
+
+/**
+ * @brief Look up an inspection order policy by name.
+ *
+ * @param name 'table', 'expensive', or 'cheapest'.
+ * @param policy Where to store the policy.
+ * @return True if name is a policy, false if not.
+ */
+bool get_order_policy(const char *name, order_policy_t *policy)
+{
+    assert(policy != NULL);
+
+    if (name == NULL) {
+        return false;
+    }
+
+    if (!strcasecmp(name, "table")) {
+        *policy = ORDER_TABLE;
+    } else if (!strcasecmp(name, "expensive")) {
+        *policy = ORDER_EXPENSIVE;
+    } else if (!strcasecmp(name, "cheapest")) {
+        *policy = ORDER_CHEAPEST;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Count the work each inspection has from the package headers.
+ *
+ * Only the RPM headers of the peers are read, so this works before
+ * anything is extracted and with only the headers fetched.
+ *
+ * @param ri The main program data structure.
+ * @return Array with a workload_t for each entry of inspections[],
+ *         free it with free().
+ */
+workload_t *get_workloads(const struct rpminspect *ri)
+{
+    workload_t *workloads = NULL;
+    uint32_t *masks = NULL;
+    int n = 0;
+    int i = 0;
+
+    assert(ri != NULL);
+
+    while (inspections[n].flag != 0) {
+        n++;
+    }
+
+    workloads = calloc(n, sizeof(*workloads));
+    assert(workloads != NULL);
+    masks = calloc(n, sizeof(*masks));
+    assert(masks != NULL);
+
+    for (i = 0; i < n; i++) {
+        masks[i] = inspections[i].files;
+    }
+
+    add_peers_workload(ri, masks, n, workloads);
+    free(masks);
+    return workloads;
+}
+
+/**
+ * @brief Count the payload files in some FILES_* classes.
+ *
+ * The same as get_workloads() for a single set of classes, such as
+ * the classes a run extracts.
+ *
+ * @param ri The main program data structure.
+ * @param files Mask of FILES_* classes.
+ * @param workload Where to store the counts.
+ */
+void get_payload_workload(const struct rpminspect *ri, const uint32_t files, workload_t *workload)
+{
+    assert(ri != NULL);
+    assert(workload != NULL);
+
+    memset(workload, 0, sizeof(*workload));
+    add_peers_workload(ri, &files, 1, workload);
+    return;
+}
+
+/**
+ * @brief Estimate how many external commands an inspection runs.
+ *
+ * Only counts the commands run for each file read.  Commands that
+ * depend on what changed between the builds, such as diff, are not
+ * counted since the headers cannot tell.
+ *
+ * @param ri The main program data structure.
+ * @param i Index of the inspection in inspections[].
+ * @param workload The workload of the inspection from get_workloads().
+ * @return Number of commands.
+ */
+uint64_t inspection_commands(const struct rpminspect *ri, const int i, const workload_t *workload)
+{
+    uint64_t tests = 0;
+    string_entry_t *entry = NULL;
+
+    assert(ri != NULL);
+    assert(i >= 0);
+    assert(workload != NULL);
+
+    switch (inspections[i].flag) {
+        case INSPECT_ANNOCHECK:
+            /* annocheck runs once per ELF object for each test */
+            if (ri->annocheck_keys != NULL) {
+                TAILQ_FOREACH(entry, ri->annocheck_keys, items) {
+                    tests++;
+                }
+            }
+
+            return workload->elf * tests;
+        case INSPECT_SHELLSYNTAX:
+            return workload->scripts;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Estimate the cost of an inspection from its workload.
+ *
+ * @param ri The main program data structure.
+ * @param i Index of the inspection in inspections[].
+ * @param workload The workload of the inspection from get_workloads().
+ * @return The cost, about microseconds on a typical host.
+ */
+uint64_t inspection_cost(const struct rpminspect *ri, const int i, const workload_t *workload)
+{
+    int w = 0;
+
+    assert(ri != NULL);
+    assert(i >= 0);
+    assert(workload != NULL);
+
+    while (weights[w].flag != 0 && weights[w].flag != inspections[i].flag) {
+        w++;
+    }
+
+    return (weights[w].per_package * workload->packages) +
+           (weights[w].per_listed * workload->files) +
+           (weights[w].per_file * workload->read_files) +
+           (weights[w].per_mib * workload->read_bytes / (1024 * 1024)) +
+           (weights[w].per_command * inspection_commands(ri, i, workload));
+}
+
+struct ranked {
+    int idx;
+    uint64_t cost;
+};
+
+static int cmp_expensive(const void *a, const void *b)
+{
+    const struct ranked *x = a;
+    const struct ranked *y = b;
+
+    if (x->cost != y->cost) {
+        return (x->cost < y->cost) ? 1 : -1;
+    }
+
+    return x->idx - y->idx;
+}
+
+static int cmp_cheapest(const void *a, const void *b)
+{
+    const struct ranked *x = a;
+    const struct ranked *y = b;
+
+    if (x->cost != y->cost) {
+        return (x->cost > y->cost) ? 1 : -1;
+    }
+
+    return x->idx - y->idx;
+}
+
+/**
+ * @brief Put the inspections in order by cost.
+ *
+ * Inspections with the same cost keep their order in inspections[].
+ *
+ * @param policy How to order the inspections.
+ * @param costs Cost of each entry of inspections[].
+ * @return Indexes in inspections[] in run order, ending with -1.
+ *         Free it with free().
+ */
+int *order_by_cost(const order_policy_t policy, const uint64_t *costs)
+{
+    struct ranked *ranked = NULL;
+    int *order = NULL;
+    int n = 0;
+    int i = 0;
+
+    assert(costs != NULL);
+
+    while (inspections[n].flag != 0) {
+        n++;
+    }
+
+    ranked = calloc(n + 1, sizeof(*ranked));
+    assert(ranked != NULL);
+
+    for (i = 0; i < n; i++) {
+        ranked[i].idx = i;
+        ranked[i].cost = costs[i];
+    }
+
+    if (policy == ORDER_EXPENSIVE) {
+        qsort(ranked, n, sizeof(*ranked), cmp_expensive);
+    } else if (policy == ORDER_CHEAPEST) {
+        qsort(ranked, n, sizeof(*ranked), cmp_cheapest);
+    }
+
+    order = calloc(n + 1, sizeof(*order));
+    assert(order != NULL);
+
+    for (i = 0; i < n; i++) {
+        order[i] = ranked[i].idx;
+    }
+
+    order[n] = -1;
+    free(ranked);
+    return order;
+}
+
+/**
+ * @brief Set the order the inspections run in.
+ *
+ * Does nothing unless the order_policy setting is 'expensive' or
+ * 'cheapest'.  Otherwise ri->order is set from the cost of each
+ * inspection.  Call it after the builds are gathered.
+ *
+ * @param ri The main program data structure.
+ */
+void schedule_inspections(struct rpminspect *ri)
+{
+    workload_t *workloads = NULL;
+    uint64_t *costs = NULL;
+    int n = 0;
+    int i = 0;
+
+    assert(ri != NULL);
+
+    if (ri->order_policy == ORDER_TABLE) {
+        return;
+    }
+
+    while (inspections[n].flag != 0) {
+        n++;
+    }
+
+    workloads = get_workloads(ri);
+    costs = calloc(n, sizeof(*costs));
+    assert(costs != NULL);
+
+    for (i = 0; i < n; i++) {
+        costs[i] = inspection_cost(ri, i, &workloads[i]);
+    }
+
+    free(ri->order);
+    ri->order = order_by_cost(ri->order_policy, costs);
+
+    for (i = 0; ri->order[i] != -1; i++) {
+        DEBUG_PRINT("%s: cost=%lu\n", inspections[ri->order[i]].name, (unsigned long) costs[ri->order[i]]);
+    }
+
+    free(costs);
+    free(workloads);
+    return;
+}
@@ -0,0 +1,601 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <json.h>
+#include <libxml/parser.h>
+#include <rpm/rpmlib.h>
+#include "rpminspect.h"
+
+/**
+ * @file serve.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Run comparison jobs sent over a Unix socket.
+ *
+ * With --serve=SOCKET, rpminspect reads its configuration and loads
+ * everything the inspections load on first use once: the RPM
+ * configuration, the license database, the fortified functions in
+ * libc, the magic database, and libxml2.  It then listens on SOCKET.
+ *
+ * Each connection carries one job, a JSON object on one line, for
+ * example:
+ *
+ *     {"before": "zsh-5.8-1.fc33", "after": "zsh-5.8-2.fc33", "tests": "license,elf"}
+ *
+ * The members are before, after, tests, exclude, arches, release, and
+ * threshold, all strings, and the same as the command line options.
+ * Only after is required.  The results are written back in the JSON
+ * output format and the connection is closed.  A request that cannot
+ * be run gets {"error": "..."} instead.  That includes jobs that fail
+ * after they start, for example on an unknown architecture or a build
+ * that cannot be gathered: the job's error messages go to the client
+ * as well as to the server's stderr.
+ *
+ * The socket is only readable and writable by the user running the
+ * server, since a job can read any local path that user can.
+ *
+ * Every job runs in its own process forked from the server, so it
+ * starts with everything already loaded and has its own working
+ * directory.  Jobs are processes rather than threads because the
+ * gathering and inspection code keeps the state of the run in static
+ * variables.  Up to one job per online CPU runs at a time, further
+ * connections wait.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+static volatile sig_atomic_t stopping = 0;
+static volatile sig_atomic_t running = 0;
+
+/* In a job process, see start_job() and end_job() */
+static FILE *job_errors = NULL;
+static int job_stderr = -1;
+static bool job_sent = false;
+
+/* The request members and where they go in a serve_job_t */
+static const struct {
+    const char *name;
+    size_t offset;
+} members[] = {
+    { "before",    offsetof(serve_job_t, before) },
+    { "after",     offsetof(serve_job_t, after) },
+    { "tests",     offsetof(serve_job_t, tests) },
+    { "exclude",   offsetof(serve_job_t, exclude) },
+    { "arches",    offsetof(serve_job_t, arches) },
+    { "release",   offsetof(serve_job_t, release) },
+    { "threshold", offsetof(serve_job_t, threshold) },
+    { NULL,        0 }
+};
+
+static void stop_server(__attribute__((unused)) int signum)
+{
+    stopping = 1;
+    return;
+}
+
+/* Reap finished jobs as they exit */
+static void reap_jobs(__attribute__((unused)) int signum)
+{
+    int saved_errno = errno;
+    int status = 0;
+
+    while (waitpid(-1, &status, WNOHANG) > 0) {
+        running--;
+    }
+
+    errno = saved_errno;
+    return;
+}
+
+/* Add an option and its value to the job command line */
+static void add_arg(serve_job_t *job, const char *option, const char *value)
+{
+    if (value == NULL) {
+        return;
+    }
+
+    if (option != NULL) {
+        job->argv[job->argc] = strdup(option);
+        assert(job->argv[job->argc] != NULL);
+        job->argc++;
+    }
+
+    job->argv[job->argc] = strdup(value);
+    assert(job->argv[job->argc] != NULL);
+    job->argc++;
+    return;
+}
+
+/**
+ * @brief Read a job request.
+ *
+ * @param request The request, a JSON object.
+ * @param job Where to store the job.  Free it with free_serve_job(),
+ *        even if this fails.
+ * @param error Where to store what is wrong with the request if it
+ *        is not valid, free it with free().
+ * @return True if the request is a valid job, false if not.
+ */
+bool parse_serve_job(const char *request, serve_job_t *job, char **error)
+{
+    struct json_object *obj = NULL;
+    char **field = NULL;
+    int i = 0;
+
+    assert(request != NULL);
+    assert(job != NULL);
+    assert(error != NULL);
+
+    memset(job, 0, sizeof(*job));
+    *error = NULL;
+    obj = json_tokener_parse(request);
+
+    if (obj == NULL || !json_object_is_type(obj, json_type_object)) {
+        xasprintf(error, _("request is not a JSON object"));
+        json_object_put(obj);
+        return false;
+    }
+
+    json_object_object_foreach(obj, key, val) {
+        for (i = 0; members[i].name != NULL; i++) {
+            if (!strcmp(members[i].name, key)) {
+                break;
+            }
+        }
+
+        if (members[i].name == NULL) {
+            xasprintf(error, _("unknown member '%s'"), key);
+            break;
+        }
+
+        if (!json_object_is_type(val, json_type_string)) {
+            xasprintf(error, _("member '%s' is not a string"), key);
+            break;
+        }
+
+        field = (char **) ((char *) job + members[i].offset);
+        free(*field);
+        *field = strdup(json_object_get_string(val));
+        assert(*field != NULL);
+    }
+
+    json_object_put(obj);
+
+    if (*error == NULL && job->after == NULL) {
+        xasprintf(error, _("request has no after build"));
+    } else if (*error == NULL && job->tests != NULL && job->exclude != NULL) {
+        xasprintf(error, _("tests and exclude cannot both be given"));
+    } else if (*error == NULL && job->threshold != NULL) {
+        for (i = RESULT_OK; i <= RESULT_BAD; i++) {
+            if (!strcasecmp(job->threshold, strseverity(i))) {
+                break;
+            }
+        }
+
+        if (i > RESULT_BAD) {
+            xasprintf(error, _("unknown threshold '%s'"), job->threshold);
+        }
+    }
+
+    if (*error != NULL) {
+        return false;
+    }
+
+    /* the command line the job is the same as */
+    job->argv = calloc(16, sizeof(*job->argv));
+    assert(job->argv != NULL);
+    add_arg(job, NULL, "rpminspect");
+    add_arg(job, "-T", job->tests);
+    add_arg(job, "-E", job->exclude);
+    add_arg(job, "-a", job->arches);
+    add_arg(job, "-r", job->release);
+    add_arg(job, "-t", job->threshold);
+    add_arg(job, "-F", "json");
+    job->builds = job->argc;
+    add_arg(job, NULL, job->before);
+    add_arg(job, NULL, job->after);
+    return true;
+}
+
+/**
+ * @brief Free the members of a serve_job_t.
+ *
+ * @param job The job to free the members of (may be NULL).
+ */
+void free_serve_job(serve_job_t *job)
+{
+    int i = 0;
+
+    if (job == NULL) {
+        return;
+    }
+
+    for (i = 0; members[i].name != NULL; i++) {
+        free(*(char **) ((char *) job + members[i].offset));
+    }
+
+    if (job->argv != NULL) {
+        for (i = 0; i < job->argc; i++) {
+            free(job->argv[i]);
+        }
+
+        free(job->argv);
+    }
+
+    memset(job, 0, sizeof(*job));
+    return;
+}
+
+/*
+ * Read a request, which ends at a newline or when the client shuts
+ * down its side of the connection.  Returns NULL if the request could
+ * not be read or is larger than SERVE_REQUEST_MAX.
+ */
+static char *read_request(const int fd)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    ssize_t n = 0;
+
+    buf = malloc(SERVE_REQUEST_MAX + 1);
+    assert(buf != NULL);
+
+    while (len < SERVE_REQUEST_MAX) {
+        n = read(fd, buf + len, SERVE_REQUEST_MAX - len);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1) {
+            break;
+        } else if (n == 0 || memchr(buf + len, '\n', n) != NULL) {
+            buf[len + n] = '\0';
+            return buf;
+        }
+
+        len += n;
+    }
+
+    free(buf);
+    return NULL;
+}
+
+/* Answer a request that cannot be run and close the connection */
+static void send_error(const int fd, const char *msg)
+{
+    FILE *fp = NULL;
+    json_writer_t w;
+
+    if ((fp = fdopen(fd, "w")) == NULL) {
+        close(fd);
+        return;
+    }
+
+    json_writer_init(&w, fp, false);
+    json_begin_object(&w, NULL);
+    json_write_string(&w, "error", msg);
+    json_end_object(&w);
+    fputc('\n', fp);
+    fclose(fp);
+    return;
+}
+
+/*
+ * At the end of a job process, copy what the job wrote to stderr to
+ * the server's stderr.  If no results were sent, send the job's error
+ * messages to the client instead.
+ */
+static void end_job(void)
+{
+    char *line = NULL;
+    size_t n = 0;
+    char *msg = NULL;
+    char *tmp = NULL;
+    FILE *fp = NULL;
+
+    if (job_errors == NULL) {
+        return;
+    }
+
+    fflush(stderr);
+    rewind(job_errors);
+    fp = fdopen(job_stderr, "w");
+
+    while (getline(&line, &n, job_errors) != -1) {
+        if (fp != NULL) {
+            fputs(line, fp);
+        }
+
+        /* the "*** " lines are the errors, leave out the usage hints */
+        if (job_sent || !strprefix(line, "*** ") || strprefix(line, "*** See ")) {
+            continue;
+        }
+
+        line[strcspn(line, "\n")] = '\0';
+
+        if (msg == NULL) {
+            msg = strdup(line + 4);
+            assert(msg != NULL);
+        } else {
+            xasprintf(&tmp, "%s\n%s", msg, line + 4);
+            free(msg);
+            msg = tmp;
+        }
+    }
+
+    free(line);
+    fclose(job_errors);
+    job_errors = NULL;
+
+    if (fp != NULL) {
+        fclose(fp);
+    }
+
+    if (!job_sent) {
+        fflush(stdout);
+        send_error(dup(STDOUT_FILENO), (msg != NULL) ? msg : _("the job failed, see the server log"));
+    }
+
+    free(msg);
+    return;
+}
+
+/*
+ * In a new job process, read the request and send stdout to the
+ * client.  Only returns if the job is to be run.
+ */
+static void start_job(const int lfd, const int client, serve_job_t *job, const sigset_t *mask)
+{
+    struct sigaction sa;
+    char *request = NULL;
+    char *error = NULL;
+
+    /* the job waits for its own commands, nothing is reaped for it */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_DFL;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGCHLD, &sa, NULL);
+    sigprocmask(SIG_SETMASK, mask, NULL);
+    close(lfd);
+
+    if ((request = read_request(client)) == NULL) {
+        send_error(client, _("request could not be read or is too large"));
+        exit(RI_PROGRAM_ERROR);
+    }
+
+    if (!parse_serve_job(request, job, &error)) {
+        send_error(client, error);
+        exit(RI_PROGRAM_ERROR);
+    }
+
+    free(request);
+
+    /* the results go back over the connection */
+    if (dup2(client, STDOUT_FILENO) == -1) {
+        send_error(client, strerror(errno));
+        exit(RI_PROGRAM_ERROR);
+    }
+
+    close(client);
+
+    /* so do the errors if the job fails, see end_job() */
+    job_stderr = dup(STDERR_FILENO);
+    job_errors = tmpfile();
+
+    if (job_stderr != -1 && job_errors != NULL && dup2(fileno(job_errors), STDERR_FILENO) != -1) {
+        atexit(end_job);
+    } else if (job_errors != NULL) {
+        fclose(job_errors);
+        job_errors = NULL;
+    }
+
+    return;
+}
+
+/**
+ * @brief Finish sending the results of a job.
+ *
+ * Call in a job process once the results have been written to
+ * stdout.  The client gets the end of the response right away rather
+ * than after the working directory is removed.
+ */
+void finish_serve_job(void)
+{
+    fflush(stdout);
+    shutdown(STDOUT_FILENO, SHUT_WR);
+    job_sent = true;
+    return;
+}
+
+/**
+ * @brief Run as a server, taking comparison jobs from a Unix socket.
+ *
+ * Returns in the server process when it is stopped by SIGTERM or
+ * SIGINT, after the running jobs have finished.  Also returns in the
+ * process of each job, which must then run the job and exit.  The job
+ * process has stdout connected to the client.
+ *
+ * @param ri The main program data structure, with the configuration
+ *        read.
+ * @param path Path of the socket to listen on.  A socket already
+ *        there is replaced.
+ * @param job Where to store the job in a job process.
+ * @return 1 in a job process, 0 when the server stops, -1 if the
+ *         server could not be started.
+ */
+int serve(const struct rpminspect *ri, const char *path, serve_job_t *job)
+{
+    struct sigaction sa;
+    struct sockaddr_un addr;
+    struct stat sb;
+    sigset_t chld;
+    sigset_t mask;
+    mode_t mode = 0;
+    long max_jobs = 0;
+    int lfd = -1;
+    int client = -1;
+    pid_t pid = 0;
+
+    assert(ri != NULL);
+    assert(path != NULL);
+    assert(job != NULL);
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, _("*** Socket path is too long: %s\n"), path);
+        fflush(stderr);
+        return -1;
+    }
+
+    /* load what the jobs would each load, they inherit it */
+    if (init_librpm() != RPMRC_OK) {
+        fprintf(stderr, _("*** unable to read RPM configuration\n"));
+        fflush(stderr);
+        return -1;
+    }
+
+    load_licensedb(ri);
+    init_elf_data();
+    (void) init_magic();
+    xmlInitParser();
+
+    /* a socket left by an earlier server is replaced, anything else is not */
+    if (lstat(path, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+        (void) unlink(path);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* only the user running the server may connect */
+    mode = umask(S_IRWXG | S_IRWXO | S_IXUSR);
+
+    if ((lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1 ||
+        bind(lfd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+        listen(lfd, SOMAXCONN) == -1) {
+        fprintf(stderr, _("*** Unable to listen on %s: %s\n"), path, strerror(errno));
+        fflush(stderr);
+        umask(mode);
+
+        if (lfd != -1) {
+            close(lfd);
+        }
+
+        return -1;
+    }
+
+    umask(mode);
+
+    /* no SA_RESTART, so a signal wakes up accept() */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_server;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    /* finished jobs are reaped right away, accept() carries on */
+    sa.sa_handler = reap_jobs;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+
+    max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (max_jobs < 1) {
+        max_jobs = 1;
+    }
+
+    if (ri->verbose) {
+        printf(_("Listening on %s, running up to %ld jobs at a time\n"), path, max_jobs);
+    }
+
+    while (!stopping) {
+        /* wait for a job to finish if every slot is busy */
+        sigprocmask(SIG_BLOCK, &chld, &mask);
+
+        while (running >= max_jobs && !stopping) {
+            sigsuspend(&mask);
+        }
+
+        sigprocmask(SIG_SETMASK, &mask, NULL);
+
+        if (stopping) {
+            break;
+        }
+
+        if ((client = accept4(lfd, NULL, NULL, SOCK_CLOEXEC)) == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+
+            fprintf(stderr, _("*** Unable to accept a connection on %s: %s\n"), path, strerror(errno));
+            fflush(stderr);
+            break;
+        }
+
+        /* nothing buffered may be written twice */
+        fflush(stdout);
+        fflush(stderr);
+
+        /* count the job before it can be reaped */
+        sigprocmask(SIG_BLOCK, &chld, &mask);
+        pid = fork();
+
+        if (pid == 0) {
+            start_job(lfd, client, job, &mask);
+            return 1;
+        } else if (pid == -1) {
+            send_error(client, strerror(errno));
+        } else {
+            DEBUG_PRINT("started job %d\n", (int) pid);
+            running++;
+            close(client);
+        }
+
+        sigprocmask(SIG_SETMASK, &mask, NULL);
+    }
+
+    close(lfd);
+    (void) unlink(path);
+
+    /* let the running jobs finish */
+    sigprocmask(SIG_BLOCK, &chld, &mask);
+
+    while (running > 0) {
+        sigsuspend(&mask);
+    }
+
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    return 0;
+}
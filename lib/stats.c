@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "rpminspect.h"
+
+/**
+ * @file stats.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Resource use of each phase of a run.
+ *
+ * With --stats, every phase of a run (Koji hub calls, downloads,
+ * extraction, peer matching, each inspection, output, and teardown)
+ * is wrapped in start_stats() and end_stats().  The difference in
+ * wall time, CPU time, peak RSS, files visited, commands run, and
+ * bytes read between the two calls is added to the entry for the
+ * phase in ri->stats.  Phases are only timed on the main thread, but
+ * the CPU time and bytes read include every thread of the process.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/* Counters the rest of the library bumps, from any thread */
+static uint64_t files_visited = 0;
+static uint64_t commands_run = 0;
+
+/**
+ * @brief Count a file passed to a per-file inspection callback.
+ */
+void count_file_visit(void)
+{
+    __atomic_add_fetch(&files_visited, 1, __ATOMIC_RELAXED);
+    return;
+}
+
+/**
+ * @brief Count a command started by the library.
+ */
+void count_subprocess(void)
+{
+    __atomic_add_fetch(&commands_run, 1, __ATOMIC_RELAXED);
+    return;
+}
+
+/*
+ * Bytes the process has read, from the rchar line of /proc/self/io.
+ * This includes reads served from the page cache.  Returns 0 where
+ * that file is not available.
+ */
+static uint64_t get_bytes_read(void)
+{
+    FILE *fp = NULL;
+    char line[BUFSIZ];
+    unsigned long long n = 0;
+
+    fp = fopen("/proc/self/io", "r");
+
+    if (fp == NULL) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "rchar: %llu", &n) == 1) {
+            break;
+        }
+    }
+
+    fclose(fp);
+    return n;
+}
+
+static double tv_seconds(const struct timeval *tv)
+{
+    return tv->tv_sec + (tv->tv_usec / 1000000.0);
+}
+
+static void take_mark(stats_mark_t *mark)
+{
+    struct rusage self;
+    struct rusage children;
+
+    assert(mark != NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &mark->wall);
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    mark->cpu = tv_seconds(&self.ru_utime) + tv_seconds(&self.ru_stime) +
+                tv_seconds(&children.ru_utime) + tv_seconds(&children.ru_stime);
+    mark->maxrss = self.ru_maxrss;
+    mark->files = __atomic_load_n(&files_visited, __ATOMIC_RELAXED);
+    mark->subprocesses = __atomic_load_n(&commands_run, __ATOMIC_RELAXED);
+    mark->bytes_read = get_bytes_read();
+    return;
+}
+
+/**
+ * @brief Start collecting for a phase.
+ *
+ * Does nothing unless --stats was given.
+ *
+ * @param ri The main program data structure.
+ * @param mark Where to keep the counters until end_stats().
+ */
+void start_stats(const struct rpminspect *ri, stats_mark_t *mark)
+{
+    assert(ri != NULL);
+    assert(mark != NULL);
+
+    if (ri->stats == NULL) {
+        return;
+    }
+
+    take_mark(mark);
+    return;
+}
+
+/**
+ * @brief Add the resources used since start_stats() to a phase.
+ *
+ * @param ri The main program data structure.
+ * @param mark Counters from start_stats().
+ * @param kind STATS_PHASE or STATS_INSPECTION.
+ * @param name Name of the phase or inspection.
+ */
+void end_stats(const struct rpminspect *ri, const stats_mark_t *mark, const stats_kind_t kind, const char *name)
+{
+    stats_mark_t now;
+    stats_entry_t *entry = NULL;
+
+    assert(ri != NULL);
+    assert(mark != NULL);
+    assert(name != NULL);
+
+    if (ri->stats == NULL) {
+        return;
+    }
+
+    take_mark(&now);
+
+    TAILQ_FOREACH(entry, ri->stats, items) {
+        if (entry->kind == kind && !strcmp(entry->name, name)) {
+            break;
+        }
+    }
+
+    if (entry == NULL) {
+        entry = calloc(1, sizeof(*entry));
+        assert(entry != NULL);
+        entry->name = strdup(name);
+        assert(entry->name != NULL);
+        entry->kind = kind;
+        TAILQ_INSERT_TAIL(ri->stats, entry, items);
+    }
+
+    entry->count++;
+    entry->wall += (now.wall.tv_sec - mark->wall.tv_sec) + ((now.wall.tv_nsec - mark->wall.tv_nsec) / 1000000000.0);
+    entry->cpu += now.cpu - mark->cpu;
+    entry->maxrss += now.maxrss - mark->maxrss;
+    entry->files += now.files - mark->files;
+    entry->subprocesses += now.subprocesses - mark->subprocesses;
+    entry->bytes_read += now.bytes_read - mark->bytes_read;
+    return;
+}
+
+/**
+ * @brief Allocate an empty stats_t.
+ *
+ * @return Newly allocated stats_t, free it with free_stats().
+ */
+stats_t *init_stats(void)
+{
+    stats_t *stats = NULL;
+
+    stats = calloc(1, sizeof(*stats));
+    assert(stats != NULL);
+    TAILQ_INIT(stats);
+    return stats;
+}
+
+/**
+ * @brief Free a stats_t.
+ *
+ * @param stats The stats_t to free (may be NULL).
+ */
+void free_stats(stats_t *stats)
+{
+    stats_entry_t *entry = NULL;
+
+    if (stats == NULL) {
+        return;
+    }
+
+    while (!TAILQ_EMPTY(stats)) {
+        entry = TAILQ_FIRST(stats);
+        TAILQ_REMOVE(stats, entry, items);
+        free(entry->name);
+        free(entry);
+    }
+
+    free(stats);
+    return;
+}
+
+/**
+ * @brief Write a stats_t as a table.
+ *
+ * Phases are listed first, then inspections, each in the order they
+ * first ran.
+ *
+ * @param stats The stats_t to write.
+ * @param fp Stream to write to.
+ */
+void print_stats(const stats_t *stats, FILE *fp)
+{
+    stats_entry_t *entry = NULL;
+    int width = strlen(_("Phase"));
+    int kind = 0;
+
+    assert(stats != NULL);
+    assert(fp != NULL);
+
+    TAILQ_FOREACH(entry, stats, items) {
+        if ((int) strlen(entry->name) > width) {
+            width = strlen(entry->name);
+        }
+    }
+
+    fprintf(fp, "%-*s %10s %10s %10s %8s %8s %12s\n", width, _("Phase"),
+            _("Wall (s)"), _("CPU (s)"), _("RSS +KB"), _("Files"), _("Cmds"), _("Read (KB)"));
+
+    for (kind = STATS_PHASE; kind <= STATS_INSPECTION; kind++) {
+        TAILQ_FOREACH(entry, stats, items) {
+            if ((int) entry->kind != kind) {
+                continue;
+            }
+
+            fprintf(fp, "%-*s %10.3f %10.3f %10ld %8" PRIu64 " %8" PRIu64 " %12" PRIu64 "\n",
+                    width, entry->name, entry->wall, entry->cpu, entry->maxrss,
+                    entry->files, entry->subprocesses, entry->bytes_read / 1024);
+        }
+    }
+
+    return;
+}
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <rpm/rpmlib.h>
+#include <rpm/rpmts.h>
+#include "rpminspect.h"
+
+/**
+ * @file stream.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Read and extract RPMs while they are downloading.
+ *
+ * An rpm_stream_t is a download_sink_t for a download entry.  The
+ * data libcurl receives is written to a pipe.  A reader thread on the
+ * other end of the pipe reads the RPM header with librpm and then
+ * hands the same descriptor to libarchive, which extracts the payload
+ * as it arrives.  The RPM only lands on disk if the entry's keep_dst
+ * is set.
+ *
+ * All downloads run on one thread, so the write end of the pipe is
+ * non-blocking.  When the pipe is full because the reader is busy,
+ * what it did not take of the current block is kept in the stream
+ * and the transfer is paused until the reader catches up.  Other
+ * transfers carry on in the meantime.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/*
+ * Release any results held by a stream and remove the partially
+ * extracted tree, if there is one.
+ */
+static void discard_stream(rpm_stream_t *stream)
+{
+    assert(stream != NULL);
+
+    free_files(stream->files);
+    stream->files = NULL;
+    free_header_columns(stream->cols);
+    stream->cols = NULL;
+    free_arena(stream->arena);
+    stream->arena = NULL;
+
+    if (stream->root != NULL) {
+        (void) rmtree(stream->root, true, false);
+        free(stream->root);
+        stream->root = NULL;
+    }
+
+    if (stream->hdr != NULL) {
+        headerFree(stream->hdr);
+        stream->hdr = NULL;
+    }
+
+    return;
+}
+
+/*
+ * Reader thread.  Parse the header, extract the payload if the
+ * package is for an architecture we are inspecting, then drain the
+ * pipe so the writer never blocks on a reader that has stopped.
+ */
+static void *stream_reader(void *arg)
+{
+    rpm_stream_t *stream = arg;
+    FD_t fd = NULL;
+    rpmRC result;
+    char buf[BUFSIZ];
+    ssize_t n = 0;
+
+    assert(stream != NULL);
+
+    fd = fdDup(stream->fds[0]);
+
+    if (fd == NULL || Ferror(fd)) {
+        fprintf(stderr, _("*** fdDup() failed for %s\n"), stream->pkg);
+        fflush(stderr);
+    } else {
+        result = rpmReadPackageFile(stream->ts, fd, stream->pkg, &stream->hdr);
+
+        if (result != RPMRC_OK) {
+            stream->hdr = NULL;
+        } else if (allowed_arch(stream->ri, get_rpm_header_arch(stream->hdr))) {
+            /* the pipe is now positioned at the start of the payload */
+            stream->arena = init_arena();
+            stream->cols = init_header_columns(stream->hdr);
+            stream->files = extract_rpm_fd(stream->ri, stream->pkg, stream->hdr, stream->cols, stream->fds[0], &stream->root, stream->arena);
+        }
+    }
+
+    while ((n = read(stream->fds[0], buf, sizeof(buf))) != 0) {
+        if (n == -1 && errno != EINTR) {
+            break;
+        }
+    }
+
+    if (fd != NULL) {
+        Fclose(fd);
+    }
+
+    close(stream->fds[0]);
+    return NULL;
+}
+
+/*
+ * download_sink_t start: set up the pipe and start the reader.  Any
+ * result from an earlier attempt is thrown away.
+ */
+static bool stream_start(download_entry_t *entry)
+{
+    rpm_stream_t *stream = NULL;
+    int r = 0;
+
+    assert(entry != NULL);
+    stream = entry->sink_data;
+    assert(stream != NULL);
+    assert(!stream->running);
+
+    discard_stream(stream);
+    stream->pkg = entry->dst;
+    stream->npending = 0;
+
+    if (pipe2(stream->fds, O_CLOEXEC) == -1) {
+        fprintf(stderr, _("*** unable to create pipe for %s: %s\n"), entry->dst, strerror(errno));
+        fflush(stderr);
+        return false;
+    }
+
+    /* only the write end, the reader blocks until there is data */
+    if (fcntl(stream->fds[1], F_SETFL, O_NONBLOCK) == -1) {
+        fprintf(stderr, _("*** unable to create pipe for %s: %s\n"), entry->dst, strerror(errno));
+        fflush(stderr);
+        close(stream->fds[0]);
+        close(stream->fds[1]);
+        return false;
+    }
+
+    stream->ts = rpmtsCreate();
+    rpmtsSetVSFlags(stream->ts, _RPMVSF_NODIGESTS | _RPMVSF_NOSIGNATURES);
+
+    r = pthread_create(&stream->thread, NULL, stream_reader, stream);
+
+    if (r != 0) {
+        fprintf(stderr, _("*** unable to start reader thread for %s: %s\n"), entry->dst, strerror(r));
+        fflush(stderr);
+        close(stream->fds[0]);
+        close(stream->fds[1]);
+        rpmtsFree(stream->ts);
+        stream->ts = NULL;
+        return false;
+    }
+
+    stream->running = true;
+    return true;
+}
+
+/*
+ * Write as much of data to the pipe as it takes without blocking.
+ * Returns the number of bytes written or -1 on error.
+ */
+static ssize_t write_some(const int fd, const char *data, const size_t len)
+{
+    size_t done = 0;
+    ssize_t n = 0;
+
+    while (done < len) {
+        n = write(fd, data + done, len - done);
+
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            return -1;
+        }
+
+        done += n;
+    }
+
+    return done;
+}
+
+/*
+ * download_sink_t write: feed received data to the reader.  Whatever
+ * is left from the last block goes first.  If the pipe takes none of
+ * the new block, the transfer is paused and the block comes back
+ * later.  If it takes part of it, the rest is kept for next time.
+ */
+static sink_result_t stream_write(download_entry_t *entry, const char *data, size_t len)
+{
+    rpm_stream_t *stream = NULL;
+    ssize_t n = 0;
+
+    assert(entry != NULL);
+    stream = entry->sink_data;
+    assert(stream != NULL);
+
+    if (stream->npending > 0) {
+        if ((n = write_some(stream->fds[1], stream->pending, stream->npending)) == -1) {
+            return SINK_ERROR;
+        }
+
+        stream->npending -= n;
+        memmove(stream->pending, stream->pending + n, stream->npending);
+
+        if (stream->npending > 0) {
+            return SINK_BLOCKED;
+        }
+    }
+
+    if ((n = write_some(stream->fds[1], data, len)) == -1) {
+        return SINK_ERROR;
+    } else if (n == 0 && len > 0) {
+        return SINK_BLOCKED;
+    }
+
+    if ((size_t) n < len) {
+        stream->npending = len - n;
+        stream->pending = realloc(stream->pending, stream->npending);
+        assert(stream->pending != NULL);
+        memcpy(stream->pending, data + n, stream->npending);
+    }
+
+    return SINK_OK;
+}
+
+/*
+ * download_sink_t wait_fd: a paused transfer resumes once the reader
+ * has made room in the pipe.
+ */
+static int stream_wait_fd(download_entry_t *entry)
+{
+    rpm_stream_t *stream = NULL;
+
+    assert(entry != NULL);
+    stream = entry->sink_data;
+    assert(stream != NULL);
+
+    return stream->fds[1];
+}
+
+/*
+ * download_sink_t finish: close the pipe, wait for the reader, and
+ * report whether the package header could be read.
+ */
+static bool stream_finish(download_entry_t *entry, bool ok)
+{
+    rpm_stream_t *stream = NULL;
+
+    assert(entry != NULL);
+    stream = entry->sink_data;
+    assert(stream != NULL);
+
+    if (!stream->running) {
+        return false;
+    }
+
+    /* the reader gets the rest of a finished download, waiting is fine now */
+    if (ok && stream->npending > 0) {
+        if (fcntl(stream->fds[1], F_SETFL, 0) == -1 || write_some(stream->fds[1], stream->pending, stream->npending) != (ssize_t) stream->npending) {
+            ok = false;
+        }
+    }
+
+    stream->npending = 0;
+    close(stream->fds[1]);
+    pthread_join(stream->thread, NULL);
+    rpmtsFree(stream->ts);
+    stream->ts = NULL;
+    stream->running = false;
+
+    if (!ok || stream->hdr == NULL) {
+        discard_stream(stream);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * download_sink_t free.
+ */
+static void stream_free(void *data)
+{
+    free_rpm_stream(data);
+    return;
+}
+
+static const download_sink_t rpm_stream_sink = {
+    .start = stream_start,
+    .write = stream_write,
+    .wait_fd = stream_wait_fd,
+    .finish = stream_finish,
+    .free = stream_free,
+};
+
+/**
+ * @brief Read and extract a downloaded RPM as it arrives.
+ *
+ * Attach a new rpm_stream_t to a download queue entry.  Once the
+ * queue's done callback sees the entry as DOWNLOAD_DONE, the stream
+ * holds the package header and, if the package architecture is being
+ * inspected, the extracted payload.  The caller takes ownership of
+ * whichever of those it uses and sets the member to NULL.  The stream
+ * is freed with the queue.
+ *
+ * @param ri The main program data structure.
+ * @param entry The download queue entry for the RPM.
+ * @param keep True to also write the RPM to the entry's dst.
+ * @return The stream attached to entry.
+ */
+rpm_stream_t *stream_rpm_download(const struct rpminspect *ri, download_entry_t *entry, bool keep)
+{
+    rpm_stream_t *stream = NULL;
+
+    assert(ri != NULL);
+    assert(entry != NULL);
+
+    stream = calloc(1, sizeof(*stream));
+    assert(stream != NULL);
+    stream->ri = ri;
+    stream->fds[0] = -1;
+    stream->fds[1] = -1;
+
+    entry->sink = &rpm_stream_sink;
+    entry->sink_data = stream;
+    entry->keep_dst = keep;
+
+    return stream;
+}
+
+/**
+ * @brief Free an rpm_stream_t and any results it still holds.
+ *
+ * @param stream The stream to free (may be NULL).
+ */
+void free_rpm_stream(rpm_stream_t *stream)
+{
+    if (stream == NULL) {
+        return;
+    }
+
+    assert(!stream->running);
+    discard_stream(stream);
+    free(stream->pending);
+    free(stream);
+    return;
+}
@@ -415,6 +415,7 @@ char *strappend(char *first, const char *second)
  */
 string_list_t *strsplit(const char *s, const char *delim)
 {
+    char *copy = NULL;
     char *walk = NULL;
     char *token = NULL;
     string_list_t *list = NULL;
@@ -424,8 +425,8 @@ string_list_t *strsplit(const char *s, const char *delim)
         return NULL;
     }
 
-    walk = strdup(s);
-    assert(s != NULL);
+    copy = walk = strdup(s);
+    assert(walk != NULL);
 
     list = calloc(1, sizeof(*list));
     assert(list != NULL);
@@ -448,7 +449,8 @@ string_list_t *strsplit(const char *s, const char *delim)
         TAILQ_INSERT_TAIL(list, entry, items);
     }
 
-    free(walk);
+    /* strsep() moves walk to the end */
+    free(copy);
     return list;
 }
 
@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "rpminspect.h"
+
+/**
+ * @file trace.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Timeline of a run in the trace event format.
+ *
+ * With --trace=FILE, spans for downloads, payload extraction, peer
+ * matching, inspections, slow per-file callbacks, and external
+ * commands are written to FILE as trace event JSON, which can be
+ * loaded in chrome://tracing or Perfetto.  Each span is a complete
+ * ("X") event with the thread it ran on.
+ *
+ * Recording a span only copies it in to a ring buffer under a short
+ * lock.  A writer thread drains the ring to the file every second or
+ * when it is half full.  If the ring fills up faster than it can be
+ * written, spans are dropped and counted rather than blocking the
+ * thread that recorded them.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/* One recorded span */
+typedef struct _trace_event_t {
+    uint64_t ts;               /* start, microseconds since init_trace() */
+    uint64_t dur;              /* duration in microseconds */
+    pid_t tid;
+    const char *cat;           /* static string */
+    char *name;
+    char *detail;              /* may be NULL */
+} trace_event_t;
+
+static bool tracing = false;
+static FILE *trace_fp = NULL;
+static uint64_t epoch = 0;
+static uint64_t threshold = 0;
+static pid_t trace_pid = 0;
+
+/* The ring, head and tail only ever grow */
+static trace_event_t *ring = NULL;
+static uint64_t head = 0;
+static uint64_t tail = 0;
+static uint64_t dropped = 0;
+static bool stopping = false;
+static bool first_event = true;
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t writer;
+
+static __thread pid_t thread_id = 0;
+
+static uint64_t now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static pid_t get_tid(void)
+{
+    if (thread_id == 0) {
+        thread_id = syscall(SYS_gettid);
+    }
+
+    return thread_id;
+}
+
+/*
+ * Write s as a JSON string.
+ */
+static void write_string(FILE *fp, const char *s)
+{
+    const unsigned char *c = (const unsigned char *) s;
+
+    fputc('"', fp);
+
+    for (; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', fp);
+            fputc(*c, fp);
+        } else if (*c < 0x20) {
+            fprintf(fp, "\\u%04x", *c);
+        } else {
+            fputc(*c, fp);
+        }
+    }
+
+    fputc('"', fp);
+    return;
+}
+
+static void write_event(FILE *fp, const trace_event_t *event)
+{
+    if (!first_event) {
+        fputs(",\n", fp);
+    }
+
+    first_event = false;
+    fprintf(fp, "{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 ",\"cat\":",
+            (int) trace_pid, (int) event->tid, event->ts, event->dur);
+    write_string(fp, event->cat);
+    fputs(",\"name\":", fp);
+    write_string(fp, event->name);
+
+    if (event->detail != NULL) {
+        fputs(",\"args\":{\"detail\":", fp);
+        write_string(fp, event->detail);
+        fputc('}', fp);
+    }
+
+    fputc('}', fp);
+    return;
+}
+
+/*
+ * Writer thread.  Spans between tail and the head seen under the
+ * lock are not touched by recorders until tail moves past them, so
+ * they are written without holding the lock.
+ */
+static void *trace_writer(__attribute__((unused)) void *arg)
+{
+    struct timespec wait;
+    uint64_t end = 0;
+    uint64_t i = 0;
+    trace_event_t *event = NULL;
+    bool done = false;
+
+    while (!done) {
+        pthread_mutex_lock(&ring_lock);
+
+        if (head == tail && !stopping) {
+            clock_gettime(CLOCK_REALTIME, &wait);
+            wait.tv_sec += 1;
+            pthread_cond_timedwait(&ring_wake, &ring_lock, &wait);
+        }
+
+        end = head;
+        done = stopping;
+        pthread_mutex_unlock(&ring_lock);
+
+        for (i = tail; i < end; i++) {
+            event = &ring[i % TRACE_RING_SIZE];
+            write_event(trace_fp, event);
+            free(event->name);
+            free(event->detail);
+        }
+
+        pthread_mutex_lock(&ring_lock);
+        tail = end;
+        done = done && head == tail;
+        pthread_mutex_unlock(&ring_lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start writing a trace to a file.
+ *
+ * The trace is finished by finish_trace(), which is also registered
+ * with atexit() so a run that exits early still leaves a trace that
+ * can be loaded.
+ *
+ * @param path File to write the trace to.
+ * @param min_usec Per-file callbacks that take less than this many
+ *        microseconds are left out.
+ * @return True if tracing started, false if the file could not be
+ *         opened.
+ */
+bool init_trace(const char *path, const unsigned int min_usec)
+{
+    int r = 0;
+
+    assert(path != NULL);
+    assert(!tracing);
+
+    trace_fp = fopen(path, "w");
+
+    if (trace_fp == NULL) {
+        fprintf(stderr, _("*** Error opening %s for writing: %s\n"), path, strerror(errno));
+        fflush(stderr);
+        return false;
+    }
+
+    ring = calloc(TRACE_RING_SIZE, sizeof(*ring));
+    assert(ring != NULL);
+
+    epoch = now_usec();
+    threshold = min_usec;
+    trace_pid = getpid();
+
+    fprintf(trace_fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(trace_fp, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"%s\"}}",
+            (int) trace_pid, (int) get_tid(), SOFTWARE_NAME);
+    first_event = false;
+
+    r = pthread_create(&writer, NULL, trace_writer, NULL);
+
+    if (r != 0) {
+        fprintf(stderr, _("*** unable to start trace writer thread: %s\n"), strerror(r));
+        fflush(stderr);
+        fclose(trace_fp);
+        trace_fp = NULL;
+        free(ring);
+        ring = NULL;
+        return false;
+    }
+
+    __atomic_store_n(&tracing, true, __ATOMIC_RELEASE);
+    atexit(finish_trace);
+    return true;
+}
+
+/**
+ * @brief Write the remaining spans and close the trace file.
+ *
+ * Does nothing if no trace is being written.
+ */
+void finish_trace(void)
+{
+    if (!__atomic_exchange_n(&tracing, false, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+
+    pthread_mutex_lock(&ring_lock);
+    stopping = true;
+    pthread_cond_signal(&ring_wake);
+    pthread_mutex_unlock(&ring_lock);
+    pthread_join(writer, NULL);
+
+    fprintf(trace_fp, "\n],\n\"otherData\":{\"dropped\":%" PRIu64 "}}\n", dropped);
+
+    if (dropped > 0) {
+        fprintf(stderr, _("*** trace ring buffer full, %" PRIu64 " spans dropped\n"), dropped);
+        fflush(stderr);
+    }
+
+    fclose(trace_fp);
+    trace_fp = NULL;
+    free(ring);
+    ring = NULL;
+    return;
+}
+
+/**
+ * @brief Start timing a span.
+ *
+ * @return Start time to pass to trace_end(), 0 if no trace is being
+ *         written.
+ */
+uint64_t trace_start(void)
+{
+    if (!__atomic_load_n(&tracing, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    return now_usec();
+}
+
+/*
+ * Copy a span in to the ring.
+ */
+static void record(const uint64_t start, const uint64_t end, const char *cat, const char *name, const char *detail)
+{
+    trace_event_t *event = NULL;
+
+    pthread_mutex_lock(&ring_lock);
+
+    if (!__atomic_load_n(&tracing, __ATOMIC_ACQUIRE) || head - tail >= TRACE_RING_SIZE) {
+        dropped++;
+        pthread_mutex_unlock(&ring_lock);
+        return;
+    }
+
+    event = &ring[head % TRACE_RING_SIZE];
+    event->ts = start - epoch;
+    event->dur = end - start;
+    event->tid = get_tid();
+    event->cat = cat;
+    event->name = strdup(name);
+    event->detail = (detail == NULL) ? NULL : strdup(detail);
+    head++;
+
+    if (head - tail == TRACE_RING_SIZE / 2) {
+        pthread_cond_signal(&ring_wake);
+    }
+
+    pthread_mutex_unlock(&ring_lock);
+    return;
+}
+
+/**
+ * @brief Record a span that began at start and ends now.
+ *
+ * @param start Return value of trace_start(), nothing is recorded if
+ *        it is 0.
+ * @param cat Category of the span, must be a static string.
+ * @param name Name of the span.
+ * @param detail Shown as the detail argument of the span (may be
+ *        NULL).
+ */
+void trace_end(const uint64_t start, const char *cat, const char *name, const char *detail)
+{
+    assert(cat != NULL);
+    assert(name != NULL);
+
+    if (start == 0) {
+        return;
+    }
+
+    record(start, now_usec(), cat, name, detail);
+    return;
+}
+
+/**
+ * @brief Like trace_end(), but only if the span was slow.
+ *
+ * Used for per-file callbacks, which are too many to record them
+ * all.  The span is recorded if it took at least the trace_threshold
+ * setting.
+ */
+void trace_end_slow(const uint64_t start, const char *cat, const char *name, const char *detail)
+{
+    uint64_t end = 0;
+
+    if (start == 0) {
+        return;
+    }
+
+    end = now_usec();
+
+    if (end - start < threshold) {
+        return;
+    }
+
+    record(start, end, cat, name, detail);
+    return;
+}
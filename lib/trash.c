@@ -0,0 +1,540 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include "rpminspect.h"
+
+/**
+ * @file trash.c
+ * @author David Cantrell &lt;dcantrell@redhat.com&gt;
+ * @date 2020
+ * @brief Remove working directories without waiting on them.
+ *
+ * After a large build the working directory can hold millions of
+ * extracted files and removing it one file at a time takes minutes.
+ * trash_tree() renames the tree in to WORKDIR/.trash, which is
+ * atomic, and then removes it according to the teardown setting:
+ *
+ *     inline      remove it with rmtree() before returning
+ *     parallel    remove it on several threads, one subtree each
+ *     background  remove it in a detached process and return at once
+ *
+ * Each trash entry is a directory holding the tree.  The run that
+ * made the entry keeps a flock() on it until the tree is gone, and a
+ * background removal inherits that lock.  An entry nobody holds a
+ * lock on was left by a run that was interrupted, and empty_trash()
+ * hands those to a background removal.  Entries other runs are still
+ * removing are left alone.
+ *
+ * @copyright GPL-3.0-or-later
+ */
+
+/* Subtrees waiting for the rmtree_parallel() threads */
+typedef struct _trash_work_t {
+    char **paths;
+    size_t count;
+    size_t next;
+    unsigned int errors;
+    pthread_mutex_t lock;
+} trash_work_t;
+
+/*
+ * Remove name in the directory open as parent, descending in to it
+ * if it is a directory.  Only the *at() calls are used, so paths
+ * never grow.  Entries another process removed first are not errors.
+ */
+static int remove_at(int parent, const char *name, bool isdir)
+{
+    int fd = -1;
+    DIR *dir = NULL;
+    struct dirent *de = NULL;
+    int r = 0;
+
+    if (!isdir) {
+        if (unlinkat(parent, name, 0) == 0 || errno == ENOENT) {
+            return 0;
+        }
+
+        if (errno != EISDIR && errno != EPERM) {
+            return -1;
+        }
+    }
+
+    fd = openat(parent, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd == -1) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+
+    dir = fdopendir(fd);
+
+    if (dir == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) {
+            continue;
+        }
+
+        if (remove_at(dirfd(dir), de->d_name, de->d_type == DT_DIR) != 0) {
+            r = -1;
+        }
+    }
+
+    closedir(dir);
+
+    if (unlinkat(parent, name, AT_REMOVEDIR) == -1 && errno != ENOENT) {
+        r = -1;
+    }
+
+    return r;
+}
+
+/*
+ * Remove everything in the directory path, but not path itself.
+ */
+static int remove_contents(const char *path)
+{
+    DIR *dir = NULL;
+    struct dirent *de = NULL;
+    int r = 0;
+
+    dir = opendir(path);
+
+    if (dir == NULL) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) {
+            continue;
+        }
+
+        if (remove_at(dirfd(dir), de->d_name, de->d_type == DT_DIR) != 0) {
+            r = -1;
+        }
+    }
+
+    closedir(dir);
+    return r;
+}
+
+/*
+ * Collect the entries TRASH_SPLIT_DEPTH levels below path as work
+ * items.  Anything that is not a directory above that depth becomes
+ * an item too.  With the working directory layout the items are the
+ * extracted package trees.
+ */
+static void split_tree(trash_work_t *work, const char *path, const int depth)
+{
+    DIR *dir = NULL;
+    struct dirent *de = NULL;
+    char *sub = NULL;
+
+    dir = opendir(path);
+
+    if (dir == NULL) {
+        return;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) {
+            continue;
+        }
+
+        xasprintf(&sub, "%s/%s", path, de->d_name);
+
+        if (de->d_type == DT_DIR && depth < TRASH_SPLIT_DEPTH) {
+            split_tree(work, sub, depth + 1);
+            free(sub);
+        } else {
+            work->paths = reallocarray(work->paths, work->count + 1, sizeof(*work->paths));
+            assert(work->paths != NULL);
+            work->paths[work->count++] = sub;
+        }
+
+        sub = NULL;
+    }
+
+    closedir(dir);
+    return;
+}
+
+/*
+ * rmtree_parallel() thread main loop.
+ */
+static void *trash_worker(void *arg)
+{
+    trash_work_t *work = arg;
+    size_t i = 0;
+
+    assert(work != NULL);
+
+    while (1) {
+        pthread_mutex_lock(&work->lock);
+
+        if (work->next >= work->count) {
+            pthread_mutex_unlock(&work->lock);
+            break;
+        }
+
+        i = work->next++;
+        pthread_mutex_unlock(&work->lock);
+
+        if (remove_at(AT_FDCWD, work->paths[i], false) != 0) {
+            pthread_mutex_lock(&work->lock);
+            work->errors++;
+            pthread_mutex_unlock(&work->lock);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Remove a directory tree on several threads.
+ *
+ * The subtrees a few levels below path are removed in parallel, each
+ * one by a single thread, and then what is left of path.  Entries
+ * that disappear while the tree is removed are not errors.
+ *
+ * @param path Directory to remove.
+ * @param contentsonly True to keep path itself.
+ * @param nthreads Number of threads, 0 means one per online CPU.
+ * @return 0 on success, -1 if anything could not be removed.
+ */
+int rmtree_parallel(const char *path, const bool contentsonly, unsigned int nthreads)
+{
+    trash_work_t work;
+    pthread_t *threads = NULL;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    long ncpus = 0;
+    int r = 0;
+
+    if (path == NULL) {
+        return 0;
+    }
+
+    memset(&work, 0, sizeof(work));
+    pthread_mutex_init(&work.lock, NULL);
+    split_tree(&work, path, 1);
+
+    if (nthreads == 0) {
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (ncpus > 0) ? ncpus : 1;
+    }
+
+    if (nthreads > work.count) {
+        nthreads = work.count;
+    }
+
+    if (nthreads > 0) {
+        threads = calloc(nthreads, sizeof(*threads));
+        assert(threads != NULL);
+    }
+
+    for (i = 0; i < nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, trash_worker, &work) != 0) {
+            break;
+        }
+
+        started++;
+    }
+
+    /* no threads at all, do the work here */
+    if (started == 0) {
+        trash_worker(&work);
+    }
+
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    DEBUG_PRINT("removed %zu subtrees of %s on %u threads\n", work.count, path, started);
+
+    if (work.errors > 0) {
+        r = -1;
+    }
+
+    /* the directories above the subtrees */
+    if (contentsonly) {
+        if (remove_contents(path) != 0) {
+            r = -1;
+        }
+    } else if (remove_at(AT_FDCWD, path, true) != 0) {
+        r = -1;
+    }
+
+    for (i = 0; i < work.count; i++) {
+        free(work.paths[i]);
+    }
+
+    free(work.paths);
+    free(threads);
+    pthread_mutex_destroy(&work.lock);
+
+    return r;
+}
+
+/*
+ * Remove the count paths in a detached process.  The process is
+ * double forked so init reaps it and its standard streams go to
+ * /dev/null so nobody waits on them.  It inherits every open
+ * descriptor, so trash entry locks stay held until it is done.
+ */
+static int remove_in_background(const char * const *paths, const size_t count)
+{
+    pid_t pid;
+    int fd = -1;
+    int status = 0;
+    int r = 0;
+    size_t i = 0;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+
+    if (pid == -1) {
+        fprintf(stderr, _("*** unable to fork to remove %s: %s\n"), paths[0], strerror(errno));
+        fflush(stderr);
+        return -1;
+    } else if (pid == 0) {
+        if (setsid() == -1 || fork() != 0) {
+            _exit(0);
+        }
+
+        fd = open("/dev/null", O_RDWR);
+
+        if (fd != -1) {
+            dup2(fd, STDIN_FILENO);
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+
+            if (fd > STDERR_FILENO) {
+                close(fd);
+            }
+        }
+
+        for (i = 0; i < count; i++) {
+            if (remove_at(AT_FDCWD, paths[i], true) != 0) {
+                r = 1;
+            }
+        }
+
+        _exit(r);
+    }
+
+    if (waitpid(pid, &status, 0) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Remove path the way the teardown setting says.
+ */
+static int remove_tree(const struct rpminspect *ri, const char *path)
+{
+    if (ri->teardown == TEARDOWN_BACKGROUND) {
+        return remove_in_background(&path, 1);
+    } else if (ri->teardown == TEARDOWN_PARALLEL) {
+        return rmtree_parallel(path, false, 0);
+    }
+
+    return rmtree(path, true, false);
+}
+
+/*
+ * Open and lock a trash entry.  Returns the locked descriptor, or -1
+ * if the entry is gone, is not a directory, or another process holds
+ * the lock.
+ */
+static int lock_entry(const char *path)
+{
+    int fd = -1;
+
+    fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    while (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Move a directory tree to the trash and remove it.
+ *
+ * The tree is renamed in to a locked entry in the trash directory
+ * under ri->workdir and then removed according to ri->teardown.  If
+ * the rename fails, for example because path is on another file
+ * system, the tree is removed where it is.
+ *
+ * @param ri The main program data structure.
+ * @param path Directory tree to remove (may be NULL).
+ * @return 0 on success, non-zero on failure.
+ */
+int trash_tree(const struct rpminspect *ri, const char *path)
+{
+    char *trash = NULL;
+    char *entry = NULL;
+    char *target = NULL;
+    int lock = -1;
+    int r = 0;
+
+    assert(ri != NULL);
+
+    if (path == NULL) {
+        return 0;
+    }
+
+    if (ri->teardown == TEARDOWN_INLINE) {
+        return rmtree(path, true, false);
+    }
+
+    xasprintf(&trash, "%s/%s", ri->workdir, TRASH_DIR);
+    xasprintf(&entry, "%s/XXXXXX", trash);
+
+    if (mkdirp(trash, S_IRWXU) || mkdtemp(entry) == NULL) {
+        DEBUG_PRINT("unable to create a trash entry in %s: %s\n", trash, strerror(errno));
+    } else if ((lock = lock_entry(entry)) == -1) {
+        /* another run took it as abandoned */
+        (void) rmdir(entry);
+    } else {
+        xasprintf(&target, "%s/tree", entry);
+
+        if (rename(path, target) == -1) {
+            DEBUG_PRINT("unable to move %s to %s: %s\n", path, target, strerror(errno));
+            (void) rmdir(entry);
+            free(target);
+            target = NULL;
+        }
+    }
+
+    if (target == NULL) {
+        r = remove_tree(ri, path);
+    } else if (ri->teardown == TEARDOWN_BACKGROUND) {
+        r = remove_tree(ri, entry);
+    } else if ((r = remove_tree(ri, target)) == 0 && rmdir(entry) == -1) {
+        r = -1;
+    }
+
+    if (lock != -1) {
+        close(lock);
+    }
+
+    free(trash);
+    free(entry);
+    free(target);
+    return r;
+}
+
+/**
+ * @brief Remove whatever interrupted runs left in the trash.
+ *
+ * Only entries no process holds a lock on are taken, so trees other
+ * runs are still removing are left to them.  The abandoned entries
+ * are removed in a detached process and the run does not wait on
+ * them.  Errors are ignored.
+ *
+ * @param ri The main program data structure.
+ */
+void empty_trash(const struct rpminspect *ri)
+{
+    DIR *dir = NULL;
+    struct dirent *de = NULL;
+    char *trash = NULL;
+    char *path = NULL;
+    char **paths = NULL;
+    int *locks = NULL;
+    int fd = -1;
+    size_t count = 0;
+    size_t i = 0;
+
+    assert(ri != NULL);
+
+    xasprintf(&trash, "%s/%s", ri->workdir, TRASH_DIR);
+    dir = opendir(trash);
+
+    if (dir == NULL) {
+        free(trash);
+        return;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) {
+            continue;
+        }
+
+        xasprintf(&path, "%s/%s", trash, de->d_name);
+
+        if ((fd = lock_entry(path)) == -1) {
+            free(path);
+            continue;
+        }
+
+        paths = reallocarray(paths, count + 1, sizeof(*paths));
+        assert(paths != NULL);
+        locks = reallocarray(locks, count + 1, sizeof(*locks));
+        assert(locks != NULL);
+        paths[count] = path;
+        locks[count] = fd;
+        count++;
+    }
+
+    closedir(dir);
+
+    if (count > 0) {
+        DEBUG_PRINT("removing %zu abandoned entries from %s\n", count, trash);
+        (void) remove_in_background((const char * const *) paths, count);
+    }
+
+    for (i = 0; i < count; i++) {
+        close(locks[i]);
+        free(paths[i]);
+    }
+
+    free(paths);
+    free(locks);
+    free(trash);
+    return;
+}
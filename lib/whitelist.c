@@ -19,13 +19,33 @@
 #include <unistd.h>
 #include <limits.h>
 #include <sys/types.h>
-#include <pwd.h>
-#include <grp.h>
 #include <assert.h>
 #include <err.h>
 #include <errno.h>
 #include "rpminspect.h"
 
+/*
+ * Find the stat-whitelist entry for the given path, or NULL.
+ */
+static stat_whitelist_entry_t *get_stat_whitelist_entry(struct rpminspect *ri, const char *localpath)
+{
+    ENTRY e;
+    ENTRY *eptr = NULL;
+
+    if (!init_stat_whitelist(ri) || ri->stat_whitelist_table == NULL) {
+        return NULL;
+    }
+
+    e.key = (char *) localpath;
+    hsearch_r(e, FIND, &eptr, ri->stat_whitelist_table);
+
+    if (eptr == NULL) {
+        return NULL;
+    }
+
+    return eptr->data;
+}
+
 /**
  * @brief Check for the given path on the stat-whitelist.  If found,
  * check the st_mode value and report accordingly.
@@ -52,27 +72,23 @@ bool on_stat_whitelist_mode(struct rpminspect *ri, const rpmfile_entry_t *file,
     params.file = file->localpath;
     params.remedy = remedy;
 
-    if (init_stat_whitelist(ri)) {
-        TAILQ_FOREACH(wlentry, ri->stat_whitelist, items) {
-            if (!strcmp(file->localpath, wlentry->filename)) {
-                if (file->st.st_mode == wlentry->mode) {
-                    xasprintf(&params.msg, _("%s on %s carries mode %04o, but is on the stat whitelist"), file->localpath, params.arch, file->st.st_mode);
-                    params.severity = RESULT_INFO;
-                    params.waiverauth = WAIVABLE_BY_ANYONE;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                } else {
-                    xasprintf(&params.msg, _("%s on %s carries mode %04o, is on the stat whitelist but expected mode %04o"), file->localpath, params.arch, file->st.st_mode, wlentry->mode);
-                    params.severity = RESULT_VERIFY;
-                    params.waiverauth = WAIVABLE_BY_SECURITY;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                }
-
-                break;
-            }
+    wlentry = get_stat_whitelist_entry(ri, file->localpath);
+
+    if (wlentry) {
+        if (file->st.st_mode == wlentry->mode) {
+            xasprintf(&params.msg, _("%s on %s carries mode %04o, but is on the stat whitelist"), file->localpath, params.arch, file->st.st_mode);
+            params.severity = RESULT_INFO;
+            params.waiverauth = WAIVABLE_BY_ANYONE;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
+        } else {
+            xasprintf(&params.msg, _("%s on %s carries mode %04o, is on the stat whitelist but expected mode %04o"), file->localpath, params.arch, file->st.st_mode, wlentry->mode);
+            params.severity = RESULT_VERIFY;
+            params.waiverauth = WAIVABLE_BY_SECURITY;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
         }
     }
 
@@ -102,9 +118,7 @@ bool on_stat_whitelist_mode(struct rpminspect *ri, const rpmfile_entry_t *file,
  */
 bool on_stat_whitelist_owner(struct rpminspect *ri, const rpmfile_entry_t *file, const char *owner, const char *header, const char *remedy)
 {
-    struct passwd pw;
-    struct passwd *pwp = NULL;
-    char buf[sysconf(_SC_GETPW_R_SIZE_MAX)];
+    const id_cache_entry_t *uid = NULL;
     stat_whitelist_entry_t *wlentry = NULL;
     struct result_params params;
 
@@ -118,37 +132,33 @@ bool on_stat_whitelist_owner(struct rpminspect *ri, const rpmfile_entry_t *file,
     params.file = file->localpath;
     params.remedy = remedy;
 
-    if (init_stat_whitelist(ri)) {
-        TAILQ_FOREACH(wlentry, ri->stat_whitelist, items) {
-            if (!strcmp(file->localpath, wlentry->filename)) {
-                /* get the UID of the file on the whitelist */
-                getpwnam_r(wlentry->owner, &pw, buf, sizeof(buf), &pwp);
-
-                if (pwp && (file->st.st_uid == pw.pw_uid) && !strcmp(owner, wlentry->owner)) {
-                    xasprintf(&params.msg, _("%s on %s carries owner %s (UID %d) and is on the stat whitelist"), file->localpath, params.arch, wlentry->owner, file->st.st_uid);
-                    params.severity = RESULT_INFO;
-                    params.waiverauth = WAIVABLE_BY_ANYONE;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                } else if (pwp == NULL) {
-                    xasprintf(&params.msg, _("%s on %s carries owner %s (UID %d) and is on the stat whitelist, but the UID cannot be verified"), file->localpath, params.arch, wlentry->owner, file->st.st_uid);
-                    params.severity = RESULT_VERIFY;
-                    params.waiverauth = WAIVABLE_BY_ANYONE;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                } else {
-                    xasprintf(&params.msg, _("%s on %s carries owner %s (UID %d), but is on the stat whitelist with expected owner %s (UID %d)"), file->localpath, params.arch, owner, file->st.st_uid, wlentry->owner, pw.pw_uid);
-                    params.severity = RESULT_VERIFY;
-                    params.waiverauth = WAIVABLE_BY_SECURITY;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                }
-
-                break;
-            }
+    wlentry = get_stat_whitelist_entry(ri, file->localpath);
+
+    if (wlentry) {
+        /* get the UID of the file on the whitelist */
+        uid = get_owner_id(ri, wlentry->owner);
+
+        if (uid->found && (file->st.st_uid == uid->id) && !strcmp(owner, wlentry->owner)) {
+            xasprintf(&params.msg, _("%s on %s carries owner %s (UID %d) and is on the stat whitelist"), file->localpath, params.arch, wlentry->owner, file->st.st_uid);
+            params.severity = RESULT_INFO;
+            params.waiverauth = WAIVABLE_BY_ANYONE;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
+        } else if (!uid->found) {
+            xasprintf(&params.msg, _("%s on %s carries owner %s (UID %d) and is on the stat whitelist, but the UID cannot be verified"), file->localpath, params.arch, wlentry->owner, file->st.st_uid);
+            params.severity = RESULT_VERIFY;
+            params.waiverauth = WAIVABLE_BY_ANYONE;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
+        } else {
+            xasprintf(&params.msg, _("%s on %s carries owner %s (UID %d), but is on the stat whitelist with expected owner %s (UID %d)"), file->localpath, params.arch, owner, file->st.st_uid, wlentry->owner, uid->id);
+            params.severity = RESULT_VERIFY;
+            params.waiverauth = WAIVABLE_BY_SECURITY;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
         }
     }
 
@@ -169,9 +179,7 @@ bool on_stat_whitelist_owner(struct rpminspect *ri, const rpmfile_entry_t *file,
  */
 bool on_stat_whitelist_group(struct rpminspect *ri, const rpmfile_entry_t *file, const char *group, const char *header, const char *remedy)
 {
-    struct group gr;
-    struct group *grp = NULL;
-    char buf[sysconf(_SC_GETGR_R_SIZE_MAX)];
+    const id_cache_entry_t *gid = NULL;
     stat_whitelist_entry_t *wlentry = NULL;
     struct result_params params;
 
@@ -184,37 +192,33 @@ bool on_stat_whitelist_group(struct rpminspect *ri, const rpmfile_entry_t *file,
     params.file = file->localpath;
     params.remedy = remedy;
 
-    if (init_stat_whitelist(ri)) {
-        TAILQ_FOREACH(wlentry, ri->stat_whitelist, items) {
-            if (!strcmp(file->localpath, wlentry->filename)) {
-                /* get the GID of the file on the whitelist */
-                getgrnam_r(wlentry->group, &gr, buf, sizeof(buf), &grp);
-
-                if (grp && (file->st.st_gid == gr.gr_gid) && !strcmp(group, gr.gr_name)) {
-                    xasprintf(&params.msg, _("%s on %s carries group %s (GID %d) and is on the stat whitelist"), file->localpath, params.arch, wlentry->group, file->st.st_gid);
-                    params.severity = RESULT_INFO;
-                    params.waiverauth = WAIVABLE_BY_ANYONE;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                } else if (grp == NULL) {
-                    xasprintf(&params.msg, _("%s on %s carries group %s (GID %d) and is on the stat whitelist, but the GID cannot be verified"), file->localpath, params.arch, wlentry->group, file->st.st_gid);
-                    params.severity = RESULT_VERIFY;
-                    params.waiverauth = WAIVABLE_BY_ANYONE;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                } else {
-                    xasprintf(&params.msg, _("%s on %s carries group %s (GID %d), but is on the stat whitelist with expected group %s (GID %d)"), file->localpath, params.arch, group, file->st.st_gid, wlentry->group, gr.gr_gid);
-                    params.severity = RESULT_VERIFY;
-                    params.waiverauth = WAIVABLE_BY_SECURITY;
-                    add_result(ri, &params);
-                    free(params.msg);
-                    return true;
-                }
-
-                break;
-            }
+    wlentry = get_stat_whitelist_entry(ri, file->localpath);
+
+    if (wlentry) {
+        /* get the GID of the file on the whitelist */
+        gid = get_group_id(ri, wlentry->group);
+
+        if (gid->found && (file->st.st_gid == gid->id) && !strcmp(group, wlentry->group)) {
+            xasprintf(&params.msg, _("%s on %s carries group %s (GID %d) and is on the stat whitelist"), file->localpath, params.arch, wlentry->group, file->st.st_gid);
+            params.severity = RESULT_INFO;
+            params.waiverauth = WAIVABLE_BY_ANYONE;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
+        } else if (!gid->found) {
+            xasprintf(&params.msg, _("%s on %s carries group %s (GID %d) and is on the stat whitelist, but the GID cannot be verified"), file->localpath, params.arch, wlentry->group, file->st.st_gid);
+            params.severity = RESULT_VERIFY;
+            params.waiverauth = WAIVABLE_BY_ANYONE;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
+        } else {
+            xasprintf(&params.msg, _("%s on %s carries group %s (GID %d), but is on the stat whitelist with expected group %s (GID %d)"), file->localpath, params.arch, group, file->st.st_gid, wlentry->group, gid->id);
+            params.severity = RESULT_VERIFY;
+            params.waiverauth = WAIVABLE_BY_SECURITY;
+            add_result(ri, &params);
+            free(params.msg);
+            return true;
         }
     }
 
@@ -228,37 +232,30 @@ bool on_stat_whitelist_group(struct rpminspect *ri, const rpmfile_entry_t *file,
  */
 caps_filelist_entry_t *get_caps_whitelist_entry(struct rpminspect *ri, const char *pkg, const char *filepath)
 {
-    caps_whitelist_entry_t *wlentry = NULL;
     caps_filelist_entry_t *flentry = NULL;
+    char *key = NULL;
+    ENTRY e;
+    ENTRY *eptr = NULL;
 
     assert(ri != NULL);
     assert(pkg != NULL);
     assert(filepath != NULL);
 
-    if (init_caps_whitelist(ri)) {
-        /* Look for the package in the caps whitelist */
-        TAILQ_FOREACH(wlentry, ri->caps_whitelist, items) {
-            if (!strcmp(wlentry->pkg, pkg)) {
-                break;
-            }
-        }
-
-        if (wlentry == NULL) {
-            return NULL;
-        }
+    if (!init_caps_whitelist(ri) || ri->caps_whitelist_table == NULL) {
+        return NULL;
+    }
 
-        /* Look for this file's entry for that package */
-        TAILQ_FOREACH(flentry, wlentry->files, items) {
-            if (strsuffix(flentry->path, filepath)) {
-                break;
-            }
-        }
+    /* same key format as init_caps_whitelist() */
+    xasprintf(&key, "%s %s", pkg, filepath);
+    e.key = key;
+    hsearch_r(e, FIND, &eptr, ri->caps_whitelist_table);
+    free(key);
 
-        /* No entry, make sure to return NULL */
-        if (flentry == NULL) {
-            return NULL;
-        }
+    if (eptr == NULL) {
+        return NULL;
     }
 
+    flentry = eptr->data;
+
     return flentry;
 }
@@ -35,6 +35,16 @@
 /* Global librpminspect state */
 struct rpminspect ri;
 
+/* Long options that have no short option */
+enum {
+    OPT_TRACE = 256,
+    OPT_EVENTS,
+    OPT_FAIL_FAST,
+    OPT_ORDER,
+    OPT_ESTIMATE,
+    OPT_SERVE
+};
+
 void sigabrt_handler(__attribute__ ((unused)) int i)
 {
     rpmFreeRpmrc();
@@ -69,6 +79,29 @@ static void usage(const char *progname)
     printf(_("  -f, --fetch-only         Fetch builds only, do not perform inspections\n"));
     printf(_("                             (implies -k)\n"));
     printf(_("  -k, --keep               Do not remove the comparison working files\n"));
+    printf(_("  -K, --keep-rpms          Keep downloaded RPM files in the working\n"));
+    printf(_("                           directory (default: extract while downloading\n"));
+    printf(_("                           and do not write the RPM files)\n"));
+    printf(_("  -n, --no-copy            Read local RPM files in place rather than\n"));
+    printf(_("                           copying them to the working directory\n"));
+    printf(_("  -s, --stats              Report the time and resources used by each\n"));
+    printf(_("                           phase and inspection\n"));
+    printf(_("  --trace=FILE             Write a timeline of the run to FILE in the\n"));
+    printf(_("                           trace event format\n"));
+    printf(_("  --events=DEST            Write each result and inspection start and\n"));
+    printf(_("                           finish to DEST as JSON Lines while running\n"));
+    printf(_("                           (DEST is a file or fd:N)\n"));
+    printf(_("  --fail-fast              Stop at the first result at or above the\n"));
+    printf(_("                           failure threshold and skip the remaining\n"));
+    printf(_("                           inspections\n"));
+    printf(_("  --order=POLICY           Run the inspections in table order, most\n"));
+    printf(_("                           expensive first, or cheapest first\n"));
+    printf(_("                           (POLICY is table, expensive, or cheapest)\n"));
+    printf(_("  --estimate               Read only the package headers and report\n"));
+    printf(_("                           the time and disk space a run would take\n"));
+    printf(_("  --serve=SOCKET           Listen on the Unix socket SOCKET and run each\n"));
+    printf(_("                           comparison job sent to it, writing the\n"));
+    printf(_("                           results back as JSON\n"));
     printf(_("  -d, --debug              Debugging mode output\n"));
     printf(_("  -v, --verbose            Verbose inspection output\n"));
     printf(_("                           when finished, display full path\n"));
@@ -256,6 +289,30 @@ static char *get_product_release(const favor_release_t favor_release, const char
     return after_product;
 }
 
+/*
+ * Note in the results what --fail-fast did to an inspection.  These
+ * bypass add_result(), which drops results once the run is cancelled.
+ */
+static void add_failfast_result(struct rpminspect *ri, const char *msg, const char *inspection)
+{
+    struct result_params params;
+
+    assert(ri != NULL);
+    assert(msg != NULL);
+    assert(inspection != NULL);
+
+    init_result_params(&params);
+    params.severity = RESULT_INFO;
+    params.waiverauth = NOT_WAIVABLE;
+    params.header = HEADER_FAILFAST;
+    params.remedy = REMEDY_FAILFAST;
+    params.noun = (char *) inspection;
+    xasprintf(&params.msg, msg, inspection, strseverity(ri->threshold));
+    add_result_entry(&ri->results, &params);
+    free(params.msg);
+    return;
+}
+
 /*
  * Used to ensure the user only specifies the -T or -E option.
  */
@@ -296,9 +353,10 @@ int main(int argc, char **argv) {
     char *progname = basename(argv[0]);
     int c, i, j;
     int idx = 0;
+    int n = 0;
     int ret = RI_INSPECTION_SUCCESS;
     glob_t expand;
-    char *short_options = "c:p:T:E:a:r:o:F:lw:t:fkdv\?V";
+    char *short_options = "c:p:T:E:a:r:o:F:lw:t:fkKnsdv\?V";
     struct option long_options[] = {
         { "config", required_argument, 0, 'c' },
         { "profile", required_argument, 0, 'p' },
@@ -313,6 +371,15 @@ int main(int argc, char **argv) {
         { "threshold", required_argument, 0, 't' },
         { "fetch-only", no_argument, 0, 'f' },
         { "keep", no_argument, 0, 'k' },
+        { "keep-rpms", no_argument, 0, 'K' },
+        { "no-copy", no_argument, 0, 'n' },
+        { "stats", no_argument, 0, 's' },
+        { "trace", required_argument, 0, OPT_TRACE },
+        { "events", required_argument, 0, OPT_EVENTS },
+        { "fail-fast", no_argument, 0, OPT_FAIL_FAST },
+        { "order", required_argument, 0, OPT_ORDER },
+        { "estimate", no_argument, 0, OPT_ESTIMATE },
+        { "serve", required_argument, 0, OPT_SERVE },
         { "debug", no_argument, 0, 'd' },
         { "verbose", no_argument, 0, 'v' },
         { "help", no_argument, 0, '?' },
@@ -330,9 +397,20 @@ int main(int argc, char **argv) {
     char *output = NULL;
     char *release = NULL;
     char *threshold = NULL;
+    char *trace = NULL;
+    char *events = NULL;
+    char *serve_path = NULL;
+    serve_job_t job;
     int formatidx = -1;
     bool fetch_only = false;
     bool keep = false;
+    bool keep_rpms = false;
+    bool no_copy = false;
+    bool stats = false;
+    bool fail_fast = false;
+    bool order_opt = false;
+    order_policy_t order_policy = ORDER_TABLE;
+    bool estimate = false;
     bool list = false;
     bool verbose = false;
     int mode = S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
@@ -354,6 +432,10 @@ int main(int argc, char **argv) {
     size_t cmdlen = 0;
     char *tail = NULL;
     bool ires = false;
+    stats_mark_t mark;
+    uint64_t span = 0;
+
+    memset(&job, 0, sizeof(job));
 
     /* Be friendly to "rpminspect ... 2>&1 | tee" use case */
     setlinebuf(stdout);
@@ -453,6 +535,43 @@ int main(int argc, char **argv) {
             case 'k':
                 keep = true;
                 break;
+            case 'K':
+                keep_rpms = true;
+                break;
+            case 'n':
+                no_copy = true;
+                break;
+            case 's':
+                stats = true;
+                break;
+            case OPT_TRACE:
+                free(trace);
+                trace = strdup(optarg);
+                break;
+            case OPT_EVENTS:
+                free(events);
+                events = strdup(optarg);
+                break;
+            case OPT_FAIL_FAST:
+                fail_fast = true;
+                break;
+            case OPT_ORDER:
+                /* validate the specified inspection order */
+                if (!get_order_policy(optarg, &order_policy)) {
+                    fprintf(stderr, _("*** Invalid inspection order: `%s`.\n"), optarg);
+                    fflush(stderr);
+                    return RI_PROGRAM_ERROR;
+                }
+
+                order_opt = true;
+                break;
+            case OPT_ESTIMATE:
+                estimate = true;
+                break;
+            case OPT_SERVE:
+                free(serve_path);
+                serve_path = strdup(optarg);
+                break;
             case 'd':
                 set_debug_mode(true);
                 break;
@@ -540,6 +659,97 @@ int main(int argc, char **argv) {
 
     /* various options from the command line */
     ri.verbose = verbose;
+    ri.keep_rpms = keep_rpms;
+    ri.no_copy = no_copy;
+    ri.fail_fast = fail_fast;
+
+    if (fail_fast) {
+        enable_cancel();
+    }
+
+    if (order_opt) {
+        ri.order_policy = order_policy;
+    }
+
+    /* run jobs sent to a socket rather than the builds given here */
+    if (serve_path != NULL) {
+        if (fetch_only || keep || estimate || trace != NULL || events != NULL || optind < argc) {
+            fprintf(stderr, _("*** --serve cannot be used with -f, -k, --estimate, --trace, --events, or builds.\n"));
+            fprintf(stderr, _("*** See `%s --help` for more information.\n"), progname);
+            fflush(stderr);
+            free_rpminspect(&ri);
+            return RI_PROGRAM_ERROR;
+        }
+
+        j = serve(&ri, serve_path, &job);
+        free(serve_path);
+
+        if (j != 1) {
+            free_rpminspect(&ri);
+            rpmFreeRpmrc();
+            return (j == 0) ? RI_INSPECTION_SUCCESS : RI_PROGRAM_ERROR;
+        }
+
+        /* this is a job process, the request overrides the options */
+        if (job.tests != NULL || job.exclude != NULL) {
+            free(insoptarg);
+            insoptarg = strdup((job.tests != NULL) ? job.tests : job.exclude);
+            exclude = (job.exclude != NULL);
+            inspection_opt = true;
+        }
+
+        if (job.arches != NULL) {
+            free(archopt);
+            archopt = strdup(job.arches);
+        }
+
+        if (job.release != NULL) {
+            free(release);
+            release = strdup(job.release);
+        }
+
+        if (job.threshold != NULL) {
+            free(threshold);
+            threshold = strdup(job.threshold);
+        }
+
+        /* the results go back to the client as JSON and nothing else */
+        formatidx = FORMAT_JSON;
+        free(output);
+        output = NULL;
+        verbose = false;
+        ri.verbose = false;
+
+        argc = job.argc;
+        argv = job.argv;
+        optind = job.builds;
+    }
+
+    /* a calibration file is updated from the stats of normal runs */
+    if (stats || (ri.calibration != NULL && !fetch_only && !estimate)) {
+        ri.stats = init_stats();
+    }
+
+    if (trace != NULL) {
+        ires = init_trace(trace, ri.trace_threshold);
+        free(trace);
+
+        if (!ires) {
+            free_rpminspect(&ri);
+            return RI_PROGRAM_ERROR;
+        }
+    }
+
+    if (events != NULL) {
+        ires = init_events(events);
+        free(events);
+
+        if (!ires) {
+            free_rpminspect(&ri);
+            return RI_PROGRAM_ERROR;
+        }
+    }
+
     ri.product_release = release;
     ri.threshold = getseverity(threshold);
 
@@ -614,6 +824,16 @@ int main(int argc, char **argv) {
         return RI_PROGRAM_ERROR;
     }
 
+    if (fetch_only && estimate) {
+        fprintf(stderr, _("*** Fetch only mode cannot be used with --estimate.\n"));
+        fprintf(stderr, _("*** See `%s --help` for more information.\n"), progname);
+        fflush(stderr);
+        free_rpminspect(&ri);
+        return RI_PROGRAM_ERROR;
+    }
+
+    event_run_start(ri.before, ri.after);
+
     /* initialize librpm, we'll be using it */
     if (init_librpm() != RPMRC_OK) {
         fprintf(stderr, _("*** unable to read RPM configuration\n"));
@@ -677,6 +897,36 @@ int main(int argc, char **argv) {
         return RI_PROGRAM_ERROR;
     }
 
+    /* reclaim what interrupted runs left in the trash, without waiting */
+    if (!fetch_only) {
+        empty_trash(&ri);
+    }
+
+    /* only read the package headers and predict the run */
+    if (estimate) {
+        if (gather_headers(&ri)) {
+            fprintf(stderr, _("*** Failed to gather specified builds.\n"));
+            fflush(stderr);
+            rpmFreeRpmrc();
+            exit(RI_PROGRAM_ERROR);
+        }
+
+        if (!write_estimate(&ri, output, formatidx == FORMAT_JSON)) {
+            ret = RI_PROGRAM_ERROR;
+        }
+
+        if (ri.worksubdir != NULL && !keep && trash_tree(&ri, ri.worksubdir)) {
+            fprintf(stderr, _("*** Error removing directory %s: %s\n"), ri.worksubdir, strerror(errno));
+            fflush(stderr);
+        }
+
+        finish_trace();
+        finish_events();
+        free_rpminspect(&ri);
+        rpmFreeRpmrc();
+        return ret;
+    }
+
     /* validate and gather the builds specified */
     if (gather_builds(&ri, fetch_only)) {
         fprintf(stderr, _("*** Failed to gather specified builds.\n"));
@@ -739,7 +989,10 @@ int main(int argc, char **argv) {
             }
         }
 
-        for (i = 0; inspections[i].flag != 0; i++) {
+        /* order the inspections by cost if asked to */
+        schedule_inspections(&ri);
+
+        for (n = 0; (i = inspection_at(&ri, n)) != -1; n++) {
             /* test not selected by user */
             if (!(ri.tests & inspections[i].flag)) {
                 continue;
@@ -750,6 +1003,26 @@ int main(int argc, char **argv) {
                 continue;
             }
 
+            /* --fail-fast found a failing result, skip the rest */
+            if (run_cancelled()) {
+                add_failfast_result(&ri, _("The %s inspection was skipped after a result at or above the %s threshold."), inspections[i].name);
+                event_inspection_skipped(inspections[i].name);
+
+                if (verbose) {
+                    xasprintf(&r, _("Skipping %s inspection..."), inspections[i].name);
+                    assert(r != NULL);
+                    printf("%-36s%5s\n", r, _("skip"));
+                    free(r);
+                }
+
+                continue;
+            }
+
+            /* extract what the inspection reads if it was put off */
+            start_stats(&ri, &mark);
+            materialize_peers(&ri, n);
+            end_stats(&ri, &mark, STATS_PHASE, "extraction");
+
             if (verbose) {
                 xasprintf(&r, _("Running %s inspection..."), inspections[i].name);
                 assert(r != NULL);
@@ -757,11 +1030,21 @@ int main(int argc, char **argv) {
                 free(r);
             }
 
+            start_stats(&ri, &mark);
+            span = trace_start();
+            event_inspection_start(inspections[i].name);
             ires = inspections[i].driver(&ri);
+            event_inspection_finish(inspections[i].name, ires);
+            trace_end(span, "inspection", inspections[i].name, ires ? "pass" : "fail");
+            end_stats(&ri, &mark, STATS_INSPECTION, inspections[i].name);
 
             if (verbose) {
                 printf("%5s\n", ires ? _("pass") : _("FAIL"));
             }
+
+            if (run_cancelled()) {
+                add_failfast_result(&ri, _("The %s inspection reported a result at or above the %s threshold.  It was stopped there and the remaining inspections were skipped."), inspections[i].name);
+            }
         }
 
         /* output the results */
@@ -770,26 +1053,54 @@ int main(int argc, char **argv) {
         }
 
         if (ri.results != NULL) {
-            formats[formatidx].driver(ri.results, output);
+            start_stats(&ri, &mark);
+            formats[formatidx].driver(ri.results, output, stats ? ri.stats : NULL);
+            end_stats(&ri, &mark, STATS_PHASE, "output");
+        }
+
+        /* a --serve client has its results, do not make it wait for teardown */
+        if (job.argv != NULL) {
+            finish_serve_job();
         }
     }
 
+    /* learn from how long this run took, for --estimate */
+    if (!fetch_only && ret != RI_PROGRAM_ERROR) {
+        update_calibration(&ri);
+    }
+
     /* Set exit code based on result threshold */
     if (ri.worst_result >= ri.threshold) {
         ret = RI_INSPECTION_FAILURE;
     }
 
+    event_run_finish(ri.worst_result, ret);
+
     /* Clean up */
     if (keep) {
         printf(_("\nKeeping working directory: %s\n"), ri.worksubdir);
     } else {
-        if (rmtree(ri.workdir, true, true)) {
-           fprintf(stderr, _("*** Error removing directory %s: %s\n"), ri.workdir, strerror(errno));
+        start_stats(&ri, &mark);
+
+        if (trash_tree(&ri, ri.worksubdir)) {
+           fprintf(stderr, _("*** Error removing directory %s: %s\n"), ri.worksubdir, strerror(errno));
            fflush(stderr);
         }
+
+        end_stats(&ri, &mark, STATS_PHASE, "teardown");
+    }
+
+    /* the report was written before teardown, show the whole run */
+    if (stats) {
+        fprintf(stderr, "\n");
+        print_stats(ri.stats, stderr);
+        fflush(stderr);
     }
 
+    finish_trace();
+    finish_events();
     free_rpminspect(&ri);
+    free_serve_job(&job);
     rpmFreeRpmrc();
 
     return ret;
@@ -85,6 +85,7 @@ class RequiresRpminspect(unittest.TestCase):
 
         # settings that the inheriting test can override
         self.buildhost_subdomain = None
+        self.extract = None
 
     def dumpResults(self):
         # The earlier exception may have been on json.loads(), so
@@ -142,6 +143,9 @@ class RequiresRpminspect(unittest.TestCase):
             if hnd:
                 cfg['metadata']['buildhost_subdomain'].append(hnd)
 
+        if self.extract:
+            cfg['common']['extract'] = self.extract
+
         # write the temporary config file for the test suite
         outstream = open(self.conffile, "w")
         outstream.write(yaml.dump(cfg).replace('- ', '  - '))
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <CUnit/Basic.h>
+#include <rpm/rpmlib.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+#define PKG "cachetest-1.0-1.noarch.rpm"
+
+/*
+ * The tests use a small package built with rpmbuild and a cache
+ * directory in a temporary directory.  digest is the SIGMD5 of the
+ * package, which is what Koji reports as the payloadhash.
+ */
+static char *tmpdir = NULL;
+static char *pkg = NULL;
+static char *digest = NULL;
+static off_t pkgsize = 0;
+static struct rpminspect ri;
+
+static const char *spec =
+    "Name: cachetest\n"
+    "Version: 1.0\n"
+    "Release: 1\n"
+    "Summary: cache test package\n"
+    "License: GPLv3+\n"
+    "BuildArch: noarch\n"
+    "%description\n"
+    "cache test package\n"
+    "%install\n"
+    "mkdir -p %{buildroot}/usr/share/cachetest\n"
+    "seq 1 10000 > %{buildroot}/usr/share/cachetest/data\n"
+    "%files\n"
+    "/usr/share/cachetest/data\n";
+
+/* Path of the cache entry for the test package */
+static char *entry_path(void)
+{
+    char *path = NULL;
+
+    xasprintf(&path, "%s/%.2s/%s-%s", ri.cache_dir, digest, digest, PKG);
+    return path;
+}
+
+/* Write a copy of the test package with the last payload byte changed */
+static void write_corrupt(const char *path)
+{
+    FILE *fp = NULL;
+    char *data = NULL;
+
+    data = malloc(pkgsize);
+    assert(data != NULL);
+    fp = fopen(pkg, "r");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+    RI_ASSERT_EQUAL(fread(data, 1, pkgsize, fp), pkgsize);
+    fclose(fp);
+
+    data[pkgsize - 1] ^= 0xff;
+
+    unlink(path);
+    fp = fopen(path, "w");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+    RI_ASSERT_EQUAL(fwrite(data, 1, pkgsize, fp), pkgsize);
+    fclose(fp);
+    free(data);
+}
+
+/* Free the headers cache_fetch() added to the header cache */
+static void free_header_cache(void)
+{
+    header_cache_entry_t *hentry = NULL;
+
+    if (ri.header_cache == NULL) {
+        return;
+    }
+
+    while (!TAILQ_EMPTY(ri.header_cache)) {
+        hentry = TAILQ_FIRST(ri.header_cache);
+        TAILQ_REMOVE(ri.header_cache, hentry, items);
+        headerFree(hentry->hdr);
+        free(hentry->pkg);
+        free(hentry);
+    }
+
+    free(ri.header_cache);
+    ri.header_cache = NULL;
+}
+
+int init_test_cache(void) {
+    char *specfile = NULL;
+    char *define = NULL;
+    char *output = NULL;
+    FILE *fp = NULL;
+    Header h = NULL;
+    struct stat sb;
+    int exitcode = 0;
+
+    memset(&ri, 0, sizeof(ri));
+    tmpdir = strdup("/tmp/test-cache.XXXXXX");
+
+    if (mkdtemp(tmpdir) == NULL || init_librpm() != RPMRC_OK) {
+        return -1;
+    }
+
+    /* build the test package */
+    xasprintf(&specfile, "%s/cachetest.spec", tmpdir);
+
+    if ((fp = fopen(specfile, "w")) == NULL) {
+        free(specfile);
+        return -1;
+    }
+
+    fputs(spec, fp);
+    fclose(fp);
+
+    xasprintf(&define, "'_topdir %s'", tmpdir);
+    output = run_cmd(&exitcode, "rpmbuild", "--quiet", "--define", define, "-bb", specfile, NULL);
+    free(output);
+    free(define);
+    free(specfile);
+
+    xasprintf(&pkg, "%s/RPMS/noarch/%s", tmpdir, PKG);
+
+    if (exitcode != 0 || stat(pkg, &sb) == -1) {
+        return -1;
+    }
+
+    pkgsize = sb.st_size;
+
+    if ((h = get_rpm_header(&ri, pkg)) == NULL || (digest = headerGetAsString(h, RPMTAG_SIGMD5)) == NULL) {
+        return -1;
+    }
+
+    free_header_cache();
+    xasprintf(&ri.cache_dir, "%s/cache", tmpdir);
+    return 0;
+}
+
+int clean_test_cache(void) {
+    free_header_cache();
+
+    if (tmpdir != NULL) {
+        rmtree(tmpdir, true, false);
+        free(tmpdir);
+    }
+
+    free(ri.cache_dir);
+    free(pkg);
+    free(digest);
+    return 0;
+}
+
+void test_cache_store_fetch(void) {
+    char *path = entry_path();
+    char *dst = NULL;
+
+    /* an unknown package is not in the cache */
+    xasprintf(&dst, "%s/fetched.rpm", tmpdir);
+    RI_ASSERT_FALSE(cache_fetch(&ri, PKG, digest, pkgsize, dst));
+    RI_ASSERT_EQUAL(access(dst, F_OK), -1);
+
+    /* a package that matches its digest is stored */
+    cache_store(&ri, PKG, digest, pkg);
+    RI_ASSERT_EQUAL(access(path, F_OK), 0);
+
+    /* and fetched back with its header */
+    RI_ASSERT_TRUE(cache_fetch(&ri, PKG, digest, pkgsize, dst));
+    RI_ASSERT_EQUAL(access(dst, F_OK), 0);
+    RI_ASSERT_PTR_NOT_NULL(ri.header_cache);
+
+    /* the wrong digest is a miss */
+    unlink(dst);
+    RI_ASSERT_FALSE(cache_fetch(&ri, PKG, "0123456789abcdef0123456789abcdef", pkgsize, dst));
+    RI_ASSERT_EQUAL(access(dst, F_OK), -1);
+
+    /* digests end up in a path name */
+    RI_ASSERT_FALSE(cache_fetch(&ri, PKG, "../../etc", pkgsize, dst));
+
+    free_header_cache();
+    unlink(dst);
+    unlink(path);
+    free(path);
+    free(dst);
+}
+
+void test_cache_reject(void) {
+    char *path = entry_path();
+    char *bad = NULL;
+    char *dst = NULL;
+
+    xasprintf(&bad, "%s/corrupt.rpm", tmpdir);
+    xasprintf(&dst, "%s/fetched.rpm", tmpdir);
+    write_corrupt(bad);
+
+    /* a corrupted download is not stored */
+    cache_store(&ri, PKG, digest, bad);
+    RI_ASSERT_EQUAL(access(path, F_OK), -1);
+
+    /* a corrupted entry is rejected and removed */
+    write_corrupt(path);
+    RI_ASSERT_FALSE(cache_fetch(&ri, PKG, digest, pkgsize, dst));
+    RI_ASSERT_EQUAL(access(path, F_OK), -1);
+    RI_ASSERT_EQUAL(access(dst, F_OK), -1);
+
+    /* so is an entry with the wrong size */
+    cache_store(&ri, PKG, digest, pkg);
+    RI_ASSERT_EQUAL(access(path, F_OK), 0);
+    RI_ASSERT_FALSE(cache_fetch(&ri, PKG, digest, pkgsize + 1, dst));
+    RI_ASSERT_EQUAL(access(path, F_OK), -1);
+    RI_ASSERT_EQUAL(access(dst, F_OK), -1);
+
+    free_header_cache();
+    unlink(bad);
+    free(path);
+    free(bad);
+    free(dst);
+}
+
+void test_prune_cache(void) {
+    static const char *names[] = { "oldest", "older", "newer", "newest" };
+    struct timespec times[2];
+    char *dir = NULL;
+    char *path = NULL;
+    char data[1000];
+    FILE *fp = NULL;
+    time_t now = time(NULL);
+    int i = 0;
+
+    memset(data, 'x', sizeof(data));
+    xasprintf(&dir, "%s/ab", ri.cache_dir);
+    RI_ASSERT_EQUAL(mkdirp(dir, S_IRWXU), 0);
+
+    /* four 1000 byte entries, each an hour newer than the last */
+    for (i = 0; i < 4; i++) {
+        xasprintf(&path, "%s/ab%s.rpm", dir, names[i]);
+        fp = fopen(path, "w");
+        RI_ASSERT_PTR_NOT_NULL(fp);
+        RI_ASSERT_EQUAL(fwrite(data, 1, sizeof(data), fp), sizeof(data));
+        fclose(fp);
+
+        times[0].tv_sec = times[1].tv_sec = now - ((4 - i) * 3600);
+        times[0].tv_nsec = times[1].tv_nsec = 0;
+        RI_ASSERT_EQUAL(utimensat(AT_FDCWD, path, times, 0), 0);
+        free(path);
+    }
+
+    /* no limit, nothing is removed */
+    ri.cache_size = 0;
+    prune_cache(&ri);
+
+    for (i = 0; i < 4; i++) {
+        xasprintf(&path, "%s/ab%s.rpm", dir, names[i]);
+        RI_ASSERT_EQUAL(access(path, F_OK), 0);
+        free(path);
+    }
+
+    /* room for two and a half, the two oldest go */
+    ri.cache_size = 2500;
+    prune_cache(&ri);
+
+    for (i = 0; i < 4; i++) {
+        xasprintf(&path, "%s/ab%s.rpm", dir, names[i]);
+        RI_ASSERT_EQUAL(access(path, F_OK), (i < 2) ? -1 : 0);
+        free(path);
+    }
+
+    ri.cache_size = 0;
+    rmtree(dir, true, false);
+    free(dir);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("cache", init_test_cache, clean_test_cache);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test cache_store() and cache_fetch()", test_cache_store_fetch) == NULL ||
+        CU_add_test(pSuite, "test rejecting damaged cache entries", test_cache_reject) == NULL ||
+        CU_add_test(pSuite, "test prune_cache()", test_prune_cache) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
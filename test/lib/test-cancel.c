@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+int init_test_cancel(void) {
+    return 0;
+}
+
+int clean_test_cancel(void) {
+    return 0;
+}
+
+static void *run_sleep(void *arg)
+{
+    int *exitcode = arg;
+
+    /* the shell starts sleep as a child, the group is terminated */
+    free(run_cmd(exitcode, "sleep 30; echo", "done", NULL));
+    return NULL;
+}
+
+/*
+ * Cancellation is process wide, so this runs as a single test in
+ * the order the run would see it.
+ */
+void test_cancel_run(void) {
+    struct rpminspect ri;
+    struct result_params params;
+    pthread_t thread;
+    int exitcode = 0;
+    char *output = NULL;
+    time_t start = 0;
+
+    memset(&ri, 0, sizeof(ri));
+    ri.fail_fast = true;
+    ri.threshold = RESULT_VERIFY;
+
+    /* without this commands are not in their own process group */
+    RI_ASSERT_FALSE(cancel_enabled());
+    enable_cancel();
+    RI_ASSERT_TRUE(cancel_enabled());
+
+    /* commands run normally before the run is cancelled */
+    output = run_cmd(&exitcode, "echo", "hello", NULL);
+    RI_ASSERT_STRING_EQUAL(output, "hello");
+    RI_ASSERT_EQUAL(exitcode, 0);
+    free(output);
+
+    /* results below the threshold do not cancel the run */
+    init_result_params(&params);
+    params.severity = RESULT_INFO;
+    params.header = "test";
+    params.msg = "informational";
+    add_result(&ri, &params);
+    RI_ASSERT_FALSE(run_cancelled());
+
+    /* a command is running when the failing result comes in */
+    RI_ASSERT_EQUAL(pthread_create(&thread, NULL, run_sleep, &exitcode), 0);
+    sleep(1);
+    start = time(NULL);
+
+    params.severity = RESULT_VERIFY;
+    params.msg = "failing";
+    add_result(&ri, &params);
+    RI_ASSERT_TRUE(run_cancelled());
+    RI_ASSERT_EQUAL(ri.worst_result, RESULT_VERIFY);
+
+    pthread_join(thread, NULL);
+    RI_ASSERT_TRUE(time(NULL) - start < 10);
+    RI_ASSERT_TRUE(WIFSIGNALED(exitcode));
+
+    /* later results are dropped */
+    params.severity = RESULT_BAD;
+    params.msg = "after the cancel";
+    add_result(&ri, &params);
+    RI_ASSERT_EQUAL(ri.worst_result, RESULT_VERIFY);
+    RI_ASSERT_STRING_EQUAL(TAILQ_LAST(ri.results, results_s)->msg, "failing");
+
+    /* and no new commands are started */
+    exitcode = 0;
+    RI_ASSERT_PTR_NULL(run_cmd(&exitcode, "echo", "hello", NULL));
+    RI_ASSERT_EQUAL(exitcode, -1);
+
+    free_results(ri.results);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("cancel", init_test_cancel, clean_test_cancel);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test cancel_run()", test_cancel_run) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
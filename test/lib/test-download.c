@@ -0,0 +1,516 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+#include "test-httpd.h"
+
+#define NUM_FILES 12
+
+/*
+ * A small HTTP/1.1 server fixture.  Every connection is handled in its
+ * own process and kept alive until the client closes it.  Paths are
+ * served as follows:
+ *     /missing.rpm     404
+ *     /flaky/NAME      503 the first time, then the file
+ *     anything else    a generated file based on the path
+ */
+static int server_port = 0;
+static char *tmpdir = NULL;
+
+/* Generated file contents for a path, the test checks against this */
+static char *make_body(const char *path, size_t *len)
+{
+    char *body = NULL;
+    size_t plen = strlen(path);
+    size_t i;
+
+    *len = 4096 + (plen * 997);
+    body = malloc(*len);
+    assert(body != NULL);
+
+    for (i = 0; i < *len; i++) {
+        body[i] = path[i % plen];
+    }
+
+    return body;
+}
+
+static void send_response(int fd, const char *status, const char *body, size_t len)
+{
+    char *head = NULL;
+
+    xasprintf(&head, "HTTP/1.1 %s\r\nContent-Length: %zu\r\n\r\n", status, len);
+
+    if (write(fd, head, strlen(head)) == -1 || (len > 0 && write(fd, body, len) == -1)) {
+        _exit(EXIT_FAILURE);
+    }
+
+    free(head);
+    return;
+}
+
+static void serve_connection(int fd)
+{
+    char req[8192];
+    char path[1024];
+    char *marker = NULL;
+    char *body = NULL;
+    size_t have = 0;
+    size_t len = 0;
+    ssize_t n = 0;
+    char *end = NULL;
+    int mfd = -1;
+
+    while (1) {
+        /* read one request */
+        while ((end = memmem(req, have, "\r\n\r\n", 4)) == NULL) {
+            n = read(fd, req + have, sizeof(req) - have);
+
+            if (n <= 0) {
+                return;
+            }
+
+            have += n;
+        }
+
+        if (sscanf(req, "GET %1023s ", path) != 1) {
+            return;
+        }
+
+        /* drop the request from the buffer */
+        end += 4;
+        have -= (end - req);
+        memmove(req, end, have);
+
+        if (!strcmp(path, "/missing.rpm")) {
+            send_response(fd, "404 Not Found", NULL, 0);
+            continue;
+        }
+
+        if (strprefix(path, "/flaky/")) {
+            xasprintf(&marker, "%s/flaky-%s", tmpdir, path + 7);
+            mfd = open(marker, O_CREAT | O_EXCL | O_WRONLY, 0644);
+            free(marker);
+
+            if (mfd != -1) {
+                close(mfd);
+                send_response(fd, "503 Service Unavailable", NULL, 0);
+                continue;
+            }
+        }
+
+        body = make_body(path, &len);
+        send_response(fd, "200 OK", body, len);
+        free(body);
+    }
+}
+
+int init_test_download(void) {
+    tmpdir = strdup("/tmp/test-download.XXXXXX");
+
+    if (mkdtemp(tmpdir) == NULL) {
+        return -1;
+    }
+
+    return start_test_server(serve_connection, &server_port);
+}
+
+int clean_test_download(void) {
+    stop_test_server();
+
+    if (tmpdir != NULL) {
+        rmtree(tmpdir, true, false);
+        free(tmpdir);
+    }
+
+    return 0;
+}
+
+/* Returns true if dst holds the generated contents for path */
+static bool check_file(const char *dst, const char *path)
+{
+    FILE *fp = NULL;
+    char *body = NULL;
+    char *data = NULL;
+    size_t len = 0;
+    bool ret = false;
+
+    body = make_body(path, &len);
+    data = malloc(len + 1);
+    assert(data != NULL);
+
+    if ((fp = fopen(dst, "r")) != NULL) {
+        ret = (fread(data, 1, len + 1, fp) == len) && !memcmp(data, body, len);
+        fclose(fp);
+    }
+
+    free(data);
+    free(body);
+    return ret;
+}
+
+static download_queue_t *new_queue(const unsigned int concurrency, const unsigned int retries)
+{
+    struct rpminspect ri;
+
+    memset(&ri, 0, sizeof(ri));
+    ri.download_concurrency = concurrency;
+    ri.download_retries = retries;
+    return init_download_queue(&ri);
+}
+
+void test_download_queue(void) {
+    download_queue_t *queue = new_queue(4, 0);
+    download_entry_t *entry = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+    char *path = NULL;
+    int i = 0;
+
+    for (i = 0; i < NUM_FILES; i++) {
+        xasprintf(&src, "http://127.0.0.1:%d/pkg-%d.rpm", server_port, i);
+        xasprintf(&dst, "%s/pkg-%d.rpm", tmpdir, i);
+        add_download(queue, src, dst);
+        free(src);
+        free(dst);
+    }
+
+    RI_ASSERT_EQUAL(run_download_queue(queue), 0);
+
+    /* entries stay in the order they were added */
+    i = 0;
+
+    TAILQ_FOREACH(entry, queue->entries, items) {
+        xasprintf(&path, "/pkg-%d.rpm", i);
+        RI_ASSERT_EQUAL(entry->state, DOWNLOAD_DONE);
+        RI_ASSERT_EQUAL(entry->attempts, 1);
+        RI_ASSERT_TRUE(strsuffix(entry->dst, path + 1));
+        RI_ASSERT_TRUE(check_file(entry->dst, path));
+        free(path);
+        i++;
+    }
+
+    RI_ASSERT_EQUAL(i, NUM_FILES);
+    free_download_queue(queue);
+}
+
+/* done callback, checks entries arrive in queue order */
+static void record_done(const download_entry_t *entry, void *data)
+{
+    int *count = data;
+    char *name = NULL;
+
+    xasprintf(&name, "done-pkg-%d.rpm", *count);
+    RI_ASSERT_TRUE(strsuffix(entry->dst, name));
+    RI_ASSERT_EQUAL(entry->state, DOWNLOAD_DONE);
+    free(name);
+    (*count)++;
+}
+
+void test_download_done(void) {
+    download_queue_t *queue = new_queue(4, 0);
+    char *src = NULL;
+    char *dst = NULL;
+    int count = 0;
+    int i = 0;
+
+    queue->done = record_done;
+    queue->done_data = &count;
+
+    for (i = 0; i < NUM_FILES; i++) {
+        xasprintf(&src, "http://127.0.0.1:%d/done/pkg-%d.rpm", server_port, i);
+        xasprintf(&dst, "%s/done-pkg-%d.rpm", tmpdir, i);
+        add_download(queue, src, dst);
+        free(src);
+        free(dst);
+    }
+
+    RI_ASSERT_EQUAL(run_download_queue(queue), 0);
+    RI_ASSERT_EQUAL(count, NUM_FILES);
+    free_download_queue(queue);
+}
+
+/* download sink that collects the body in memory */
+typedef struct _collect_t {
+    char *data;
+    size_t len;
+    int started;
+    int finished;
+    int calls;
+    int blocked;       /* times the sink blocked */
+    int fd;            /* with block set, for wait_fd */
+    bool block;        /* block on every other block of data */
+} collect_t;
+
+static bool collect_start(download_entry_t *entry)
+{
+    collect_t *c = entry->sink_data;
+
+    free(c->data);
+    c->data = NULL;
+    c->len = 0;
+    c->started++;
+    return true;
+}
+
+static sink_result_t collect_write(download_entry_t *entry, const char *data, size_t len)
+{
+    collect_t *c = entry->sink_data;
+
+    /* the same data comes back after the sink blocks */
+    if (c->block && (c->calls++ % 2) == 0) {
+        c->blocked++;
+        return SINK_BLOCKED;
+    }
+
+    c->data = realloc(c->data, c->len + len);
+    assert(c->data != NULL);
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    return SINK_OK;
+}
+
+static int collect_wait_fd(download_entry_t *entry)
+{
+    collect_t *c = entry->sink_data;
+
+    return c->fd;
+}
+
+static bool collect_finish(download_entry_t *entry, bool ok)
+{
+    collect_t *c = entry->sink_data;
+
+    c->finished++;
+    return ok;
+}
+
+static void collect_free(void *data)
+{
+    collect_t *c = data;
+
+    free(c->data);
+    free(c);
+}
+
+static const download_sink_t collect_sink = {
+    .start = collect_start,
+    .write = collect_write,
+    .wait_fd = collect_wait_fd,
+    .finish = collect_finish,
+    .free = collect_free,
+};
+
+void test_download_sink(void) {
+    download_queue_t *queue = new_queue(2, 1);
+    download_entry_t *entry = NULL;
+    collect_t *c = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+    char *body = NULL;
+    size_t len = 0;
+
+    xasprintf(&src, "http://127.0.0.1:%d/flaky/sink.rpm", server_port);
+    xasprintf(&dst, "%s/sink.rpm", tmpdir);
+    entry = add_download(queue, src, dst);
+    c = calloc(1, sizeof(*c));
+    assert(c != NULL);
+    entry->sink = &collect_sink;
+    entry->sink_data = c;
+
+    RI_ASSERT_EQUAL(run_download_queue(queue), 0);
+
+    /* the sink saw both attempts but only the second body */
+    RI_ASSERT_EQUAL(entry->state, DOWNLOAD_DONE);
+    RI_ASSERT_EQUAL(c->started, 2);
+    RI_ASSERT_EQUAL(c->finished, 2);
+    body = make_body("/flaky/sink.rpm", &len);
+    RI_ASSERT_EQUAL(c->len, len);
+    RI_ASSERT_TRUE(c->len == len && !memcmp(c->data, body, len));
+
+    /* keep_dst was not set, so nothing was written */
+    RI_ASSERT_EQUAL(access(dst, F_OK), -1);
+
+    free(body);
+    free(src);
+    free(dst);
+    free_download_queue(queue);
+}
+
+void test_download_paused(void) {
+    download_queue_t *queue = new_queue(2, 0);
+    download_entry_t *entry = NULL;
+    collect_t *c = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+    char *body = NULL;
+    size_t len = 0;
+    int fds[2];
+
+    /* an empty pipe is always writable */
+    RI_ASSERT_EQUAL(pipe(fds), 0);
+
+    xasprintf(&src, "http://127.0.0.1:%d/paused.rpm", server_port);
+    xasprintf(&dst, "%s/paused.rpm", tmpdir);
+    entry = add_download(queue, src, dst);
+    c = calloc(1, sizeof(*c));
+    assert(c != NULL);
+    c->block = true;
+    c->fd = fds[1];
+    entry->sink = &collect_sink;
+    entry->sink_data = c;
+    entry->keep_dst = true;
+
+    RI_ASSERT_EQUAL(run_download_queue(queue), 0);
+
+    /* the sink blocked on every block but got each one once */
+    RI_ASSERT_EQUAL(entry->state, DOWNLOAD_DONE);
+    RI_ASSERT_TRUE(c->blocked > 0);
+    body = make_body("/paused.rpm", &len);
+    RI_ASSERT_EQUAL(c->len, len);
+    RI_ASSERT_TRUE(c->len == len && !memcmp(c->data, body, len));
+
+    /* and so did the file */
+    RI_ASSERT_TRUE(check_file(dst, "/paused.rpm"));
+
+    close(fds[0]);
+    close(fds[1]);
+    free(body);
+    free(src);
+    free(dst);
+    free_download_queue(queue);
+}
+
+void test_download_skip_done(void) {
+    download_queue_t *queue = new_queue(2, 0);
+    download_entry_t *entry = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+    int count = 0;
+    int i = 0;
+
+    queue->done = record_done;
+    queue->done_data = &count;
+
+    for (i = 0; i < NUM_FILES; i++) {
+        xasprintf(&src, "http://127.0.0.1:%d/skip/pkg-%d.rpm", server_port, i);
+        xasprintf(&dst, "%s/done-pkg-%d.rpm", tmpdir, i);
+        entry = add_download(queue, src, dst);
+
+        /* pretend every other file is already here */
+        if (i % 2 == 0) {
+            entry->state = DOWNLOAD_DONE;
+        }
+
+        free(src);
+        free(dst);
+    }
+
+    RI_ASSERT_EQUAL(run_download_queue(queue), 0);
+    RI_ASSERT_EQUAL(count, NUM_FILES);
+
+    /* only the missing files were downloaded */
+    i = 0;
+
+    TAILQ_FOREACH(entry, queue->entries, items) {
+        RI_ASSERT_EQUAL(entry->attempts, (i % 2 == 0) ? 0 : 1);
+        i++;
+    }
+
+    free_download_queue(queue);
+}
+
+void test_download_missing(void) {
+    download_queue_t *queue = new_queue(2, 2);
+    download_entry_t *entry = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+
+    xasprintf(&src, "http://127.0.0.1:%d/missing.rpm", server_port);
+    xasprintf(&dst, "%s/missing.rpm", tmpdir);
+    add_download(queue, src, dst);
+
+    RI_ASSERT_EQUAL(run_download_queue(queue), 1);
+
+    /* a 404 is not retried and leaves no file behind */
+    entry = TAILQ_FIRST(queue->entries);
+    RI_ASSERT_EQUAL(entry->state, DOWNLOAD_FAILED);
+    RI_ASSERT_EQUAL(entry->attempts, 1);
+    RI_ASSERT_EQUAL(access(dst, F_OK), -1);
+
+    free(src);
+    free(dst);
+    free_download_queue(queue);
+}
+
+void test_download_retry(void) {
+    download_queue_t *queue = new_queue(2, 1);
+    download_entry_t *entry = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+
+    xasprintf(&src, "http://127.0.0.1:%d/flaky/pkg.rpm", server_port);
+    xasprintf(&dst, "%s/flaky.rpm", tmpdir);
+    add_download(queue, src, dst);
+
+    /* the first attempt gets a 503, the retry gets the file */
+    RI_ASSERT_EQUAL(run_download_queue(queue), 0);
+
+    entry = TAILQ_FIRST(queue->entries);
+    RI_ASSERT_EQUAL(entry->state, DOWNLOAD_DONE);
+    RI_ASSERT_EQUAL(entry->attempts, 2);
+    RI_ASSERT_TRUE(check_file(dst, "/flaky/pkg.rpm"));
+
+    free(src);
+    free(dst);
+    free_download_queue(queue);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("download", init_test_download, clean_test_download);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test run_download_queue()", test_download_queue) == NULL ||
+        CU_add_test(pSuite, "test run_download_queue() done callback", test_download_done) == NULL ||
+        CU_add_test(pSuite, "test run_download_queue() done entries", test_download_skip_done) == NULL ||
+        CU_add_test(pSuite, "test run_download_queue() sink", test_download_sink) == NULL ||
+        CU_add_test(pSuite, "test run_download_queue() paused sink", test_download_paused) == NULL ||
+        CU_add_test(pSuite, "test run_download_queue() missing file", test_download_missing) == NULL ||
+        CU_add_test(pSuite, "test run_download_queue() retry", test_download_retry) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,543 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <CUnit/Basic.h>
+#include <rpm/rpmlib.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+#include "test-httpd.h"
+
+#define NVR "esttest-1.0-1"
+#define PKG NVR ".noarch.rpm"
+
+/*
+ * The tests use a small package built with rpmbuild.  Its description
+ * is long enough that the header does not fit in the first
+ * HEADER_FETCH_SIZE bytes, so gather_headers() has to fetch it again.
+ */
+static char *tmpdir = NULL;
+static char *pkg = NULL;
+static char *range_log = NULL;
+static int server_port = 0;
+
+static const char *spec =
+    "Name: esttest\n"
+    "Version: 1.0\n"
+    "Release: 1\n"
+    "Summary: estimate test package\n"
+    "License: GPLv3+\n"
+    "BuildArch: noarch\n"
+    "%description\n"
+    "%(seq 1 20000)\n"
+    "%install\n"
+    "mkdir -p %{buildroot}/usr/share/esttest\n"
+    "seq 1 1000 > %{buildroot}/usr/share/esttest/data\n"
+    "%files\n"
+    "/usr/share/esttest/data\n";
+
+/*
+ * A Koji hub and package server in one.  Every connection is handled
+ * in its own process and closed after one request.  POST requests are
+ * hub calls: getBuild and listBuildRPMs describe a build of the test
+ * package, anything else is nil.  GET requests are for the test
+ * package, the byte range of each one is appended to range_log.
+ */
+#define XML_STR(s) "<value><string>" s "</string></value>"
+#define XML_INT(i) "<value><int>" #i "</int></value>"
+#define XML_MEMBER(n, v) "<member><name>" n "</name>" v "</member>"
+
+#define BUILD_RESPONSE \
+    "<value><struct>" \
+    XML_MEMBER("id", XML_INT(1)) \
+    XML_MEMBER("build_id", XML_INT(1)) \
+    XML_MEMBER("package_name", XML_STR("esttest")) \
+    XML_MEMBER("name", XML_STR("esttest")) \
+    XML_MEMBER("version", XML_STR("1.0")) \
+    XML_MEMBER("release", XML_STR("1")) \
+    XML_MEMBER("nvr", XML_STR(NVR)) \
+    XML_MEMBER("epoch", "<value><nil/></value>") \
+    XML_MEMBER("state", XML_INT(1)) \
+    "</struct></value>"
+
+#define RPMS_RESPONSE \
+    "<value><array><data><value><array><data>" \
+    "<value><struct>" \
+    XML_MEMBER("arch", XML_STR("noarch")) \
+    XML_MEMBER("name", XML_STR("esttest")) \
+    XML_MEMBER("version", XML_STR("1.0")) \
+    XML_MEMBER("release", XML_STR("1")) \
+    "</struct></value>" \
+    "</data></array></value></data></array></value>"
+
+static void send_all(int fd, const char *data, size_t len)
+{
+    ssize_t n = 0;
+
+    while (len > 0) {
+        if ((n = write(fd, data, len)) == -1) {
+            _exit(EXIT_FAILURE);
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return;
+}
+
+static void hub_respond(int fd, const char *body)
+{
+    const char *value = "<value><nil/></value>";
+    char *xml = NULL;
+    char *head = NULL;
+
+    if (strstr(body, "listBuildRPMs") != NULL) {
+        value = RPMS_RESPONSE;
+    } else if (strstr(body, "getBuild") != NULL) {
+        value = BUILD_RESPONSE;
+    }
+
+    xasprintf(&xml, "<?xml version=\"1.0\"?><methodResponse><params><param>%s</param></params></methodResponse>", value);
+    xasprintf(&head, "HTTP/1.1 200 OK\r\nContent-Type: text/xml\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", strlen(xml));
+    send_all(fd, head, strlen(head));
+    send_all(fd, xml, strlen(xml));
+    free(head);
+    free(xml);
+    return;
+}
+
+static void serve_package(int fd, const char *req)
+{
+    const char *range = NULL;
+    char *data = NULL;
+    char *head = NULL;
+    FILE *fp = NULL;
+    struct stat sb;
+    long first = 0;
+    long last = 0;
+    int lfd = -1;
+
+    if (stat(pkg, &sb) == -1 || (data = malloc(sb.st_size)) == NULL) {
+        _exit(EXIT_FAILURE);
+    }
+
+    if ((fp = fopen(pkg, "r")) == NULL || fread(data, 1, sb.st_size, fp) != (size_t) sb.st_size) {
+        _exit(EXIT_FAILURE);
+    }
+
+    fclose(fp);
+    last = sb.st_size - 1;
+
+    if ((range = strcasestr(req, "Range: bytes=")) != NULL && sscanf(range + 13, "%ld-%ld", &first, &last) == 2) {
+        lfd = open(range_log, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+        if (lfd == -1 || dprintf(lfd, "%ld-%ld\n", first, last) < 0) {
+            _exit(EXIT_FAILURE);
+        }
+
+        close(lfd);
+
+        if (last >= sb.st_size) {
+            last = sb.st_size - 1;
+        }
+
+        xasprintf(&head, "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %ld-%ld/%ld\r\nContent-Length: %ld\r\nConnection: close\r\n\r\n", first, last, (long) sb.st_size, last - first + 1);
+    } else {
+        xasprintf(&head, "HTTP/1.1 200 OK\r\nContent-Length: %ld\r\nConnection: close\r\n\r\n", (long) sb.st_size);
+    }
+
+    send_all(fd, head, strlen(head));
+    send_all(fd, data + first, last - first + 1);
+    free(head);
+    free(data);
+    return;
+}
+
+static void serve_connection(int fd)
+{
+    char *req = NULL;
+    char *end = NULL;
+    char *cl = NULL;
+    char *body = NULL;
+    size_t have = 0;
+    size_t alloc = 65536;
+    size_t start = 0;
+    size_t need = 0;
+    ssize_t n = 0;
+
+    req = malloc(alloc);
+    assert(req != NULL);
+
+    /* read the request headers */
+    while ((end = memmem(req, have, "\r\n\r\n", 4)) == NULL) {
+        if ((n = read(fd, req + have, alloc - have - 1)) <= 0) {
+            free(req);
+            return;
+        }
+
+        have += n;
+    }
+
+    req[have] = '\0';
+    *end = '\0';
+
+    if (strprefix(req, "GET ")) {
+        serve_package(fd, req);
+        free(req);
+        return;
+    }
+
+    if ((cl = strcasestr(req, "Content-Length:")) == NULL) {
+        free(req);
+        return;
+    }
+
+    if (strcasestr(req, "100-continue") != NULL) {
+        send_all(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+    }
+
+    /* read the rest of the body */
+    start = (end + 4) - req;
+    need = start + strtoul(cl + 15, NULL, 10);
+
+    if (need >= alloc) {
+        alloc = need + 1;
+        req = realloc(req, alloc);
+        assert(req != NULL);
+    }
+
+    while (have < need) {
+        if ((n = read(fd, req + have, need - have)) <= 0) {
+            free(req);
+            return;
+        }
+
+        have += n;
+    }
+
+    body = strndup(req + start, need - start);
+    hub_respond(fd, body);
+    free(body);
+    free(req);
+    return;
+}
+
+/* Package size counted by update_calibration() and write_estimate() */
+static uint64_t header_size(Header h)
+{
+    uint64_t size = headerGetNumber(h, RPMTAG_LONGSIGSIZE);
+
+    return (size == 0) ? headerGetNumber(h, RPMTAG_SIGSIZE) : size;
+}
+
+/* Set up a struct rpminspect with the test package as a peer and stats */
+static void init_calibration_ri(struct rpminspect *ri, const double gather, const double inspection)
+{
+    stats_mark_t mark;
+    stats_entry_t *entry = NULL;
+    Header h = NULL;
+
+    memset(ri, 0, sizeof(*ri));
+    xasprintf(&ri->calibration, "%s/calibration", tmpdir);
+
+    h = get_rpm_header(ri, pkg);
+    assert(h != NULL);
+    add_peer(&ri->peers, AFTER_BUILD, true, pkg, h, NULL);
+
+    /* a run that took these many seconds to gather and inspect */
+    ri->stats = init_stats();
+    start_stats(ri, &mark);
+    end_stats(ri, &mark, STATS_PHASE, "download");
+    end_stats(ri, &mark, STATS_INSPECTION, inspections[0].name);
+
+    TAILQ_FOREACH(entry, ri->stats, items) {
+        entry->wall = (entry->kind == STATS_PHASE) ? gather : inspection;
+    }
+
+    return;
+}
+
+int init_test_estimate(void) {
+    char *specfile = NULL;
+    char *define = NULL;
+    char *output = NULL;
+    FILE *fp = NULL;
+    int exitcode = 0;
+
+    tmpdir = strdup("/tmp/test-estimate.XXXXXX");
+
+    if (mkdtemp(tmpdir) == NULL || init_librpm() != RPMRC_OK) {
+        return -1;
+    }
+
+    /* build the test package */
+    xasprintf(&specfile, "%s/esttest.spec", tmpdir);
+
+    if ((fp = fopen(specfile, "w")) == NULL) {
+        free(specfile);
+        return -1;
+    }
+
+    fputs(spec, fp);
+    fclose(fp);
+
+    xasprintf(&define, "'_topdir %s'", tmpdir);
+    output = run_cmd(&exitcode, "rpmbuild", "--quiet", "--define", define, "-bb", specfile, NULL);
+    free(output);
+    free(define);
+    free(specfile);
+
+    xasprintf(&pkg, "%s/RPMS/noarch/%s", tmpdir, PKG);
+
+    if (exitcode != 0 || access(pkg, R_OK) == -1) {
+        return -1;
+    }
+
+    xasprintf(&range_log, "%s/ranges.log", tmpdir);
+    return start_test_server(serve_connection, &server_port);
+}
+
+int clean_test_estimate(void) {
+    stop_test_server();
+
+    if (tmpdir != NULL) {
+        rmtree(tmpdir, true, false);
+        free(tmpdir);
+    }
+
+    free(pkg);
+    free(range_log);
+    return 0;
+}
+
+void test_blend_calibration(void) {
+    /* the first sample is taken as it is */
+    CU_ASSERT_DOUBLE_EQUAL(blend_calibration(0, 5.0), 5.0, 0.000001);
+    CU_ASSERT_DOUBLE_EQUAL(blend_calibration(-1.0, 3.0), 3.0, 0.000001);
+
+    /* later ones move the value part of the way */
+    CU_ASSERT_DOUBLE_EQUAL(blend_calibration(4.0, 8.0), 4.0 + (4.0 * CALIBRATION_WEIGHT), 0.000001);
+    CU_ASSERT_DOUBLE_EQUAL(blend_calibration(8.0, 8.0), 8.0, 0.000001);
+}
+
+void test_calibration_file(void) {
+    calibration_t cal;
+    calibration_t readback;
+    char *path = NULL;
+    FILE *fp = NULL;
+    struct stat sb;
+
+    xasprintf(&path, "%s/roundtrip", tmpdir);
+
+    /* no file, everything is 0 */
+    RI_ASSERT_FALSE(read_calibration(path, &cal));
+    CU_ASSERT_DOUBLE_EQUAL(cal.gather_rate, 0, 0.000001);
+    CU_ASSERT_DOUBLE_EQUAL(cal.factors[0], 0, 0.000001);
+    free(cal.factors);
+
+    RI_ASSERT_FALSE(read_calibration(NULL, &cal));
+    free(cal.factors);
+
+    /* what is written is read back, values of 0 are left out */
+    (void) read_calibration(NULL, &cal);
+    cal.gather_rate = 1048576;
+    cal.factors[0] = 0.5;
+    write_calibration(path, &cal);
+
+    RI_ASSERT_EQUAL(stat(path, &sb), 0);
+    RI_ASSERT_EQUAL(sb.st_mode & 0777, 0644);
+
+    RI_ASSERT_TRUE(read_calibration(path, &readback));
+    CU_ASSERT_DOUBLE_EQUAL(readback.gather_rate, 1048576, 0.000001);
+    CU_ASSERT_DOUBLE_EQUAL(readback.factors[0], 0.5, 0.000001);
+    CU_ASSERT_DOUBLE_EQUAL(readback.factors[1], 0, 0.000001);
+    free(readback.factors);
+
+    /* comments, unknown names, and values that are not positive are ignored */
+    fp = fopen(path, "a");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+    fprintf(fp, "# gather 1\n");
+    fprintf(fp, "gather -5\n");
+    fprintf(fp, "nosuchinspection 3\n");
+    fprintf(fp, "%s 2.5 # comment\n", inspections[1].name);
+    fprintf(fp, "%s 0\n", inspections[0].name);
+    fclose(fp);
+
+    RI_ASSERT_TRUE(read_calibration(path, &readback));
+    CU_ASSERT_DOUBLE_EQUAL(readback.gather_rate, 1048576, 0.000001);
+    CU_ASSERT_DOUBLE_EQUAL(readback.factors[0], 0.5, 0.000001);
+    CU_ASSERT_DOUBLE_EQUAL(readback.factors[1], 2.5, 0.000001);
+    free(readback.factors);
+
+    free(cal.factors);
+    unlink(path);
+    free(path);
+}
+
+void test_update_calibration(void) {
+    struct rpminspect ri;
+    calibration_t cal;
+    workload_t *workloads = NULL;
+    char *lockfile = NULL;
+    struct stat sb;
+    uint64_t bytes = 0;
+    uint64_t cost = 0;
+    double rate = 0;
+    pid_t pid = -1;
+    int status = 0;
+    int lock = -1;
+
+    init_calibration_ri(&ri, 2.0, 1.0);
+    bytes = header_size(TAILQ_FIRST(ri.peers)->after_hdr);
+    RI_ASSERT_TRUE(bytes > 0);
+    workloads = get_workloads(&ri);
+    cost = inspection_cost(&ri, 0, &workloads[0]);
+    free(workloads);
+
+    /* another run holds the lock, this one waits for it */
+    xasprintf(&lockfile, "%s.lock", ri.calibration);
+    lock = open(lockfile, O_RDWR | O_CREAT, 0644);
+    RI_ASSERT_NOT_EQUAL(lock, -1);
+    RI_ASSERT_EQUAL(flock(lock, LOCK_EX), 0);
+
+    pid = fork();
+    RI_ASSERT_NOT_EQUAL(pid, -1);
+
+    if (pid == 0) {
+        update_calibration(&ri);
+        _exit(EXIT_SUCCESS);
+    }
+
+    usleep(200000);
+    RI_ASSERT_EQUAL(waitpid(pid, &status, WNOHANG), 0);
+    RI_ASSERT_EQUAL(access(ri.calibration, F_OK), -1);
+
+    RI_ASSERT_EQUAL(flock(lock, LOCK_UN), 0);
+    close(lock);
+    RI_ASSERT_EQUAL(waitpid(pid, &status, 0), pid);
+    RI_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* the first run is taken as it is */
+    RI_ASSERT_EQUAL(stat(ri.calibration, &sb), 0);
+    RI_ASSERT_EQUAL(sb.st_mode & 0777, 0644);
+    RI_ASSERT_TRUE(read_calibration(ri.calibration, &cal));
+    rate = bytes / 2.0;
+    CU_ASSERT_DOUBLE_EQUAL(cal.gather_rate, rate, 1);
+
+    if (cost > 0) {
+        CU_ASSERT_DOUBLE_EQUAL(cal.factors[0], 1000000.0 / cost, 0.000001);
+    }
+
+    free(cal.factors);
+    free_rpminspect(&ri);
+
+    /* a slower run is blended in */
+    init_calibration_ri(&ri, 4.0, 1.0);
+    update_calibration(&ri);
+    RI_ASSERT_TRUE(read_calibration(ri.calibration, &cal));
+    CU_ASSERT_DOUBLE_EQUAL(cal.gather_rate, blend_calibration(rate, bytes / 4.0), 1);
+    free(cal.factors);
+
+    unlink(ri.calibration);
+    unlink(lockfile);
+    free(lockfile);
+    free_rpminspect(&ri);
+}
+
+void test_gather_headers(void) {
+    struct rpminspect ri;
+    rpmpeer_entry_t *peer = NULL;
+    FILE *fp = NULL;
+    long first = 0;
+    long last = 0;
+    long ranges[2] = { 0, 0 };
+    int n = 0;
+
+    memset(&ri, 0, sizeof(ri));
+    xasprintf(&ri.kojihub, "http://127.0.0.1:%d/kojihub", server_port);
+    xasprintf(&ri.kojiursine, "http://127.0.0.1:%d/packages", server_port);
+    xasprintf(&ri.workdir, "%s/work", tmpdir);
+    RI_ASSERT_EQUAL(mkdirp(ri.workdir, S_IRWXU), 0);
+    ri.after = strdup(NVR);
+    ri.buildtype = KOJI_BUILD_RPM;
+
+    RI_ASSERT_EQUAL(gather_headers(&ri), 0);
+
+    /* the package is a peer with its whole header and no files */
+    RI_ASSERT_PTR_NOT_NULL(ri.peers);
+    peer = TAILQ_FIRST(ri.peers);
+    RI_ASSERT_PTR_NOT_NULL(peer);
+    RI_ASSERT_PTR_NOT_NULL(peer->after_hdr);
+    RI_ASSERT_STRING_EQUAL(headerGetString(peer->after_hdr, RPMTAG_NAME), "esttest");
+    RI_ASSERT_PTR_NOT_NULL(strstr(headerGetString(peer->after_hdr, RPMTAG_DESCRIPTION), "20000"));
+    RI_ASSERT_PTR_NULL(peer->after_files);
+
+    /* the first request did not hold the header, it was asked for again */
+    fp = fopen(range_log, "r");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+
+    while (n < 3 && fscanf(fp, "%ld-%ld\n", &first, &last) == 2) {
+        RI_ASSERT_EQUAL(first, 0);
+
+        if (n < 2) {
+            ranges[n] = last;
+        }
+
+        n++;
+    }
+
+    fclose(fp);
+    RI_ASSERT_EQUAL(n, 2);
+    RI_ASSERT_EQUAL(ranges[0], HEADER_FETCH_SIZE - 1);
+    RI_ASSERT_TRUE(ranges[1] > ranges[0]);
+
+    rmtree(ri.worksubdir, true, false);
+    free_rpminspect(&ri);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("estimate", init_test_estimate, clean_test_estimate);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test blend_calibration()", test_blend_calibration) == NULL ||
+        CU_add_test(pSuite, "test read_calibration() and write_calibration()", test_calibration_file) == NULL ||
+        CU_add_test(pSuite, "test update_calibration()", test_update_calibration) == NULL ||
+        CU_add_test(pSuite, "test gather_headers() fetching a header again", test_gather_headers) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
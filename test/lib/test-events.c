@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <pthread.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+#define RESULTS_PER_THREAD 100
+
+static char *eventsfile = NULL;
+
+int init_test_events(void) {
+    int fd = -1;
+
+    eventsfile = strdup("/tmp/test-events.XXXXXX");
+    fd = mkstemp(eventsfile);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+int clean_test_events(void) {
+    if (eventsfile != NULL) {
+        unlink(eventsfile);
+        free(eventsfile);
+    }
+
+    return 0;
+}
+
+static void *report_results(__attribute__((unused)) void *arg)
+{
+    struct result_params params;
+    int i = 0;
+
+    init_result_params(&params);
+    params.severity = RESULT_BAD;
+    params.waiverauth = WAIVABLE_BY_ANYONE;
+    params.header = "test";
+    params.msg = "a \"quoted\"\tmessage";
+    params.file = "/usr/bin/test";
+
+    for (i = 0; i < RESULTS_PER_THREAD; i++) {
+        event_result(&params);
+    }
+
+    return NULL;
+}
+
+/*
+ * Count the lines of fp that are whole events and the ones that
+ * contain needle.  Returns -1 if any line is not a whole event.
+ */
+static int count_events(FILE *fp, const char *needle, int *matches)
+{
+    char *line = NULL;
+    size_t n = 0;
+    ssize_t len = 0;
+    int count = 0;
+
+    *matches = 0;
+
+    while ((len = getline(&line, &n, fp)) != -1) {
+        if (!strprefix(line, "{\"event\":\"") || !strsuffix(line, "}\n")) {
+            count = -1;
+            break;
+        }
+
+        if (strstr(line, needle) != NULL) {
+            (*matches)++;
+        }
+
+        count++;
+    }
+
+    free(line);
+    return count;
+}
+
+void test_events_file(void) {
+    pthread_t threads[4];
+    FILE *fp = NULL;
+    int matches = 0;
+    int i = 0;
+
+    RI_ASSERT_TRUE(init_events(eventsfile));
+    event_run_start(NULL, "test-1.0-1");
+    event_inspection_start("test");
+
+    for (i = 0; i < 4; i++) {
+        RI_ASSERT_EQUAL(pthread_create(&threads[i], NULL, report_results, NULL), 0);
+    }
+
+    for (i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    event_inspection_finish("test", false);
+    event_run_finish(RESULT_BAD, RI_INSPECTION_FAILURE);
+    finish_events();
+
+    /* nothing is written once the stream is closed */
+    event_inspection_start("late");
+
+    fp = fopen(eventsfile, "r");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+    RI_ASSERT_EQUAL(count_events(fp, "\"message\":\"a \\\"quoted\\\"\\tmessage\",\"file\":\"\\/usr\\/bin\\/test\"", &matches), (4 * RESULTS_PER_THREAD) + 4);
+    RI_ASSERT_EQUAL(matches, 4 * RESULTS_PER_THREAD);
+    rewind(fp);
+    RI_ASSERT_EQUAL(count_events(fp, "\"event\":\"inspection finish\",", &matches), (4 * RESULTS_PER_THREAD) + 4);
+    RI_ASSERT_EQUAL(matches, 1);
+    fclose(fp);
+}
+
+void test_events_fd(void) {
+    int fds[2];
+    FILE *fp = NULL;
+    char *dest = NULL;
+    int matches = 0;
+
+    RI_ASSERT_FALSE(init_events("fd:"));
+    RI_ASSERT_FALSE(init_events("fd:x"));
+
+    RI_ASSERT_EQUAL(pipe(fds), 0);
+    xasprintf(&dest, "fd:%d", fds[1]);
+    RI_ASSERT_TRUE(init_events(dest));
+    free(dest);
+    event_inspection_start("test");
+    finish_events();
+
+    /* the descriptor itself is left open */
+    RI_ASSERT_EQUAL(write(fds[1], "", 0), 0);
+    close(fds[1]);
+
+    fp = fdopen(fds[0], "r");
+    RI_ASSERT_PTR_NOT_NULL(fp);
+    RI_ASSERT_EQUAL(count_events(fp, "\"inspection\":\"test\"}", &matches), 1);
+    RI_ASSERT_EQUAL(matches, 1);
+    fclose(fp);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("events", init_test_events, clean_test_events);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test events to a file", test_events_file) == NULL) {
+        return NULL;
+    }
+
+    if (CU_add_test(pSuite, "test events to a file descriptor", test_events_fd) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "test-httpd.h"
+
+static pid_t server_pid = -1;
+
+int start_test_server(test_handler_t handler, int *port)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    int sock = -1;
+    int conn = -1;
+
+    assert(handler != NULL);
+    assert(port != NULL);
+
+    /* listen before forking so the port is ready for the tests */
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (sock == -1) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+        listen(sock, 64) == -1 ||
+        getsockname(sock, (struct sockaddr *) &addr, &addrlen) == -1) {
+        close(sock);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    server_pid = fork();
+
+    if (server_pid == -1) {
+        close(sock);
+        return -1;
+    } else if (server_pid == 0) {
+        signal(SIGCHLD, SIG_IGN);
+
+        while ((conn = accept(sock, NULL, NULL)) != -1) {
+            if (fork() == 0) {
+                close(sock);
+                handler(conn);
+                close(conn);
+                _exit(EXIT_SUCCESS);
+            }
+
+            close(conn);
+        }
+
+        _exit(EXIT_FAILURE);
+    }
+
+    close(sock);
+    return 0;
+}
+
+void stop_test_server(void)
+{
+    if (server_pid > 0) {
+        kill(server_pid, SIGTERM);
+        waitpid(server_pid, NULL, 0);
+        server_pid = -1;
+    }
+
+    return;
+}
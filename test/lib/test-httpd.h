@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LIBRPMINSPECT_TEST_HTTPD_H
+#define _LIBRPMINSPECT_TEST_HTTPD_H
+
+/* Handles one client connection, the connection is closed after */
+typedef void (*test_handler_t)(int);
+
+/*
+ * Start a server on a loopback port for the tests.  Every connection
+ * is passed to handler in its own process.  Returns 0 and sets port,
+ * or -1 on error.
+ */
+int start_test_server(test_handler_t handler, int *port);
+
+/* Stop the server started by start_test_server() */
+void stop_test_server(void);
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+/* The expected strings are what json-c writes for the same tree */
+
+static char *buf = NULL;
+static size_t len = 0;
+static FILE *fp = NULL;
+
+int init_test_jsonwriter(void) {
+    return 0;
+}
+
+int clean_test_jsonwriter(void) {
+    return 0;
+}
+
+static void open_buffer(void) {
+    fp = open_memstream(&buf, &len);
+    RI_ASSERT_PTR_NOT_NULL(fp);
+}
+
+static void close_buffer(void) {
+    fclose(fp);
+}
+
+void test_json_pretty(void) {
+    json_writer_t w;
+
+    open_buffer();
+    json_writer_init(&w, fp, true);
+    json_begin_object(&w, NULL);
+    json_begin_array(&w, "license");
+    json_begin_object(&w, NULL);
+    json_write_string(&w, "result", "BAD");
+    json_write_string(&w, "message", "a/b \"c\"\n\t\x01\\");
+    json_end_object(&w);
+    json_begin_object(&w, NULL);
+    json_end_object(&w);
+    json_end_array(&w);
+    json_begin_array(&w, "empty");
+    json_end_array(&w);
+    json_begin_object(&w, "stats");
+    json_write_int(&w, "count", 3);
+    json_write_int(&w, "negative", -42);
+    json_end_object(&w);
+    json_end_object(&w);
+    close_buffer();
+
+    RI_ASSERT_STRING_EQUAL(buf,
+        "{\n"
+        "  \"license\": [\n"
+        "    {\n"
+        "      \"result\": \"BAD\",\n"
+        "      \"message\": \"a\\/b \\\"c\\\"\\n\\t\\u0001\\\\\"\n"
+        "    },\n"
+        "    {\n"
+        "    }\n"
+        "  ],\n"
+        "  \"empty\": [\n"
+        "  ],\n"
+        "  \"stats\": {\n"
+        "    \"count\": 3,\n"
+        "    \"negative\": -42\n"
+        "  }\n"
+        "}");
+    free(buf);
+}
+
+void test_json_plain(void) {
+    json_writer_t w;
+
+    open_buffer();
+    json_writer_init(&w, fp, false);
+    json_begin_object(&w, NULL);
+    json_write_string(&w, "event", "result");
+    json_write_string(&w, "noun", NULL);
+    json_begin_array(&w, "list");
+    json_write_int(&w, NULL, 1);
+    json_write_string(&w, NULL, "two");
+    json_end_array(&w);
+    json_begin_object(&w, "empty");
+    json_end_object(&w);
+    json_end_object(&w);
+    close_buffer();
+
+    RI_ASSERT_STRING_EQUAL(buf, "{\"event\":\"result\",\"noun\":null,\"list\":[1,\"two\"],\"empty\":{}}");
+    free(buf);
+}
+
+void test_json_write_double(void) {
+    json_writer_t w;
+
+    open_buffer();
+    json_writer_init(&w, fp, false);
+    json_begin_array(&w, NULL);
+    json_write_double(&w, NULL, 0.0);
+    json_write_double(&w, NULL, 2.5);
+    json_write_double(&w, NULL, 0.1);
+    json_write_double(&w, NULL, 123456789.0);
+    json_write_double(&w, NULL, 3.0e21);
+    json_write_double(&w, NULL, -1e-7);
+    json_end_array(&w);
+    close_buffer();
+
+    RI_ASSERT_STRING_EQUAL(buf, "[0.0,2.5,0.10000000000000001,123456789.0,3e+21,-9.9999999999999995e-08]");
+    free(buf);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("jsonwriter", init_test_jsonwriter, clean_test_jsonwriter);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test pretty JSON", test_json_pretty) == NULL) {
+        return NULL;
+    }
+
+    if (CU_add_test(pSuite, "test plain JSON", test_json_plain) == NULL) {
+        return NULL;
+    }
+
+    if (CU_add_test(pSuite, "test json_write_double()", test_json_write_double) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -16,22 +16,308 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
 #include <CUnit/Basic.h>
 #include "rpminspect.h"
 
 #include "test-main.h"
+#include "test-httpd.h"
 
 struct koji_build *build = NULL;
 koji_rpmlist_t *list = NULL;
 
+/*
+ * A mock Koji hub.  Every connection is handled in its own process.
+ * The hub answers the calls rpminspect makes with canned responses
+ * and appends the name of each method it is called with to a log
+ * file, which the tests use to count requests.  Calls made through
+ * multiCall are logged as "multiCall".
+ */
+static int hub_port = 0;
+static char *tmpdir = NULL;
+static char *hub_log = NULL;
+
+#define XML_STR(s) "<value><string>" s "</string></value>"
+#define XML_INT(i) "<value><int>" #i "</int></value>"
+#define XML_MEMBER(n, v) "<member><name>" n "</name>" v "</member>"
+
+#define BUILD_RESPONSE \
+    "<value><struct>" \
+    XML_MEMBER("id", XML_INT(1)) \
+    XML_MEMBER("build_id", XML_INT(1)) \
+    XML_MEMBER("package_name", XML_STR("foo")) \
+    XML_MEMBER("name", XML_STR("foo")) \
+    XML_MEMBER("version", XML_STR("1.0")) \
+    XML_MEMBER("release", XML_STR("1")) \
+    XML_MEMBER("nvr", XML_STR("foo-1.0-1")) \
+    XML_MEMBER("epoch", "<value><nil/></value>") \
+    XML_MEMBER("state", XML_INT(1)) \
+    "</struct></value>"
+
+#define RPM_STRUCT(arch) \
+    "<value><struct>" \
+    XML_MEMBER("arch", XML_STR(arch)) \
+    XML_MEMBER("name", XML_STR("foo")) \
+    XML_MEMBER("version", XML_STR("1.0")) \
+    XML_MEMBER("release", XML_STR("1")) \
+    XML_MEMBER("size", XML_INT(4096)) \
+    XML_MEMBER("payloadhash", XML_STR("0123456789abcdef0123456789abcdef")) \
+    "</struct></value>"
+
+#define RPMS_RESPONSE \
+    "<value><array><data>" RPM_STRUCT("x86_64") RPM_STRUCT("src") "</data></array></value>"
+
+#define TASK_STRUCT(id, arch) \
+    "<value><struct>" \
+    XML_MEMBER("id", XML_INT(id)) \
+    XML_MEMBER("arch", XML_STR(arch)) \
+    XML_MEMBER("method", XML_STR("buildArch")) \
+    XML_MEMBER("state", XML_INT(2)) \
+    "</struct></value>"
+
+#define TASK_DESCENDENTS_RESPONSE \
+    "<value><struct>" \
+    XML_MEMBER("100", "<value><array><data>" TASK_STRUCT(100, "noarch") "</data></array></value>") \
+    XML_MEMBER("101", "<value><array><data>" TASK_STRUCT(101, "x86_64") "</data></array></value>") \
+    XML_MEMBER("102", "<value><array><data>" TASK_STRUCT(102, "aarch64") "</data></array></value>") \
+    "</struct></value>"
+
+#define TASK_RESULT_RESPONSE \
+    "<value><struct>" \
+    XML_MEMBER("brootid", XML_INT(7)) \
+    XML_MEMBER("srpms", "<value><array><data>" XML_STR("tasks/1/foo-1.0-1.src.rpm") "</data></array></value>") \
+    XML_MEMBER("rpms", "<value><array><data>" XML_STR("tasks/1/foo-1.0-1.x86_64.rpm") "</data></array></value>") \
+    XML_MEMBER("logs", "<value><array><data></data></array></value>") \
+    "</struct></value>"
+
+#define ARCHES_RESPONSE \
+    "<value><array><data>" XML_STR("x86_64") XML_STR("aarch64") XML_STR("noarch") "</data></array></value>"
+
+static void hub_logcall(const char *method)
+{
+    int fd = -1;
+
+    fd = open(hub_log, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if (fd == -1 || write(fd, method, strlen(method)) == -1 || write(fd, "\n", 1) == -1) {
+        _exit(EXIT_FAILURE);
+    }
+
+    close(fd);
+    return;
+}
+
+/* Number of times the hub has been called with method */
+static int hub_calls(const char *method)
+{
+    FILE *fp = NULL;
+    char line[BUFSIZ];
+    int count = 0;
+
+    if ((fp = fopen(hub_log, "r")) == NULL) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (!strcmp(line, method)) {
+            count++;
+        }
+    }
+
+    fclose(fp);
+    return count;
+}
+
+/* The canned response value for a method */
+static const char *hub_value(const char *body)
+{
+    if (strstr(body, "getBuild") != NULL) {
+        return BUILD_RESPONSE;
+    } else if (strstr(body, "listBuildRPMs") != NULL) {
+        return RPMS_RESPONSE;
+    } else if (strstr(body, "getTaskInfo") != NULL) {
+        return TASK_STRUCT(1, "noarch");
+    } else if (strstr(body, "getTaskDescendents") != NULL) {
+        return TASK_DESCENDENTS_RESPONSE;
+    } else if (strstr(body, "getTaskResult") != NULL) {
+        return TASK_RESULT_RESPONSE;
+    } else if (strstr(body, "getAllArches") != NULL) {
+        return ARCHES_RESPONSE;
+    }
+
+    return "<value><nil/></value>";
+}
+
+static void hub_respond(int fd, const char *body)
+{
+    char *value = NULL;
+    char *xml = NULL;
+    char *head = NULL;
+    const char *walk = body;
+    int calls = 0;
+    int i = 0;
+
+    if (strstr(body, "<methodName>multiCall</methodName>") != NULL) {
+        /* one result array per call in the batch */
+        hub_logcall("multiCall");
+        value = strdup("<value><array><data>");
+
+        while ((walk = strstr(walk, "<name>methodName</name>")) != NULL) {
+            walk++;
+            calls++;
+        }
+
+        for (i = 0; i < calls; i++) {
+            value = strappend(value, "<value><array><data>");
+            value = strappend(value, hub_value(strstr(body, "<name>methodName</name>")));
+            value = strappend(value, "</data></array></value>");
+        }
+
+        value = strappend(value, "</data></array></value>");
+    } else {
+        walk = strstr(body, "<methodName>") + 12;
+        xml = strndup(walk, strcspn(walk, "<"));
+        hub_logcall(xml);
+        free(xml);
+        value = strdup(hub_value(body));
+    }
+
+    xasprintf(&xml, "<?xml version=\"1.0\"?><methodResponse><params><param>%s</param></params></methodResponse>", value);
+    xasprintf(&head, "HTTP/1.1 200 OK\r\nContent-Type: text/xml\r\nContent-Length: %zu\r\n\r\n", strlen(xml));
+
+    if (write(fd, head, strlen(head)) == -1 || write(fd, xml, strlen(xml)) == -1) {
+        _exit(EXIT_FAILURE);
+    }
+
+    free(head);
+    free(xml);
+    free(value);
+    return;
+}
+
+static void hub_connection(int fd)
+{
+    char *req = NULL;
+    char *end = NULL;
+    char *body = NULL;
+    char *cl = NULL;
+    size_t have = 0;
+    size_t alloc = 65536;
+    size_t len = 0;
+    size_t start = 0;
+    size_t need = 0;
+    ssize_t n = 0;
+
+    req = malloc(alloc);
+    assert(req != NULL);
+
+    while (1) {
+        /* read the request headers */
+        while ((end = memmem(req, have, "\r\n\r\n", 4)) == NULL) {
+            n = read(fd, req + have, alloc - have - 1);
+
+            if (n <= 0) {
+                free(req);
+                return;
+            }
+
+            have += n;
+        }
+
+        req[have] = '\0';
+        *end = '\0';
+
+        if ((cl = strcasestr(req, "Content-Length:")) == NULL) {
+            free(req);
+            return;
+        }
+
+        len = strtoul(cl + 15, NULL, 10);
+
+        if (strcasestr(req, "100-continue") != NULL && write(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25) == -1) {
+            _exit(EXIT_FAILURE);
+        }
+
+        /* read the rest of the body */
+        start = (end + 4) - req;
+        need = start + len;
+
+        if (need >= alloc) {
+            alloc = need + 1;
+            req = realloc(req, alloc);
+            assert(req != NULL);
+        }
+
+        while (have < need) {
+            n = read(fd, req + have, need - have);
+
+            if (n <= 0) {
+                free(req);
+                return;
+            }
+
+            have += n;
+        }
+
+        body = strndup(req + start, len);
+        hub_respond(fd, body);
+        free(body);
+
+        /* keep anything that belongs to the next request */
+        have -= need;
+        memmove(req, req + need, have);
+    }
+}
+
 int init_test_koji(void) {
-    return 0;
+    tmpdir = strdup("/tmp/test-koji.XXXXXX");
+
+    if (mkdtemp(tmpdir) == NULL) {
+        return -1;
+    }
+
+    xasprintf(&hub_log, "%s/hub.log", tmpdir);
+    return start_test_server(hub_connection, &hub_port);
 }
 
 int clean_test_koji(void) {
+    free_koji_client();
+    stop_test_server();
+
+    if (tmpdir != NULL) {
+        rmtree(tmpdir, true, false);
+        free(tmpdir);
+    }
+
+    free(hub_log);
     return 0;
 }
 
+/* Set up a struct rpminspect pointing at the mock hub */
+static void init_hub_ri(struct rpminspect *ri)
+{
+    memset(ri, 0, sizeof(*ri));
+    xasprintf(&ri->kojihub, "http://127.0.0.1:%d/kojihub", hub_port);
+    xasprintf(&ri->cache_dir, "%s/cache", tmpdir);
+    return;
+}
+
+static void free_hub_ri(struct rpminspect *ri)
+{
+    free(ri->kojihub);
+    free(ri->cache_dir);
+    return;
+}
+
 void test_init_koji_build(void) {
     build = calloc(1, sizeof(*build));
     RI_ASSERT_PTR_NOT_NULL(build);
@@ -44,6 +330,143 @@ void test_init_koji_rpmlist(void) {
     RI_ASSERT_PTR_NOT_NULL(list);
 }
 
+/* Check the build we get back from the mock hub */
+static void check_hub_build(struct koji_build *b)
+{
+    koji_buildlist_entry_t *entry = NULL;
+    koji_rpmlist_entry_t *rpm = NULL;
+    int n = 0;
+
+    RI_ASSERT_PTR_NOT_NULL(b);
+
+    if (b == NULL) {
+        return;
+    }
+
+    RI_ASSERT_STRING_EQUAL(b->nvr, "foo-1.0-1");
+    RI_ASSERT_EQUAL(b->state, KOJI_BUILD_STATE_COMPLETE);
+    entry = TAILQ_FIRST(b->builds);
+    RI_ASSERT_PTR_NOT_NULL(entry);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    RI_ASSERT_EQUAL(entry->build_id, 1);
+
+    TAILQ_FOREACH(rpm, entry->rpms, items) {
+        RI_ASSERT_STRING_EQUAL(rpm->name, "foo");
+        RI_ASSERT_STRING_EQUAL(rpm->payloadhash, "0123456789abcdef0123456789abcdef");
+        RI_ASSERT_EQUAL(rpm->size, 4096);
+        n++;
+    }
+
+    RI_ASSERT_EQUAL(n, 2);
+    return;
+}
+
+void test_get_koji_build(void) {
+    struct rpminspect ri;
+    struct koji_build *b = NULL;
+
+    init_hub_ri(&ri);
+
+    /* listBuildRPMs goes through multiCall */
+    b = get_koji_build(&ri, "foo-1.0-1");
+    check_hub_build(b);
+    free_koji_build(b);
+    RI_ASSERT_EQUAL(hub_calls("getBuild"), 1);
+    RI_ASSERT_EQUAL(hub_calls("multiCall"), 1);
+    RI_ASSERT_EQUAL(hub_calls("listBuildRPMs"), 0);
+
+    /* the build is complete, so the second lookup is all cached */
+    b = get_koji_build(&ri, "foo-1.0-1");
+    check_hub_build(b);
+    free_koji_build(b);
+    RI_ASSERT_EQUAL(hub_calls("getBuild"), 1);
+    RI_ASSERT_EQUAL(hub_calls("multiCall"), 1);
+
+    free_hub_ri(&ri);
+}
+
+void test_get_koji_task(void) {
+    struct rpminspect ri;
+    struct koji_task *task = NULL;
+    koji_task_entry_t *descendent = NULL;
+    int multicalls = hub_calls("multiCall");
+    int n = 0;
+
+    init_hub_ri(&ri);
+
+    /* one multiCall gets every getTaskResult */
+    task = get_koji_task(&ri, "1");
+    RI_ASSERT_PTR_NOT_NULL(task);
+
+    if (task != NULL) {
+        TAILQ_FOREACH(descendent, task->descendents, items) {
+            RI_ASSERT_EQUAL(descendent->brootid, 7);
+            RI_ASSERT_STRING_EQUAL(TAILQ_FIRST(descendent->rpms)->data, "tasks/1/foo-1.0-1.x86_64.rpm");
+            n++;
+        }
+    }
+
+    RI_ASSERT_EQUAL(n, 3);
+    free_koji_task(task);
+    RI_ASSERT_EQUAL(hub_calls("getTaskInfo"), 1);
+    RI_ASSERT_EQUAL(hub_calls("getTaskDescendents"), 1);
+    RI_ASSERT_EQUAL(hub_calls("getTaskResult"), 0);
+    RI_ASSERT_EQUAL(hub_calls("multiCall"), multicalls + 1);
+
+    /* closed tasks are cached */
+    task = get_koji_task(&ri, "1");
+    RI_ASSERT_PTR_NOT_NULL(task);
+    free_koji_task(task);
+    RI_ASSERT_EQUAL(hub_calls("getTaskInfo"), 1);
+    RI_ASSERT_EQUAL(hub_calls("getTaskDescendents"), 1);
+    RI_ASSERT_EQUAL(hub_calls("multiCall"), multicalls + 1);
+
+    free_hub_ri(&ri);
+}
+
+void test_get_all_arches(void) {
+    struct rpminspect ri;
+    string_list_t *arches = NULL;
+    string_entry_t *arch = NULL;
+    char *cached = NULL;
+    int n = 0;
+
+    init_hub_ri(&ri);
+
+    arches = get_all_arches(&ri);
+    RI_ASSERT_PTR_NOT_NULL(arches);
+
+    if (arches != NULL) {
+        TAILQ_FOREACH(arch, arches, items) {
+            n++;
+        }
+    }
+
+    /* src is always added */
+    RI_ASSERT_EQUAL(n, 4);
+    list_free(arches, free);
+    RI_ASSERT_EQUAL(hub_calls("getAllArches"), 1);
+
+    /* served from the cache */
+    arches = get_all_arches(&ri);
+    list_free(arches, free);
+    RI_ASSERT_EQUAL(hub_calls("getAllArches"), 1);
+
+    /* without a cache, every lookup goes to the hub */
+    cached = ri.cache_dir;
+    ri.cache_dir = NULL;
+    arches = get_all_arches(&ri);
+    list_free(arches, free);
+    RI_ASSERT_EQUAL(hub_calls("getAllArches"), 2);
+    ri.cache_dir = cached;
+
+    free_hub_ri(&ri);
+}
+
 CU_pSuite get_suite(void) {
     CU_pSuite pSuite = NULL;
 
@@ -55,7 +478,10 @@ CU_pSuite get_suite(void) {
 
     /* add tests to the suite */
     if (CU_add_test(pSuite, "test init_koji_build()", test_init_koji_build) == NULL ||
-        CU_add_test(pSuite, "test init_koji_rpmlist()", test_init_koji_rpmlist) == NULL) {
+        CU_add_test(pSuite, "test init_koji_rpmlist()", test_init_koji_rpmlist) == NULL ||
+        CU_add_test(pSuite, "test get_koji_build()", test_get_koji_build) == NULL ||
+        CU_add_test(pSuite, "test get_koji_task()", test_get_koji_task) == NULL ||
+        CU_add_test(pSuite, "test get_all_arches()", test_get_all_arches) == NULL) {
         return NULL;
     }
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+static const char *prefixes[] = {"/usr/bin", "/usr/", "/bin", NULL};
+static const char *suffixes[] = {".h", ".hpp", ".orig", NULL};
+
+int init_test_pathmatch(void) {
+    return 0;
+}
+
+int clean_test_pathmatch(void) {
+    return 0;
+}
+
+void test_match_path_prefix(void) {
+    string_list_t *list = list_from_array(prefixes);
+    path_matcher_t *matcher = compile_path_matcher(list, PATH_MATCH_PREFIX);
+
+    RI_ASSERT_PTR_NOT_NULL(matcher);
+
+    /* first listed rule wins, same as walking the list */
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "/usr/bin/ls"), "/usr/bin");
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "/usr/lib/libc.so"), "/usr/");
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "/bin/sh"), "/bin");
+    RI_ASSERT_TRUE(match_path(matcher, "/etc/passwd") == NULL);
+    RI_ASSERT_TRUE(match_path(matcher, "/us") == NULL);
+
+    free_path_matcher(matcher);
+    list_free(list, free);
+}
+
+void test_match_path_suffix(void) {
+    string_list_t *list = list_from_array(suffixes);
+    path_matcher_t *matcher = compile_path_matcher(list, PATH_MATCH_SUFFIX);
+
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "/usr/include/stdio.h"), ".h");
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "/usr/include/c++/vector.hpp"), ".hpp");
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "/etc/foo.conf.orig"), ".orig");
+    RI_ASSERT_TRUE(match_path(matcher, "/usr/include/stdio.c") == NULL);
+
+    free_path_matcher(matcher);
+    list_free(list, free);
+}
+
+void test_match_path_exact(void) {
+    string_list_t *list = list_from_array(prefixes);
+    path_matcher_t *matcher = compile_path_matcher(list, PATH_MATCH_EXACT);
+
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "/usr/bin"), "/usr/bin");
+    RI_ASSERT_TRUE(match_path(matcher, "/usr/bin/ls") == NULL);
+    RI_ASSERT_TRUE(match_path(matcher, "/usr") == NULL);
+
+    free_path_matcher(matcher);
+    list_free(list, free);
+}
+
+void test_match_path_rule(void) {
+    path_matcher_t *matcher = init_path_matcher(PATH_MATCH_PREFIX);
+
+    /* the key is matched, the rule is what comes back */
+    add_path_matcher_rule(matcher, "etc/sudoers.d/", "/etc/sudoers.d/");
+    RI_ASSERT_STRING_EQUAL(match_path(matcher, "etc/sudoers.d/wheel"), "/etc/sudoers.d/");
+    RI_ASSERT_TRUE(match_path(matcher, "/etc/sudoers.d/wheel") == NULL);
+    RI_ASSERT_TRUE(match_path(NULL, "/etc/sudoers.d/wheel") == NULL);
+
+    free_path_matcher(matcher);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("pathmatch", init_test_pathmatch, clean_test_pathmatch);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test match_path() prefix", test_match_path_prefix) == NULL ||
+        CU_add_test(pSuite, "test match_path() suffix", test_match_path_suffix) == NULL ||
+        CU_add_test(pSuite, "test match_path() exact", test_match_path_exact) == NULL ||
+        CU_add_test(pSuite, "test add_path_matcher_rule()", test_match_path_rule) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+/*
+ * A package with a signature header of 2 index entries and 5 bytes
+ * of data, padded to 56 bytes, then a main header of 3 index entries
+ * and 100 bytes of data, 164 bytes.  The header ends at 96 + 56 + 164.
+ */
+#define SIG_OFFSET 96
+#define MAIN_OFFSET (SIG_OFFSET + 56)
+#define HEADER_END (MAIN_OFFSET + 164)
+
+static char path[] = "/tmp/test-rpm.XXXXXX";
+static unsigned char pkg[HEADER_END + 200];
+
+static void put_intro(unsigned char *p, const uint32_t il, const uint32_t dl)
+{
+    p[0] = 0x8e;
+    p[1] = 0xad;
+    p[2] = 0xe8;
+    p[3] = 0x01;
+    p[8] = il >> 24;
+    p[9] = il >> 16;
+    p[10] = il >> 8;
+    p[11] = il;
+    p[12] = dl >> 24;
+    p[13] = dl >> 16;
+    p[14] = dl >> 8;
+    p[15] = dl;
+}
+
+/* Write the first len bytes of the package to the test file */
+static void write_pkg(const size_t len)
+{
+    FILE *fp = fopen(path, "w");
+
+    RI_ASSERT_PTR_NOT_NULL(fp);
+    RI_ASSERT_EQUAL(fwrite(pkg, 1, len, fp), len);
+    fclose(fp);
+}
+
+int init_test_rpm(void) {
+    int fd = mkstemp(path);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    close(fd);
+    memset(pkg, 0, sizeof(pkg));
+    pkg[0] = 0xed;
+    pkg[1] = 0xab;
+    pkg[2] = 0xee;
+    pkg[3] = 0xdb;
+    put_intro(pkg + SIG_OFFSET, 2, 5);
+    put_intro(pkg + MAIN_OFFSET, 3, 100);
+    return 0;
+}
+
+int clean_test_rpm(void) {
+    unlink(path);
+    return 0;
+}
+
+void test_get_rpm_header_end(void) {
+    off_t end = 0;
+
+    /* the whole package */
+    write_pkg(sizeof(pkg));
+    RI_ASSERT_EQUAL(get_rpm_header_end(path, &end), 1);
+    RI_ASSERT_EQUAL(end, HEADER_END);
+
+    /* exactly the headers */
+    write_pkg(HEADER_END);
+    RI_ASSERT_EQUAL(get_rpm_header_end(path, &end), 1);
+    RI_ASSERT_EQUAL(end, HEADER_END);
+
+    /* both intros but not all of the main header */
+    write_pkg(HEADER_END - 1);
+    RI_ASSERT_EQUAL(get_rpm_header_end(path, &end), 0);
+    RI_ASSERT_EQUAL(end, HEADER_END);
+
+    /* only the signature header, need the main intro */
+    write_pkg(MAIN_OFFSET);
+    RI_ASSERT_EQUAL(get_rpm_header_end(path, &end), 0);
+    RI_ASSERT_EQUAL(end, MAIN_OFFSET + 16);
+
+    /* only the lead */
+    write_pkg(SIG_OFFSET);
+    RI_ASSERT_EQUAL(get_rpm_header_end(path, &end), 0);
+    RI_ASSERT_EQUAL(end, SIG_OFFSET + 16);
+
+    /* not a package */
+    pkg[0] = 0;
+    write_pkg(sizeof(pkg));
+    RI_ASSERT_EQUAL(get_rpm_header_end(path, &end), -1);
+    pkg[0] = 0xed;
+
+    /* bad main header magic */
+    pkg[MAIN_OFFSET] = 0;
+    write_pkg(sizeof(pkg));
+    RI_ASSERT_EQUAL(get_rpm_header_end(path, &end), -1);
+    pkg[MAIN_OFFSET] = 0x8e;
+
+    RI_ASSERT_EQUAL(get_rpm_header_end("/nonexistent/test.rpm", &end), -1);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("rpm", init_test_rpm, clean_test_rpm);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test get_rpm_header_end()", test_get_rpm_header_end) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
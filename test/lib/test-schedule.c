@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+static int ninspections = 0;
+
+int init_test_schedule(void) {
+    while (inspections[ninspections].flag != 0) {
+        ninspections++;
+    }
+
+    return 0;
+}
+
+int clean_test_schedule(void) {
+    return 0;
+}
+
+static int find_inspection(const uint64_t flag) {
+    int i = 0;
+
+    for (i = 0; inspections[i].flag != 0; i++) {
+        if (inspections[i].flag == flag) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void test_get_order_policy(void) {
+    order_policy_t policy = ORDER_TABLE;
+
+    RI_ASSERT_TRUE(get_order_policy("expensive", &policy));
+    RI_ASSERT_EQUAL(policy, ORDER_EXPENSIVE);
+    RI_ASSERT_TRUE(get_order_policy("Cheapest", &policy));
+    RI_ASSERT_EQUAL(policy, ORDER_CHEAPEST);
+    RI_ASSERT_TRUE(get_order_policy("table", &policy));
+    RI_ASSERT_EQUAL(policy, ORDER_TABLE);
+    RI_ASSERT_FALSE(get_order_policy("fastest", &policy));
+    RI_ASSERT_FALSE(get_order_policy(NULL, &policy));
+    RI_ASSERT_EQUAL(policy, ORDER_TABLE);
+}
+
+void test_inspection_cost(void) {
+    struct rpminspect ri;
+    workload_t metadata;
+    workload_t elf;
+    int annocheck = find_inspection(INSPECT_ANNOCHECK);
+    int license = find_inspection(INSPECT_LICENSE);
+
+    memset(&ri, 0, sizeof(ri));
+    memset(&metadata, 0, sizeof(metadata));
+    metadata.packages = 4;
+    metadata.files = 1000;
+
+    elf = metadata;
+    elf.read_files = 100;
+    elf.read_bytes = 100 * 1024 * 1024;
+    elf.elf = 100;
+
+    /* reading files costs more than listing them */
+    RI_ASSERT(inspection_cost(&ri, annocheck, &elf) > inspection_cost(&ri, annocheck, &metadata));
+    RI_ASSERT(inspection_cost(&ri, annocheck, &elf) > inspection_cost(&ri, license, &elf));
+
+    /* no annocheck tests configured, no commands */
+    RI_ASSERT_EQUAL(inspection_commands(&ri, annocheck, &elf), 0);
+    RI_ASSERT_EQUAL(inspection_commands(&ri, license, &elf), 0);
+}
+
+void test_order_by_cost(void) {
+    uint64_t *costs = NULL;
+    int *order = NULL;
+    int i = 0;
+
+    costs = calloc(ninspections, sizeof(*costs));
+    RI_ASSERT_PTR_NOT_NULL(costs);
+
+    /* everything costs the same but the last two */
+    for (i = 0; i < ninspections; i++) {
+        costs[i] = 10;
+    }
+
+    costs[ninspections - 1] = 30;
+    costs[ninspections - 2] = 20;
+
+    order = order_by_cost(ORDER_EXPENSIVE, costs);
+    RI_ASSERT_EQUAL(order[0], ninspections - 1);
+    RI_ASSERT_EQUAL(order[1], ninspections - 2);
+
+    /* ties stay in table order */
+    for (i = 2; i < ninspections; i++) {
+        RI_ASSERT_EQUAL(order[i], i - 2);
+    }
+
+    RI_ASSERT_EQUAL(order[ninspections], -1);
+    free(order);
+
+    order = order_by_cost(ORDER_CHEAPEST, costs);
+
+    for (i = 0; i < ninspections - 2; i++) {
+        RI_ASSERT_EQUAL(order[i], i);
+    }
+
+    RI_ASSERT_EQUAL(order[ninspections - 2], ninspections - 2);
+    RI_ASSERT_EQUAL(order[ninspections - 1], ninspections - 1);
+    RI_ASSERT_EQUAL(order[ninspections], -1);
+    free(order);
+
+    order = order_by_cost(ORDER_TABLE, costs);
+
+    for (i = 0; i < ninspections; i++) {
+        RI_ASSERT_EQUAL(order[i], i);
+    }
+
+    free(order);
+    free(costs);
+}
+
+void test_run_order(void) {
+    struct rpminspect ri;
+    int *order = NULL;
+    int kmod = find_inspection(INSPECT_KMOD);
+    int i = 0;
+
+    memset(&ri, 0, sizeof(ri));
+    ri.tests = INSPECT_KMOD | INSPECT_LICENSE;
+    ri.before = "before";
+
+    /* without an order, the inspections run in table order */
+    RI_ASSERT_EQUAL(inspection_at(&ri, 0), 0);
+    RI_ASSERT_EQUAL(inspection_at(&ri, ninspections - 1), ninspections - 1);
+    RI_ASSERT_EQUAL(inspection_at(&ri, ninspections), -1);
+    RI_ASSERT_EQUAL(remaining_payload_files(&ri, kmod + 1), FILES_NONE);
+
+    /* run kmod first, then everything else */
+    order = calloc(ninspections + 1, sizeof(*order));
+    RI_ASSERT_PTR_NOT_NULL(order);
+    order[0] = kmod;
+
+    for (i = 0; i < ninspections; i++) {
+        if (i != kmod) {
+            order[(i < kmod) ? i + 1 : i] = i;
+        }
+    }
+
+    order[ninspections] = -1;
+    ri.order = order;
+
+    RI_ASSERT_EQUAL(inspection_at(&ri, 0), kmod);
+    RI_ASSERT_EQUAL(inspection_at(&ri, ninspections), -1);
+    RI_ASSERT_EQUAL(remaining_payload_files(&ri, 0), FILES_KMODS);
+    RI_ASSERT_EQUAL(remaining_payload_files(&ri, 1), FILES_NONE);
+
+    free(order);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("schedule", init_test_schedule, clean_test_schedule);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test get_order_policy()", test_get_order_policy) == NULL) {
+        return NULL;
+    }
+
+    if (CU_add_test(pSuite, "test inspection_cost()", test_inspection_cost) == NULL) {
+        return NULL;
+    }
+
+    if (CU_add_test(pSuite, "test order_by_cost()", test_order_by_cost) == NULL) {
+        return NULL;
+    }
+
+    if (CU_add_test(pSuite, "test run order", test_run_order) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
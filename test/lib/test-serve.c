@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+int init_test_serve(void) {
+    return 0;
+}
+
+int clean_test_serve(void) {
+    return 0;
+}
+
+/* Check that a request is rejected with an error message */
+static void check_invalid(const char *request)
+{
+    serve_job_t job;
+    char *error = NULL;
+
+    RI_ASSERT_FALSE(parse_serve_job(request, &job, &error));
+    RI_ASSERT_PTR_NOT_NULL(error);
+    RI_ASSERT_PTR_NULL(job.argv);
+    free(error);
+    free_serve_job(&job);
+}
+
+void test_parse_serve_job(void) {
+    serve_job_t job;
+    char *error = NULL;
+
+    /* a comparison with every member */
+    RI_ASSERT_TRUE(parse_serve_job("{\"before\": \"zsh-5.8-1.fc33\", \"after\": \"zsh-5.8-2.fc33\", \"tests\": \"license,elf\", \"arches\": \"x86_64\", \"release\": \"fc33\", \"threshold\": \"bad\"}\n", &job, &error));
+    RI_ASSERT_PTR_NULL(error);
+    RI_ASSERT_STRING_EQUAL(job.before, "zsh-5.8-1.fc33");
+    RI_ASSERT_STRING_EQUAL(job.after, "zsh-5.8-2.fc33");
+    RI_ASSERT_EQUAL(job.argc, 13);
+    RI_ASSERT_PTR_NULL(job.argv[job.argc]);
+    RI_ASSERT_STRING_EQUAL(job.argv[0], "rpminspect");
+    RI_ASSERT_STRING_EQUAL(job.argv[1], "-T");
+    RI_ASSERT_STRING_EQUAL(job.argv[2], "license,elf");
+    RI_ASSERT_STRING_EQUAL(job.argv[9], "-F");
+    RI_ASSERT_STRING_EQUAL(job.argv[10], "json");
+    RI_ASSERT_EQUAL(job.builds, 11);
+    RI_ASSERT_STRING_EQUAL(job.argv[11], "zsh-5.8-1.fc33");
+    RI_ASSERT_STRING_EQUAL(job.argv[12], "zsh-5.8-2.fc33");
+    free_serve_job(&job);
+    RI_ASSERT_PTR_NULL(job.argv);
+
+    /* a single build */
+    RI_ASSERT_TRUE(parse_serve_job("{\"after\": \"zsh-5.8-2.fc33\", \"exclude\": \"abidiff\"}", &job, &error));
+    RI_ASSERT_EQUAL(job.argc, 6);
+    RI_ASSERT_STRING_EQUAL(job.argv[1], "-E");
+    RI_ASSERT_STRING_EQUAL(job.argv[2], "abidiff");
+    RI_ASSERT_EQUAL(job.builds, 5);
+    RI_ASSERT_STRING_EQUAL(job.argv[5], "zsh-5.8-2.fc33");
+    free_serve_job(&job);
+
+    check_invalid("zsh-5.8-2.fc33");
+    check_invalid("[\"zsh-5.8-2.fc33\"]");
+    check_invalid("{\"before\": \"zsh-5.8-1.fc33\"}");
+    check_invalid("{\"after\": \"zsh-5.8-2.fc33\", \"output\": \"/etc/passwd\"}");
+    check_invalid("{\"after\": 1}");
+    check_invalid("{\"after\": \"zsh-5.8-2.fc33\", \"tests\": \"elf\", \"exclude\": \"abidiff\"}");
+    check_invalid("{\"after\": \"zsh-5.8-2.fc33\", \"threshold\": \"bogus\"}");
+
+    /* freeing an empty job is fine */
+    memset(&job, 0, sizeof(job));
+    free_serve_job(&job);
+    free_serve_job(NULL);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("serve", init_test_serve, clean_test_serve);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test parse_serve_job()", test_parse_serve_job) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
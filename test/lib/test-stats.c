@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+int init_test_stats(void) {
+    return 0;
+}
+
+int clean_test_stats(void) {
+    return 0;
+}
+
+void test_end_stats(void) {
+    struct rpminspect ri;
+    stats_mark_t mark;
+    stats_entry_t *entry = NULL;
+    int i = 0;
+
+    memset(&ri, 0, sizeof(ri));
+
+    /* without --stats nothing is collected */
+    start_stats(&ri, &mark);
+    end_stats(&ri, &mark, STATS_PHASE, "download");
+    RI_ASSERT_PTR_NULL(ri.stats);
+
+    ri.stats = init_stats();
+
+    for (i = 0; i < 3; i++) {
+        start_stats(&ri, &mark);
+        count_file_visit();
+        count_file_visit();
+        count_subprocess();
+        end_stats(&ri, &mark, STATS_INSPECTION, "elf");
+    }
+
+    start_stats(&ri, &mark);
+    end_stats(&ri, &mark, STATS_PHASE, "elf");
+
+    /* one entry per kind and name */
+    entry = TAILQ_FIRST(ri.stats);
+    RI_ASSERT_PTR_NOT_NULL(entry);
+    RI_ASSERT_STRING_EQUAL(entry->name, "elf");
+    RI_ASSERT_EQUAL(entry->kind, STATS_INSPECTION);
+    RI_ASSERT_EQUAL(entry->count, 3);
+    RI_ASSERT_EQUAL(entry->files, 6);
+    RI_ASSERT_EQUAL(entry->subprocesses, 3);
+    RI_ASSERT_TRUE(entry->wall >= 0.0);
+
+    entry = TAILQ_NEXT(entry, items);
+    RI_ASSERT_PTR_NOT_NULL(entry);
+    RI_ASSERT_EQUAL(entry->kind, STATS_PHASE);
+    RI_ASSERT_EQUAL(entry->count, 1);
+    RI_ASSERT_EQUAL(entry->files, 0);
+    RI_ASSERT_PTR_NULL(TAILQ_NEXT(entry, items));
+
+    free_stats(ri.stats);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("stats", init_test_stats, clean_test_stats);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test end_stats()", test_end_stats) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+#define SPANS_PER_THREAD 100
+
+static char *tracefile = NULL;
+
+int init_test_trace(void) {
+    int fd = -1;
+
+    tracefile = strdup("/tmp/test-trace.XXXXXX");
+    fd = mkstemp(tracefile);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+int clean_test_trace(void) {
+    if (tracefile != NULL) {
+        unlink(tracefile);
+        free(tracefile);
+    }
+
+    return 0;
+}
+
+static void *record_spans(__attribute__((unused)) void *arg)
+{
+    uint64_t span = 0;
+    int i = 0;
+
+    for (i = 0; i < SPANS_PER_THREAD; i++) {
+        span = trace_start();
+        trace_end(span, "test", "span", "a \"quoted\"\tdetail");
+    }
+
+    return NULL;
+}
+
+/* Count the occurrences of needle in the trace file */
+static int count_in_file(const char *needle)
+{
+    FILE *fp = NULL;
+    char *line = NULL;
+    size_t n = 0;
+    char *s = NULL;
+    int count = 0;
+
+    fp = fopen(tracefile, "r");
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    while (getline(&line, &n, fp) != -1) {
+        for (s = strstr(line, needle); s != NULL; s = strstr(s + 1, needle)) {
+            count++;
+        }
+    }
+
+    free(line);
+    fclose(fp);
+    return count;
+}
+
+void test_trace(void) {
+    pthread_t threads[4];
+    uint64_t span = 0;
+    int i = 0;
+
+    /* nothing is recorded before tracing starts */
+    RI_ASSERT_EQUAL(trace_start(), 0);
+
+    RI_ASSERT_TRUE(init_trace(tracefile, 1000000));
+
+    for (i = 0; i < 4; i++) {
+        RI_ASSERT_EQUAL(pthread_create(&threads[i], NULL, record_spans, NULL), 0);
+    }
+
+    for (i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* under the threshold */
+    span = trace_start();
+    RI_ASSERT_NOT_EQUAL(span, 0);
+    trace_end_slow(span, "test", "fast", NULL);
+
+    finish_trace();
+    RI_ASSERT_EQUAL(trace_start(), 0);
+
+    RI_ASSERT_EQUAL(count_in_file("\"ph\":\"X\""), 4 * SPANS_PER_THREAD);
+    RI_ASSERT_EQUAL(count_in_file("\"detail\":\"a \\\"quoted\\\"\\u0009detail\""), 4 * SPANS_PER_THREAD);
+    RI_ASSERT_EQUAL(count_in_file("\"fast\""), 0);
+    RI_ASSERT_EQUAL(count_in_file("\"dropped\":0}}"), 1);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("trace", init_test_trace, clean_test_trace);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test trace", test_trace) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
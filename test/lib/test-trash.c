@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2020  Red Hat, Inc.
+ * Author(s):  David Cantrell <dcantrell@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <CUnit/Basic.h>
+#include "rpminspect.h"
+
+#include "test-main.h"
+
+static char *tmpdir = NULL;
+
+int init_test_trash(void) {
+    tmpdir = strdup("/tmp/test-trash.XXXXXX");
+
+    if (mkdtemp(tmpdir) == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int clean_test_trash(void) {
+    if (tmpdir != NULL) {
+        rmtree(tmpdir, true, false);
+        free(tmpdir);
+    }
+
+    return 0;
+}
+
+/*
+ * Make a working directory like the one for a run, with a few
+ * extracted package trees holding files, symlinks, and directories.
+ */
+static char *make_tree(const char *name)
+{
+    char *top = NULL;
+    char *path = NULL;
+    FILE *fp = NULL;
+    const char *builds[] = { "before", "after" };
+    int b, p, f;
+
+    xasprintf(&top, "%s/%s", tmpdir, name);
+
+    for (b = 0; b < 2; b++) {
+        for (p = 0; p < 4; p++) {
+            xasprintf(&path, "%s/%s/x86_64/pkg%d/usr/share/doc/pkg%d", top, builds[b], p, p);
+            assert(mkdirp(path, S_IRWXU) == 0);
+
+            for (f = 0; f < 8; f++) {
+                free(path);
+                xasprintf(&path, "%s/%s/x86_64/pkg%d/usr/share/doc/pkg%d/file%d", top, builds[b], p, p, f);
+                fp = fopen(path, "w");
+                assert(fp != NULL);
+                fprintf(fp, "%s\n", path);
+                fclose(fp);
+            }
+
+            free(path);
+            xasprintf(&path, "%s/%s/x86_64/pkg%d/usr/share/doc/link", top, builds[b], p);
+            assert(symlink("/nonexistent", path) == 0);
+            free(path);
+
+            xasprintf(&path, "%s/%s/x86_64/pkg%d.rpm", top, builds[b], p);
+            fp = fopen(path, "w");
+            assert(fp != NULL);
+            fclose(fp);
+            free(path);
+            path = NULL;
+        }
+    }
+
+    return top;
+}
+
+/* Return the number of entries in a directory, or -1 if it is gone */
+static int count_entries(const char *path)
+{
+    DIR *dir = NULL;
+    struct dirent *de = NULL;
+    int n = 0;
+
+    dir = opendir(path);
+
+    if (dir == NULL) {
+        return -1;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") && strcmp(de->d_name, "..")) {
+            n++;
+        }
+    }
+
+    closedir(dir);
+    return n;
+}
+
+/* Wait up to ten seconds for a directory to have n entries */
+static int wait_entries(const char *path, const int n)
+{
+    int i = 0;
+
+    for (i = 0; i < 100 && count_entries(path) != n; i++) {
+        usleep(100000);
+    }
+
+    return count_entries(path);
+}
+
+void test_rmtree_parallel(void) {
+    char *top = NULL;
+
+    top = make_tree("parallel");
+    RI_ASSERT_EQUAL(rmtree_parallel(top, false, 3), 0);
+    RI_ASSERT_EQUAL(access(top, F_OK), -1);
+    free(top);
+
+    /* keep the top directory */
+    top = make_tree("contents");
+    RI_ASSERT_EQUAL(rmtree_parallel(top, true, 0), 0);
+    RI_ASSERT_EQUAL(count_entries(top), 0);
+    RI_ASSERT_EQUAL(rmdir(top), 0);
+    free(top);
+}
+
+void test_trash_tree(void) {
+    struct rpminspect ri;
+    char *top = NULL;
+    char *trash = NULL;
+
+    memset(&ri, 0, sizeof(ri));
+    ri.workdir = tmpdir;
+    xasprintf(&trash, "%s/%s", tmpdir, TRASH_DIR);
+
+    ri.teardown = TEARDOWN_INLINE;
+    top = make_tree("inline");
+    RI_ASSERT_EQUAL(trash_tree(&ri, top), 0);
+    RI_ASSERT_EQUAL(access(top, F_OK), -1);
+    free(top);
+
+    ri.teardown = TEARDOWN_PARALLEL;
+    top = make_tree("parallel");
+    RI_ASSERT_EQUAL(trash_tree(&ri, top), 0);
+    RI_ASSERT_EQUAL(access(top, F_OK), -1);
+    RI_ASSERT_EQUAL(count_entries(trash), 0);
+    free(top);
+
+    /* the entry is gone once the background removal is done */
+    ri.teardown = TEARDOWN_BACKGROUND;
+    top = make_tree("background");
+    RI_ASSERT_EQUAL(trash_tree(&ri, top), 0);
+    RI_ASSERT_EQUAL(access(top, F_OK), -1);
+    RI_ASSERT_EQUAL(wait_entries(trash, 0), 0);
+    free(top);
+
+    RI_ASSERT_EQUAL(trash_tree(&ri, NULL), 0);
+    free(trash);
+}
+
+void test_empty_trash(void) {
+    struct rpminspect ri;
+    char *top = NULL;
+    char *trash = NULL;
+    char *dest = NULL;
+    char *busy = NULL;
+    int fd = -1;
+
+    memset(&ri, 0, sizeof(ri));
+    ri.workdir = tmpdir;
+    ri.teardown = TEARDOWN_PARALLEL;
+
+    /* what an interrupted run leaves behind */
+    xasprintf(&trash, "%s/%s", tmpdir, TRASH_DIR);
+    RI_ASSERT_EQUAL(mkdirp(trash, S_IRWXU), 0);
+    xasprintf(&dest, "%s/abcdef", trash);
+
+    top = make_tree("leftover");
+    RI_ASSERT_EQUAL(rename(top, dest), 0);
+    RI_ASSERT_EQUAL(count_entries(trash), 1);
+
+    /* it is removed in the background */
+    empty_trash(&ri);
+    RI_ASSERT_EQUAL(wait_entries(trash, 0), 0);
+
+    /* nothing to do */
+    empty_trash(&ri);
+    RI_ASSERT_EQUAL(count_entries(trash), 0);
+
+    /* an entry another run is still removing is left alone */
+    free(top);
+    top = make_tree("busy");
+    xasprintf(&busy, "%s/ghijkl", trash);
+    RI_ASSERT_EQUAL(rename(top, busy), 0);
+    fd = open(busy, O_RDONLY | O_DIRECTORY);
+    RI_ASSERT_TRUE(fd != -1);
+    RI_ASSERT_EQUAL(flock(fd, LOCK_EX), 0);
+
+    empty_trash(&ri);
+    sleep(1);
+    RI_ASSERT_EQUAL(count_entries(trash), 1);
+
+    /* until that run is gone */
+    close(fd);
+    empty_trash(&ri);
+    RI_ASSERT_EQUAL(wait_entries(trash, 0), 0);
+
+    free(top);
+    free(dest);
+    free(busy);
+    free(trash);
+}
+
+CU_pSuite get_suite(void) {
+    CU_pSuite pSuite = NULL;
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("trash", init_test_trash, clean_test_trash);
+    if (pSuite == NULL) {
+        return NULL;
+    }
+
+    /* add tests to the suite */
+    if (CU_add_test(pSuite, "test rmtree_parallel()", test_rmtree_parallel) == NULL ||
+        CU_add_test(pSuite, "test trash_tree()", test_trash_tree) == NULL ||
+        CU_add_test(pSuite, "test empty_trash()", test_empty_trash) == NULL) {
+        return NULL;
+    }
+
+    return pSuite;
+}
@@ -0,0 +1,60 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+# Author(s):  David Cantrell <dcantrell@redhat.com>
+#             Jim Bair <jbair@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import os
+from baseclass import TestRPMs, TestCompareRPMs
+
+# rpmfluff has no way to set file capabilities, so install a small
+# script and list it with %caps in the spec file
+def add_caps_file(rpm, path, caps):
+    rpm.section_install += 'mkdir -p $RPM_BUILD_ROOT%s\n' % os.path.dirname(path)
+    rpm.section_install += 'printf "#!/bin/sh\\nexit 0\\n" > $RPM_BUILD_ROOT%s\n' % path
+    rpm.section_install += 'chmod 0755 $RPM_BUILD_ROOT%s\n' % path
+    rpm.get_subpackage(None).section_files += '%%caps(%s) %s\n' % (caps, path)
+
+class CapsNotOnWhitelistRPMs(TestRPMs):
+    """
+    Run only the capabilities inspection on a package with a file that
+    has capabilities but is not on the capabilities whitelist, which
+    fails.  The payload is not extracted for this inspection, so the
+    capabilities have to come from the package header.
+    """
+    def setUp(self):
+        TestRPMs.setUp(self)
+        add_caps_file(self.rpm, '/usr/bin/pinger', 'cap_net_raw=ep')
+
+        self.inspection = 'capabilities'
+        self.label = 'capabilities'
+        self.result = 'BAD'
+        self.waiver_auth = 'Security'
+
+class CapsChangedCompareRPMs(TestCompareRPMs):
+    """
+    Run only the capabilities inspection on two builds where the
+    capabilities of a file changed, which needs verification.
+    """
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        add_caps_file(self.before_rpm, '/usr/bin/pinger', 'cap_net_raw=ep')
+        add_caps_file(self.after_rpm, '/usr/bin/pinger', 'cap_net_admin,cap_net_raw=ep')
+
+        self.inspection = 'capabilities'
+        self.label = 'capabilities'
+        self.result = 'VERIFY'
+        self.waiver_auth = 'Security'
@@ -0,0 +1,93 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+# Author(s):  David Cantrell <dcantrell@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import json
+import shutil
+import subprocess
+import rpmfluff
+from baseclass import RequiresRpminspect, BEFORE_NAME, BEFORE_VER, BEFORE_REL, AFTER_NAME, AFTER_VER, AFTER_REL
+
+INSPECTION_KEYS = ['files', 'files read', 'bytes read', 'elf', 'java', 'kmods', 'scripts', 'commands', 'time']
+TOTAL_KEYS = ['inspections', 'packages', 'package bytes', 'gather time', 'inspection time', 'total time', 'disk bytes', 'calibration']
+
+# Base test case class that runs --estimate on before and after builds
+class TestEstimate(RequiresRpminspect):
+    def setUp(self):
+        RequiresRpminspect.setUp(self)
+        self.before_rpm = rpmfluff.SimpleRpmBuild(BEFORE_NAME, BEFORE_VER, BEFORE_REL)
+        self.after_rpm = rpmfluff.SimpleRpmBuild(AFTER_NAME, AFTER_VER, AFTER_REL)
+
+        # turn off all rpmbuild post processing stuff for the purposes of testing
+        self.before_rpm.header += "\n%global __os_install_post %{nil}\n"
+        self.after_rpm.header += "\n%global __os_install_post %{nil}\n"
+
+        # an ELF executable and a data file in each build
+        for rpm in [self.before_rpm, self.after_rpm]:
+            rpm.add_simple_compilation()
+            rpm.add_installed_file("/usr/share/data/estimate.txt", rpmfluff.SourceFile("estimate.txt", "estimate\n" * 1024))
+
+        self.before_rpm.do_make()
+        self.after_rpm.do_make()
+        self.configFile()
+
+    def estimate(self, builds):
+        args = [self.rpminspect, '-c', self.conffile, '-F', 'json', '-r', 'GENERIC', '--estimate'] + builds
+        self.p = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        (self.out, self.err) = self.p.communicate()
+        self.inspection = '--estimate'
+
+        if self.p.returncode != 0:
+            self.dumpResults()
+
+        self.assertEqual(self.p.returncode, 0)
+        self.results = json.loads(self.out)
+
+        # every key is there
+        for key in TOTAL_KEYS:
+            self.assertIn(key, self.results)
+
+        self.assertTrue(len(self.results['inspections']) > 0)
+
+        for name, workload in self.results['inspections'].items():
+            for key in INSPECTION_KEYS:
+                self.assertIn(key, workload)
+
+        # and the packages were counted
+        self.assertEqual(self.results['packages'], len(builds))
+        self.assertTrue(self.results['package bytes'] > 0)
+        self.assertTrue(self.results['total time'] > 0)
+        self.assertTrue(any(w['files'] > 0 for w in self.results['inspections'].values()))
+        self.assertTrue(any(w['files read'] > 0 and w['bytes read'] > 0 for w in self.results['inspections'].values()))
+        self.assertTrue(any(w['elf'] > 0 for w in self.results['inspections'].values()))
+
+    def tearDown(self):
+        RequiresRpminspect.tearDown(self)
+        shutil.rmtree(self.before_rpm.get_base_dir(), ignore_errors=True)
+        shutil.rmtree(self.after_rpm.get_base_dir(), ignore_errors=True)
+
+# Estimate a single build
+class EstimateSingleBuild(TestEstimate):
+    def runTest(self):
+        for a in self.after_rpm.get_build_archs():
+            self.estimate([self.after_rpm.get_built_rpm(a)])
+
+# Estimate comparing a before and after build
+class EstimateCompareBuilds(TestEstimate):
+    def runTest(self):
+        for a in self.after_rpm.get_build_archs():
+            self.estimate([self.before_rpm.get_built_rpm(a), self.after_rpm.get_built_rpm(a)])
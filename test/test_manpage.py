@@ -257,3 +257,34 @@ class InvalidManPageCompareKoji(TestCompareKoji):
         self.label = 'man-pages'
         self.result = 'VERIFY'
         self.waiver_auth = 'Anyone'
+
+# Invalid man page syntax in RPM with lazy extraction (VERIFY)
+class InvalidManPageLazyRPM(TestRPMs):
+    def setUp(self):
+        TestRPMs.setUp(self)
+        self.extract = 'lazy'
+
+        # add a bad man page
+        self.rpm.add_installed_file('/usr/share/man/man1/foo.1.gz', rpmfluff.GeneratedSourceFile('foo.1', rpmfluff.make_png()))
+
+        # the test
+        self.inspection = 'manpage'
+        self.label = 'man-pages'
+        self.result = 'VERIFY'
+        self.waiver_auth = 'Anyone'
+
+# Invalid man page syntax in compare RPMs with lazy extraction (VERIFY)
+class InvalidManPageLazyCompareRPMs(TestCompareRPMs):
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        self.extract = 'lazy'
+
+        # add a bad man page
+        self.before_rpm.add_installed_file('/usr/share/man/man1/foo.1.gz', rpmfluff.GeneratedSourceFile('foo.1', rpmfluff.make_png()))
+        self.after_rpm.add_installed_file('/usr/share/man/man1/foo.1.gz', rpmfluff.GeneratedSourceFile('foo.1', rpmfluff.make_png()))
+
+        # the test
+        self.inspection = 'manpage'
+        self.label = 'man-pages'
+        self.result = 'VERIFY'
+        self.waiver_auth = 'Anyone'
@@ -0,0 +1,43 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+# Author(s):  David Cantrell <dcantrell@redhat.com>
+#             Jim Bair <jbair@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import os
+from baseclass import TestCompareRPMs
+
+# rpmfluff cannot add special files, so create the FIFO in %install
+def add_fifo(rpm, path):
+    rpm.section_install += 'mkdir -p $RPM_BUILD_ROOT%s\n' % os.path.dirname(path)
+    rpm.section_install += 'mkfifo -m 0666 $RPM_BUILD_ROOT%s\n' % path
+    rpm.get_subpackage(None).section_files += '%%attr(0666,-,-) %s\n' % path
+
+class WorldWritableFifoCompareRPMs(TestCompareRPMs):
+    """
+    A world-writable FIFO is reported as world-writable.  Only regular
+    files are extracted for the permissions inspection, so this also
+    checks that files which were not extracted can be reported.
+    """
+    def setUp(self):
+        TestCompareRPMs.setUp(self)
+        add_fifo(self.before_rpm, '/var/lib/fifotest/pipe')
+        add_fifo(self.after_rpm, '/var/lib/fifotest/pipe')
+
+        self.inspection = 'permissions'
+        self.label = 'permissions'
+        self.result = 'BAD'
+        self.waiver_auth = 'Security'
@@ -0,0 +1,119 @@
+#
+# Copyright (C) 2020  Red Hat, Inc.
+# Author(s):  David Cantrell <dcantrell@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import json
+import os
+import shutil
+import socket
+import stat
+import subprocess
+import tempfile
+import time
+import rpmfluff
+from baseclass import RequiresRpminspect, AFTER_NAME, AFTER_VER, AFTER_REL
+
+# Base test case class that runs jobs on an rpminspect --serve server
+class TestServe(RequiresRpminspect):
+    def setUp(self):
+        RequiresRpminspect.setUp(self)
+        self.configFile()
+
+        self.tmpdir = tempfile.mkdtemp()
+        self.sock = os.path.join(self.tmpdir, 'rpminspect.sock')
+        self.p = subprocess.Popen([self.rpminspect, '-c', self.conffile, '--serve=' + self.sock],
+                                  stdout=subprocess.PIPE,
+                                  stderr=subprocess.PIPE)
+
+        # wait for the server to listen
+        for i in range(100):
+            if os.path.exists(self.sock) or self.p.poll() is not None:
+                break
+
+            time.sleep(0.1)
+
+        self.assertTrue(os.path.exists(self.sock))
+
+    def sendJob(self, request):
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.connect(self.sock)
+        s.sendall(request.encode('utf-8') + b'\n')
+        response = b''
+
+        while True:
+            data = s.recv(4096)
+
+            if not data:
+                break
+
+            response += data
+
+        s.close()
+        return json.loads(response)
+
+    def tearDown(self):
+        self.p.terminate()
+        self.p.communicate()
+        shutil.rmtree(self.tmpdir, ignore_errors=True)
+        RequiresRpminspect.tearDown(self)
+
+class SocketIsPrivateServe(TestServe):
+    """
+    Only the user running the server can connect to the socket.
+    """
+    def runTest(self):
+        self.assertEqual(stat.S_IMODE(os.stat(self.sock).st_mode), 0o600)
+
+class InvalidRequestServe(TestServe):
+    """
+    A request that cannot be parsed gets an error back.
+    """
+    def runTest(self):
+        self.assertIn('error', self.sendJob('not a job'))
+        self.assertIn('error', self.sendJob('{"after": "x", "threshold": "bogus"}'))
+
+class FailedJobServe(TestServe):
+    """
+    A job that fails once it has started still gets an error back,
+    with the reason the job gave.
+    """
+    def runTest(self):
+        response = self.sendJob('{"after": "x", "tests": "bogus"}')
+        self.assertIn('error', response)
+        self.assertIn('bogus', response['error'])
+
+class SuccessfulJobServe(TestServe):
+    """
+    A job that runs gets the results in the JSON output format.
+    """
+    def setUp(self):
+        TestServe.setUp(self)
+        self.rpm = rpmfluff.SimpleRpmBuild(AFTER_NAME, AFTER_VER, AFTER_REL)
+        self.rpm.header += "\n%global __os_install_post %{nil}\n"
+
+    def runTest(self):
+        self.rpm.do_make()
+
+        for a in self.rpm.get_build_archs():
+            job = {'after': self.rpm.get_built_rpm(a), 'tests': 'license', 'release': 'GENERIC'}
+            response = self.sendJob(json.dumps(job))
+            self.assertNotIn('error', response)
+            self.assertIn('license', response)
+
+    def tearDown(self):
+        shutil.rmtree(self.rpm.get_base_dir(), ignore_errors=True)
+        TestServe.tearDown(self)